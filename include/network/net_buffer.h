@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+namespace ToolBox
+{
+
+    /*
+    * @brief 引用计数的预成帧发送缓冲区.
+    * 内存布局为 [NetBuffer 头][uint32 长度头][payload],长度头的位置在申请时就预留好,
+    * 逻辑线程直接把数据写到 Data() 中,网络线程拿到后不再拷贝到发送 ringbuffer, 直接交给 writev 发送.
+    * 引用计数为原子变量,同一个缓冲区可以被多个连接/多个网络线程共享,最后一个 Release 的线程负责释放内存.
+    */
+    class NetBuffer
+    {
+    public:
+        /*
+        * @brief 申请一个缓冲区,引用计数初始为 1
+        * @param capacity payload 的最大容量(不含长度头)
+        */
+        static NetBuffer* Create(uint32_t capacity)
+        {
+            char* block = new char[sizeof(NetBuffer) + sizeof(uint32_t) + capacity];
+            return new (block) NetBuffer(capacity);
+        }
+        /*
+        * @brief 申请一个缓冲区并拷贝数据,引用计数初始为 1
+        * @param data 数据指针
+        * @param size 数据长度
+        */
+        static NetBuffer* Create(const char* data, uint32_t size)
+        {
+            NetBuffer* buffer = Create(size);
+            memcpy(buffer->Data(), data, size);
+            buffer->SetSize(size);
+            return buffer;
+        }
+        /*
+        * @brief 拷贝一段已经带有长度头的完整帧,引用计数初始为 1
+        * @param frame 帧数据指针[长度头 + payload]
+        * @param frame_size 帧长度,不小于长度头
+        */
+        static NetBuffer* CreateFrame(const char* frame, uint32_t frame_size)
+        {
+            if (frame_size < sizeof(uint32_t))
+            {
+                return Create(0);
+            }
+            NetBuffer* buffer = Create(frame_size - sizeof(uint32_t));
+            memcpy(buffer->Frame(), frame, frame_size);
+            buffer->size_ = frame_size - sizeof(uint32_t);
+            return buffer;
+        }
+        /*
+        * @brief 增加引用
+        */
+        void AddRef(uint32_t count = 1)
+        {
+            ref_count_.fetch_add(count, std::memory_order_relaxed);
+        }
+        /*
+        * @brief 减少引用,引用为 0 时释放内存
+        */
+        void Release()
+        {
+            if (1 == ref_count_.fetch_sub(1, std::memory_order_acq_rel))
+            {
+                this->~NetBuffer();
+                delete[] reinterpret_cast<char*>(this);
+            }
+        }
+        /*
+        * @brief 获取当前引用计数[仅用于调试与统计]
+        */
+        uint32_t RefCount() const
+        {
+            return ref_count_.load(std::memory_order_relaxed);
+        }
+        /*
+        * @brief payload 写入位置
+        */
+        char* Data()
+        {
+            return Frame() + sizeof(uint32_t);
+        }
+        /*
+        * @brief payload 容量
+        */
+        uint32_t Capacity() const
+        {
+            return capacity_;
+        }
+        /*
+        * @brief 设置 payload 的实际长度,同时写入长度头
+        */
+        void SetSize(uint32_t size)
+        {
+            size_ = size > capacity_ ? capacity_ : size;
+            memcpy(Frame(), (char*)&size_, sizeof(uint32_t));
+        }
+        /*
+        * @brief payload 的实际长度
+        */
+        uint32_t Size() const
+        {
+            return size_;
+        }
+        /*
+        * @brief 完整帧(长度头 + payload)的起始地址
+        */
+        char* Frame()
+        {
+            return reinterpret_cast<char*>(this + 1);
+        }
+        /*
+        * @brief 完整帧(长度头 + payload)的长度
+        */
+        uint32_t FrameSize() const
+        {
+            return size_ + sizeof(uint32_t);
+        }
+
+    private:
+        /*
+        * 构造,只能通过 Create 申请
+        */
+        explicit NetBuffer(uint32_t capacity)
+            : capacity_(capacity)
+        {
+            SetSize(0);
+        }
+        ~NetBuffer() = default;
+        NetBuffer(const NetBuffer&) = delete;
+        NetBuffer& operator=(const NetBuffer&) = delete;
+
+    private:
+        std::atomic<uint32_t> ref_count_ = 1;   // 引用计数
+        uint32_t capacity_ = 0;                 // payload 容量
+        uint32_t size_ = 0;                     // payload 实际长度
+        uint32_t reserved_ = 0;                 // 对齐,保证帧起始地址 8 字节对齐
+    };
+
+};  // ToolBox
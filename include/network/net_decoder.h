@@ -0,0 +1,298 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+
+namespace ToolBox
+{
+
+    /*
+    * @brief 接收缓冲区中可读数据的只读视图.环形缓冲区回绕时数据分为首尾相接的两段
+    */
+    struct NetRecvView
+    {
+        const char* data[2] = { nullptr, nullptr };     // 各段起始地址
+        std::size_t size[2] = { 0, 0 };                 // 各段长度
+        /*
+        * @brief 可读数据总长度
+        */
+        std::size_t Size() const
+        {
+            return size[0] + size[1];
+        }
+        /*
+        * @brief 第 offset 个字节,调用方保证 offset < Size()
+        */
+        char At(std::size_t offset) const
+        {
+            return offset < size[0] ? data[0][offset] : data[1][offset - size[0]];
+        }
+        /*
+        * @brief 从 offset 处拷贝数据
+        * @return 实际拷贝的长度
+        */
+        std::size_t Copy(std::size_t offset, char* out, std::size_t len) const
+        {
+            if (offset >= Size())
+            {
+                return 0;
+            }
+            len = len < Size() - offset ? len : Size() - offset;
+            std::size_t copied = 0;
+            if (offset < size[0])
+            {
+                copied = len < size[0] - offset ? len : size[0] - offset;
+                memcpy(out, data[0] + offset, copied);
+            }
+            if (copied < len)
+            {
+                memcpy(out + copied, data[1] + (offset + copied - size[0]), len - copied);
+            }
+            return len;
+        }
+        /*
+        * @brief 跳过开头 offset 个字节后的视图,调用方保证 offset <= Size()
+        */
+        NetRecvView Sub(std::size_t offset) const
+        {
+            NetRecvView view;
+            if (offset < size[0])
+            {
+                view.data[0] = data[0] + offset;
+                view.size[0] = size[0] - offset;
+                view.data[1] = data[1];
+                view.size[1] = size[1];
+            }
+            else
+            {
+                view.data[0] = data[1] + (offset - size[0]);
+                view.size[0] = size[1] - (offset - size[0]);
+            }
+            return view;
+        }
+    };
+
+    /*
+    * @brief 解码结果
+    */
+    enum NetDecodeResult
+    {
+        NDR_NEED_MORE = 0,      // 数据不足一条完整消息
+        NDR_FRAME,              // 解出一条完整消息
+        NDR_ERROR,              // 数据不合法,连接将被关闭
+    };
+
+    /*
+    * @brief 解出的一条消息在可读数据中的位置: [header_size, header_size + payload_size) 为投递给逻辑线程的内容,
+    *        frame_size 为整条消息占用的字节数(含头与尾部分隔符等)
+    */
+    struct NetDecodedFrame
+    {
+        uint32_t header_size = 0;       // 消息头长度,不投递
+        uint32_t payload_size = 0;      // 投递的内容长度
+        uint32_t frame_size = 0;        // 整条消息的长度,不小于 header_size + payload_size
+    };
+
+    /*
+    * @brief 消息解码器,在网络线程中从接收缓冲区切分出完整消息,每个连接一个实例,可以保存解析状态.
+    *        未设置解码器的连接使用内置的 uint32 长度头格式,不经过虚函数调用.
+    */
+    class NetDecoder
+    {
+    public:
+        virtual ~NetDecoder() = default;
+        /*
+        * @brief 从 view 的开头解出一条消息
+        * @param view 可读数据
+        * @param max_frame_size 单条消息的长度上限[即连接的接收缓冲区上限]
+        * @param frame 解出的消息位置
+        */
+        virtual NetDecodeResult Decode(const NetRecvView& view, uint32_t max_frame_size, NetDecodedFrame& frame) = 0;
+    };
+
+    /*
+    * @brief 为新连接创建解码器
+    */
+    using NetDecoderCreator = std::function<std::unique_ptr<NetDecoder>()>;
+
+    /*
+    * @brief 内置的 uint32 长度头格式[长度不含长度头自身],与未设置解码器时的格式相同
+    */
+    class NetLengthDecoder : public NetDecoder
+    {
+    public:
+        NetDecodeResult Decode(const NetRecvView& view, uint32_t max_frame_size, NetDecodedFrame& frame) override
+        {
+            uint32_t len = 0;
+            if (view.Copy(0, (char*)&len, sizeof(uint32_t)) < sizeof(uint32_t))
+            {
+                return NDR_NEED_MORE;
+            }
+            if (len > max_frame_size)
+            {
+                return NDR_ERROR;
+            }
+            if (view.Size() - sizeof(uint32_t) < len)
+            {
+                return NDR_NEED_MORE;
+            }
+            frame.header_size = sizeof(uint32_t);
+            frame.payload_size = len;
+            frame.frame_size = sizeof(uint32_t) + len;
+            return NDR_FRAME;
+        }
+    };
+
+    /*
+    * @brief varint 长度头格式[protobuf 的 base 128 varint,最多 5 字节]
+    */
+    class NetVarintDecoder : public NetDecoder
+    {
+    public:
+        NetDecodeResult Decode(const NetRecvView& view, uint32_t max_frame_size, NetDecodedFrame& frame) override
+        {
+            uint64_t len = 0;
+            std::size_t header_size = 0;
+            while (true)
+            {
+                if (header_size >= view.Size())
+                {
+                    return NDR_NEED_MORE;
+                }
+                if (header_size >= 5)
+                {
+                    return NDR_ERROR;
+                }
+                uint8_t byte = static_cast<uint8_t>(view.At(header_size));
+                len |= uint64_t(byte & 0x7F) << (7 * header_size);
+                header_size++;
+                if (0 == (byte & 0x80))
+                {
+                    break;
+                }
+            }
+            if (len > max_frame_size)
+            {
+                return NDR_ERROR;
+            }
+            if (view.Size() - header_size < len)
+            {
+                return NDR_NEED_MORE;
+            }
+            frame.header_size = static_cast<uint32_t>(header_size);
+            frame.payload_size = static_cast<uint32_t>(len);
+            frame.frame_size = static_cast<uint32_t>(header_size + len);
+            return NDR_FRAME;
+        }
+    };
+
+    /*
+    * @brief HTTP/1.x 风格的消息: 以空行结束的头部 + Content-Length 指定长度的消息体,投递整条消息(头部与消息体).
+    *        不支持 chunked 编码.记录已扫描的位置,数据分多次到达时不重复扫描
+    */
+    class NetHttpDecoder : public NetDecoder
+    {
+    public:
+        NetDecodeResult Decode(const NetRecvView& view, uint32_t max_frame_size, NetDecodedFrame& frame) override
+        {
+            std::size_t size = view.Size();
+            // 查找头部结束的空行 \r\n\r\n
+            if (0 == header_end_)
+            {
+                std::size_t offset = scanned_ >= 3 ? scanned_ - 3 : 0;
+                for (; offset + 4 <= size; offset++)
+                {
+                    if ('\r' == view.At(offset) && '\n' == view.At(offset + 1) && '\r' == view.At(offset + 2) && '\n' == view.At(offset + 3))
+                    {
+                        header_end_ = offset + 4;
+                        break;
+                    }
+                }
+                scanned_ = size;
+                if (0 == header_end_)
+                {
+                    return size > max_frame_size ? NDR_ERROR : NDR_NEED_MORE;
+                }
+                if (!ParseContentLength(view, header_end_, max_frame_size, content_length_))
+                {
+                    return NDR_ERROR;
+                }
+            }
+            std::size_t frame_size = header_end_ + content_length_;
+            if (frame_size > max_frame_size)
+            {
+                return NDR_ERROR;
+            }
+            if (size < frame_size)
+            {
+                return NDR_NEED_MORE;
+            }
+            frame.header_size = 0;
+            frame.payload_size = static_cast<uint32_t>(frame_size);
+            frame.frame_size = static_cast<uint32_t>(frame_size);
+            header_end_ = 0;
+            content_length_ = 0;
+            scanned_ = 0;
+            return NDR_FRAME;
+        }
+
+    private:
+        /*
+        * @brief 在头部中查找 Content-Length,不区分大小写,没有时为 0
+        * @param max_length 允许的最大长度
+        * @param length [out] 消息体长度
+        * @return 长度超过 max_length 时返回 false,避免恶意的超长数值溢出后得到错误的长度
+        */
+        static bool ParseContentLength(const NetRecvView& view, std::size_t header_end, std::size_t max_length, std::size_t& length)
+        {
+            length = 0;
+            static const char name[] = "content-length:";
+            const std::size_t name_len = sizeof(name) - 1;
+            for (std::size_t line = 0; line + name_len < header_end;)
+            {
+                std::size_t index = 0;
+                while (index < name_len && name[index] == (view.At(line + index) | 0x20))
+                {
+                    index++;
+                }
+                if (name_len == index)
+                {
+                    for (std::size_t pos = line + name_len; pos < header_end; pos++)
+                    {
+                        char c = view.At(pos);
+                        if (c >= '0' && c <= '9')
+                        {
+                            std::size_t digit = static_cast<std::size_t>(c - '0');
+                            if (length > (max_length - digit) / 10)
+                            {
+                                return false;
+                            }
+                            length = length * 10 + digit;
+                        }
+                        else if (' ' != c)
+                        {
+                            break;
+                        }
+                    }
+                    return true;
+                }
+                // 跳到下一行
+                while (line < header_end && '\n' != view.At(line))
+                {
+                    line++;
+                }
+                line++;
+            }
+            return true;
+        }
+
+    private:
+        std::size_t scanned_ = 0;           // 已扫描过的数据长度
+        std::size_t header_end_ = 0;        // 头部结束位置,0 表示尚未找到
+        std::size_t content_length_ = 0;    // 消息体长度
+    };
+
+};  // ToolBox
@@ -4,7 +4,10 @@
 #include <stdint.h>
 #include <functional>
 #include <string>
+#include <vector>
 #include "network/network_def.h"
+#include "network/net_buffer.h"
+#include "network/net_decoder.h"
 
 namespace ToolBox
 {
@@ -17,6 +20,7 @@ namespace ToolBox
     using ErroredMethod = std::function<void(NetworkType type, uint64_t opaque, uint64_t conn_id, ENetErrCode err_code, int32_t err_no)>;
     using CloseMethod = std::function<void(NetworkType type, uint64_t opaque, uint64_t conn_id, ENetErrCode net_err, int32_t sys_err)>;
     using ReceivedMethod = std::function<void(NetworkType type, uint64_t opaque, uint64_t conn_id, const char* data, size_t size)>;
+    using ReceivedBatchMethod = std::function<void(NetworkType type, uint64_t opaque, uint64_t conn_id, const NetRecvBatch& batch)>;
 
     class NetworkChannel;
     class Network
@@ -32,7 +36,7 @@ namespace ToolBox
         virtual ~Network();
         /*
         * @brief 启动工作线程
-        * @param net_thread_num 需要启动的网络线程数量
+        * @param net_thread_num 需要启动的网络线程数量[1~256]
         */
         bool Start(std::size_t net_thread_num = 1);
         /*
@@ -40,6 +44,12 @@ namespace ToolBox
         */
         void Update();
         /*
+        * @brief 低延迟模式下逻辑线程的忙等版 Update:在 spin_usecs 微秒内反复检查事件队列,一有事件即分发并返回
+        * @param spin_usecs 最长忙等的微秒数
+        * @return 分发的事件数,超时没有事件时为 0
+        */
+        std::size_t SpinUpdate(uint32_t spin_usecs);
+        /*
         * @brief 结束并等待工作线程结束,在主线程内调用
         */
         void StopWait();
@@ -58,6 +68,21 @@ namespace ToolBox
         */
         ENetErrCode Send(uint64_t conn_id, const char* data, uint32_t size);
         /*
+        * @brief 通知工作线程发送引用计数缓冲区[零拷贝].长度头已预留在缓冲区中,网络线程直接交给 writev,不再拷贝进发送缓冲区.
+        *        小于 ZERO_COPY_SEND_MIN_SIZE 的包在网络线程内仍走拷贝路径.
+        * @param conn_id 连接id
+        * @param buffer 由 NetBuffer::Create 申请并填充好数据的缓冲区,调用者持有的一个引用被接管,无论成功与否调用后都不可再使用
+        */
+        ENetErrCode Send(uint64_t conn_id, NetBuffer* buffer);
+        /*
+        * @brief 广播:数据只序列化一次,按网络线程分组后每个网络线程只投递一个事件,各连接共享同一个缓冲区
+        * @param conn_ids 目标连接id列表
+        * @param data 被发送数据的指针
+        * @param size 被发送数据的长度
+        * @return 存在无效连接时返回 NET_INVALID_CONNID,有效的连接仍会发送
+        */
+        ENetErrCode Broadcast(const std::vector<uint64_t>& conn_ids, const char* data, uint32_t size);
+        /*
         * 通知网络线程建立一个监听器
         * @param type 网络类型
         * @param opaque 信道标记,通过此监听器建立的"连接"都携带此标记
@@ -85,6 +110,82 @@ namespace ToolBox
         * @param timeout 默认超过2毫秒就进行发送.
         */
         void SetSimulateNagle(uint32_t packets_num = 10, uint32_t timeout = 2);
+        /*
+        * @brief 网络库特性:UDP/KCP 批量收发.可读时用 recvmmsg 一次读取多个数据报,发送的数据报(含 KCP 的输出分片)
+        *        攒到网络线程每帧末尾用 sendmmsg 一次发出,减少每个数据报的系统调用.默认开启.
+        *        内核发送缓冲区已满时,未发出的数据报在所属会话中排队,之后每帧重试.Start 前后均可调用,之后建立的网络也会沿用.
+        *        批量接收共用一块 batch_size * datagram_size 的缓冲区[KCP 按 KCP 的 MTU 预留],超长的数据报被截断丢弃并回调 NET_RECV_BUFF_OVERFLOW,
+        *        之后预留的大小加倍[最大 64K].
+        * @param batch_size 单次批量处理的数据报数量,默认 NETWORK_UDP_BATCH_SIZE,为 1 时退化为逐个数据报 recvfrom/sendto.
+        * @param datagram_size 原始 UDP 批量接收时每个数据报预留的大小,默认 NETWORK_UDP_DATAGRAM_SIZE.
+        */
+        void SetUdpBatchSize(uint32_t batch_size = NETWORK_UDP_BATCH_SIZE, uint32_t datagram_size = NETWORK_UDP_DATAGRAM_SIZE);
+        /*
+        * @brief 网络库特性:TCP 批量接收.网络线程把一次读取中解出的所有完整消息拷贝进一块连续内存,附带偏移表,
+        *        只投递一个接收事件,减少频繁发送小包的连接每条消息的内存申请与事件开销.
+        *        未设置 SetOnReceivedBatch 时仍按条回调 SetOnReceived.Start 前后均可调用.
+        * @param enable 是否开启
+        */
+        void SetRecvBatch(bool enable = true);
+        /*
+        * @brief 网络库特性:TCP 自定义消息格式.为 opaque 相同的监听器/连接器建立的连接指定解码器,网络线程用它从接收缓冲区切分出完整消息,
+        *        直接投递解出的消息内容,逻辑线程无需再次拼包.未指定时使用内置的 uint32 长度头格式.
+        *        只影响接收,Send 仍会加上 uint32 长度头,自定义格式的发送请用 SendBuffer 等自行成帧.对之后建立的连接生效.
+        * @param opaque 监听器/连接器的 opaque
+        * @param creator 为每个新连接创建解码器,为空时取消设置
+        */
+        void SetDecoder(uint64_t opaque, NetDecoderCreator creator);
+        /*
+        * @brief 网络库特性:TCP 自适应缓冲区.新连接的收发缓冲区从 NETWORK_ADAPTIVE_BUFFER_MIN_SIZE 开始按需倍增,
+        *        上限仍是 Accept/Connect 传入的 send_buff_size/recv_buff_size;空闲的缓冲区定期缩容,内存块归还到网络线程的缓存中复用.
+        *        适合连接数多而大部分连接空闲的场景.默认关闭,每个连接固定预留 2 个 256K 的缓冲区.需在 Start 之后调用,对之后建立的连接生效.
+        * @param enable 是否开启
+        */
+        void SetAdaptiveBuffer(bool enable = true);
+        /*
+        * @brief 网络库特性:网络线程空闲时阻塞等待,直到有 io 就绪或逻辑线程投递了事件才被唤醒[默认开启].
+        *        关闭后退化为固定超时的轮询.需在 Start 之前调用.
+        */
+        void SetWorkerBlockingWait(bool enable = true);
+        /*
+        * @brief 设置每个网络线程每种网络最多可以同时存在的 socket 数量[包括监听器],epoll 的事件数组与 udp/kcp 会话目录按此大小建立.需在 Start 之前调用.
+        * @param max_socket_count socket 数量上限,默认 NETWORK_MAX_SOCKET_COUNT
+        */
+        void SetMaxSocketCount(uint32_t max_socket_count = NETWORK_MAX_SOCKET_COUNT);
+        /*
+        * @brief 网络库特性:低延迟模式.网络线程绑定到指定的 cpu,阻塞等待前先以 epoll_wait(..., 0) 忙轮询一段时间,
+        *        可选为连接设置 SO_BUSY_POLL.逻辑线程可配合 SpinUpdate 忙等事件.需开启阻塞等待[默认开启],在 Start 之前调用.
+        * @param mode 低延迟模式的参数
+        */
+        void SetLatencyMode(const NetLatencyMode& mode);
+        /*
+        * @brief 设置新连接在网络线程之间的分配策略,默认随机.监听器仍固定在第0个网络线程
+        * @param policy 分配策略
+        */
+        void SetPlacementPolicy(NetPlacementPolicy policy);
+        /*
+        * @brief 设置监听器接受新连接的方式,对之后调用的 Accept 生效,默认 NAM_HANDSHAKE.
+        *        NAM_REUSEPORT 下每个网络线程都会回调一次 OnBinded,且不再回调 OnAccepting,新连接也不经过分配策略.
+        *        udp/kcp 的会话分布在各网络线程上,逻辑线程通过共享的会话目录把发送与关闭路由到会话所在线程.
+        * @param mode 接受新连接的方式
+        */
+        void SetAcceptMode(NetAcceptMode mode);
+        /*
+        * @brief 获取每个网络线程的负载快照[存活连接数,收发字节数,最近窗口字节数,分配次数],在逻辑线程调用
+        */
+        std::vector<NetThreadLoad> GetThreadLoadStats();
+        /*
+        * @brief 获取每个网络线程与逻辑线程之间事件队列的深度与丢弃统计,在逻辑线程调用
+        */
+        std::vector<NetEventQueueStat> GetEventQueueStats();
+        /*
+        * @brief 获取网络指标快照,在逻辑线程调用,可定期轮询.
+        *        网络线程指标[收发字节数/消息数/系统调用数/唤醒次数/每次唤醒的事件数/队列深度与丢弃]为各计数的当前值.
+        *        with_connections 为 true 时同时请求各网络线程在下一次循环发布 TCP 连接指标[缓冲区占用/积压时长/最后收发时间],
+        *        返回的是上一次发布的结果,首次请求时为空.
+        * @param with_connections 是否附带连接指标
+        */
+        NetMetricsSnapshot GetMetricsSnapshot(bool with_connections = false);
     public:
         /*
         * @brief 设置绑定成功的回调
@@ -118,6 +219,10 @@ namespace ToolBox
         * @brief 设置接收的回调
         */
         Network& SetOnReceived(ReceivedMethod receive_method);
+        /*
+        * @brief 设置批量接收的回调.设置后优先于 SetOnReceived 的回调,单条投递的消息也会包装成只有一条的批次
+        */
+        Network& SetOnReceivedBatch(ReceivedBatchMethod receive_batch_method);
     private:
         NetworkChannel* network_channel_ = nullptr;
     };
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <vector>
 namespace ToolBox
 {
 
@@ -40,4 +42,165 @@ namespace ToolBox
 
     // 主线程与网络线程之间的队列的最大数量
     constexpr std::size_t NETWORK_EVENT_QUEUE_MAX_COUNT = 32 * 1024;
+    // 逻辑线程每次从单个网络线程队列中批量取出的事件数量
+    constexpr std::size_t NETWORK_EVENT_DISPATCH_BATCH = 256;
+
+    // 负载统计窗口,单位毫秒(ms)
+    constexpr std::size_t NETWORK_LOAD_WINDOW_MS = 1000;
+    // 一致性哈希环上每个网络线程的虚拟节点数
+    constexpr std::size_t NETWORK_HASH_VIRTUAL_NODES = 64;
+
+    // 每个网络线程每种网络默认最多可以同时存在的 socket 数量[包括监听器]
+    constexpr uint32_t NETWORK_MAX_SOCKET_COUNT = 10000;
+
+    // UDP/KCP 单次 recvmmsg/sendmmsg 默认批量处理的数据报数量
+    constexpr uint32_t NETWORK_UDP_BATCH_SIZE = 32;
+    // UDP/KCP 批量收发数据报数量的上限
+    constexpr uint32_t NETWORK_UDP_BATCH_MAX = 256;
+    // UDP 批量接收时默认为每个数据报预留的缓冲区大小,覆盖以太网 MTU 下不分片的数据报
+    constexpr uint32_t NETWORK_UDP_DATAGRAM_SIZE = 2048;
+    // 自适应缓冲区模式下 TCP 连接收发缓冲区的初始(最小)大小
+    constexpr uint32_t NETWORK_ADAPTIVE_BUFFER_MIN_SIZE = 4 * 1024;
+    // 每个网络线程缓存的缩容归还的缓冲区上限
+    constexpr std::size_t NETWORK_ADAPTIVE_BUFFER_SLAB_CACHE_SIZE = 64 * 1024 * 1024;
+
+    /*
+    * 新连接(被动接受的与主动发起的)在网络线程之间的分配策略
+    */
+    enum NetPlacementPolicy
+    {
+        NPP_RANDOM = 0,             // 随机
+        NPP_LEAST_CONNECTIONS,      // 存活连接数最少的网络线程
+        NPP_LEAST_BYTES,            // 最近一个统计窗口内收发字节数最少的网络线程
+        NPP_CONSISTENT_HASH,        // 按 信道标记+远端地址 一致性哈希,同一远端固定落在同一网络线程
+        NPP_MAX,
+    };
+
+    /*
+    * 监听器接受新连接的方式
+    */
+    enum NetAcceptMode
+    {
+        NAM_HANDSHAKE = 0,      // 第0个网络线程监听,新连接经逻辑线程(OnAccepting)按分配策略交给某个网络线程
+        NAM_REUSEPORT,          // 每个网络线程各自以 SO_REUSEPORT 监听,新连接直接在本线程加入io多路复用[仅 linux].udp/kcp 的会话由内核按远端地址固定分给某个网络线程
+        NAM_MAX,
+    };
+
+    /*
+    * 低延迟模式的参数,以 cpu 换取微秒级的延迟,适合撮合/交易类对延迟敏感的服务
+    */
+    struct NetLatencyMode
+    {
+        std::vector<int32_t> cpu_affinity;  // 第 i 个网络线程绑定的 cpu,未给出或为负数的网络线程不绑定
+        uint32_t spin_usecs = 0;            // 网络线程阻塞等待前以 epoll_wait(..., 0) 忙轮询的微秒数,0 为不忙轮询
+        uint32_t busy_poll_usecs = 0;       // 连接的 SO_BUSY_POLL 微秒数,0 为不设置;超过 net.core.busy_read 需要 CAP_NET_ADMIN
+    };
+
+    /*
+    * 批量接收模式下一次读取解出的所有完整消息,共用一块连续内存,只在回调期间有效
+    */
+    struct NetRecvBatch
+    {
+        const char* data = nullptr;         // 第一条消息的起始地址,各消息首尾相接
+        const uint32_t* offsets = nullptr;  // 各消息相对 data 的偏移,共 count + 1 项,最后一项为总长度
+        uint32_t count = 0;                 // 消息数量
+        /*
+        * 第 index 条消息的起始地址
+        */
+        const char* Frame(uint32_t index) const
+        {
+            return data + offsets[index];
+        }
+        /*
+        * 第 index 条消息的长度
+        */
+        uint32_t FrameSize(uint32_t index) const
+        {
+            return offsets[index + 1] - offsets[index];
+        }
+    };
+
+    /*
+    * 单个网络线程的负载快照,用于验证分配策略的均衡效果
+    */
+    struct NetThreadLoad
+    {
+        uint32_t net_thread_index = 0;                  // 网络线程序号
+        NetPlacementPolicy policy = NPP_RANDOM;         // 当前使用的分配策略
+        uint32_t connections = 0;                       // 存活连接数(不含监听器,各网络类型之和)
+        uint64_t recv_bytes = 0;                        // 累计接收字节数
+        uint64_t send_bytes = 0;                        // 累计发送字节数
+        uint64_t window_bytes = 0;                      // 最近一个统计窗口内的收发字节数
+        uint64_t placed = 0;                            // 累计分配到此线程的新连接数
+        uint64_t placements_handled = 0;                // 网络线程已处理的分配数,与 placed 之差为尚未处理的分配
+        uint64_t send_flushes = 0;                      // 累计有数据可发的发送刷新次数(TCP 每次 UpdateSend,UDP/KCP 每帧批量发送)
+        uint64_t send_syscalls = 0;                     // 累计发送系统调用次数,send_syscalls / send_flushes 即每次刷新的系统调用数
+        uint64_t kcp_updates = 0;                       // 累计 ikcp_update 调用次数(KCP)
+        uint64_t nagle_scanned = 0;                     // 模拟 Nagle 定时刷新累计遍历的 socket 数(只遍历有待处理数据的 socket)
+        uint64_t nagle_flushed = 0;                     // 模拟 Nagle 定时刷新累计有数据收发的 socket 数
+        uint64_t buffer_bytes = 0;                      // 连接收发缓冲区占用的字节数(TCP)
+        uint64_t buffer_cached_bytes = 0;               // 缩容归还后缓存待复用的缓冲区字节数(TCP)
+    };
+
+    /*
+    * 单个网络线程与逻辑线程之间事件队列的统计,用于根据真实数据调整 NETWORK_EVENT_QUEUE_MAX_COUNT
+    */
+    struct NetEventQueueStat
+    {
+        uint32_t net_thread_index = 0;      // 网络线程序号
+        std::size_t to_main_depth = 0;      // 网络线程->逻辑线程 队列当前深度
+        std::size_t to_main_max_depth = 0;  // 网络线程->逻辑线程 队列历史最大深度
+        uint64_t to_main_pushed = 0;        // 网络线程->逻辑线程 累计投递的事件数
+        uint64_t to_main_dropped = 0;       // 网络线程->逻辑线程 队列满而丢弃的事件数
+        std::size_t to_worker_depth = 0;    // 逻辑线程->网络线程 队列当前深度(各网络类型之和)
+        uint64_t to_worker_dropped = 0;     // 逻辑线程->网络线程 队列满而丢弃的事件数(各网络类型之和)
+    };
+
+    /*
+    * 单个网络线程的运行指标,各计数为网络线程发布的累计值,逻辑线程两次快照相减即区间内的速率
+    */
+    struct NetWorkerMetrics
+    {
+        uint32_t net_thread_index = 0;      // 网络线程序号
+        uint32_t connections = 0;           // 存活连接数(不含监听器,各网络类型之和)
+        uint64_t recv_bytes = 0;            // 累计投递给逻辑线程的消息字节数
+        uint64_t send_bytes = 0;            // 累计逻辑线程请求发送的字节数
+        uint64_t recv_packets = 0;          // 累计投递给逻辑线程的消息数
+        uint64_t send_packets = 0;          // 累计逻辑线程请求发送的消息数(广播按目标连接数计)
+        uint64_t recv_syscalls = 0;         // 累计接收系统调用次数[io_uring 的 multishot recv 不计]
+        uint64_t send_syscalls = 0;         // 累计发送系统调用次数
+        uint64_t wakeups = 0;               // io 多路复用返回了 io 事件的次数
+        uint64_t io_events = 0;             // 累计处理的 io 事件数
+        double events_per_wakeup = 0;       // 每次唤醒平均处理的 io 事件数
+        std::size_t to_main_depth = 0;      // 网络线程->逻辑线程 队列当前深度
+        uint64_t to_main_dropped = 0;       // 网络线程->逻辑线程 队列满而丢弃的事件数
+        std::size_t to_worker_depth = 0;    // 逻辑线程->网络线程 队列当前深度
+        uint64_t to_worker_dropped = 0;     // 逻辑线程->网络线程 队列满而丢弃的事件数
+    };
+
+    /*
+    * 单个 TCP 连接的指标,用于找出消费慢的对端
+    */
+    struct NetConnMetrics
+    {
+        uint64_t conn_id = 0;               // 连接ID
+        uint32_t net_thread_index = 0;      // 所在网络线程序号
+        uint64_t send_buffered = 0;         // 待发送的字节数(发送缓冲区 + 零拷贝发送队列)
+        uint64_t send_capacity = 0;         // 发送缓冲区上限
+        uint64_t recv_buffered = 0;         // 接收缓冲区中尚未解出完整消息的字节数
+        uint64_t recv_capacity = 0;         // 接收缓冲区上限
+        uint64_t send_blocked_ms = 0;       // 累计因内核发送缓冲区满[EAGAIN/短写]而积压的毫秒数,含当前仍在积压的时长
+        int64_t last_recv_ms = 0;           // 最后一次读到数据的时间戳(毫秒)
+        int64_t last_send_ms = 0;           // 最后一次发出数据的时间戳(毫秒)
+    };
+
+    /*
+    * 网络指标快照
+    */
+    struct NetMetricsSnapshot
+    {
+        int64_t timestamp_ms = 0;                   // 快照时间戳(毫秒)
+        std::vector<NetWorkerMetrics> workers;      // 各网络线程的指标
+        std::vector<NetConnMetrics> connections;    // 各网络线程上一次发布的 TCP 连接指标
+    };
 };  // ToolBox
\ No newline at end of file
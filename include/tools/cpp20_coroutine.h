@@ -16,6 +16,8 @@
 #include <future>
 
 #include "tools/ringbuffer.h"
+#include "tools/mpsc_queue.h"
+#include "tools/log.h"
 
 
 namespace ToolBox {
@@ -295,74 +297,66 @@ public:
 
 class LooperExecutor : public IExecutor {
 private:
-    std::condition_variable queue_condition;
-    std::mutex queue_lock;
-    std::queue<std::function<void()>> executable_queue;
+    // 任务节点,投递时分配,执行完释放
+    struct LooperTask : public MPSCNode {
+        std::function<void()> func;
+    };
+    // 任意线程投递,looper 线程执行;投递无锁,队列为空时 looper 线程阻塞等待
+    MPSCIntrusiveList<LooperTask, true> executable_queue;
 
-    std::atomic<bool> is_active; // true是工作状态,如果要关闭事件循环,就置为 false
+    std::atomic<bool> is_active{true}; // true是工作状态,如果要关闭事件循环,就置为 false
+    std::atomic<bool> is_discard{false}; // 关闭时是否丢弃尚未执行的任务
     std::thread work_thread;
 
 private:
     // 处理事件循环
     void run_loop() {
         // 检查当前事件循环是否是工作状态,或者队列没有清空.
-        while (is_active.load(std::memory_order_relaxed) ||
-            !executable_queue.empty()) {
-        std::unique_lock lock(queue_lock);
-        if (executable_queue.empty()) {
-            // 队列为空,需要等待新任务加入队列或者关闭事件循环的通知.
-            queue_condition.wait(lock);
-            // 如果队列为空,那么说明收到的是关闭的通知
-            if (executable_queue.empty()) {
-                // 现有逻辑下此处用 break 也可
-                // 使用 continue 可以再次检查状态和队列,方便将来扩展
+        while (!is_discard.load(std::memory_order_acquire)) {
+            LooperTask* task = executable_queue.Pop();
+            if (nullptr == task) {
+                if (!is_active.load(std::memory_order_acquire) && executable_queue.Empty()) {
+                    break;
+                }
+                // 队列为空,需要等待新任务加入队列或者关闭事件循环的通知.
+                executable_queue.Wait();
                 continue;
             }
+            // func 是外部逻辑,执行期间其他线程可以继续投递
+            task->func();
+            delete task;
         }
-
-        // 取出第一个任务,解锁再执行.
-        // func 是外部逻辑,不需要锁保护; func 当中可能请求锁,导致死锁.
-        auto func = executable_queue.front();
-        executable_queue.pop();
-        lock.unlock();
-        func();
-        }
-  }
+    }
 
 public:
     LooperExecutor() {
         work_thread = std::thread(&LooperExecutor::run_loop, this);
-        is_active.store(true, std::memory_order_relaxed);
     }
     ~LooperExecutor() {
         shutdown(false);
         // 等待线程执行完,防止出现意外情况.
         join();
+        while (LooperTask* task = executable_queue.Pop()) {
+            delete task;
+        }
     }
 
     void execute(std::function<void()> &&func) override {
-        std::unique_lock lock(queue_lock);
         if (is_active.load(std::memory_order_relaxed)) {
-            executable_queue.push(func);
-            lock.unlock();
-            // 通知队列,主要用于队列之前为空时调用 wait 等待的情况
-            // 通知不需要加锁,否则锁会交给 wait 方导致当前线程阻塞
-            queue_condition.notify_one();
+            auto* task = new LooperTask;
+            task->func = std::move(func);
+            executable_queue.Push(task);
         }
     }
     void shutdown(bool wait_for_complete = true) {
-        // 修改后立即生效,在 run_loop 当中就能尽早(加锁前)就检测到 is_active 的变化
-        is_active.store(false, std::memory_order_relaxed);
+        // 修改后立即生效,在 run_loop 当中就能尽早检测到 is_active 的变化
+        is_active.store(false, std::memory_order_release);
         if (!wait_for_complete) {
-            std::unique_lock lock(queue_lock);
-            // 清空任务队列
-            decltype(executable_queue) empty_queue;
-            executable_queue.swap(empty_queue);
-            lock.unlock();
+            // 不再执行队列中的任务,剩余任务在析构时释放
+            is_discard.store(true, std::memory_order_release);
         }
-        // 通知 wait 函数, 避免 Looper 线程不退出
-        // 不需要加锁, 否则锁会交给 wait 放导致当前线程阻塞.
-        queue_condition.notify_all();
+        // 唤醒等待中的 looper 线程,避免其不退出
+        executable_queue.WakeUp();
     }
 
     void join() {
@@ -376,8 +370,9 @@ public:
 #define LOOPER_EVENT_QUEUE_MAX_COUNT 10240
 class RingBufferSPSCEventExecutor : public IExecutor {
 private:
-    RingBufferSPSC<std::function<void()>, LOOPER_EVENT_QUEUE_MAX_COUNT> executable_queue;
-    std::atomic<bool> is_active; // true是工作状态,如果要关闭事件循环,就置为 false
+    RingBufferSPSCCached<std::function<void()>, LOOPER_EVENT_QUEUE_MAX_COUNT> executable_queue;
+    std::atomic<bool> is_active{true}; // true是工作状态,如果要关闭事件循环,就置为 false
+    std::atomic<bool> is_discard{false}; // 关闭时是否丢弃尚未执行的任务
     std::thread work_thread;
 
 private:
@@ -385,10 +380,14 @@ private:
     void run_loop() {
         int idle_count = 0;
         // 检查当前事件循环是否是工作状态,或者队列没有清空.
-        while (is_active.load(std::memory_order_relaxed)) {
+        while (!is_discard.load(std::memory_order_acquire)) {
 
             if (executable_queue.Empty()) 
             {
+                if (!is_active.load(std::memory_order_acquire)) 
+                {
+                    break;
+                }
                 if (idle_count < 100) 
                 {
                     std::this_thread::yield();
@@ -400,7 +399,7 @@ private:
                 idle_count++;
                 continue;
             }
-            while (!executable_queue.Empty()) 
+            while (!is_discard.load(std::memory_order_relaxed) && !executable_queue.Empty()) 
             {
                 auto func = executable_queue.Pop();
                 func();
@@ -413,7 +412,6 @@ private:
 public:
     RingBufferSPSCEventExecutor() {
         work_thread = std::thread(&RingBufferSPSCEventExecutor::run_loop, this);
-        is_active.store(true, std::memory_order_relaxed);
     }
     ~RingBufferSPSCEventExecutor() {
         shutdown(false);
@@ -423,19 +421,18 @@ public:
 
     void execute(std::function<void()> &&func) override {
         if (is_active.load(std::memory_order_relaxed)) {
-            if (executable_queue.Full()) 
+            if (!executable_queue.Push(std::move(func))) 
             {
-                // TO DO: add error log
-                fprintf(stderr,"[coroutine] execute failed for executable_queue is full.");
+                LogError("[coroutine] execute failed for executable_queue is full.");
             }
-            executable_queue.Push(std::move(func));
         }
     }
     void shutdown(bool wait_for_complete = true) {
-        is_active.store(false, std::memory_order_relaxed);
+        // 不再接受新任务;队列只能由读线程清空,等待完成时读线程执行完队列中的任务后退出
+        is_active.store(false, std::memory_order_release);
         if (!wait_for_complete) {
-            // 清空任务队列
-            executable_queue.Clear();
+            // 读线程看到丢弃标记后不再取任务,未执行的任务随队列一起析构
+            is_discard.store(true, std::memory_order_release);
         }
     }
 
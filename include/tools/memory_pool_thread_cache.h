@@ -0,0 +1,439 @@
+#pragma once
+
+#include "singleton.h"
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <vector>
+#include "debug_print.h"
+
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace ToolBox{
+
+#define MemPoolThreadCacheMgr Singleton<ToolBox::MemoryPoolThreadCache>::Instance()
+
+/*
+* 内存块的分级: 128 字节以内按 8 字节分级,之后每个2的幂区间再均分为 4 级,最多浪费 25%[2的幂取整最多浪费 50%]
+* 256K 以上的内存块直接向系统申请
+*/
+class ThreadCacheSizeClass
+{
+public:
+    static constexpr std::size_t SMALL_STEP_MAX = 128;                  // 按 8 字节分级的上限
+    static constexpr std::size_t SMALL_CLASS_COUNT = SMALL_STEP_MAX / 8;
+    static constexpr std::size_t MAX_SIZE = 256 * 1024;                 // 分级管理的最大内存块
+    static constexpr std::size_t CLASS_COUNT = SMALL_CLASS_COUNT + (17 - 7 + 1) * 4;  // 共 60 级
+    /*
+    * 内存大小对应的级别,调用方保证 size <= MAX_SIZE
+    */
+    static uint32_t Index(std::size_t size)
+    {
+        if (size <= SMALL_STEP_MAX)
+        {
+            return size == 0 ? 0 : static_cast<uint32_t>((size + 7) / 8 - 1);
+        }
+        std::size_t lg = std::bit_width(size - 1) - 1;      // size - 1 落在 [2^lg, 2^(lg+1))
+        return static_cast<uint32_t>(SMALL_CLASS_COUNT + (lg - 7) * 4 + ((size - 1 - (std::size_t(1) << lg)) >> (lg - 2)));
+    }
+    /*
+    * 级别对应的内存块大小
+    */
+    static std::size_t Size(uint32_t index)
+    {
+        if (index < SMALL_CLASS_COUNT)
+        {
+            return (index + 1) * 8;
+        }
+        std::size_t k = index - SMALL_CLASS_COUNT;
+        std::size_t lg = 7 + k / 4;
+        return (std::size_t(1) << lg) + ((k % 4 + 1) << (lg - 2));
+    }
+    /*
+    * 线程缓存与中心链表之间一次转移的内存块数量,约 64K 字节
+    */
+    static uint32_t BatchSize(uint32_t index)
+    {
+        std::size_t count = 64 * 1024 / Size(index);
+        return static_cast<uint32_t>(count < 2 ? 2 : (count > 128 ? 128 : count));
+    }
+};
+
+class MemoryPoolThreadCache;
+
+/*
+* 线程缓存: 每个线程每个级别一条空闲链表,分配与归还都不加锁.
+* 链表空时从中心链表取一批,过长时还一批给中心链表.
+* 在其他线程释放的内存块进入释放线程的缓存,再经中心链表回到分配线程,适合网络线程申请、逻辑线程释放的模式.
+*/
+class ThreadCache
+{
+public:
+    /*
+    * 空闲链表,内存块的前 8 个字节存放下一个内存块的地址
+    */
+    struct FreeList
+    {
+        void* head = nullptr;
+        uint32_t count = 0;
+    };
+    ThreadCache(MemoryPoolThreadCache* pool)
+        : pool_(pool)
+    {}
+    /*
+    * 线程退出时把缓存的内存块全部还给中心链表
+    */
+    ~ThreadCache();
+    /*
+    * 分配内存块
+    * @param index 级别
+    */
+    void* Allocate(uint32_t index);
+    /*
+    * 归还内存块
+    * @param index 级别
+    */
+    void Deallocate(void* pointer, uint32_t index);
+
+private:
+    MemoryPoolThreadCache* pool_ = nullptr;
+    std::array<FreeList, ThreadCacheSizeClass::CLASS_COUNT> lists_;
+};
+
+/*
+* 线程缓存内存池[通过 MemPoolThreadCacheMgr 单例使用]
+* 内存页来自按 1M 对齐的 span,每次向系统申请 64 个 span,每个 span 只切分一种级别的内存块.
+* span 头部记录级别,释放时由地址对齐找到 span 头,内存块本身不带头部.
+* 中心链表按批保存内存块,线程缓存与中心链表之间整批转移,一次加锁摊到一批内存块上.
+*/
+class MemoryPoolThreadCache : public DebugPrint
+{
+public:
+    static constexpr std::size_t SPAN_SIZE = 1 << 20;           // span 大小,也是 span 的对齐
+    static constexpr std::size_t REGION_SPAN_COUNT = 64;        // 每次向系统申请的 span 数量
+    static constexpr std::size_t SPAN_HEADER_SIZE = 64;         // span 头部大小,内存块从其后开始切分
+    static constexpr uint32_t LARGE_CLASS = UINT32_MAX;         // 直接向系统申请的大内存块
+    static constexpr uint32_t SPAN_MAGIC = 0x54435350;
+
+    MemoryPoolThreadCache(){};
+    /*
+    * 申请内存
+    * @param size 申请内存的大小
+    */
+    char* GetMemory(std::size_t size)
+    {
+        if (size > ThreadCacheSizeClass::MAX_SIZE)
+        {
+            return AllocateLarge(size);
+        }
+        return static_cast<char*>(LocalCache().Allocate(ThreadCacheSizeClass::Index(size)));
+    }
+    /*
+    * 归还内存,可以在任意线程归还
+    * @param pointer 归还内存的指针
+    */
+    void GiveBack(char* pointer, const char* debug_tag = nullptr)
+    {
+        if (nullptr == pointer)
+        {
+            return;
+        }
+        SpanHeader* header = GetSpanHeader(pointer);
+        if (LARGE_CLASS == header->class_index)
+        {
+            mapped_bytes_.fetch_sub(header->mapped_size, std::memory_order_relaxed);
+            Unmap(header, header->mapped_size);
+            return;
+        }
+        LocalCache().Deallocate(pointer, header->class_index);
+    }
+    /*
+    * 申请 size 字节时实际占用的内存块大小
+    */
+    static std::size_t AllocSize(std::size_t size)
+    {
+        if (size > ThreadCacheSizeClass::MAX_SIZE)
+        {
+            return size;
+        }
+        return ThreadCacheSizeClass::Size(ThreadCacheSizeClass::Index(size));
+    }
+    /*
+    * 向系统申请的内存总量[含大内存块]
+    */
+    std::size_t GetMappedBytes() const
+    {
+        return mapped_bytes_.load(std::memory_order_relaxed);
+    }
+    /*
+    * 中心链表中缓存的内存块总量
+    */
+    std::size_t GetCentralCachedBytes()
+    {
+        std::size_t bytes = 0;
+        for (uint32_t index = 0; index < ThreadCacheSizeClass::CLASS_COUNT; index++)
+        {
+            std::lock_guard<std::mutex> lock(centrals_[index].mutex);
+            for (auto& batch : centrals_[index].batches)
+            {
+                bytes += batch.count * ThreadCacheSizeClass::Size(index);
+            }
+        }
+        return bytes;
+    }
+    /*
+    * 调试打印
+    */
+    void DebugPrint()
+    {
+        if (GetDebugStatus())
+        {
+            Print("内存池向系统申请了 %zu 字节,中心链表缓存了 %zu 字节.\n", GetMappedBytes(), GetCentralCachedBytes());
+        }
+    }
+    /*
+    * 从中心链表取一批内存块放入线程缓存的空闲链表[线程缓存调用]
+    * @return 是否取到
+    */
+    bool FetchBatch(uint32_t index, ThreadCache::FreeList& list)
+    {
+        CentralList& central = centrals_[index];
+        std::lock_guard<std::mutex> lock(central.mutex);
+        if (!central.batches.empty())
+        {
+            list.head = central.batches.back().head;
+            list.count = central.batches.back().count;
+            central.batches.pop_back();
+            return true;
+        }
+        // 没有缓存的批次,从 span 中切分
+        std::size_t object_size = ThreadCacheSizeClass::Size(index);
+        uint32_t batch_size = ThreadCacheSizeClass::BatchSize(index);
+        void* head = nullptr;
+        uint32_t count = 0;
+        while (count < batch_size)
+        {
+            if (static_cast<std::size_t>(central.span_end - central.span_cursor) < object_size)
+            {
+                if (count > 0)
+                {
+                    break;
+                }
+                char* span = AllocateSpan(index);
+                if (nullptr == span)
+                {
+                    return false;
+                }
+                central.span_cursor = span + SPAN_HEADER_SIZE;
+                central.span_end = span + SPAN_SIZE;
+            }
+            central.span_end -= object_size;
+            *reinterpret_cast<void**>(central.span_end) = head;
+            head = central.span_end;
+            count++;
+        }
+        list.head = head;
+        list.count = count;
+        return true;
+    }
+    /*
+    * 从线程缓存的空闲链表头部取 count 个内存块还给中心链表[线程缓存调用]
+    */
+    void ReleaseBatch(uint32_t index, ThreadCache::FreeList& list, uint32_t count)
+    {
+        if (0 == count || nullptr == list.head)
+        {
+            return;
+        }
+        void* head = list.head;
+        void* tail = head;
+        uint32_t moved = 1;
+        while (moved < count && nullptr != *reinterpret_cast<void**>(tail))
+        {
+            tail = *reinterpret_cast<void**>(tail);
+            moved++;
+        }
+        list.head = *reinterpret_cast<void**>(tail);
+        list.count -= moved;
+        *reinterpret_cast<void**>(tail) = nullptr;
+        CentralList& central = centrals_[index];
+        std::lock_guard<std::mutex> lock(central.mutex);
+        central.batches.push_back(Batch{ head, moved });
+    }
+
+private:
+    /*
+    * span 头部
+    */
+    struct SpanHeader
+    {
+        uint32_t magic = SPAN_MAGIC;
+        uint32_t class_index = 0;       // 级别, LARGE_CLASS 为大内存块
+        std::size_t mapped_size = 0;    // 大内存块向系统申请的大小
+    };
+    static_assert(sizeof(SpanHeader) <= SPAN_HEADER_SIZE);
+    /*
+    * 中心链表中的一批内存块
+    */
+    struct Batch
+    {
+        void* head = nullptr;
+        uint32_t count = 0;
+    };
+    /*
+    * 每个级别的中心链表
+    */
+    struct CentralList
+    {
+        std::mutex mutex;
+        std::vector<Batch> batches;         // 线程缓存还回来的批次
+        char* span_cursor = nullptr;        // 当前 span 未切分部分的起点
+        char* span_end = nullptr;           // 当前 span 未切分部分的终点,从尾部向前切分
+    };
+    /*
+    * 当前线程的缓存
+    */
+    ThreadCache& LocalCache()
+    {
+        thread_local ThreadCache cache(this);
+        return cache;
+    }
+    /*
+    * 由内存块地址找到所在 span 的头部
+    */
+    static SpanHeader* GetSpanHeader(void* pointer)
+    {
+        return reinterpret_cast<SpanHeader*>(reinterpret_cast<uintptr_t>(pointer) & ~(uintptr_t(SPAN_SIZE) - 1));
+    }
+    /*
+    * 分配一个 span 给级别 index
+    */
+    char* AllocateSpan(uint32_t index)
+    {
+        std::lock_guard<std::mutex> lock(span_mutex_);
+        if (region_cursor_ == region_end_)
+        {
+            char* region = MapAligned(SPAN_SIZE * REGION_SPAN_COUNT);
+            if (nullptr == region)
+            {
+                return nullptr;
+            }
+            mapped_bytes_.fetch_add(SPAN_SIZE * REGION_SPAN_COUNT, std::memory_order_relaxed);
+            region_cursor_ = region;
+            region_end_ = region + SPAN_SIZE * REGION_SPAN_COUNT;
+        }
+        char* span = region_cursor_;
+        region_cursor_ += SPAN_SIZE;
+        SpanHeader* header = new (span) SpanHeader();
+        header->class_index = index;
+        return span;
+    }
+    /*
+    * 大内存块单独向系统申请,同样按 span 对齐并带 span 头部
+    */
+    char* AllocateLarge(std::size_t size)
+    {
+        std::size_t mapped_size = (size + SPAN_HEADER_SIZE + 0xFFFF) & ~std::size_t(0xFFFF);
+        char* span = MapAligned(mapped_size);
+        if (nullptr == span)
+        {
+            return nullptr;
+        }
+        mapped_bytes_.fetch_add(mapped_size, std::memory_order_relaxed);
+        SpanHeader* header = new (span) SpanHeader();
+        header->class_index = LARGE_CLASS;
+        header->mapped_size = mapped_size;
+        return span + SPAN_HEADER_SIZE;
+    }
+    /*
+    * 向系统申请按 SPAN_SIZE 对齐的内存
+    */
+    static char* MapAligned(std::size_t size)
+    {
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
+        return static_cast<char*>(_aligned_malloc(size, SPAN_SIZE));
+#else
+        std::size_t map_size = size + SPAN_SIZE;
+        void* raw = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (MAP_FAILED == raw)
+        {
+            return nullptr;
+        }
+        // 多申请一个 span,裁掉对齐地址前后多余的部分
+        uintptr_t begin = reinterpret_cast<uintptr_t>(raw);
+        uintptr_t aligned = (begin + SPAN_SIZE - 1) & ~(uintptr_t(SPAN_SIZE) - 1);
+        if (aligned > begin)
+        {
+            munmap(raw, aligned - begin);
+        }
+        std::size_t tail = begin + map_size - (aligned + size);
+        if (tail > 0)
+        {
+            munmap(reinterpret_cast<void*>(aligned + size), tail);
+        }
+        return reinterpret_cast<char*>(aligned);
+#endif
+    }
+    /*
+    * 归还向系统申请的内存
+    */
+    static void Unmap(void* pointer, std::size_t size)
+    {
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
+        _aligned_free(pointer);
+#else
+        munmap(pointer, size);
+#endif
+    }
+
+private:
+    std::array<CentralList, ThreadCacheSizeClass::CLASS_COUNT> centrals_;   // 各级别的中心链表
+    std::mutex span_mutex_;                     // 保护 span 的分配
+    char* region_cursor_ = nullptr;             // 当前 region 中未分配的 span 起点
+    char* region_end_ = nullptr;                // 当前 region 的终点
+    std::atomic<std::size_t> mapped_bytes_ = 0; // 向系统申请的内存总量
+};
+
+inline ThreadCache::~ThreadCache()
+{
+    for (uint32_t index = 0; index < ThreadCacheSizeClass::CLASS_COUNT; index++)
+    {
+        pool_->ReleaseBatch(index, lists_[index], lists_[index].count);
+    }
+}
+
+inline void* ThreadCache::Allocate(uint32_t index)
+{
+    FreeList& list = lists_[index];
+    if (nullptr == list.head && !pool_->FetchBatch(index, list))
+    {
+        return nullptr;
+    }
+    void* pointer = list.head;
+    list.head = *reinterpret_cast<void**>(pointer);
+    list.count--;
+    return pointer;
+}
+
+inline void ThreadCache::Deallocate(void* pointer, uint32_t index)
+{
+    FreeList& list = lists_[index];
+    *reinterpret_cast<void**>(pointer) = list.head;
+    list.head = pointer;
+    list.count++;
+    uint32_t batch_size = ThreadCacheSizeClass::BatchSize(index);
+    if (list.count > batch_size * 2)
+    {
+        pool_->ReleaseBatch(index, list, batch_size);
+    }
+}
+
+};  // ToolBox
@@ -0,0 +1,420 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#if defined(__linux__)
+#include <climits>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace ToolBox{
+
+/*
+* 单消费者的阻塞等待[多生产者-单消费者队列使用]
+* 生产者入队后 Notify,只有消费者声明了正在等待才进入内核唤醒;消费者等待前再检查一次队列,不会错过通知.
+* Linux 下直接使用 futex 且支持超时,其他平台使用 std::atomic::wait.
+*/
+class MPSCWaiter
+{
+public:
+    /*
+    * 入队后通知,生产者调用
+    */
+    void Notify()
+    {
+        // 与 Wait 中的栅栏配对: 生产者的入队与消费者的等待声明至少有一方能看到另一方
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping_.load(std::memory_order_relaxed))
+        {
+            seq_.fetch_add(1, std::memory_order_release);
+            Wake();
+        }
+    }
+    /*
+    * 唤醒一次等待,任意线程调用.消费者尚未进入等待时,下一次等待立即返回,不会丢失
+    */
+    void WakeUp()
+    {
+        pending_.store(true, std::memory_order_seq_cst);
+        seq_.fetch_add(1, std::memory_order_release);
+        Wake();
+    }
+    /*
+    * 等待直到 ready() 为真、被 WakeUp 或超时,消费者调用
+    * @param ready 检查队列是否有数据
+    * @param timeout_ms 等待的毫秒数,小于 0 表示一直等待
+    * @return ready() 是否为真
+    */
+    template<typename Ready>
+    bool Wait(Ready&& ready, int32_t timeout_ms)
+    {
+        if (ready() || pending_.exchange(false, std::memory_order_acq_rel))
+        {
+            return ready();
+        }
+        uint32_t seq = seq_.load(std::memory_order_acquire);
+        sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!ready() && !pending_.load(std::memory_order_relaxed))
+        {
+            Sleep(seq, timeout_ms);
+        }
+        sleeping_.store(false, std::memory_order_relaxed);
+        // 睡眠中收到的 WakeUp 留到下一次等待消费,宁可多醒一次也不丢失
+        return ready();
+    }
+private:
+    void Wake()
+    {
+#if defined(__linux__)
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&seq_), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+        seq_.notify_one();
+#endif
+    }
+    void Sleep(uint32_t seq, int32_t timeout_ms)
+    {
+#if defined(__linux__)
+        struct timespec ts;
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+        // seq 已变化时立即返回
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&seq_), FUTEX_WAIT_PRIVATE, seq, timeout_ms < 0 ? nullptr : &ts, nullptr, 0);
+#else
+        if (timeout_ms < 0)
+        {
+            seq_.wait(seq, std::memory_order_acquire);
+            return;
+        }
+        // std::atomic::wait 不支持超时,按毫秒轮询
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        while (seq_.load(std::memory_order_acquire) == seq && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+#endif
+    }
+private:
+    std::atomic<uint32_t> seq_ = 0;         // 唤醒序号,futex 等待在它上面
+    std::atomic<bool> sleeping_ = false;    // 消费者是否声明了正在等待
+    std::atomic<bool> pending_ = false;     // 是否有未消费的 WakeUp
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex requires a plain 32-bit word");
+};
+
+/*
+* 有界无锁队列 [multi producer-single consumer]
+* 每个槽位带序号[Vyukov],生产者 CAS 竞争写位置,消费者只读写自己的位置,无 CAS.
+* 接口与 RingBufferSPSC 一致,可直接替换;Push 在队列满时返回 false.
+* Empty/Pop/PopBulk/Wait 只能由读线程调用, Push/Full/Count/WakeUp 任意线程调用.
+* Type 数据类型
+* Size 队列长度,向上取2的幂
+* Blocking 是否支持 Wait,开启后每次入队多一次内存栅栏
+*/
+template<typename Type, std::size_t Size, bool Blocking = false>
+class MPSCRingBuffer
+{
+public:
+    static constexpr std::size_t CACHE_LINE_SIZE = 64;
+    static constexpr std::size_t CAPACITY = std::bit_ceil(Size);
+    static_assert(Size > 1, "MPSCRingBuffer size must be greater than 1");
+    /*
+    * 构造
+    */
+    MPSCRingBuffer()
+        : cells_(new Cell[CAPACITY])
+    {
+        for (std::size_t index = 0; index < CAPACITY; index++)
+        {
+            cells_[index].sequence.store(index, std::memory_order_relaxed);
+        }
+    }
+    MPSCRingBuffer(const MPSCRingBuffer&) = delete;
+    MPSCRingBuffer& operator=(const MPSCRingBuffer&) = delete;
+    /*
+    * 判空,读线程调用.生产者已占用但尚未写完的槽位视为空
+    */
+    bool Empty() const
+    {
+        auto read_pos = read_pos_.load(std::memory_order_relaxed);
+        return cells_[read_pos & MASK].sequence.load(std::memory_order_acquire) != read_pos + 1;
+    }
+    /*
+    * 判满,任意线程调用[仅作为参考,并发入队时 Push 仍可能失败]
+    */
+    bool Full() const
+    {
+        return Count() >= CAPACITY;
+    }
+    /*
+    * 当前元素数量,任意线程调用[仅作为统计参考]
+    */
+    std::size_t Count() const
+    {
+        auto read_pos = read_pos_.load(std::memory_order_acquire);
+        auto write_pos = write_pos_.load(std::memory_order_acquire);
+        return write_pos > read_pos ? write_pos - read_pos : 0;
+    }
+    /*
+    * 入队列,任意线程调用
+    * @return 队列满时返回 false
+    */
+    bool Push(Type&& type)
+    {
+        auto write_pos = write_pos_.load(std::memory_order_relaxed);
+        Cell* cell = nullptr;
+        while (true)
+        {
+            cell = &cells_[write_pos & MASK];
+            auto sequence = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(write_pos);
+            if (0 == diff)
+            {
+                if (write_pos_.compare_exchange_weak(write_pos, write_pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                // 槽位还没被读走,队列满
+                return false;
+            }
+            else
+            {
+                write_pos = write_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::move(type);
+        cell->sequence.store(write_pos + 1, std::memory_order_release);
+        if constexpr (Blocking)
+        {
+            waiter_.Notify();
+        }
+        return true;
+    }
+    /*
+    * 出队列,读线程调用.调用前须确认非空
+    */
+    Type Pop()
+    {
+        Type type{};
+        PopBulk(&type, 1);
+        return type;
+    }
+    /*
+    * 批量出队列,读线程调用.遇到尚未写完的槽位即停止,保证顺序
+    * @param out 输出数组
+    * @param max_count 最多出队数量
+    * @return 实际出队数量
+    */
+    std::size_t PopBulk(Type* out, std::size_t max_count)
+    {
+        auto read_pos = read_pos_.load(std::memory_order_relaxed);
+        std::size_t count = 0;
+        for (; count < max_count; count++)
+        {
+            Cell& cell = cells_[(read_pos + count) & MASK];
+            if (cell.sequence.load(std::memory_order_acquire) != read_pos + count + 1)
+            {
+                break;
+            }
+            out[count] = std::move(cell.data);
+            // 槽位交还给下一轮的生产者
+            cell.sequence.store(read_pos + count + CAPACITY, std::memory_order_release);
+        }
+        if (count > 0)
+        {
+            read_pos_.store(read_pos + count, std::memory_order_relaxed);
+        }
+        return count;
+    }
+    /*
+    * 等待队列非空,读线程调用
+    * @param timeout_ms 等待的毫秒数,小于 0 表示一直等待
+    * @return 队列是否非空[超时或被 WakeUp 时可能为空]
+    */
+    bool Wait(int32_t timeout_ms = -1)
+    {
+        static_assert(Blocking, "MPSCRingBuffer::Wait requires Blocking = true");
+        return waiter_.Wait([this]() { return !Empty(); }, timeout_ms);
+    }
+    /*
+    * 唤醒等待中的读线程[如退出时],任意线程调用
+    */
+    void WakeUp()
+    {
+        waiter_.WakeUp();
+    }
+    /*
+    * 清空,读线程调用
+    */
+    void Clear()
+    {
+        Type type{};
+        while (1 == PopBulk(&type, 1))
+        {
+        }
+    }
+private:
+    static constexpr std::size_t MASK = CAPACITY - 1;
+    struct Cell
+    {
+        std::atomic<std::size_t> sequence;  // 等于位置时可写,等于位置+1 时可读
+        Type data{};
+    };
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> write_pos_ = 0;   // 写位置,生产者竞争
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> read_pos_ = 0;    // 读位置,只有读线程修改
+    alignas(CACHE_LINE_SIZE) std::unique_ptr<Cell[]> cells_;            // 槽位
+    MPSCWaiter waiter_;                                                 // 阻塞等待
+};
+
+/*
+* 侵入式链表节点,放入 MPSCIntrusiveList 的类型须继承此类
+*/
+struct MPSCNode
+{
+    std::atomic<MPSCNode*> mpsc_next = nullptr;
+};
+
+/*
+* 无界侵入式无锁队列 [multi producer-single consumer,Vyukov]
+* 入队只有一次原子交换,不会失败也不分配内存,节点的所有权随入队交给读线程.
+* 入队与链接之间被打断的瞬间,读线程会暂时看不到之后的节点,Pop 返回空,稍后重试即可.
+* Empty/Pop/PopBulk/Wait 只能由读线程调用, Push/WakeUp 任意线程调用.
+* Node 节点类型,须继承 MPSCNode
+* Blocking 是否支持 Wait,开启后每次入队多一次内存栅栏
+*/
+template<typename Node, bool Blocking = false>
+class MPSCIntrusiveList
+{
+    static_assert(std::is_base_of_v<MPSCNode, Node>, "MPSCIntrusiveList node must derive from MPSCNode");
+public:
+    static constexpr std::size_t CACHE_LINE_SIZE = 64;
+    /*
+    * 构造
+    */
+    MPSCIntrusiveList()
+        : head_(&stub_), tail_(&stub_)
+    {
+    }
+    MPSCIntrusiveList(const MPSCIntrusiveList&) = delete;
+    MPSCIntrusiveList& operator=(const MPSCIntrusiveList&) = delete;
+    /*
+    * 判空,读线程调用
+    */
+    bool Empty() const
+    {
+        return tail_ == &stub_ && nullptr == stub_.mpsc_next.load(std::memory_order_acquire);
+    }
+    /*
+    * 入队列,任意线程调用
+    */
+    void Push(Node* node)
+    {
+        Link(node);
+        if constexpr (Blocking)
+        {
+            waiter_.Notify();
+        }
+    }
+    /*
+    * 出队列,读线程调用
+    * @return 节点,队列空时为 nullptr
+    */
+    Node* Pop()
+    {
+        MPSCNode* tail = tail_;
+        MPSCNode* next = tail->mpsc_next.load(std::memory_order_acquire);
+        if (tail == &stub_)
+        {
+            if (nullptr == next)
+            {
+                return nullptr;
+            }
+            tail_ = next;
+            tail = next;
+            next = next->mpsc_next.load(std::memory_order_acquire);
+        }
+        if (nullptr != next)
+        {
+            tail_ = next;
+            return static_cast<Node*>(tail);
+        }
+        if (tail != head_.load(std::memory_order_acquire))
+        {
+            // 生产者已交换了头部但还没链接上,稍后重试
+            return nullptr;
+        }
+        // 只剩最后一个节点,放回 stub 让它有后继
+        Link(&stub_);
+        next = tail->mpsc_next.load(std::memory_order_acquire);
+        if (nullptr != next)
+        {
+            tail_ = next;
+            return static_cast<Node*>(tail);
+        }
+        return nullptr;
+    }
+    /*
+    * 批量出队列,读线程调用
+    * @param out 输出数组
+    * @param max_count 最多出队数量
+    * @return 实际出队数量
+    */
+    std::size_t PopBulk(Node** out, std::size_t max_count)
+    {
+        std::size_t count = 0;
+        while (count < max_count)
+        {
+            Node* node = Pop();
+            if (nullptr == node)
+            {
+                break;
+            }
+            out[count++] = node;
+        }
+        return count;
+    }
+    /*
+    * 等待队列非空,读线程调用
+    * @param timeout_ms 等待的毫秒数,小于 0 表示一直等待
+    * @return 队列是否非空[超时或被 WakeUp 时可能为空]
+    */
+    bool Wait(int32_t timeout_ms = -1)
+    {
+        static_assert(Blocking, "MPSCIntrusiveList::Wait requires Blocking = true");
+        return waiter_.Wait([this]() { return !Empty(); }, timeout_ms);
+    }
+    /*
+    * 唤醒等待中的读线程[如退出时],任意线程调用
+    */
+    void WakeUp()
+    {
+        waiter_.WakeUp();
+    }
+private:
+    /*
+    * 把节点链接到头部
+    */
+    void Link(MPSCNode* node)
+    {
+        node->mpsc_next.store(nullptr, std::memory_order_relaxed);
+        MPSCNode* prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->mpsc_next.store(node, std::memory_order_release);
+    }
+private:
+    alignas(CACHE_LINE_SIZE) std::atomic<MPSCNode*> head_;  // 最新入队的节点,生产者交换
+    alignas(CACHE_LINE_SIZE) MPSCNode* tail_;               // 下一个出队的节点,只有读线程修改
+    MPSCNode stub_;                                         // 哨兵节点
+    MPSCWaiter waiter_;                                     // 阻塞等待
+};
+
+};  // ToolBox
@@ -0,0 +1,291 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+#include "tools/singleton.h"
+#include "debug_print.h"
+
+namespace ToolBox
+{
+
+    /*
+    * 线程本地对象池: 每个线程一个弹匣[magazine],取对象与本线程归还都不加锁,不使用原子操作.
+    * 对象槽位记录分配它的弹匣.其他线程归还的对象先攒在归还线程本地,按所属弹匣每攒满一批,
+    * 用一次 CAS 整批挂到所属弹匣的回收栈上;所属线程本地用完时一次取走回收栈上的全部对象.
+    * 适合网络线程创建事件、逻辑线程销毁事件[或相反]的模式.
+    * 线程退出时弹匣不释放,留给之后新建的线程接管,其他线程仍可安全地归还属于它的对象.
+    * 线程与弹匣的对应关系按对象类型保存在 thread_local 中,因此每种对象类型只能有一个对象池,通过单例使用.
+    */
+    template<typename ObjectType, std::size_t Count = 128, std::size_t BatchCount = 64>
+    class ObjectPoolThreadLocal : public DebugPrint
+    {
+    private:
+        struct Magazine;
+        /*
+        * 对象槽位
+        */
+        struct Slot
+        {
+            Magazine* owner = nullptr;      // 分配该槽位的弹匣
+            Slot* next = nullptr;           // 空闲链表/回收栈中的下一个槽位
+            alignas(ObjectType) unsigned char storage[sizeof(ObjectType)];
+        };
+        /*
+        * 其他线程的弹匣的待归还批次
+        */
+        struct PendingBatch
+        {
+            Magazine* owner = nullptr;
+            Slot* head = nullptr;
+            Slot* tail = nullptr;
+            std::size_t count = 0;
+        };
+        /*
+        * 弹匣,同一时刻只属于一个线程
+        */
+        struct Magazine
+        {
+            Slot* free_list = nullptr;              // 本线程可用的槽位
+            std::atomic<Slot*> recycled = nullptr;  // 其他线程整批归还的槽位
+            std::vector<PendingBatch> pending;      // 本线程归还的、属于其他弹匣的槽位
+        };
+        /*
+        * 线程退出时交出弹匣
+        */
+        struct MagazineHolder
+        {
+            ObjectPoolThreadLocal* pool = nullptr;
+            Magazine* magazine = nullptr;
+            ~MagazineHolder()
+            {
+                if (nullptr != magazine)
+                {
+                    pool->Orphan(magazine);
+                }
+            }
+        };
+
+        friend class Singleton<ObjectPoolThreadLocal>;
+        /*
+        * 构造,只由单例调用
+        */
+        ObjectPoolThreadLocal() = default;
+
+    public:
+        ObjectPoolThreadLocal(const ObjectPoolThreadLocal&) = delete;
+        ObjectPoolThreadLocal(ObjectPoolThreadLocal&&) = delete;
+        ObjectPoolThreadLocal& operator=(const ObjectPoolThreadLocal&) = delete;
+        /*
+        * 获取对象
+        */
+        template<typename...Args>
+        ObjectType* GetObject(Args&&...args)
+        {
+            Magazine* magazine = LocalMagazine();
+            if (nullptr == magazine->free_list)
+            {
+                // 先取回其他线程归还的对象,仍没有时扩容
+                magazine->free_list = magazine->recycled.exchange(nullptr, std::memory_order_acquire);
+                if (nullptr == magazine->free_list)
+                {
+                    Expand(magazine);
+                }
+            }
+            Slot* slot = magazine->free_list;
+            magazine->free_list = slot->next;
+            return new (slot->storage) ObjectType(std::forward<Args>(args)...);
+        }
+        /*
+        * 归还对象,可以在任意线程归还
+        */
+        void GiveBack(ObjectType* object)
+        {
+            if (nullptr == object)
+            {
+                return;
+            }
+            object->~ObjectType();
+            Slot* slot = reinterpret_cast<Slot*>(reinterpret_cast<unsigned char*>(object) - offsetof(Slot, storage));
+            Magazine* magazine = LocalMagazine();
+            if (slot->owner == magazine)
+            {
+                slot->next = magazine->free_list;
+                magazine->free_list = slot;
+                return;
+            }
+            PendingBatch* batch = nullptr;
+            for (auto& pending : magazine->pending)
+            {
+                if (pending.owner == slot->owner)
+                {
+                    batch = &pending;
+                    break;
+                }
+            }
+            if (nullptr == batch)
+            {
+                batch = &magazine->pending.emplace_back();
+                batch->owner = slot->owner;
+            }
+            slot->next = batch->head;
+            batch->head = slot;
+            if (nullptr == batch->tail)
+            {
+                batch->tail = slot;
+            }
+            if (++batch->count >= BatchCount)
+            {
+                PushBatch(*batch);
+            }
+        }
+        /*
+        * 把本线程攒着的、属于其他线程的对象立即归还[批次未满时也归还]
+        */
+        void Flush()
+        {
+            for (auto& pending : LocalMagazine()->pending)
+            {
+                PushBatch(pending);
+            }
+        }
+        /*
+        * 已分配的对象槽位总数
+        */
+        std::size_t GetCapacity() const
+        {
+            return capacity_.load(std::memory_order_relaxed);
+        }
+        /*
+        * 测试打印
+        */
+        void DebugPrint()
+        {
+            if (!GetDebugStatus())
+            {
+                return;
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            Print("\n ========== ObjectPoolThreadLocal ========== \n");
+            Print("对象槽位个数:%zu,弹匣个数:%zu,无主弹匣个数:%zu\n", GetCapacity(), magazines_.size(), orphans_.size());
+            Print("\n ---------- ObjectPoolThreadLocal ---------- \n");
+        }
+
+    private:
+        /*
+        * 本线程的弹匣,首次使用时接管一个无主弹匣或新建
+        */
+        Magazine* LocalMagazine()
+        {
+            thread_local MagazineHolder holder;
+            if (nullptr == holder.magazine)
+            {
+                holder.pool = this;
+                holder.magazine = Adopt();
+            }
+            return holder.magazine;
+        }
+        /*
+        * 接管无主弹匣或新建弹匣[每个线程只调用一次]
+        */
+        Magazine* Adopt()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!orphans_.empty())
+            {
+                Magazine* magazine = orphans_.back();
+                orphans_.pop_back();
+                return magazine;
+            }
+            magazines_.emplace_back(std::make_unique<Magazine>());
+            return magazines_.back().get();
+        }
+        /*
+        * 线程退出,归还攒着的对象后交出弹匣
+        */
+        void Orphan(Magazine* magazine)
+        {
+            for (auto& pending : magazine->pending)
+            {
+                PushBatch(pending);
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            orphans_.push_back(magazine);
+        }
+        /*
+        * 把一批槽位整批挂到所属弹匣的回收栈上
+        */
+        void PushBatch(PendingBatch& batch)
+        {
+            if (0 == batch.count)
+            {
+                return;
+            }
+            Slot* head = batch.owner->recycled.load(std::memory_order_relaxed);
+            do
+            {
+                batch.tail->next = head;
+            }
+            while (!batch.owner->recycled.compare_exchange_weak(head, batch.head, std::memory_order_release, std::memory_order_relaxed));
+            batch.head = nullptr;
+            batch.tail = nullptr;
+            batch.count = 0;
+        }
+        /*
+        * 扩容: 一次分配 Count 个槽位放入弹匣的空闲链表
+        */
+        void Expand(Magazine* magazine)
+        {
+            auto slots = std::make_unique<Slot[]>(Count);
+            for (std::size_t i = 0; i < Count; i++)
+            {
+                slots[i].owner = magazine;
+                slots[i].next = i + 1 < Count ? &slots[i + 1] : magazine->free_list;
+            }
+            magazine->free_list = &slots[0];
+            capacity_.fetch_add(Count, std::memory_order_relaxed);
+            std::lock_guard<std::mutex> lock(mutex_);
+            slabs_.emplace_back(std::move(slots));
+        }
+
+    private:
+        std::mutex mutex_;                                      // 保护弹匣与内存块的登记,只在线程首次使用、线程退出与扩容时加锁
+        std::vector<std::unique_ptr<Magazine>> magazines_;      // 所有弹匣
+        std::vector<Magazine*> orphans_;                        // 线程已退出的弹匣
+        std::vector<std::unique_ptr<Slot[]>> slabs_;            // 槽位内存块
+        std::atomic<std::size_t> capacity_ = 0;                 // 槽位总数
+    };
+
+    /*
+    * 线程本地对象池单例
+    */
+    template<typename ObjectType>
+    static ObjectPoolThreadLocal<ObjectType>& GetObjectPoolThreadLocalMgrRef()
+    {
+        return *(Singleton<ObjectPoolThreadLocal<ObjectType>>::Instance());
+    }
+
+    /*
+    * 从线程本地对象池单例中构造一个对象
+    * @param ObjectType 对象类型
+    * @param Args 参数
+    */
+    template <typename ObjectType, typename...Args>
+    static ObjectType* GetObjectThreadLocal(Args&&...args)
+    {
+        return GetObjectPoolThreadLocalMgrRef<ObjectType>().GetObject(std::forward<Args>(args)...);
+    }
+
+    /*
+    * 归还对象到线程本地对象池单例
+    */
+    template<typename ObjectType>
+    static void GiveBackObjectThreadLocal(ObjectType* object)
+    {
+        GetObjectPoolThreadLocalMgrRef<ObjectType>().GiveBack(object);
+    }
+
+};  // ToolBox
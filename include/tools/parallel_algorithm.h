@@ -0,0 +1,250 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "tools/thread_pool_work_stealing.h"
+
+namespace ToolBox{
+
+/*
+* 并行算法: 在工作窃取线程池上递归二分区间,左半部分作为任务提交,右半部分就地执行,
+* 等待子任务时帮忙执行其他任务而不阻塞,因此可在工作线程内嵌套调用,也可在任意线程调用.
+* 每次二分只使用一个线程本地对象池中的任务对象,不按元素分配内存;归并排序只分配一次临时缓冲区.
+* grain 为不再二分的区间长度,为 0 时按线程数自动选取.
+*/
+namespace parallel_detail
+{
+    /*
+    * 自动选取的粒度: 每个线程约 8 段,便于窃取时均衡负载
+    */
+    inline std::size_t AutoGrain(const ThreadPoolWorkStealing& pool, std::size_t size, std::size_t grain)
+    {
+        if (grain > 0)
+        {
+            return grain;
+        }
+        return (std::max)(std::size_t(1), size / (pool.GetThreadNum() * 8));
+    }
+    /*
+    * 并行执行 left 与 right,都完成后返回;任一方抛出的异常在返回前重新抛出
+    */
+    template<typename Left, typename Right>
+    void ForkJoin(ThreadPoolWorkStealing& pool, Left&& left, Right&& right)
+    {
+        std::atomic<bool> done = false;
+        std::exception_ptr left_error;
+        pool.Post([&]
+        {
+            try
+            {
+                left();
+            }
+            catch (...)
+            {
+                left_error = std::current_exception();
+            }
+            done.store(true, std::memory_order_release);
+        });
+        std::exception_ptr right_error;
+        try
+        {
+            right();
+        }
+        catch (...)
+        {
+            right_error = std::current_exception();
+        }
+        while (!done.load(std::memory_order_acquire))
+        {
+            if (!pool.RunPendingTask())
+            {
+                std::this_thread::yield();
+            }
+        }
+        if (left_error)
+        {
+            std::rethrow_exception(left_error);
+        }
+        if (right_error)
+        {
+            std::rethrow_exception(right_error);
+        }
+    }
+    template<typename Index, typename Func>
+    void ForRange(ThreadPoolWorkStealing& pool, Index begin, Index end, std::size_t grain, Func& func)
+    {
+        if (std::size_t(end - begin) <= grain)
+        {
+            func(begin, end);
+            return;
+        }
+        Index mid = begin + (end - begin) / 2;
+        ForkJoin(pool, [&] { ForRange(pool, begin, mid, grain, func); }, [&] { ForRange(pool, mid, end, grain, func); });
+    }
+    template<typename Iterator, typename Type, typename ReduceOp>
+    Type Reduce(ThreadPoolWorkStealing& pool, Iterator first, Iterator last, const Type& identity, std::size_t grain, ReduceOp& reduce)
+    {
+        if (std::size_t(last - first) <= grain)
+        {
+            Type result = identity;
+            for (; first != last; ++first)
+            {
+                result = reduce(std::move(result), *first);
+            }
+            return result;
+        }
+        Iterator mid = first + (last - first) / 2;
+        Type left = identity;
+        Type right = identity;
+        ForkJoin(pool, [&] { left = Reduce(pool, first, mid, identity, grain, reduce); },
+                       [&] { right = Reduce(pool, mid, last, identity, grain, reduce); });
+        return reduce(std::move(left), std::move(right));
+    }
+    /*
+    * 并行归并两个有序区间到 out: 取较长区间的中点,在另一区间二分查找分界,两侧分别归并
+    */
+    template<typename Iterator, typename OutIterator, typename Compare>
+    void Merge(ThreadPoolWorkStealing& pool, Iterator first1, Iterator last1, Iterator first2, Iterator last2, OutIterator out, std::size_t grain, Compare& comp)
+    {
+        std::size_t size1 = std::size_t(last1 - first1);
+        std::size_t size2 = std::size_t(last2 - first2);
+        if (size1 + size2 <= grain)
+        {
+            std::merge(std::make_move_iterator(first1), std::make_move_iterator(last1),
+                       std::make_move_iterator(first2), std::make_move_iterator(last2), out, comp);
+            return;
+        }
+        if (size1 < size2)
+        {
+            // 保证第一个区间较长;相等元素仍取自原第一个区间之前,归并保持稳定
+            Iterator mid2 = first2 + size2 / 2;
+            Iterator mid1 = std::upper_bound(first1, last1, *mid2, comp);
+            OutIterator out_mid = out + (mid1 - first1) + (mid2 - first2);
+            ForkJoin(pool, [&] { Merge(pool, first1, mid1, first2, mid2, out, grain, comp); },
+                           [&] { Merge(pool, mid1, last1, mid2, last2, out_mid, grain, comp); });
+            return;
+        }
+        Iterator mid1 = first1 + size1 / 2;
+        Iterator mid2 = std::lower_bound(first2, last2, *mid1, comp);
+        OutIterator out_mid = out + (mid1 - first1) + (mid2 - first2);
+        ForkJoin(pool, [&] { Merge(pool, first1, mid1, first2, mid2, out, grain, comp); },
+                       [&] { Merge(pool, mid1, last1, mid2, last2, out_mid, grain, comp); });
+    }
+    /*
+    * 归并排序 [first, last),buffer 为等长的临时区间;结果在 first 中
+    */
+    template<typename Iterator, typename BufferIterator, typename Compare>
+    void Sort(ThreadPoolWorkStealing& pool, Iterator first, Iterator last, BufferIterator buffer, std::size_t grain, Compare& comp)
+    {
+        std::size_t size = std::size_t(last - first);
+        if (size <= grain)
+        {
+            std::stable_sort(first, last, comp);
+            return;
+        }
+        Iterator mid = first + size / 2;
+        ForkJoin(pool, [&] { Sort(pool, first, mid, buffer, grain, comp); },
+                       [&] { Sort(pool, mid, last, buffer + (mid - first), grain, comp); });
+        Merge(pool, first, mid, mid, last, buffer, grain, comp);
+        auto move_back = [&](std::size_t begin, std::size_t end)
+        {
+            std::move(buffer + begin, buffer + end, first + begin);
+        };
+        ForRange(pool, std::size_t(0), size, grain, move_back);
+    }
+};  // parallel_detail
+
+/*
+* 并行遍历下标区间 [begin, end),对每个下标调用 func(index)
+*/
+template<typename Index, typename Func>
+void ParallelFor(ThreadPoolWorkStealing& pool, Index begin, Index end, Func&& func, std::size_t grain = 0)
+{
+    if (!(begin < end))
+    {
+        return;
+    }
+    grain = parallel_detail::AutoGrain(pool, std::size_t(end - begin), grain);
+    auto range = [&func](Index first, Index last)
+    {
+        for (; first != last; ++first)
+        {
+            func(first);
+        }
+    };
+    parallel_detail::ForRange(pool, begin, end, grain, range);
+}
+
+/*
+* 并行遍历下标区间 [begin, end),对每一段调用 func(first, last),便于在段内复用局部状态
+*/
+template<typename Index, typename Func>
+void ParallelForRange(ThreadPoolWorkStealing& pool, Index begin, Index end, Func&& func, std::size_t grain = 0)
+{
+    if (!(begin < end))
+    {
+        return;
+    }
+    grain = parallel_detail::AutoGrain(pool, std::size_t(end - begin), grain);
+    parallel_detail::ForRange(pool, begin, end, grain, func);
+}
+
+/*
+* 并行归约 [first, last): reduce 须满足结合律,identity 为单位元
+* @return 归约结果
+*/
+template<typename Iterator, typename Type, typename ReduceOp = std::plus<>>
+Type ParallelReduce(ThreadPoolWorkStealing& pool, Iterator first, Iterator last, Type identity, ReduceOp reduce = ReduceOp(), std::size_t grain = 0)
+{
+    if (first == last)
+    {
+        return identity;
+    }
+    grain = parallel_detail::AutoGrain(pool, std::size_t(last - first), grain);
+    return parallel_detail::Reduce(pool, first, last, identity, grain, reduce);
+}
+
+/*
+* 并行变换: out[i] = op(first[i])
+* @return 输出区间的尾后迭代器
+*/
+template<typename Iterator, typename OutIterator, typename Operation>
+OutIterator ParallelTransform(ThreadPoolWorkStealing& pool, Iterator first, Iterator last, OutIterator out, Operation&& op, std::size_t grain = 0)
+{
+    std::size_t size = std::size_t(last - first);
+    ParallelForRange(pool, std::size_t(0), size, [&](std::size_t begin, std::size_t end)
+    {
+        std::transform(first + begin, first + end, out + begin, op);
+    }, grain);
+    return out + size;
+}
+
+/*
+* 并行稳定归并排序 [first, last),只分配一次与区间等长的临时缓冲区.
+* 元素移入缓冲区后在缓冲区中排序,原区间作为归并的临时区间,最后移回,元素只需可移动构造,不要求默认构造
+*/
+template<typename Iterator, typename Compare = std::less<>>
+void ParallelSort(ThreadPoolWorkStealing& pool, Iterator first, Iterator last, Compare comp = Compare(), std::size_t grain = 0)
+{
+    std::size_t size = std::size_t(last - first);
+    if (size < 2)
+    {
+        return;
+    }
+    grain = (std::max)(parallel_detail::AutoGrain(pool, size, grain), std::size_t(2));
+    std::vector<typename std::iterator_traits<Iterator>::value_type> buffer(std::make_move_iterator(first), std::make_move_iterator(last));
+    parallel_detail::Sort(pool, buffer.begin(), buffer.end(), first, grain, comp);
+    auto move_back = [&](std::size_t begin, std::size_t end)
+    {
+        std::move(buffer.begin() + begin, buffer.begin() + end, first + begin);
+    };
+    parallel_detail::ForRange(pool, std::size_t(0), size, grain, move_back);
+}
+
+};  // ToolBox
@@ -4,10 +4,127 @@
 #include <string.h>
 #include <atomic>
 #include <array>
+#include <bit>
+#include <vector>
 #include "debug_print.h"
+#if defined(__linux__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 namespace ToolBox{
-    
+
+/*
+* 环形队列的内存块分配器,未设置时直接 new/delete.
+* 分配出的内存块必须能被 delete[] 释放,以便环形队列随时切换分配器.
+*/
+class RingBufferAllocator
+{
+public:
+    virtual ~RingBufferAllocator() = default;
+    /*
+    * 分配内存块
+    * @param size 内存块大小[2的幂]
+    */
+    virtual char* Allocate(std::size_t size) = 0;
+    /*
+    * 归还内存块
+    * @param buffer 内存块
+    * @param size 内存块大小
+    */
+    virtual void Deallocate(char* buffer, std::size_t size) = 0;
+};
+
+/*
+* 按2的幂大小分级缓存内存块的分配器[非线程安全,每个线程一个]
+* 环形队列缩容时把内存块还回来,其他环形队列扩容时直接复用,缓存总量超过上限的内存块直接释放
+*/
+class RingBufferSlab : public RingBufferAllocator
+{
+public:
+    /*
+    * 构造
+    * @param max_cached_bytes 最多缓存的字节数
+    */
+    explicit RingBufferSlab(std::size_t max_cached_bytes = 64 * 1024 * 1024)
+        : max_cached_bytes_(max_cached_bytes)
+    {
+    }
+    /*
+    * 析构
+    */
+    ~RingBufferSlab()
+    {
+        for (auto& free_list : free_lists_)
+        {
+            for (auto* buffer : free_list)
+            {
+                delete[] buffer;
+            }
+        }
+    }
+    char* Allocate(std::size_t size) override
+    {
+        in_use_bytes_ += size;
+        std::size_t index = SizeClass(size);
+        if (index < free_lists_.size() && !free_lists_[index].empty())
+        {
+            char* buffer = free_lists_[index].back();
+            free_lists_[index].pop_back();
+            cached_bytes_ -= size;
+            return buffer;
+        }
+        return new char[size];
+    }
+    void Deallocate(char* buffer, std::size_t size) override
+    {
+        in_use_bytes_ -= size;
+        std::size_t index = SizeClass(size);
+        if (cached_bytes_ + size > max_cached_bytes_)
+        {
+            delete[] buffer;
+            return;
+        }
+        if (index >= free_lists_.size())
+        {
+            free_lists_.resize(index + 1);
+        }
+        free_lists_[index].emplace_back(buffer);
+        cached_bytes_ += size;
+    }
+    /*
+    * 正在被环形队列使用的字节数
+    */
+    std::size_t GetInUseBytes() const { return in_use_bytes_; }
+    /*
+    * 缓存中的字节数
+    */
+    std::size_t GetCachedBytes() const { return cached_bytes_; }
+    /*
+    * 设置最多缓存的字节数
+    */
+    void SetMaxCachedBytes(std::size_t max_cached_bytes) { max_cached_bytes_ = max_cached_bytes; }
+private:
+    /*
+    * 大小对应的级别,即 log2(size)
+    */
+    static std::size_t SizeClass(std::size_t size)
+    {
+        std::size_t index = 0;
+        while ((std::size_t(1) << index) < size)
+        {
+            index++;
+        }
+        return index;
+    }
+private:
+    std::vector<std::vector<char*>> free_lists_;    // 按 log2(大小) 分级的空闲内存块
+    std::size_t max_cached_bytes_ = 0;              // 最多缓存的字节数
+    std::size_t cached_bytes_ = 0;                  // 缓存中的字节数
+    std::size_t in_use_bytes_ = 0;                  // 正在使用的字节数
+};
+
 /*
 * 非线程安全的环形队列
 * Type 数据类型
@@ -33,11 +150,37 @@ public:
     {
         if(nullptr != buffer_)
         {
-            delete[] buffer_;
+            Deallocate(buffer_, buffer_size_);
             buffer_ = nullptr;
         }
         
     }
+    /*
+    * 设置内存块分配器,现有数据搬到新分配器的内存块中
+    * @param allocator 分配器,为 nullptr 时直接 new/delete
+    */
+    void SetAllocator(RingBufferAllocator* allocator)
+    {
+        if (allocator == allocator_)
+        {
+            return;
+        }
+        Rebuild(buffer_size_, allocator);
+    }
+    /*
+    * 调整缓冲区大小,向上取2的幂且不小于已有数据,用于扩容或空闲时缩容
+    * @param size 期望的大小
+    * @return 是否成功
+    */
+    bool Resize(std::size_t size)
+    {
+        size = RebuildNum((std::max)(size, ReadableSize() + 1));
+        if (size == buffer_size_)
+        {
+            return true;
+        }
+        return Rebuild(size, allocator_);
+    }
 
     /*
     * 清理缓冲区
@@ -105,6 +248,29 @@ public:
         return buffer_ + read_pos_;
     }
     /*
+    * 获取全部可读数据的内存段[回绕时为两段],供 writev 一次性聚合发送
+    * @param data 各段起始地址
+    * @param size 各段长度
+    * @return 段数量 0~2
+    */
+    std::size_t ReadableSegments(char* (&data)[2], std::size_t (&size)[2])
+    {
+        std::size_t total = ReadableSize();
+        if (0 == total)
+        {
+            return 0;
+        }
+        data[0] = buffer_ + read_pos_;
+        size[0] = ContinuouslyReadableSize();
+        if (size[0] == total)
+        {
+            return 1;
+        }
+        data[1] = buffer_;
+        size[1] = total - size[0];
+        return 2;
+    }
+    /*
     * 调整读位置
     */
     void AdjustReadPos(std::size_t size)
@@ -154,7 +320,20 @@ public:
                 return 0;
             }
         }
-        len = (std::min)(len, WriteableSize());
+        return WriteNoEnlage(buffer, len);
+    }
+    /*
+    * 写入,不扩容[缓冲区内存被外部引用时使用]
+    * @param buffer 读取数组的指针
+    * @param len 读取数组的长度
+    * @return std::size_t 返回实际写入的长度,剩余空间不足时为 0
+    */
+    std::size_t WriteNoEnlage(const char* buffer, std::size_t len)
+    {
+        if(WriteableSize() < len)
+        {
+            return 0;
+        }
         auto rbytes = (std::min)(len, buffer_size_ - write_pos_);
         memmove(buffer_ + (write_pos_ & (buffer_size_ - 1)), buffer, rbytes);
         memmove(buffer_, buffer + rbytes, len - rbytes);
@@ -190,6 +369,27 @@ public:
         return len;
     }
     /*
+    * 从读位置之后的偏移处读取而不移动读游标
+    * @param offset 相对读位置的偏移
+    * @param buffer 拷贝的内存指针
+    * @param len  拷贝的长度
+    * @return std::size_t 返回实际拷贝的长度
+    */
+    std::size_t CopyAt(std::size_t offset, char* buffer, std::size_t len)
+    {
+        auto readable = ReadableSize();
+        if (offset >= readable)
+        {
+            return 0;
+        }
+        len = (std::min)(len, readable - offset);
+        auto pos = (read_pos_ + offset) % buffer_size_;
+        auto rbytes = (std::min)(len, buffer_size_ - pos);
+        memmove(buffer, buffer_ + pos, rbytes);
+        memmove(buffer + rbytes, buffer_, len - rbytes);
+        return len;
+    }
+    /*
     * 擦除
     * @param len 擦除的长度
     */
@@ -208,16 +408,7 @@ public:
         {
             return false;
         }
-        auto size = ReadableSize();
-        auto new_size = buffer_size_ * 2;
-        auto buffer = new char[new_size];
-        Read(buffer, size);
-        buffer_size_ = new_size;
-        read_pos_ = 0;
-        write_pos_ = size;
-        delete[] buffer_;
-        buffer_ = buffer;
-        return true;
+        return Rebuild(buffer_size_ * 2, allocator_);
     }
     /*
     * 按类型读取
@@ -286,6 +477,36 @@ public:
         SetDebugPrint(old_debug_status);
     }
 private:
+    /*
+    * 以新的大小与分配器重建缓冲区,保留可读数据
+    */
+    bool Rebuild(std::size_t new_size, RingBufferAllocator* allocator)
+    {
+        auto size = ReadableSize();
+        auto buffer = nullptr != allocator ? allocator->Allocate(new_size) : new char[new_size];
+        Read(buffer, size);
+        Deallocate(buffer_, buffer_size_);
+        allocator_ = allocator;
+        buffer_size_ = new_size;
+        read_pos_ = 0;
+        write_pos_ = size;
+        buffer_ = buffer;
+        return true;
+    }
+    /*
+    * 归还内存块
+    */
+    void Deallocate(char* buffer, std::size_t size)
+    {
+        if (nullptr != allocator_)
+        {
+            allocator_->Deallocate(buffer, size);
+        }
+        else
+        {
+            delete[] buffer;
+        }
+    }
     /*
     * 求大于等于(小于等于)一个整数最小2次幂算法
     * [算法原理见] https://blog.csdn.net/Kakarotto_/article/details/108958843
@@ -306,8 +527,424 @@ private:
     size_t read_pos_ = 0;       // 可读取位置
     char* buffer_ = nullptr;    // 缓冲区
     double ratio_ = 0;          // 警戒值
+    RingBufferAllocator* allocator_ = nullptr;  // 内存块分配器
 };
 
+#if defined(__linux__) || defined(__APPLE__)
+/*
+* 虚拟内存镜像的环形队列[非线程安全]
+* 同一块物理内存在虚拟地址上连续映射两次,读写位置之后的任意一段都是连续内存,
+* 回绕处不必拆成两段: 帧可以在缓冲区内原地解析,收发一次系统调用即可处理全部可读/可写数据.
+* 接口与 RingBuffer 一致,可直接替换;缓冲区大小向上取整到页大小的2的幂,每次扩容/缩容都要重新映射,不支持设置分配器.
+* Type 数据类型
+* Size 队列长度
+* Ratio 警戒值,超过此容量,队列长度会自动增长一倍
+*/
+template <typename Type, std::size_t Size, std::size_t Ratio = 75>
+class MirroredRingBuffer : public DebugPrint
+{
+public:
+    /*
+    * 构造函数,映射失败时 Valid() 为 false
+    */
+    MirroredRingBuffer()
+        : ratio_((double)Ratio / double(100.0))
+    {
+        Map(RoundSize(Size), buffer_, buffer_size_);
+    }
+    /*
+    * 析构
+    */
+    ~MirroredRingBuffer()
+    {
+        Unmap(buffer_, buffer_size_);
+        buffer_ = nullptr;
+    }
+    MirroredRingBuffer(const MirroredRingBuffer&) = delete;
+    MirroredRingBuffer& operator=(const MirroredRingBuffer&) = delete;
+    /*
+    * 是否映射成功
+    */
+    bool Valid() const
+    {
+        return nullptr != buffer_;
+    }
+    /*
+    * 调整缓冲区大小,向上取整且不小于已有数据,用于扩容或空闲时缩容
+    * @param size 期望的大小
+    * @return 是否成功
+    */
+    bool Resize(std::size_t size)
+    {
+        size = RoundSize((std::max)(size, ReadableSize()));
+        if (size == buffer_size_)
+        {
+            return true;
+        }
+        return Rebuild(size);
+    }
+    /*
+    * 清理缓冲区
+    */
+    void Clear()
+    {
+        write_pos_ = 0;
+        read_pos_ = 0;
+    }
+    /*
+    * 判断是否需要扩容
+    */
+    bool NeedEnlage(std::size_t new_len = 0)
+    {
+        auto ratio = (double)ReadableSize() / (double)buffer_size_;
+        return ratio > ratio_ || WriteableSize() < new_len;
+    }
+    /*
+    * 可写数据长度[读写位置单调递增,不需要空出一个元素判满]
+    */
+    std::size_t WriteableSize()
+    {
+        return buffer_size_ - ReadableSize();
+    }
+    /*
+    * 连续可写数据长度,即全部可写数据长度
+    */
+    std::size_t ContinuouslyWriteableSize()
+    {
+        while (NeedEnlage())
+        {
+            if (!Enlage())
+            {
+                return 0;
+            }
+        }
+        return WriteableSize();
+    }
+    /*
+    * 调整写位置
+    */
+    void AdjustWritePos(std::size_t size)
+    {
+        write_pos_ += size;
+    }
+    /*
+    * 获取可写位置指针,之后 WriteableSize() 字节连续可写
+    */
+    char* GetWritePtr()
+    {
+        return buffer_ + (write_pos_ & (buffer_size_ - 1));
+    }
+    /*
+    * 连续可读数据长度,即全部可读数据长度
+    */
+    std::size_t ContinuouslyReadableSize()
+    {
+        return ReadableSize();
+    }
+    /*
+    * 获取可读位置指针,之后 ReadableSize() 字节连续可读
+    */
+    char* GetReadPtr()
+    {
+        return buffer_ + (read_pos_ & (buffer_size_ - 1));
+    }
+    /*
+    * 获取全部可读数据的内存段,始终只有一段
+    * @param data 各段起始地址
+    * @param size 各段长度
+    * @return 段数量 0~1
+    */
+    std::size_t ReadableSegments(char* (&data)[2], std::size_t (&size)[2])
+    {
+        size[0] = ReadableSize();
+        if (0 == size[0])
+        {
+            return 0;
+        }
+        data[0] = GetReadPtr();
+        return 1;
+    }
+    /*
+    * 调整读位置
+    */
+    void AdjustReadPos(std::size_t size)
+    {
+        read_pos_ += size;
+    }
+    /*
+    * 可读数据长度
+    */
+    std::size_t ReadableSize()
+    {
+        return write_pos_ - read_pos_;
+    }
+    std::size_t ReadPos(){ return read_pos_ & (buffer_size_ - 1); }
+    std::size_t WritePos(){ return write_pos_ & (buffer_size_ - 1); }
+    /*
+    * 获取 buffer size
+    */
+    std::size_t GetBufferSize(){ return buffer_size_; }
+    /*
+    * 判空
+    */
+    bool Empty()
+    {
+        return ReadableSize() == 0;
+    }
+    /*
+    * 判满
+    */
+    bool Full()
+    {
+        return WriteableSize() == 0;
+    }
+    /*
+    * 写入
+    * @param buffer 读取数组的指针
+    * @param len 读取数组的长度
+    */
+    std::size_t Write(const char* buffer, std::size_t len)
+    {
+        while (NeedEnlage(len))
+        {
+            if (!Enlage())
+            {
+                return 0;
+            }
+        }
+        return WriteNoEnlage(buffer, len);
+    }
+    /*
+    * 写入,不扩容[缓冲区内存被外部引用时使用]
+    * @param buffer 读取数组的指针
+    * @param len 读取数组的长度
+    * @return std::size_t 返回实际写入的长度,剩余空间不足时为 0
+    */
+    std::size_t WriteNoEnlage(const char* buffer, std::size_t len)
+    {
+        if (WriteableSize() < len)
+        {
+            return 0;
+        }
+        memmove(GetWritePtr(), buffer, len);
+        write_pos_ += len;
+        return len;
+    }
+    /*
+    * 读取
+    * @param buffer 读取数组的指针
+    * @param len 读取数组的长度
+    * @return std::size_t 返回实际读出的长度
+    */
+    std::size_t Read(char* buffer, std::size_t len)
+    {
+        len = Copy(buffer, len);
+        read_pos_ += len;
+        return len;
+    }
+    /*
+    * 读取而不移动读游标
+    * @param buffer 拷贝的内存指针
+    * @param len  拷贝的长度
+    */
+    std::size_t Copy(char* buffer, std::size_t len)
+    {
+        len = (std::min)(len, ReadableSize());
+        memmove(buffer, GetReadPtr(), len);
+        return len;
+    }
+    /*
+    * 从读位置之后的偏移处读取而不移动读游标
+    * @param offset 相对读位置的偏移
+    * @param buffer 拷贝的内存指针
+    * @param len  拷贝的长度
+    * @return std::size_t 返回实际拷贝的长度
+    */
+    std::size_t CopyAt(std::size_t offset, char* buffer, std::size_t len)
+    {
+        auto readable = ReadableSize();
+        if (offset >= readable)
+        {
+            return 0;
+        }
+        len = (std::min)(len, readable - offset);
+        memmove(buffer, GetReadPtr() + offset, len);
+        return len;
+    }
+    /*
+    * 擦除
+    * @param len 擦除的长度
+    */
+    std::size_t Remove(std::size_t len)
+    {
+        len = (std::min)(len, ReadableSize());
+        read_pos_ += len;
+        return len;
+    }
+    /*
+    * 缓冲区扩容一倍
+    */
+    bool Enlage()
+    {
+        if (buffer_size_ > SIZE_MAX / 4)
+        {
+            return false;
+        }
+        return Rebuild(buffer_size_ * 2);
+    }
+    /*
+    * 按类型读取
+    * @param 读取的类型
+    */
+    template<typename OType>
+    bool Read(OType& type)
+    {
+        if (ReadableSize() < sizeof(OType))
+        {
+            return false;
+        }
+        Read((char*)(&type), sizeof(OType));
+        return true;
+    }
+    /*
+    * 按类型写
+    * @param type 写入的类型
+    */
+    template<typename OType>
+    bool Write(const OType& type)
+    {
+        return sizeof(OType) == Write((const char*)(&type), sizeof(OType));
+    }
+    /*
+    * 按类型拷贝
+    * @param type 拷贝的类型
+    */
+    template<typename OType>
+    bool Copy(OType& type)
+    {
+        if (ReadableSize() < sizeof(OType))
+        {
+            return false;
+        }
+        Copy((char*)(&type), sizeof(OType));
+        return true;
+    }
+    /*
+    * 测试打印
+    */
+    void DebugPrint(bool force = false, bool detail = true)
+    {
+        bool old_debug_status = GetDebugStatus();
+        if (false == force && false == old_debug_status)
+        {
+            return;
+        }
+        SetDebugPrint(true);
+        Print("\n ========== MirroredRingBuffer ========== \n");
+        Print("缓冲区大小:%zu,读位置:%zu,写位置:%zu,警戒值:%f\n", buffer_size_, ReadPos(), WritePos(), ratio_);
+        for (size_t i = 0; true == detail && i < buffer_size_; i++)
+        {
+            Print("0x%02X ", buffer_[i]);
+        }
+        Print("\n ---------- MirroredRingBuffer ---------- \n");
+        SetDebugPrint(old_debug_status);
+    }
+private:
+    /*
+    * 以新的大小重新映射缓冲区,保留可读数据
+    */
+    bool Rebuild(std::size_t new_size)
+    {
+        char* buffer = nullptr;
+        std::size_t buffer_size = 0;
+        if (!Map(new_size, buffer, buffer_size))
+        {
+            return false;
+        }
+        auto size = ReadableSize();
+        memcpy(buffer, GetReadPtr(), size);
+        Unmap(buffer_, buffer_size_);
+        buffer_ = buffer;
+        buffer_size_ = buffer_size;
+        read_pos_ = 0;
+        write_pos_ = size;
+        return true;
+    }
+    /*
+    * 映射两份相同的物理内存: 先保留 2*size 的地址空间,再把同一个匿名文件覆盖映射到前后两半.
+    * 映射建立后即可关闭文件,映射本身持有引用,不长期占用文件描述符.
+    */
+    static bool Map(std::size_t size, char*& buffer, std::size_t& buffer_size)
+    {
+#if defined(__linux__)
+        int fd = memfd_create("toolbox_ring", MFD_CLOEXEC);
+#else
+        // macOS 没有 memfd,用随即删除的共享内存对象代替
+        char name[64];
+        snprintf(name, sizeof(name), "/toolbox_ring_%d_%p", getpid(), (void*)&buffer);
+        int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        shm_unlink(name);
+#endif
+        if (fd < 0)
+        {
+            return false;
+        }
+        if (0 != ftruncate(fd, (off_t)size))
+        {
+            close(fd);
+            return false;
+        }
+        void* base = mmap(nullptr, size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (MAP_FAILED == base)
+        {
+            close(fd);
+            return false;
+        }
+        char* addr = static_cast<char*>(base);
+        if (MAP_FAILED == mmap(addr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0)
+                || MAP_FAILED == mmap(addr + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0))
+        {
+            munmap(base, size * 2);
+            close(fd);
+            return false;
+        }
+        close(fd);
+        buffer = addr;
+        buffer_size = size;
+        return true;
+    }
+    /*
+    * 解除映射
+    */
+    static void Unmap(char* buffer, std::size_t size)
+    {
+        if (nullptr != buffer)
+        {
+            munmap(buffer, size * 2);
+        }
+    }
+    /*
+    * 向上取整到不小于页大小的2的幂
+    */
+    static std::size_t RoundSize(std::size_t num)
+    {
+        static const std::size_t page_size = std::size_t(sysconf(_SC_PAGESIZE));
+        std::size_t size = page_size;
+        while (size < num)
+        {
+            size <<= 1;
+        }
+        return size;
+    }
+private:
+    std::size_t buffer_size_ = 0;   // 缓冲区的长度[映射的地址空间为两倍]
+    std::size_t write_pos_ = 0;     // 累计写入位置,取模后为可写入位置
+    std::size_t read_pos_ = 0;      // 累计读取位置,取模后为可读取位置
+    char* buffer_ = nullptr;        // 缓冲区
+    double ratio_ = 0;              // 警戒值
+};
+#endif  // __linux__ || __APPLE__
+
 /*
 * 无锁循环队列 [single producer-single consumer]
 */
@@ -340,6 +977,13 @@ public:
         return (Size == count_);
     }
     /*
+    * 当前元素数量,任意线程调用[仅作为统计参考]
+    */
+    std::size_t Count() const
+    {
+        return count_.load(std::memory_order_relaxed);
+    }
+    /*
     * 出队列,读线程调用
     */
     Type Pop()
@@ -350,6 +994,26 @@ public:
         return type;
     }
     /*
+    * 批量出队列,读线程调用.整批只做一次原子操作
+    * @param out 输出数组
+    * @param max_count 最多出队数量
+    * @return 实际出队数量
+    */
+    std::size_t PopBulk(Type* out, std::size_t max_count)
+    {
+        std::size_t count = (std::min)(max_count, count_.load());
+        for (std::size_t index = 0; index < count; index++)
+        {
+            out[index] = array_[read_pos_];
+            read_pos_ = (read_pos_ + 1) % Size;
+        }
+        if (count > 0)
+        {
+            count_.fetch_sub(count);
+        }
+        return count;
+    }
+    /*
     * 入队列,写线程调用
     */
     void Push(Type&& type)
@@ -374,4 +1038,147 @@ private:
     std::atomic<std::size_t> count_;    // 元素数量
 };
 
+/*
+* 无锁循环队列 [single producer-single consumer],RingBufferSPSC 的替代
+* 1. 生产者与消费者的位置各占一个缓存行,各自缓存对方的位置,只有缓存的位置显示满/空时才读取对方的缓存行.
+* 2. 位置单调递增,按2的幂掩码取下标;发布位置使用 release,读取对方位置使用 acquire.
+* 3. PushBulk/PopBulk 整批只发布一次位置.
+* Empty/Pop/PopBulk 只能由读线程调用, Full/Push/PushBulk 只能由写线程调用.
+* Type 数据类型
+* Size 队列长度
+*/
+template<typename Type, std::size_t Size>
+class RingBufferSPSCCached
+{
+public:
+    static constexpr std::size_t CACHE_LINE_SIZE = 64;
+    static_assert(Size > 0, "RingBufferSPSCCached size must be positive");
+    /*
+    * 判空,读线程调用
+    */
+    bool Empty()
+    {
+        auto read_pos = read_pos_.load(std::memory_order_relaxed);
+        if (cached_write_pos_ != read_pos)
+        {
+            return false;
+        }
+        cached_write_pos_ = write_pos_.load(std::memory_order_acquire);
+        return cached_write_pos_ == read_pos;
+    }
+    /*
+    * 判满,写线程调用
+    */
+    bool Full()
+    {
+        auto write_pos = write_pos_.load(std::memory_order_relaxed);
+        if (write_pos - cached_read_pos_ < Size)
+        {
+            return false;
+        }
+        cached_read_pos_ = read_pos_.load(std::memory_order_acquire);
+        return write_pos - cached_read_pos_ >= Size;
+    }
+    /*
+    * 当前元素数量,任意线程调用[仅作为统计参考]
+    */
+    std::size_t Count() const
+    {
+        // 先读读位置,后读到的写位置不会小于它
+        auto read_pos = read_pos_.load(std::memory_order_acquire);
+        return write_pos_.load(std::memory_order_acquire) - read_pos;
+    }
+    /*
+    * 出队列,读线程调用.调用前须确认非空
+    */
+    Type Pop()
+    {
+        auto read_pos = read_pos_.load(std::memory_order_relaxed);
+        Type type = std::move(array_[read_pos & MASK]);
+        read_pos_.store(read_pos + 1, std::memory_order_release);
+        return type;
+    }
+    /*
+    * 批量出队列,读线程调用
+    * @param out 输出数组
+    * @param max_count 最多出队数量
+    * @return 实际出队数量
+    */
+    std::size_t PopBulk(Type* out, std::size_t max_count)
+    {
+        auto read_pos = read_pos_.load(std::memory_order_relaxed);
+        if (cached_write_pos_ - read_pos < max_count)
+        {
+            cached_write_pos_ = write_pos_.load(std::memory_order_acquire);
+        }
+        std::size_t count = (std::min)(max_count, cached_write_pos_ - read_pos);
+        for (std::size_t index = 0; index < count; index++)
+        {
+            out[index] = std::move(array_[(read_pos + index) & MASK]);
+        }
+        if (count > 0)
+        {
+            read_pos_.store(read_pos + count, std::memory_order_release);
+        }
+        return count;
+    }
+    /*
+    * 入队列,写线程调用
+    * @return 队列满时返回 false
+    */
+    bool Push(Type&& type)
+    {
+        if (Full())
+        {
+            return false;
+        }
+        auto write_pos = write_pos_.load(std::memory_order_relaxed);
+        array_[write_pos & MASK] = std::move(type);
+        write_pos_.store(write_pos + 1, std::memory_order_release);
+        return true;
+    }
+    /*
+    * 批量入队列,写线程调用
+    * @param data 输入数组,入队的元素被移走
+    * @param count 数量
+    * @return 实际入队数量,队列剩余空间不足时只入队一部分
+    */
+    std::size_t PushBulk(Type* data, std::size_t count)
+    {
+        auto write_pos = write_pos_.load(std::memory_order_relaxed);
+        if (Size - (write_pos - cached_read_pos_) < count)
+        {
+            cached_read_pos_ = read_pos_.load(std::memory_order_acquire);
+        }
+        count = (std::min)(count, Size - (write_pos - cached_read_pos_));
+        for (std::size_t index = 0; index < count; index++)
+        {
+            array_[(write_pos + index) & MASK] = std::move(data[index]);
+        }
+        if (count > 0)
+        {
+            write_pos_.store(write_pos + count, std::memory_order_release);
+        }
+        return count;
+    }
+    /*
+    * 清空,读写两端都停止时调用
+    */
+    void Clear()
+    {
+        read_pos_.store(0, std::memory_order_relaxed);
+        write_pos_.store(0, std::memory_order_relaxed);
+        cached_read_pos_ = 0;
+        cached_write_pos_ = 0;
+    }
+private:
+    static constexpr std::size_t CAPACITY = std::bit_ceil(Size);    // 存储长度,向上取2的幂
+    static constexpr std::size_t MASK = CAPACITY - 1;
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> write_pos_ = 0;   // 写位置,写线程修改
+    std::size_t cached_read_pos_ = 0;                                   // 写线程缓存的读位置
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> read_pos_ = 0;    // 读位置,读线程修改
+    std::size_t cached_write_pos_ = 0;                                  // 读线程缓存的写位置
+    alignas(CACHE_LINE_SIZE) std::array<Type, CAPACITY> array_;         // 数据存储
+};
+
 };  // ToolBox
\ No newline at end of file
@@ -0,0 +1,527 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <semaphore>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "tools/object_pool_thread_local.h"
+
+namespace ToolBox{
+
+/*
+* 线程池任务: 可调用对象不超过 INLINE_SIZE 时就地存放[小对象优化],否则另行分配.
+* 任务对象取自线程本地对象池,提交与执行都不分配内存.
+*/
+class ThreadPoolTask
+{
+public:
+    static constexpr std::size_t INLINE_SIZE = 48;
+    ThreadPoolTask() = default;
+    ThreadPoolTask(const ThreadPoolTask&) = delete;
+    ThreadPoolTask& operator=(const ThreadPoolTask&) = delete;
+    ~ThreadPoolTask()
+    {
+        Reset();
+    }
+    /*
+    * 设置可调用对象
+    */
+    template<typename Function>
+    void Set(Function&& func)
+    {
+        using FuncType = std::decay_t<Function>;
+        Reset();
+        if constexpr (sizeof(FuncType) <= INLINE_SIZE && alignof(FuncType) <= alignof(std::max_align_t))
+        {
+            callable_ = new (storage_) FuncType(std::forward<Function>(func));
+            destroy_ = [](void* callable) { static_cast<FuncType*>(callable)->~FuncType(); };
+        }
+        else
+        {
+            callable_ = new FuncType(std::forward<Function>(func));
+            destroy_ = [](void* callable) { delete static_cast<FuncType*>(callable); };
+        }
+        invoke_ = [](void* callable) { (*static_cast<FuncType*>(callable))(); };
+    }
+    /*
+    * 执行并销毁可调用对象
+    */
+    void Run()
+    {
+        invoke_(callable_);
+        Reset();
+    }
+private:
+    void Reset()
+    {
+        if (nullptr != callable_)
+        {
+            destroy_(callable_);
+            callable_ = nullptr;
+        }
+    }
+private:
+    void (*invoke_)(void*) = nullptr;       // 调用
+    void (*destroy_)(void*) = nullptr;      // 销毁
+    void* callable_ = nullptr;              // 可调用对象,就地存放时指向 storage_
+    alignas(std::max_align_t) unsigned char storage_[INLINE_SIZE];
+};
+
+/*
+* Chase-Lev 工作窃取双端队列[固定容量]
+* 所属线程在底部压入与弹出,其他线程从顶部窃取;只存放指针,窃取失败时读到的值直接丢弃.
+* Capacity 容量,须为2的幂
+*/
+template<typename Type, std::size_t Capacity>
+class WorkStealingDeque
+{
+    static_assert(Capacity > 0 && 0 == (Capacity & (Capacity - 1)), "WorkStealingDeque capacity must be a power of two");
+public:
+    static constexpr std::size_t CACHE_LINE_SIZE = 64;
+    WorkStealingDeque()
+        : buffer_(new std::atomic<Type*>[Capacity])
+    {
+    }
+    /*
+    * 压入底部,所属线程调用
+    * @return 队列满时返回 false
+    */
+    bool Push(Type* item)
+    {
+        auto bottom = bottom_.load(std::memory_order_relaxed);
+        auto top = top_.load(std::memory_order_acquire);
+        if (bottom - top >= static_cast<int64_t>(Capacity))
+        {
+            return false;
+        }
+        buffer_[bottom & MASK].store(item, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+        return true;
+    }
+    /*
+    * 从底部弹出,所属线程调用
+    * @return 队列空或最后一个被窃取时为 nullptr
+    */
+    Type* Pop()
+    {
+        auto bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto top = top_.load(std::memory_order_relaxed);
+        if (top > bottom)
+        {
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        Type* item = buffer_[bottom & MASK].load(std::memory_order_relaxed);
+        if (top == bottom)
+        {
+            // 只剩最后一个,与窃取者竞争
+            if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                item = nullptr;
+            }
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+    /*
+    * 从顶部窃取,任意线程调用
+    * @return 队列空或与其他线程竞争失败时为 nullptr
+    */
+    Type* Steal()
+    {
+        auto top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto bottom = bottom_.load(std::memory_order_acquire);
+        if (top >= bottom)
+        {
+            return nullptr;
+        }
+        Type* item = buffer_[top & MASK].load(std::memory_order_relaxed);
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            return nullptr;
+        }
+        return item;
+    }
+    /*
+    * 元素数量,任意线程调用[仅作为参考]
+    */
+    std::size_t Count() const
+    {
+        auto bottom = bottom_.load(std::memory_order_relaxed);
+        auto top = top_.load(std::memory_order_relaxed);
+        return bottom > top ? std::size_t(bottom - top) : 0;
+    }
+private:
+    static constexpr int64_t MASK = static_cast<int64_t>(Capacity - 1);
+    alignas(CACHE_LINE_SIZE) std::atomic<int64_t> top_ = 0;     // 窃取端,窃取者 CAS 竞争
+    alignas(CACHE_LINE_SIZE) std::atomic<int64_t> bottom_ = 0;  // 所属线程端
+    std::unique_ptr<std::atomic<Type*>[]> buffer_;              // 存储
+};
+
+/*
+* 工作窃取线程池
+* 1. 每个工作线程一个 Chase-Lev 双端队列,工作线程内提交的任务压入自己的队列底部[后进先出,缓存友好],
+*    空闲时先取全局队列,再从其他线程的队列顶部窃取.
+* 2. 非工作线程提交的任务进入全局队列[互斥锁保护],工作线程每次取走一批,分摊加锁.
+* 3. 任务对象取自线程本地对象池,可调用对象就地存放;Post 不创建 future.
+* 4. 空闲线程自旋片刻后休眠,每次提交最多唤醒一个休眠线程,不会惊群.
+* 5. 停止后尚未执行的任务直接销毁,Add 返回的 future 得到 broken_promise.
+*/
+class ThreadPoolWorkStealing
+{
+public:
+    static constexpr std::size_t DEQUE_CAPACITY = 8192;     // 单个工作线程队列的容量,满了转入全局队列
+    static constexpr std::size_t INJECT_BATCH = 32;         // 从全局队列一次最多取走的任务数
+    static constexpr uint32_t SPIN_ROUNDS = 64;             // 休眠前的空转查找轮数
+    /*
+    * 构造
+    * @param n 线程数,不大于 0 时取硬件线程数
+    */
+    explicit ThreadPoolWorkStealing(int32_t n = 0)
+    {
+        int32_t nthreads = n;
+        if (nthreads <= 0)
+        {
+            nthreads = std::thread::hardware_concurrency();
+            nthreads = (nthreads == 0 ? 2 : nthreads);
+        }
+        for (int32_t i = 0; i < nthreads; i++)
+        {
+            workers_.emplace_back(std::make_unique<Worker>());
+        }
+        for (int32_t i = 0; i < nthreads; i++)
+        {
+            workers_[i]->thread = std::thread([this, i] { WorkerLoop(uint32_t(i)); });
+        }
+    }
+    /*
+    * 析构
+    */
+    ~ThreadPoolWorkStealing()
+    {
+        Stop();
+        for (auto& worker : workers_)
+        {
+            if (worker->thread.joinable())
+            {
+                worker->thread.join();
+            }
+        }
+        for (auto& worker : workers_)
+        {
+            while (ThreadPoolTask* task = worker->deque.Pop())
+            {
+                GiveBackObjectThreadLocal(task);
+            }
+        }
+        for (ThreadPoolTask* task : injector_)
+        {
+            GiveBackObjectThreadLocal(task);
+        }
+        injector_.clear();
+    }
+    ThreadPoolWorkStealing(const ThreadPoolWorkStealing&) = delete;
+    ThreadPoolWorkStealing& operator=(const ThreadPoolWorkStealing&) = delete;
+    /*
+    * 停止线程池,工作线程执行完当前任务后退出
+    */
+    void Stop()
+    {
+        stop_.store(true, std::memory_order_seq_cst);
+        for (auto& worker : workers_)
+        {
+            worker->wakeup.release();
+        }
+    }
+    /*
+    * 线程数
+    */
+    std::size_t GetThreadNum() const
+    {
+        return workers_.size();
+    }
+    /*
+    * 当前线程是否是本线程池的工作线程
+    */
+    bool IsWorkerThread() const
+    {
+        return current_pool_ == this;
+    }
+    /*
+    * 提交任务,不关心结果.停止后在工作线程中提交不抛异常,任务随线程池销毁
+    */
+    template<typename Function>
+    void Post(Function&& func)
+    {
+        if (stop_.load(std::memory_order_acquire) && !IsWorkerThread())
+        {
+            throw std::runtime_error("thread pool has stopped.");
+        }
+        ThreadPoolTask* task = GetObjectThreadLocal<ThreadPoolTask>();
+        task->Set(std::forward<Function>(func));
+        Submit(task);
+    }
+    /*
+    * 提交任务,通过 future 取得结果
+    */
+    template<typename Function, typename... Args>
+    std::future<typename std::invoke_result_t<Function, Args...>> Add(Function&& func, Args&&... args)
+    {
+        using return_type = typename std::invoke_result_t<Function, Args...>;
+        std::packaged_task<return_type()> packaged(std::bind(std::forward<Function>(func), std::forward<Args>(args)...));
+        auto ret = packaged.get_future();
+        Post([packaged = std::move(packaged)]() mutable { packaged(); });
+        return ret;
+    }
+    /*
+    * 在当前线程执行一个待执行的任务,用于 fork-join 中等待子任务时帮忙执行而不是阻塞
+    * @return 是否执行了任务
+    */
+    bool RunPendingTask()
+    {
+        uint32_t index = IsWorkerThread() ? current_index_ : uint32_t(workers_.size());
+        ThreadPoolTask* task = FindTask(index);
+        if (nullptr == task)
+        {
+            return false;
+        }
+        RunTask(task);
+        return true;
+    }
+private:
+    /*
+    * 工作线程
+    */
+    struct Worker
+    {
+        WorkStealingDeque<ThreadPoolTask, DEQUE_CAPACITY> deque;    // 本线程的任务队列
+        std::counting_semaphore<> wakeup{0};                        // 休眠与唤醒,多余的唤醒只会多查找一轮
+        std::thread thread;
+        uint32_t random = 0;                                        // 选择窃取对象的随机数
+    };
+    /*
+    * 提交任务: 工作线程压入自己的队列,否则进入全局队列,然后唤醒一个休眠线程
+    */
+    void Submit(ThreadPoolTask* task)
+    {
+        if (!IsWorkerThread() || !workers_[current_index_]->deque.Push(task))
+        {
+            std::lock_guard<std::mutex> lock(injector_mutex_);
+            injector_.emplace_back(task);
+            injector_size_.store(injector_.size(), std::memory_order_relaxed);
+        }
+        // 与休眠前的栅栏配对: 提交者看到休眠登记,或休眠者看到新任务
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parked_count_.load(std::memory_order_relaxed) > 0)
+        {
+            WakeOne();
+        }
+    }
+    /*
+    * 唤醒一个休眠的工作线程
+    */
+    void WakeOne()
+    {
+        uint32_t index = 0;
+        {
+            std::lock_guard<std::mutex> lock(parked_mutex_);
+            if (parked_.empty())
+            {
+                return;
+            }
+            index = parked_.back();
+            parked_.pop_back();
+            parked_count_.store(parked_.size(), std::memory_order_relaxed);
+        }
+        workers_[index]->wakeup.release();
+    }
+    /*
+    * 查找任务: 自己的队列、全局队列、其他线程的队列
+    * @param index 工作线程下标,非工作线程为线程数
+    */
+    ThreadPoolTask* FindTask(uint32_t index)
+    {
+        Worker* self = index < workers_.size() ? workers_[index].get() : nullptr;
+        if (nullptr != self)
+        {
+            if (ThreadPoolTask* task = self->deque.Pop())
+            {
+                return task;
+            }
+        }
+        if (ThreadPoolTask* task = TakeInjected(self))
+        {
+            return task;
+        }
+        return StealTask(index);
+    }
+    /*
+    * 从全局队列取一批,第一个返回,其余压入自己的队列供其他线程窃取
+    */
+    ThreadPoolTask* TakeInjected(Worker* self)
+    {
+        if (0 == injector_size_.load(std::memory_order_relaxed))
+        {
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(injector_mutex_);
+        if (injector_.empty())
+        {
+            return nullptr;
+        }
+        ThreadPoolTask* task = injector_.front();
+        injector_.pop_front();
+        if (nullptr != self)
+        {
+            std::size_t batch = (std::min)(INJECT_BATCH, injector_.size() / workers_.size());
+            for (std::size_t count = 0; count < batch && self->deque.Push(injector_.front()); count++)
+            {
+                injector_.pop_front();
+            }
+        }
+        injector_size_.store(injector_.size(), std::memory_order_relaxed);
+        return task;
+    }
+    /*
+    * 从随机起点开始依次窃取其他线程的任务
+    */
+    ThreadPoolTask* StealTask(uint32_t index)
+    {
+        std::size_t count = workers_.size();
+        uint32_t start = 0;
+        if (index < count)
+        {
+            // xorshift
+            uint32_t& random = workers_[index]->random;
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            start = random;
+        }
+        for (std::size_t offset = 0; offset < count; offset++)
+        {
+            std::size_t victim = (start + offset) % count;
+            if (victim == index)
+            {
+                continue;
+            }
+            if (ThreadPoolTask* task = workers_[victim]->deque.Steal())
+            {
+                return task;
+            }
+        }
+        return nullptr;
+    }
+    /*
+    * 是否还有待执行的任务[休眠前复查]
+    */
+    bool HasPendingTask() const
+    {
+        if (injector_size_.load(std::memory_order_relaxed) > 0)
+        {
+            return true;
+        }
+        for (auto& worker : workers_)
+        {
+            if (worker->deque.Count() > 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+    /*
+    * 执行任务并归还任务对象
+    */
+    void RunTask(ThreadPoolTask* task)
+    {
+        task->Run();
+        GiveBackObjectThreadLocal(task);
+    }
+    /*
+    * 工作线程主循环
+    */
+    void WorkerLoop(uint32_t index)
+    {
+        current_pool_ = this;
+        current_index_ = index;
+        workers_[index]->random = index * 2654435761u + 1;
+        uint32_t idle_rounds = 0;
+        while (!stop_.load(std::memory_order_acquire))
+        {
+            if (ThreadPoolTask* task = FindTask(index))
+            {
+                RunTask(task);
+                idle_rounds = 0;
+                continue;
+            }
+            if (++idle_rounds < SPIN_ROUNDS)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            idle_rounds = 0;
+            Park(index);
+        }
+        // 归还本线程攒着的、属于其他线程的任务对象
+        GetObjectPoolThreadLocalMgrRef<ThreadPoolTask>().Flush();
+        current_pool_ = nullptr;
+    }
+    /*
+    * 休眠: 先登记再复查,复查到任务或已停止时撤销登记
+    */
+    void Park(uint32_t index)
+    {
+        {
+            std::lock_guard<std::mutex> lock(parked_mutex_);
+            parked_.emplace_back(index);
+            parked_count_.store(parked_.size(), std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (HasPendingTask() || stop_.load(std::memory_order_relaxed))
+        {
+            std::lock_guard<std::mutex> lock(parked_mutex_);
+            for (auto iter = parked_.begin(); iter != parked_.end(); iter++)
+            {
+                if (*iter == index)
+                {
+                    parked_.erase(iter);
+                    parked_count_.store(parked_.size(), std::memory_order_relaxed);
+                    return;
+                }
+            }
+            // 已被提交者移出登记并唤醒,消费掉这次唤醒
+        }
+        workers_[index]->wakeup.acquire();
+    }
+private:
+    std::vector<std::unique_ptr<Worker>> workers_;  // 工作线程
+    std::atomic<bool> stop_ = false;                // 是否停止线程池
+
+    std::mutex injector_mutex_;                     // 保护全局队列
+    std::deque<ThreadPoolTask*> injector_;          // 全局队列,非工作线程提交的任务
+    std::atomic<std::size_t> injector_size_ = 0;    // 全局队列长度,为 0 时不加锁
+
+    std::mutex parked_mutex_;                       // 保护休眠登记
+    std::vector<uint32_t> parked_;                  // 休眠中的工作线程
+    std::atomic<std::size_t> parked_count_ = 0;     // 休眠中的工作线程数
+
+    static inline thread_local ThreadPoolWorkStealing* current_pool_ = nullptr;    // 当前线程所属的线程池
+    static inline thread_local uint32_t current_index_ = 0;                        // 当前线程在线程池中的下标
+};
+
+};  // ToolBox
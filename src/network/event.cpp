@@ -1,7 +1,9 @@
 #include "event.h"
 #include "network_def_internal.h"
+#include "network/net_buffer.h"
 #include <string.h>
 #include <cstddef>
+#include <algorithm>
 #include <string.h>
 
 namespace ToolBox
@@ -37,7 +39,27 @@ namespace ToolBox
         switch (GetID())
         {
             case EID_MainToWorkerSend:
-                GIVE_BACK_MEMORY_RAW(net_req_.stream_.data_, "NetEventWorker::~NetEventWorker");
+                GIVE_BACK_MEMORY(net_req_.stream_.data_, "NetEventWorker::~NetEventWorker");
+                break;
+            case EID_MainToWorkerSendBuffer:
+                if (nullptr != net_req_.shared_.buffer_)
+                {
+                    net_req_.shared_.buffer_->Release();
+                    net_req_.shared_.buffer_ = nullptr;
+                }
+                break;
+            case EID_MainToWorkerBroadcast:
+                if (nullptr != net_req_.shared_.buffer_)
+                {
+                    net_req_.shared_.buffer_->Release();
+                    net_req_.shared_.buffer_ = nullptr;
+                }
+                if (nullptr != net_req_.shared_.conn_ids_)
+                {
+                    GIVE_BACK_MEMORY(net_req_.shared_.conn_ids_, "NetEventWorker::~NetEventWorker");
+                    net_req_.shared_.conn_ids_ = nullptr;
+                }
+                net_req_.shared_.conn_count_ = 0;
                 break;
             default:
                 break;
@@ -107,6 +129,31 @@ namespace ToolBox
         return net_req_.stream_.size_;
     }
 
+    void NetEventWorker::SetBuffer(NetBuffer* buffer)
+    {
+        net_req_.shared_.buffer_ = buffer;
+    }
+    NetBuffer* NetEventWorker::GetBuffer() const
+    {
+        return net_req_.shared_.buffer_;
+    }
+
+    void NetEventWorker::SetBroadcastConnIDs(const std::vector<uint64_t>& conn_ids)
+    {
+        // 从线程缓存内存池取,不在每次广播时向系统申请;由网络线程析构事件时归还
+        net_req_.shared_.conn_ids_ = reinterpret_cast<uint64_t*>(GET_NET_MEMORY(sizeof(uint64_t) * conn_ids.size()));
+        net_req_.shared_.conn_count_ = static_cast<uint32_t>(conn_ids.size());
+        std::copy(conn_ids.begin(), conn_ids.end(), net_req_.shared_.conn_ids_);
+    }
+    const uint64_t* NetEventWorker::GetBroadcastConnIDs() const
+    {
+        return net_req_.shared_.conn_ids_;
+    }
+    uint32_t NetEventWorker::GetBroadcastConnCount() const
+    {
+        return net_req_.shared_.conn_count_;
+    }
+
     void NetEventWorker::SetFd(int32_t fd)
     {
         net_req_.address_.fd_ = fd;
@@ -117,6 +164,16 @@ namespace ToolBox
         return net_req_.address_.fd_;
     }
 
+    void NetEventWorker::SetReusePort(bool reuse_port)
+    {
+        net_req_.address_.reuse_port_ = reuse_port;
+    }
+
+    bool NetEventWorker::IsReusePort() const
+    {
+        return net_req_.address_.reuse_port_;
+    }
+
     void NetEventWorker::SetFeatureParam(int32_t param1, int32_t param2)
     {
         net_req_.net_feature_.param1_ = param1;
@@ -137,7 +194,7 @@ namespace ToolBox
         switch (GetID())
         {
             case EID_WorkerToMainRecv: 
-                GIVE_BACK_MEMORY_RAW((char*)net_evt_.recv_.data_);
+                GIVE_BACK_MEMORY((char*)net_evt_.recv_.data_);
                 break;
             default:
                 break;
@@ -4,12 +4,14 @@
 #include <string>
 #include <unordered_map>
 #include <functional>
+#include <vector>
 #include "network_def_internal.h"
 
 namespace ToolBox
 {
 
     enum class ENetErrCode;
+    class NetBuffer;
 
     enum EventID
     {
@@ -20,6 +22,11 @@ namespace ToolBox
         EID_MainToWorkerClose,
         EID_MainToWorkerSend,
         EID_MainToWorkerSetSimulateNagle,
+        EID_MainToWorkerSendBuffer,
+        EID_MainToWorkerBroadcast,
+        EID_MainToWorkerSetUdpBatchSize,
+        EID_MainToWorkerSetAdaptiveBuffer,
+        EID_MainToWorkerSetRecvBatch,
         EID_WorkerToMainBinded,
         EID_WorkerToMainBindFailed,
         EID_WorkerToMainConnected,
@@ -125,6 +132,26 @@ namespace ToolBox
         */
         uint32_t GetDataSize() const;
         /*
+        * 设置 引用计数缓冲区[接管调用者持有的一个引用]
+        */
+        void SetBuffer(NetBuffer* buffer);
+        /*
+        * 获取 引用计数缓冲区
+        */
+        NetBuffer* GetBuffer() const;
+        /*
+        * 设置 广播的目标连接ID列表
+        */
+        void SetBroadcastConnIDs(const std::vector<uint64_t>& conn_ids);
+        /*
+        * 获取 广播的目标连接ID列表
+        */
+        const uint64_t* GetBroadcastConnIDs() const;
+        /*
+        * 获取 广播的目标连接数量
+        */
+        uint32_t GetBroadcastConnCount() const;
+        /*
         * 设置新连接的文件描述符
         */
         void SetFd(int32_t fd);
@@ -133,6 +160,14 @@ namespace ToolBox
         */
         int32_t GetFd() const;
         /*
+        * 设置监听器是否以 SO_REUSEPORT 监听
+        */
+        void SetReusePort(bool reuse_port);
+        /*
+        * 监听器是否以 SO_REUSEPORT 监听
+        */
+        bool IsReusePort() const;
+        /*
         * 设置特性参数
         */
         void SetFeatureParam(int32_t param1, int32_t param2);
@@ -151,6 +186,13 @@ namespace ToolBox
                 char* data_;
                 int32_t size_;
             } stream_;
+            struct SendBufferReq
+            {
+                uint64_t connect_id_;
+                NetBuffer* buffer_;
+                uint64_t* conn_ids_;    // 广播的目标连接[取自线程缓存内存池]
+                uint32_t conn_count_;   // 广播的目标连接数量
+            } shared_;
             struct Address
             {
                 char ip_[16];
@@ -158,6 +200,7 @@ namespace ToolBox
                 int32_t send_buff_size;
                 int32_t recv_buff_size;
                 int32_t fd_;
+                bool reuse_port_;       // 监听器是否以 SO_REUSEPORT 监听
             } address_;
             struct NetFeature
             {
@@ -217,6 +260,7 @@ namespace ToolBox
                 uint64_t connect_id_;
                 char ip_[16];
                 uint16_t port_;
+                bool reuse_port_;       // 监听器是否以 SO_REUSEPORT 在每个网络线程各监听一份
             } bind_;
             struct Accepting
             {
@@ -233,8 +277,9 @@ namespace ToolBox
             struct Recv
             {
                 uint64_t connect_id_;
-                const char* data_;
-                uint32_t size_;
+                const char* data_;      // 单条消息;批量时为 偏移表[frame_count_ + 1] + 首尾相接的消息
+                uint32_t size_;         // 消息长度;批量时为所有消息的总长度
+                uint32_t frame_count_;  // 0:单条消息; >0:批量消息的数量
             } recv_;
             struct Error
             {
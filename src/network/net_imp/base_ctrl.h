@@ -1,6 +1,7 @@
 #pragma once
 #include "net_imp_define.h"
 #include "base_socket.h"
+#include <atomic>
 
 namespace ToolBox
 {
@@ -39,6 +40,28 @@ namespace ToolBox
         * 执行一次. e.g. epollwait;GetQueuedCompletionStatus;kevent.
         */
         virtual bool RunOnce(std::time_t time_stamp) = 0;
+        /*
+        * @brief 交由网络线程统一阻塞等待: 返回可被外部等待的句柄(如 epoll fd),之后 RunOnce 不再阻塞.
+        *        不支持的实现返回 -1,保持自身的定时等待.
+        */
+        virtual int32_t AttachExternalWait()
+        {
+            return -1;
+        }
+        /*
+        * 累计返回了 io 事件的等待次数[网络线程发布,任意线程读取]
+        */
+        uint64_t GetWakeups() const
+        {
+            return wakeups_.load(std::memory_order_relaxed);
+        }
+        /*
+        * 累计处理的 io 事件数[网络线程发布,任意线程读取]
+        */
+        uint64_t GetIoEvents() const
+        {
+            return io_events_.load(std::memory_order_relaxed);
+        }
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
         /*
         * @brief 建立 socket 与 iocp 的关联
@@ -48,6 +71,22 @@ namespace ToolBox
             return true;
         };
 #endif
+    protected:
+        /*
+        * 记录一次等待返回的 io 事件数,只有网络线程写,无需原子加
+        */
+        void AddWakeup(uint32_t events)
+        {
+            if (0 == events)
+            {
+                return;
+            }
+            wakeups_.store(wakeups_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            io_events_.store(io_events_.load(std::memory_order_relaxed) + events, std::memory_order_relaxed);
+        }
+    private:
+        std::atomic<uint64_t> wakeups_ = 0;     // 累计返回了 io 事件的等待次数
+        std::atomic<uint64_t> io_events_ = 0;   // 累计处理的 io 事件数
     };
 
 };  // ToolBox
@@ -1,4 +1,5 @@
 #include "base_socket.h"
+#include "network/net_buffer.h"
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
 #include <ioapiset.h>
 #endif
@@ -25,6 +26,14 @@ namespace ToolBox
 #endif
         event_type_ = SOCKET_EVENT_INVALID;
     }
+    void BaseSocket::SendBuffer(NetBuffer* buffer, bool /*by_reference*/)
+    {
+        if (nullptr == buffer)
+        {
+            return;
+        }
+        Send(buffer->Frame(), buffer->FrameSize());
+    }
     bool BaseSocket::IsSocketValid()
     {
         return socket_id_ > 0;
@@ -59,6 +68,22 @@ namespace ToolBox
         return error;
     }
 
+    void BaseSocket::SetBusyPoll(int32_t fd)
+    {
+#if defined(__linux__) && defined(SO_BUSY_POLL)
+        int32_t busy_poll = static_cast<int32_t>(p_network_->GetBusyPoll());
+        if (0 == busy_poll)
+        {
+            return;
+        }
+        if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &busy_poll, sizeof(busy_poll)) < 0)
+        {
+            // 超过 net.core.busy_read 需要 CAP_NET_ADMIN,失败不影响连接
+            NetworkLogTrace("[Network] set SO_BUSY_POLL failed. fd:%d, usecs:%d, errno:%d", fd, busy_poll, errno);
+        }
+#endif // __linux__
+    }
+
     void BaseSocket::OnErrored(ENetErrCode err_code, int32_t err_no)
     {
         p_network_->OnErrored(GetOpaque(), GetConnID(), err_code, err_no);
@@ -35,14 +35,14 @@ namespace ToolBox
         /*
         * 获取连接ID
         */
-        uint32_t GetConnID()
+        uint64_t GetConnID()
         {
             return conn_id_;
         }
         /*
         * 设置 分配的连接ID
         */
-        void SetConnID(uint32_t id)
+        void SetConnID(uint64_t id)
         {
             conn_id_ = id;
         }
@@ -70,8 +70,9 @@ namespace ToolBox
         * @brief 监听(模拟)
         * @param ip 地址
         * @param port 端口
+        * @param reuse_port 是否以 SO_REUSEPORT 监听,并在本网络线程内直接接管接受的连接
         */
-        virtual bool InitNewAccepter(uint64_t opaque, const std::string& ip, uint16_t port, int32_t send_buff_size, int32_t recv_buff_size) = 0;
+        virtual bool InitNewAccepter(uint64_t opaque, const std::string& ip, uint16_t port, int32_t send_buff_size, int32_t recv_buff_size, bool reuse_port) = 0;
 
         /*
         *  初始化从accpet函数接收得来的socket
@@ -92,9 +93,23 @@ namespace ToolBox
         */
         virtual void Send(const char* buffer, std::size_t length) = 0;
         /*
-        * Update
+        * @brief 发送引用计数缓冲区.默认退化为拷贝发送,支持零拷贝的 socket 需重写
+        * @param buffer 已成帧的缓冲区,需要延后发送时由 socket 自行 AddRef
+        * @param by_reference 为 true 时小包也按引用排队,不拷贝
         */
-        virtual void Update(std::time_t time_stamp) {};
+        virtual void SendBuffer(NetBuffer* buffer, bool by_reference);
+        /*
+        * 模拟 Nagle 的定时刷新
+        * @return 是否有数据收发
+        */
+        virtual bool Update(std::time_t time_stamp)
+        {
+            return false;
+        };
+        /*
+        * 自适应缓冲区模式下定期调用,缓冲区空闲时缩容
+        */
+        virtual void ShrinkBuffers() {};
         /*
         * 获取socket状态
         */
@@ -216,11 +231,25 @@ namespace ToolBox
 
 #endif
 
+        /*
+        * @brief 获取连接指标,不提供连接指标的 socket 返回 false
+        */
+        virtual bool GetConnMetrics(NetConnMetrics& metrics)
+        {
+            return false;
+        }
         /*
         * @brief 关闭
         */
         virtual void Close(ENetErrCode net_err, int32_t sys_err);
         /*
+        * @brief 网络线程退出后释放文件描述符,不通知逻辑线程也不归还 socket 池
+        */
+        virtual void CloseWithoutNotify()
+        {
+            BaseSocket::Close(ENetErrCode::NET_SUCCESS, 0);
+        }
+        /*
         * socket 是否有效
         */
         virtual bool IsSocketValid();
@@ -229,10 +258,14 @@ namespace ToolBox
         * 获取 socket 错误
         */
         int32_t GetSocketError();
+        /*
+        * 按网络的设置开启 SO_BUSY_POLL,接收时先在网卡队列上忙轮询,未设置时不做处理
+        */
+        void SetBusyPoll(int32_t fd);
 
     protected:
         uint64_t opaque_ = 0;   // 信道标记
-        uint32_t conn_id_ = INVALID_CONN_ID;
+        uint64_t conn_id_ = INVALID_CONN_ID;
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
         SOCKET socket_id_ = 0;
 #elif defined(__linux__)
@@ -49,6 +49,10 @@ namespace ToolBox
         */
         virtual void Update(std::time_t time_stamp) override;
         /*
+        * @brief 自适应缓冲区模式下需要按检查间隔醒来缩容
+        */
+        virtual int32_t GetWaitTimeout() override;
+        /*
         * @brief 获取控制器
         */
         IOMultiplexingInterface* GetBaseCtrl()
@@ -59,12 +63,40 @@ namespace ToolBox
         * @brief 从IO多路复用种删去监听
         */
         virtual void CloseListenInMultiplexing(int32_t socket_id) override;
+        /*
+        * @brief 交由网络线程统一阻塞等待
+        */
+        virtual int32_t AttachWaiter() override
+        {
+            return nullptr != base_ctrl_ ? base_ctrl_->AttachExternalWait() : -1;
+        }
+        /*
+        * @brief 除监听器以外的连接数
+        */
+        virtual uint32_t CountConnections() const override
+        {
+            return static_cast<uint32_t>(sock_mgr_.ConnectionCount());
+        }
+        /*
+        * @brief io 多路复用返回了 io 事件的次数
+        */
+        virtual uint64_t GetIoWakeups() const override
+        {
+            return nullptr != base_ctrl_ ? base_ctrl_->GetWakeups() : 0;
+        }
+        /*
+        * @brief io 多路复用累计处理的 io 事件数
+        */
+        virtual uint64_t GetIoEvents() const override
+        {
+            return nullptr != base_ctrl_ ? base_ctrl_->GetIoEvents() : 0;
+        }
 
     protected:
         /*
         * 工作线程内建立监听器
         */
-        virtual uint64_t OnNewAccepter(uint64_t opaque, const std::string& ip, const uint16_t port, int32_t send_buff_size, int32_t recv_buff_size) override;
+        virtual uint64_t OnNewAccepter(uint64_t opaque, const std::string& ip, const uint16_t port, int32_t send_buff_size, int32_t recv_buff_size, bool reuse_port) override;
         /*
         * 主线程通知,将fd加入io多路复用
         */
@@ -81,10 +113,24 @@ namespace ToolBox
         * 工作线程内工作线程内发送
         */
         virtual void OnSend(uint64_t connect_id, const char* data, uint32_t size) override;
+        /*
+        * 工作线程内发送引用计数缓冲区
+        */
+        virtual void OnSendBuffer(uint64_t connect_id, NetBuffer* buffer, bool by_reference) override;
+        /*
+        * 采集各连接的指标
+        */
+        virtual void CollectConnMetrics(std::vector<NetConnMetrics>& metrics) override;
+    private:
+        /*
+        * 初始化失败而仍占着槽位的 socket 关闭后归还,不计入连接数
+        */
+        void FreeFailedSocket_(SocketType* socket);
     protected:
         SocketPool<SocketType> sock_mgr_;       // socket 池
         IOMultiplexingInterface* base_ctrl_;    // io多路复用接口
         std::time_t last_update_timestamp = 0;  // 上次update时的时间戳
+        std::time_t last_shrink_timestamp_ = 0; // 上次检查空闲缓冲区的时间戳
     };
 
     template<typename SocketType>
@@ -107,7 +153,7 @@ namespace ToolBox
             NetworkLogError("[Network] Init INetwork failed. network_type:%d", network_type);
             return false;
         }
-        if (!sock_mgr_.Init(MAX_SOCKET_COUNT, net_thread_index))
+        if (!sock_mgr_.Init(master->GetMaxSocketCount(), net_thread_index))
         {
             NetworkLogError("[Network] Init sock_mgr_ failed. network_type:%d", network_type);
             return false;
@@ -128,6 +174,12 @@ namespace ToolBox
             base_ctrl_->DestroyIOMultiplexing();
             base_ctrl_ = nullptr;
         }
+        // 网络线程已退出,仍未关闭的连接在这里释放文件描述符
+        sock_mgr_.Foreach([](SocketType * socket) -> bool
+        {
+            socket->CloseWithoutNotify();
+            return true;
+        });
         if (!sock_mgr_.UnInit())
         {
             NetworkLogError("[Network] sock_mgr_ UnInit failed. network_type:%d", GetNetworkType());
@@ -148,6 +200,7 @@ namespace ToolBox
         // NetworkLogInfo("[Network] Update. network_type:%d,time_stamp:%lld, last_update_timestamp:%lld", GetNetworkType(), time_stamp, last_update_timestamp);
         INetwork::Update(time_stamp);
         base_ctrl_->RunOnce(time_stamp);
+        SetLiveConnections(CountConnections());
 
         int32_t nagle_timeout = GetSimulateNagleTimeout();
         // NetworkLogDebug("[Network] Update. network_type:%d, nagle_timeout:%d, time_stamp:%lld, last_update_timestamp:%lld", GetNetworkType(), nagle_timeout, time_stamp, last_update_timestamp);
@@ -155,17 +208,58 @@ namespace ToolBox
         {
             // NetworkLogDebug("[Network] Update. network_type:%d, nagle_timeout:%d, time_stamp:%lld, last_update_timestamp:%lld", GetNetworkType(), nagle_timeout, time_stamp, last_update_timestamp);
             last_update_timestamp = time_stamp;
-            sock_mgr_.Foreach([time_stamp](SocketType * socket) -> bool
+            // 只刷新有积攒数据或延后读取的 socket
+            uint64_t flushed = 0;
+            std::size_t scanned = sock_mgr_.ForeachDirty([time_stamp, &flushed](SocketType * socket)
+            {
+                if (socket->Update(time_stamp))
+                {
+                    flushed++;
+                }
+            });
+            AddNagleTick(scanned, flushed);
+        }
+        if (IsAdaptiveBuffer() && time_stamp >= last_shrink_timestamp_ + ADAPTIVE_BUFF_SHRINK_INTERVAL)
+        {
+            last_shrink_timestamp_ = time_stamp;
+            sock_mgr_.Foreach([](SocketType * socket) -> bool
             {
                 if (socket)
                 {
-                    socket->Update(time_stamp);
+                    socket->ShrinkBuffers();
                 }
                 return true;
             });
         }
+        PublishBufferBytes();
+
 
+    }
 
+    template<typename SocketType>
+    int32_t ImpNetwork<SocketType>::GetWaitTimeout()
+    {
+        int32_t timeout = INetwork::GetWaitTimeout();
+        if (IsAdaptiveBuffer() && (timeout < 0 || timeout > ADAPTIVE_BUFF_SHRINK_INTERVAL))
+        {
+            timeout = ADAPTIVE_BUFF_SHRINK_INTERVAL;
+        }
+        return timeout;
+    }
+
+    template<typename SocketType>
+    void ImpNetwork<SocketType>::CollectConnMetrics(std::vector<NetConnMetrics>& metrics)
+    {
+        metrics.reserve(sock_mgr_.Count());
+        NetConnMetrics conn_metrics;
+        sock_mgr_.Foreach([&](SocketType * socket) -> bool
+        {
+            if (socket && socket->GetConnMetrics(conn_metrics))
+            {
+                metrics.emplace_back(conn_metrics);
+            }
+            return true;
+        });
     }
 
     template<typename SocketType>
@@ -179,7 +273,7 @@ namespace ToolBox
     }
 
     template<typename SocketType>
-    uint64_t ImpNetwork<SocketType>::OnNewAccepter(uint64_t opaque, const std::string& ip, const uint16_t port, int32_t send_buff_size, int32_t recv_buff_size)
+    uint64_t ImpNetwork<SocketType>::OnNewAccepter(uint64_t opaque, const std::string& ip, const uint16_t port, int32_t send_buff_size, int32_t recv_buff_size, bool reuse_port)
     {
         SocketType* new_socket = sock_mgr_.Alloc();
         if (nullptr == new_socket)
@@ -189,11 +283,13 @@ namespace ToolBox
         }
         new_socket->SetSocketMgr(&sock_mgr_);
         new_socket->SetNetwork(this);
-        if (false == new_socket->InitNewAccepter(opaque, ip, port, send_buff_size, recv_buff_size))
+        if (false == new_socket->InitNewAccepter(opaque, ip, port, send_buff_size, recv_buff_size, reuse_port))
         {
+            FreeFailedSocket_(new_socket);
             OnErrored(opaque, 0, ENetErrCode::NET_ACCEPT_FAILED, 0);
             return INVALID_CONN_ID;
         }
+        sock_mgr_.MarkListener(new_socket);
         base_ctrl_->OperEvent(*new_socket, EventOperType::EVENT_OPER_ADD, new_socket->GetEventType());
         return new_socket->GetConnID();
     }
@@ -232,15 +328,27 @@ namespace ToolBox
         new_socket->SetNetwork(this);
         if (false == new_socket->InitNewConnecter(opaque, ip, port, send_buff_size, recv_buff_size))
         {
+            FreeFailedSocket_(new_socket);
             return INVALID_CONN_ID;
         }
         base_ctrl_->OperEvent(*new_socket, EventOperType::EVENT_OPER_ADD, new_socket->GetEventType());
         return new_socket->GetConnID();
     }
     template<typename SocketType>
+    void ImpNetwork<SocketType>::FreeFailedSocket_(SocketType* socket)
+    {
+        // 部分失败路径已在 socket 内部关闭并归还
+        if (socket != sock_mgr_.GetSocket(socket->GetConnID()))
+        {
+            return;
+        }
+        socket->CloseWithoutNotify();
+        sock_mgr_.Free(socket);
+    }
+    template<typename SocketType>
     void ImpNetwork<SocketType>::OnClose(uint64_t connect_id)
     {
-        auto socket = sock_mgr_.GetSocket((uint32_t)connect_id);
+        auto socket = sock_mgr_.GetSocket(connect_id);
         if (nullptr == socket)
         {
             return;
@@ -258,4 +366,15 @@ namespace ToolBox
         socket->Send(data, size);
     }
 
+    template<typename SocketType>
+    void ImpNetwork<SocketType>::OnSendBuffer(uint64_t connect_id, NetBuffer* buffer, bool by_reference)
+    {
+        auto socket = sock_mgr_.GetSocket(connect_id);
+        if (nullptr == socket)
+        {
+            return;
+        }
+        socket->SendBuffer(buffer, by_reference);
+    }
+
 };  // ToolBox
\ No newline at end of file
@@ -89,11 +89,12 @@ namespace ToolBox
         bool RunOnce(std::time_t time_stamp) override
         {
             epoll_event evt;
-            int32_t count = EpollWait(EPOLL_WAIT_MSECONDS);
+            int32_t count = EpollWait(wait_msec_);
             if (count < 0)
             {
                 return false;
             }
+            AddWakeup(static_cast<uint32_t>(count));
             for (int32_t i = 0; i < count; i++)
             {
                 epoll_event& event = events_[i];
@@ -118,8 +119,17 @@ namespace ToolBox
             }
             return true;
         }
+        /*
+        * 由网络线程统一等待 epoll fd 的可读,此后 epoll_wait 不再阻塞
+        */
+        int32_t AttachExternalWait() override
+        {
+            wait_msec_ = 0;
+            return epoll_fd_;
+        }
     private:
         uint32_t max_events_ = 0; // 最大事件数
+        int32_t wait_msec_ = EPOLL_WAIT_MSECONDS;   // epoll_wait 等待毫秒数
         int epoll_fd_;            // epoll 文件描述符
         epoll_event* events_;     // epoll 事件数组
     };
@@ -10,7 +10,7 @@ namespace ToolBox
 
     bool TcpEpollNetwork::Init(NetworkChannel* master, NetworkType network_type, uint32_t net_thread_index)
     {
-        base_ctrl_ = new EpollCtrl(MAX_SOCKET_COUNT);
+        base_ctrl_ = new EpollCtrl(master->GetMaxSocketCount());
         if (!ImpNetwork<TcpSocket>::Init(master, network_type, net_thread_index))
         {
             NetworkLogError("[Network] Init TcpEpollNetwork failed. network_type:%d", network_type);
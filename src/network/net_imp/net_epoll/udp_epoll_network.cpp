@@ -6,13 +6,14 @@
 #include "network/net_imp/udp_socket.h"
 #include "epoll_ctrl.h"
 #include "network/net_imp/socket_pool.h"
+#include "network/net_buffer.h"
 
 namespace ToolBox
 {
 
     bool UdpEpollNetwork::Init(NetworkChannel* master, NetworkType network_type, uint32_t net_thread_index)
     {
-        base_ctrl_ = new EpollCtrl(MAX_SOCKET_COUNT);
+        base_ctrl_ = new EpollCtrl(master->GetMaxSocketCount());
         if (!ImpNetwork<UdpSocket>::Init(master, network_type, net_thread_index))
         {
             NetworkLogError("[Network] Init UdpEpollNetwork failed. network_type:%d", network_type);
@@ -23,20 +24,68 @@ namespace ToolBox
 
     void UdpEpollNetwork::Update(std::time_t time_stamp)
     {
+        // KCP 的数据报不超过 KCP 的 MTU,原始 UDP 按配置预留
+        batch_io_.SetBatchSize(GetUdpBatchSize(), is_kcp_open_ ? KCP_TRANSPORT_MTU : GetUdpDatagramSize());
         ImpNetwork<UdpSocket>::Update(time_stamp);
         if (is_kcp_open_)
         {
-            // 更新 kcp [TODO: 这里的update存在优化空间]
-            for (auto iter : address_to_connect_)
+            // 只更新定时器到期的会话与刚收到输入/有数据排队的会话,空闲会话不参与每帧的更新.
+            // 到期的会话先放入待更新列表,等时间轮走完再更新,避免在时间轮追赶时钟的过程中被重复触发
+            kcp_timer_.Update();
+            std::vector<uint64_t> dirty;
+            dirty.swap(kcp_dirty_);
+            for (auto conn_id : dirty)
             {
-                auto socket = sock_mgr_.GetSocket(iter.second);
+                auto* socket = sock_mgr_.GetSocket(conn_id);
+                if (nullptr == socket || socket->GetConnID() != conn_id)
+                {
+                    continue;
+                }
+                socket->SetKcpDirty(false);
+                UpdateKcp_(socket, time_stamp);
+            }
+            dirty.clear();
+            if (kcp_dirty_.empty())
+            {
+                // 复用列表的内存
+                dirty.swap(kcp_dirty_);
+            }
+        }
+        // 先重试之前发送阻塞的数据报,再把本帧排队的数据报(含 kcp 的输出分片)统一批量发送
+        if (!send_pending_.empty())
+        {
+            std::vector<uint64_t> pending;
+            pending.swap(send_pending_);
+            for (auto conn_id : pending)
+            {
+                auto* socket = sock_mgr_.GetSocket(conn_id);
                 if (nullptr == socket)
                 {
                     continue;
                 }
-                socket->KcpUpdate(time_stamp);
+                socket->SetSendPending(false);
+                if (socket->FlushUnsent())
+                {
+                    MarkSendPending(socket);
+                }
             }
         }
+        batch_io_.FlushSend(this);
+    }
+
+    int32_t UdpEpollNetwork::GetWaitTimeout()
+    {
+        int32_t timeout = ImpNetwork<UdpSocket>::GetWaitTimeout();
+        if (is_kcp_open_ && kcp_scheduled_ > 0 && (timeout < 0 || timeout > KCP_UPDATE_INTERVAL))
+        {
+            timeout = KCP_UPDATE_INTERVAL;
+        }
+        if (!send_pending_.empty() && (timeout < 0 || timeout > 1))
+        {
+            // 有发送阻塞的数据报,下一毫秒重试
+            timeout = 1;
+        }
+        return timeout;
     }
 
     UdpSocket* UdpEpollNetwork::GetSocketByUdpAddress(const UdpAddress& udp_address)
@@ -52,13 +101,24 @@ namespace ToolBox
         }
     }
 
-    void UdpEpollNetwork::AddUdpAddress(const UdpAddress& udp_address, uint32_t conn_id)
+    void UdpEpollNetwork::AddSession(uint64_t session_id, uint64_t conn_id)
     {
-        address_to_connect_[udp_address.GetID()] = conn_id;
+        address_to_connect_[session_id] = conn_id;
+        if (nullptr != session_directory_ && !session_directory_->Insert(session_id, conn_id))
+        {
+            NetworkLogError("[Network][UdpEpollNetwork] Session directory is full. session_id:%llu, conn_id:%llu", session_id, conn_id);
+        }
     }
-    void UdpEpollNetwork::DeleteUdpAddress(const UdpAddress& udp_address)
+    void UdpEpollNetwork::DeleteSession(uint64_t session_id)
     {
-        address_to_connect_.erase(udp_address.GetID());
+        if (0 == address_to_connect_.erase(session_id))
+        {
+            return;
+        }
+        if (nullptr != session_directory_)
+        {
+            session_directory_->Erase(session_id);
+        }
     }
 
     void UdpEpollNetwork::OpenKcpMode()
@@ -66,10 +126,94 @@ namespace ToolBox
         is_kcp_open_ = true;
     }
 
+    void UdpEpollNetwork::MarkKcpDirty(UdpSocket* socket)
+    {
+        if (socket->IsKcpDirty())
+        {
+            return;
+        }
+        socket->SetKcpDirty(true);
+        kcp_dirty_.emplace_back(socket->GetConnID());
+    }
 
-    uint64_t UdpEpollNetwork::OnNewAccepter(uint64_t opaque, const std::string& ip, const uint16_t port, int32_t send_buff_size, int32_t recv_buff_size)
+    void UdpEpollNetwork::MarkSendPending(UdpSocket* socket)
     {
-        auto conn_id = ImpNetwork<UdpSocket>::OnNewAccepter(opaque, ip, port, send_buff_size, recv_buff_size);
+        if (socket->IsSendPending())
+        {
+            return;
+        }
+        socket->SetSendPending(true);
+        send_pending_.emplace_back(socket->GetConnID());
+    }
+
+    void UdpEpollNetwork::RequeueSend(uint64_t conn_id, const char* data, std::size_t size)
+    {
+        auto* socket = sock_mgr_.GetSocket(conn_id);
+        if (nullptr == socket)
+        {
+            return;
+        }
+        socket->QueueUnsent(data, size);
+    }
+
+    void UdpEpollNetwork::UpdateKcp_(UdpSocket* socket, std::time_t time_stamp)
+    {
+        socket->KcpUpdate(time_stamp);
+        AddKcpUpdates(1);
+        ScheduleKcp_(socket, time_stamp);
+    }
+
+    void UdpEpollNetwork::ScheduleKcp_(UdpSocket* socket, std::time_t time_stamp)
+    {
+        HTIMER timer = socket->GetKcpTimer();
+        if (socket->IsKcpIdle())
+        {
+            if (INVALID_HTIMER != timer)
+            {
+                kcp_timer_.KillTimer(timer);
+                socket->SetKcpTimer(INVALID_HTIMER);
+                kcp_scheduled_--;
+            }
+            return;
+        }
+        IUINT32 current = static_cast<IUINT32>(time_stamp);
+        int32_t delay = static_cast<int32_t>(ikcp_check(socket->GetKcp(), current) - current);
+        // 时间轮精度为 1 毫秒,且不能把定时器加到正在触发的槽位上
+        delay = delay < 1 ? 1 : delay;
+        if (INVALID_HTIMER != timer)
+        {
+            if (kcp_timer_.GetTimeLeft(timer) == delay)
+            {
+                return;
+            }
+            kcp_timer_.KillTimer(timer);
+            kcp_scheduled_--;
+        }
+        uint64_t conn_id = socket->GetConnID();
+        socket->SetKcpTimer(kcp_timer_.AddTimer([this, conn_id](int32_t)
+        {
+            OnKcpTimer_(conn_id);
+        }, delay, 1));
+        kcp_scheduled_++;
+    }
+
+    void UdpEpollNetwork::OnKcpTimer_(uint64_t conn_id)
+    {
+        kcp_scheduled_--;
+        auto* socket = sock_mgr_.GetSocket(conn_id);
+        if (nullptr == socket || socket->GetConnID() != conn_id)
+        {
+            // 会话已关闭
+            return;
+        }
+        socket->SetKcpTimer(INVALID_HTIMER);
+        MarkKcpDirty(socket);
+    }
+
+
+    uint64_t UdpEpollNetwork::OnNewAccepter(uint64_t opaque, const std::string& ip, const uint16_t port, int32_t send_buff_size, int32_t recv_buff_size, bool reuse_port)
+    {
+        auto conn_id = ImpNetwork<UdpSocket>::OnNewAccepter(opaque, ip, port, send_buff_size, recv_buff_size, reuse_port);
         auto* new_socket = sock_mgr_.GetSocket(conn_id);
         if (nullptr != new_socket)
         {
@@ -78,6 +222,7 @@ namespace ToolBox
             {
                 new_socket->OpenKcpMode();
             }
+            // 监听器不登记到会话目录: SO_REUSEPORT 模式下每个网络线程的监听器共用同一个本地地址
             address_to_connect_[new_socket->GetLocalAddressID()] = new_socket->GetConnID();
             return new_socket->GetLocalAddressID();
         }
@@ -94,14 +239,14 @@ namespace ToolBox
             {
                 new_socket->OpenKcpMode();
             }
-            uint64_t remote_address_id = new_socket->GetRemoteAddressID();
-            address_to_connect_[remote_address_id] = new_socket->GetConnID();
-            NetworkLogDebug("[Network][UdpEpollNetwork] OnConnected. remote_address_id:%llu, conn_id:%llu", remote_address_id, new_socket->GetConnID());
-            if (remote_address_id > 0)
+            uint64_t session_id = new_socket->GetSessionID();
+            AddSession(session_id, new_socket->GetConnID());
+            NetworkLogDebug("[Network][UdpEpollNetwork] OnConnected. session_id:%llu, conn_id:%llu", session_id, new_socket->GetConnID());
+            if (session_id > 0)
             {
-                OnConnected(opaque, remote_address_id);
+                OnConnected(opaque, session_id);
             }
-            return remote_address_id;
+            return session_id;
         }
         return INVALID_CONN_ID;
     }
@@ -112,8 +257,10 @@ namespace ToolBox
         {
             return;
         }
-        ImpNetwork<UdpSocket>::OnClose(iter->second);
-        address_to_connect_.erase(iter);
+        // 关闭时 UdpSocket::Close 会删除映射,先取出连接ID
+        uint64_t conn_id = iter->second;
+        ImpNetwork<UdpSocket>::OnClose(conn_id);
+        DeleteSession(address_id);
     }
 
     void UdpEpollNetwork::OnSend(uint64_t address_id, const char* data, uint32_t size)
@@ -140,6 +287,11 @@ namespace ToolBox
         }
     }
 
+    void UdpEpollNetwork::OnSendBuffer(uint64_t address_id, NetBuffer* buffer, bool /*by_reference*/)
+    {
+        OnSend(address_id, buffer->Frame(), buffer->FrameSize());
+    }
+
 };  // ToolBox
 
 #endif // __linux__
\ No newline at end of file
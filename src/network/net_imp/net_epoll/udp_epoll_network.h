@@ -1,13 +1,14 @@
 #pragma once
 #ifdef __linux__
 #include "network/net_imp/imp_network.h"
+#include "network/net_imp/udp_socket.h"
+#include "network/udp_session_directory.h"
 #include <unordered_map>
+#include <vector>
 
 namespace ToolBox
 {
 
-    class UdpSocket;
-    class UdpAddress;
     /*
     * 定义基于 UDP 和 Epoll 的网络
     */
@@ -30,6 +31,10 @@ namespace ToolBox
         * 执行一次网络循环
         */
         virtual void Update(std::time_t time_stamp) override;
+        /*
+        * kcp 模式需要按 kcp 时钟间隔驱动 ikcp_update,有发送阻塞的数据报时需要尽快重试
+        */
+        virtual int32_t GetWaitTimeout() override;
     public:
         /*
         * @brief UdpAddress 是否存在
@@ -38,15 +43,24 @@ namespace ToolBox
         */
         UdpSocket* GetSocketByUdpAddress(const UdpAddress& udp_address);
         /*
-        * @brief 增加地址映射
-        * @param udp_address udp地址
+        * @brief 增加会话映射,并登记到会话目录
+        * @param session_id 会话ID(UdpSocket::GetSessionID)
+        * @param conn_id SocketPool管理的连接ID
+        */
+        void AddSession(uint64_t session_id, uint64_t conn_id);
+        /*
+        * @brief 删除会话映射,并从会话目录中移除
+        * @param session_id 会话ID
         */
-        void AddUdpAddress(const UdpAddress& udp_address, uint32_t conn_id);
+        void DeleteSession(uint64_t session_id);
         /*
-        * @brief 删除地址映射
-        * @param udp_address udp地址
+        * @brief 设置多个网络线程共享的会话目录
+        * @param directory 会话目录,由 NetworkChannel 持有
         */
-        void DeleteUdpAddress(const UdpAddress& udp_address);
+        void SetSessionDirectory(UdpSessionDirectory* directory)
+        {
+            session_directory_ = directory;
+        }
         /*
         * @brief 开启Kcp模式
         */
@@ -59,11 +73,35 @@ namespace ToolBox
         {
             return is_kcp_open_;
         };
+        /*
+        * @brief 获取本网络线程的批量收发器
+        */
+        UdpBatchIO& GetBatchIO()
+        {
+            return batch_io_;
+        }
+        /*
+        * @brief kcp 会话刚收到输入或有数据排队,本帧末尾更新
+        * @param socket kcp 会话
+        */
+        void MarkKcpDirty(UdpSocket* socket);
+        /*
+        * @brief socket 有发送阻塞的数据报,之后每帧重试直到发完
+        * @param socket 有数据报排队的 socket
+        */
+        void MarkSendPending(UdpSocket* socket);
+        /*
+        * @brief 批量发送阻塞的数据报交回所属的 socket 排队,socket 已关闭时丢弃
+        * @param conn_id 发送数据报的 socket 的连接ID
+        * @param data 数据指针
+        * @param size 数据长度
+        */
+        void RequeueSend(uint64_t conn_id, const char* data, std::size_t size);
     protected:
         /*
         * 工作线程内建立监听器
         */
-        virtual uint64_t OnNewAccepter(uint64_t opaque, const std::string& ip, const uint16_t port, int32_t send_buff_size, int32_t recv_buff_size) override;
+        virtual uint64_t OnNewAccepter(uint64_t opaque, const std::string& ip, const uint16_t port, int32_t send_buff_size, int32_t recv_buff_size, bool reuse_port) override;
         /*
         * 工作线程内建立连接器
         */
@@ -76,10 +114,34 @@ namespace ToolBox
         * 工作线程内工作线程内发送
         */
         virtual void OnSend(uint64_t address_id, const char* data, uint32_t size) override;
+        /*
+        * 工作线程内发送引用计数缓冲区,UDP/KCP 走拷贝路径
+        */
+        virtual void OnSendBuffer(uint64_t address_id, NetBuffer* buffer, bool by_reference) override;
+
+    private:
+        /*
+        * @brief 更新一个 kcp 会话并重新安排它的定时器
+        */
+        void UpdateKcp_(UdpSocket* socket, std::time_t time_stamp);
+        /*
+        * @brief 按 ikcp_check 安排下一次更新,空闲的会话不安排定时器,直到再次收到输入或有数据排队
+        */
+        void ScheduleKcp_(UdpSocket* socket, std::time_t time_stamp);
+        /*
+        * @brief kcp 会话的定时器到期
+        */
+        void OnKcpTimer_(uint64_t conn_id);
 
     private:
-        std::unordered_map<uint64_t, uint32_t> address_to_connect_;      // 地址转换的ID 到 SocketPool管理的连接ID的映射
+        std::unordered_map<uint64_t, uint64_t> address_to_connect_;      // 地址转换的ID 到 SocketPool管理的连接ID的映射
+        UdpSessionDirectory* session_directory_ = nullptr;              // 多个网络线程共享的会话目录
         bool is_kcp_open_ = false;      // KCP是否开启
+        UdpBatchIO batch_io_;           // 批量收发器
+        TimerWheel kcp_timer_;          // 驱动 kcp 会话的时间轮
+        std::vector<uint64_t> kcp_dirty_;               // 刚收到输入或有数据排队的 kcp 会话
+        std::vector<uint64_t> send_pending_;            // 有发送阻塞的数据报的 socket
+        std::size_t kcp_scheduled_ = 0; // 时间轮中尚未到期的 kcp 定时器数量
     };
 
 };  // ToolBox
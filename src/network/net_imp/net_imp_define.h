@@ -27,14 +27,32 @@
 
 namespace ToolBox
 {
-    constexpr std::size_t MAX_SOCKET_COUNT = 10000;
-    constexpr std::size_t INVALID_CONN_ID = UINT32_MAX;
+    constexpr uint64_t INVALID_CONN_ID = UINT64_MAX;
+    /* 连接ID的编码[高位到低位]: 保留(为 0) | 槽位复用代数 | 网络线程序号 | 槽位下标,编解码见 socket_pool.h */
+    constexpr uint32_t CONN_ID_GENERATION_BITS = 16;                /* 槽位复用代数的位数,同一槽位复用 65536 次后过期的连接ID才会重新匹配 */
+    constexpr uint32_t CONN_ID_THREAD_BITS = 8;                     /* 网络线程序号的位数,最多 256 个网络线程 */
+    constexpr uint32_t CONN_ID_INDEX_BITS = 32;                     /* 槽位下标的位数,每个网络线程每种网络的 socket 数量上限由 SetMaxSocketCount 配置 */
+    constexpr uint32_t MAX_NET_THREAD_COUNT = 1u << CONN_ID_THREAD_BITS;
+    constexpr uint64_t CONN_ID_INDEX_MASK = (uint64_t(1) << CONN_ID_INDEX_BITS) - 1;
+    constexpr uint32_t INVALID_NET_THREAD_INDEX = UINT32_MAX;       /* 找不到连接所在的网络线程 */
+    /*
+    * 从连接ID中取出网络线程序号
+    */
+    inline uint32_t GetConnIDThreadIndex(uint64_t conn_id)
+    {
+        return static_cast<uint32_t>(conn_id >> CONN_ID_INDEX_BITS) & (MAX_NET_THREAD_COUNT - 1);
+    }
     constexpr std::size_t DEFAULT_CONN_BUFFER_SIZE = 256 * 1024;        /* 256 k */
     constexpr std::size_t DEFAULT_RING_BUFF_SIZE = 256 * 1024;        /* 256 k */
     constexpr std::size_t DEFAULT_BACKLOG_SIZE = 256;
+    constexpr std::size_t ZERO_COPY_SEND_MIN_SIZE = 4 * 1024;       /* 不小于 4k 的引用计数缓冲区才走零拷贝发送,小包拷贝进 ringbuffer 更划算 */
+    constexpr int32_t MAX_SEND_IOV_COUNT = 64;                      /* 单次 writev 最多聚合的内存段数量 */
+    constexpr int32_t ADAPTIVE_BUFF_SHRINK_INTERVAL = 1000;         /* 自适应缓冲区模式下检查空闲缓冲区并缩容的间隔,单位毫秒(ms) */
     //
     constexpr int32_t KCP_TRANSPORT_MTU = 1000;
     constexpr uint32_t KCP_CONV = 0x01020304;          //  kcp会话ID, must equal in two endpoint from the same connection
+    constexpr int32_t KCP_UPDATE_INTERVAL = 10;        //  kcp 内部时钟间隔,单位毫秒(ms)
+    constexpr std::size_t UDP_MAX_DATAGRAM_SIZE = 64 * 1024;      /* 单个 UDP 数据报的最大长度,批量接收时每个数据报预留大小的上限 */
 
     using SocketAddress = sockaddr_in;
     /*
@@ -1,111 +1,234 @@
 #include "io_uring_ctrl.h"
 #ifdef LINUX_IO_URING
 
-#include "network_def_internal.h"
+#include "network/network_def_internal.h"
+#include "network/net_buffer.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
 #include <unistd.h>
 
 
 namespace ToolBox
 {
 
-    IOUringCtrl::IOUringCtrl(uint max_events)
+    IOUringCtrl::IOUringCtrl(uint32_t max_events)
         : max_events_(max_events)
     {
-        ring_ = new io_uring();
     }
 
     IOUringCtrl::~IOUringCtrl()
     {
-        io_uring_queue_exit(ring_);
+        DestroyIOMultiplexing();
     }
 
     bool IOUringCtrl::CreateIOMultiplexing()
     {
         NetworkLogInfo("[Network] start CreateIOMultiplexing.");
-
-        // initialize io_uring
-        struct io_uring_params params;
-        // struct io_uring ring;
-        memset(&params, 0, sizeof(params));
-        int32_t ret = io_uring_queue_init_params(max_events_, ring_, &params);
-        if (ret < 0)
+        if (!ring_.Init(max_events_, max_events_ * URING_CQ_FACTOR))
         {
-            NetworkLogError("[Network] io_uring_queue_init_params failed. ret:%d", ret);
+            NetworkLogError("[Network] io_uring_setup failed. errno:%d", errno);
             return false;
         }
-
-        // check if IORING_FEAT_FAST_POLL is supported
-        if (!(params.features & IORING_FEAT_FAST_POLL))
+        if (!(ring_.GetFeatures() & IORING_FEAT_FAST_POLL))
         {
             NetworkLogError("[Network] IORING_FEAT_FAST_POLL not available in the kernel.");
+            ring_.Exit();
             return false;
         }
 
-        // check if buffer selection is supported
-        struct io_uring_probe* probe;
-        probe = io_uring_get_probe_ring(ring_);
-        if (!probe)
+        // 注册 provided buffer ring,multishot recv 从中取缓冲区
+        buf_ring_size_ = URING_BUF_RING_ENTRIES * sizeof(struct io_uring_buf);
+        void* ring_mem = mmap(nullptr, buf_ring_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        void* bufs_mem = mmap(nullptr, URING_BUF_RING_ENTRIES * URING_BUF_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (MAP_FAILED == ring_mem || MAP_FAILED == bufs_mem)
         {
-            NetworkLogError("[Network] Buffer select not supported, skipping...");
+            NetworkLogError("[Network] mmap provided buffers failed. errno:%d", errno);
+            if (MAP_FAILED != ring_mem)
+            {
+                munmap(ring_mem, buf_ring_size_);
+            }
+            if (MAP_FAILED != bufs_mem)
+            {
+                munmap(bufs_mem, URING_BUF_RING_ENTRIES * URING_BUF_SIZE);
+            }
+            ring_.Exit();
             return false;
         }
-        if (!io_uring_opcode_supported(probe, IORING_OP_PROVIDE_BUFFERS))
+        buf_ring_ = static_cast<struct io_uring_buf_ring*>(ring_mem);
+        bufs_ = static_cast<char*>(bufs_mem);
+        struct io_uring_buf_reg buf_reg;
+        memset(&buf_reg, 0, sizeof(buf_reg));
+        buf_reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring_);
+        buf_reg.ring_entries = URING_BUF_RING_ENTRIES;
+        buf_reg.bgid = URING_BUF_GROUP;
+        buf_ring_mapped_ = ring_.Register(IORING_REGISTER_PBUF_RING, &buf_reg, 1) >= 0;
+        if (buf_ring_mapped_)
         {
-            NetworkLogError("[Network] Buffer select not supported, skipping...");
-            return false;
+            buf_tail_ = 0;
+            for (uint32_t bid = 0; bid < URING_BUF_RING_ENTRIES; bid++)
+            {
+                RecycleBuffer(static_cast<uint16_t>(bid));
+            }
+            __atomic_store_n(&buf_ring_->tail, buf_tail_, __ATOMIC_RELEASE);
+        }
+        else
+        {
+            // 内核不支持 ring 映射[5.19 之前],一次提交全部缓冲区
+            NetworkLogWarn("[Network] register provided buffer ring failed, fall back to provide buffers.");
+            struct io_uring_sqe* sqe = ring_.GetSqe();
+            sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+            sqe->fd = static_cast<int32_t>(URING_BUF_RING_ENTRIES);
+            sqe->addr = reinterpret_cast<uint64_t>(bufs_);
+            sqe->len = static_cast<uint32_t>(URING_BUF_SIZE);
+            sqe->buf_group = URING_BUF_GROUP;
+            int32_t ret = ring_.Submit(1);
+            int32_t provide_res = -EINVAL;
+            ring_.ForeachCqe([&provide_res](const struct io_uring_cqe& cqe)
+            {
+                provide_res = cqe.res;
+            });
+            if (ret < 0 || provide_res < 0)
+            {
+                NetworkLogError("[Network] provide buffers failed. ret:%d, res:%d", ret, provide_res);
+                DestroyIOMultiplexing();
+                return false;
+            }
         }
-        free(probe);
-
-        // register buffers for buffer selection
-        struct io_uring_sqe* sqe;
-        struct io_uring_cqe* cqe;
-
-        sqe = io_uring_get_sqe(ring_);
-        io_uring_prep_provide_buffers(sqe, bufs_, MAX_MESSAGE_LEN, BUFFERS_COUNT, group_id_, 0);
 
-        io_uring_submit(ring_);
-        io_uring_wait_cqe(ring_, &cqe);
-        if (cqe->res < 0)
+        // 注册稀疏的文件表,以 fd 为下标;内核不支持时退化为普通 fd
+        struct rlimit limit;
+        uint32_t fixed_count = URING_MAX_FIXED_FILES;
+        if (0 == getrlimit(RLIMIT_NOFILE, &limit) && limit.rlim_cur < fixed_count)
         {
-            NetworkLogError("[Network] cqe->res = %d\n", cqe->res);
-            return false;
+            fixed_count = static_cast<uint32_t>(limit.rlim_cur);
+        }
+        struct io_uring_rsrc_register files_reg;
+        memset(&files_reg, 0, sizeof(files_reg));
+        files_reg.nr = fixed_count;
+        files_reg.flags = IORING_RSRC_REGISTER_SPARSE;
+        int32_t ret = ring_.Register(IORING_REGISTER_FILES2, &files_reg, sizeof(files_reg));
+        if (ret < 0)
+        {
+            NetworkLogWarn("[Network] register sparse files failed, use plain fd. ret:%d", ret);
+        }
+        else
+        {
+            fixed_files_.assign(fixed_count, 0);
         }
-        io_uring_cqe_seen(ring_, cqe);
 
+        // 探测 send_zc
+        std::vector<char> probe_mem(sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op), 0);
+        auto* probe = reinterpret_cast<struct io_uring_probe*>(probe_mem.data());
+        if (ring_.Register(IORING_REGISTER_PROBE, probe, 256) >= 0)
+        {
+            send_zc_ = probe->last_op >= IORING_OP_SEND_ZC
+                       && (probe->ops[IORING_OP_SEND_ZC].flags & IO_URING_OP_SUPPORTED);
+        }
+        created_ = true;
+        NetworkLogInfo("[Network] io_uring created. entries:%u, buf ring:%d, fixed files:%zu, send_zc:%d", max_events_, buf_ring_mapped_, fixed_files_.size(), send_zc_);
         return true;
     }
+
     void IOUringCtrl::DestroyIOMultiplexing()
     {
-
-        // if (events_ != nullptr)
-        // {
-        //     delete[] events_;
-        //     events_ = nullptr;
-        // }
-        // if (-1 != epoll_fd_)
-        // {
-        //     close(epoll_fd_);
-        //     epoll_fd_ = -1;
-        // }
+        created_ = false;
+        buf_ring_mapped_ = false;
+        ring_.Exit();
+        if (nullptr != buf_ring_)
+        {
+            munmap(buf_ring_, buf_ring_size_);
+            buf_ring_ = nullptr;
+        }
+        if (nullptr != bufs_)
+        {
+            munmap(bufs_, URING_BUF_RING_ENTRIES * URING_BUF_SIZE);
+            bufs_ = nullptr;
+        }
+        fixed_files_.clear();
+        // 环已销毁,内核不再引用请求,释放其持有的缓冲区
+        for (auto& op : ops_)
+        {
+            if (nullptr != op->buffer)
+            {
+                op->buffer->Release();
+                op->buffer = nullptr;
+            }
+        }
+        free_ops_ = nullptr;
+        ops_.clear();
     }
 
-    // bool IOUringCtrl::DelEvent(int socket_fd)
-    // {
-    //     epoll_event evt;
-    //     return epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, socket_fd, &evt) == 0;
-    // }
+    bool IOUringCtrl::DelEvent(int socket_fd)
+    {
+        if (!created_ || socket_fd < 0)
+        {
+            return true;
+        }
+        // 先把已准备的提交项交给内核,以免 fd 关闭后它们作用在复用了该 fd 的新连接上
+        if (ring_.Pending() > 0)
+        {
+            ring_.Submit();
+        }
+        bool fixed = static_cast<std::size_t>(socket_fd) < fixed_files_.size() && fixed_files_[socket_fd];
+        struct io_uring_sync_cancel_reg cancel_reg;
+        memset(&cancel_reg, 0, sizeof(cancel_reg));
+        cancel_reg.fd = socket_fd;
+        cancel_reg.flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL | (fixed ? IORING_ASYNC_CANCEL_FD_FIXED : 0);
+        cancel_reg.timeout.tv_sec = -1;
+        cancel_reg.timeout.tv_nsec = -1;
+        int32_t ret = ring_.Register(IORING_REGISTER_SYNC_CANCEL, &cancel_reg, 1);
+        if (ret < 0 && -ENOENT != ret)
+        {
+            // 内核不支持同步取消,改为提交异步取消
+            struct io_uring_sqe* sqe = ring_.GetSqe();
+            if (nullptr != sqe)
+            {
+                sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                sqe->fd = socket_fd;
+                sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL | (fixed ? IORING_ASYNC_CANCEL_FD_FIXED : 0);
+                sqe->user_data = 0;
+                ring_.Submit();
+            }
+        }
+        if (fixed)
+        {
+            // 文件表持有文件的引用,不移出则 close 后连接不会真正关闭
+            int32_t unset_fd = -1;
+            struct io_uring_rsrc_update2 update;
+            memset(&update, 0, sizeof(update));
+            update.offset = static_cast<uint32_t>(socket_fd);
+            update.data = reinterpret_cast<uint64_t>(&unset_fd);
+            update.nr = 1;
+            ring_.Register(IORING_REGISTER_FILES_UPDATE2, &update, sizeof(update));
+            fixed_files_[socket_fd] = 0;
+        }
+        return true;
+    }
 
     bool IOUringCtrl::OperEvent(BaseSocket& socket, EventOperType op_type, int32_t event_type)
     {
         if (EventOperType::EVENT_OPER_ADD == op_type)
         {
-            if (SOCKET_EVENT_RECV & event_type)
+            switch (socket.GetSocketState())
             {
-                return OnRecv(socket, 0);
-            }
-            else if (SOCKET_EVENT_SEND & event_type)
-            {
-                return OnSend(socket, 0);
+            case SocketState::SOCK_STATE_LISTENING:
+                return (SOCKET_EVENT_RECV & event_type) ? AddSocketAccept(socket) : true;
+            case SocketState::SOCK_STATE_CONNECTING:
+                return (SOCKET_EVENT_SEND & event_type) ? AddSocketConnect(socket) : true;
+            case SocketState::SOCK_STATE_ESTABLISHED:
+                if ((SOCKET_EVENT_RECV & event_type) && !AddSocketRead(socket))
+                {
+                    return false;
+                }
+                // 没有待发送的数据或已有发送请求时不投递
+                return AddSocketWrite(socket);
+            default:
+                return false;
             }
         }
         else if (EventOperType::EVENT_OPER_RDC == op_type)
@@ -115,7 +238,7 @@ namespace ToolBox
             {
                 now_event_type &= ~SOCKET_EVENT_RECV;
             }
-            else if (SOCKET_EVENT_SEND & event_type)
+            if (SOCKET_EVENT_SEND & event_type)
             {
                 now_event_type &= ~SOCKET_EVENT_SEND;
             }
@@ -124,237 +247,485 @@ namespace ToolBox
         return true;
     }
 
-    int32_t IOUringCtrl::URingWait(int msec)
+    bool IOUringCtrl::RunOnce(std::time_t time_stamp)
     {
-        return io_uring_submit_and_wait(ring_, 1);
+        if (!created_)
+        {
+            return false;
+        }
+        uint32_t reaped = ProcessCompletions(time_stamp);
+        if (!external_wait_ && 0 == reaped)
+        {
+            // 没有完成事件,提交后等待一会儿
+            int32_t ret = ring_.Submit(1, URING_WAIT_MSECONDS);
+            if (ret < 0)
+            {
+                NetworkLogError("[Network] io_uring_enter failed. ret:%d", ret);
+                return false;
+            }
+            ProcessCompletions(time_stamp);
+        }
+        return Flush(time_stamp);
     }
 
-    bool IOUringCtrl::RunOnce(std::time_t time_stamp)
+    bool IOUringCtrl::Flush(std::time_t time_stamp)
+    {
+        if (!created_)
+        {
+            return false;
+        }
+        flush_requested_ = false;
+        // 发送通常在提交时就地完成,处理完成事件又会投递下一段.
+        // 继续提交直到没有新请求、发送挂起等待可写或达到轮数上限,效果同 epoll 下一直写到 EAGAIN
+        for (uint32_t round = 0; ring_.Pending() > 0; round++)
+        {
+            int32_t ret = ring_.Submit();
+            if (ret < 0)
+            {
+                NetworkLogError("[Network] io_uring_enter failed. ret:%d", ret);
+                return false;
+            }
+            if (round + 1 >= URING_FLUSH_ROUNDS || 0 == ProcessCompletions(time_stamp))
+            {
+                break;
+            }
+        }
+        return true;
+    }
+
+    int32_t IOUringCtrl::AttachExternalWait()
+    {
+        external_wait_ = true;
+        return ring_.GetFd();
+    }
+
+    bool IOUringCtrl::RegisterFile(int32_t fd)
+    {
+        if (fd < 0 || static_cast<std::size_t>(fd) >= fixed_files_.size())
+        {
+            return false;
+        }
+        if (fixed_files_[fd])
+        {
+            return true;
+        }
+        struct io_uring_rsrc_update2 update;
+        memset(&update, 0, sizeof(update));
+        update.offset = static_cast<uint32_t>(fd);
+        update.data = reinterpret_cast<uint64_t>(&fd);
+        update.nr = 1;
+        if (ring_.Register(IORING_REGISTER_FILES_UPDATE2, &update, sizeof(update)) < 0)
+        {
+            return false;
+        }
+        fixed_files_[fd] = 1;
+        return true;
+    }
+
+    struct io_uring_sqe* IOUringCtrl::PrepareSqe(BaseSocket& socket, uint8_t opcode, UringOp* op)
+    {
+        struct io_uring_sqe* sqe = ring_.GetSqe();
+        if (nullptr == sqe)
+        {
+            NetworkLogError("[Network] get sqe from io_uring failed.");
+            return nullptr;
+        }
+        int32_t fd = socket.GetSocketID();
+        sqe->opcode = opcode;
+        sqe->fd = fd;
+        if (RegisterFile(fd))
+        {
+            // 注册文件的下标即 fd
+            sqe->flags |= IOSQE_FIXED_FILE;
+        }
+        sqe->user_data = reinterpret_cast<uint64_t>(op);
+        return sqe;
+    }
+
+    bool IOUringCtrl::AddSocketAccept(BaseSocket& socket)
+    {
+        auto* ctx = socket.GetUringSocket();
+        if (nullptr == ctx)
+        {
+            NetworkLogError("[Network] the socket get uring socket failed.");
+            return false;
+        }
+        if (nullptr != ctx->recv_op)
+        {
+            return true;
+        }
+        UringOp* op = AllocOp(UringOpType::URING_OP_ACCEPT, socket.GetConnID());
+        struct io_uring_sqe* sqe = PrepareSqe(socket, IORING_OP_ACCEPT, op);
+        if (nullptr == sqe)
+        {
+            FreeOp(op);
+            return false;
+        }
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_CLOEXEC;
+        ctx->recv_op = op;
+        NetworkLogDebug("[Network] AddSocketAccept add accept. socket id:%d, socket state:%d", socket.GetSocketID(), socket.GetSocketState());
+        return true;
+    }
+
+    bool IOUringCtrl::AddSocketRead(BaseSocket& socket)
+    {
+        auto* ctx = socket.GetUringSocket();
+        if (nullptr == ctx)
+        {
+            NetworkLogError("[Network] the socket get uring socket failed.");
+            return false;
+        }
+        if (nullptr != ctx->recv_op)
+        {
+            return true;
+        }
+        UringOp* op = AllocOp(UringOpType::URING_OP_RECV, socket.GetConnID());
+        struct io_uring_sqe* sqe = PrepareSqe(socket, IORING_OP_RECV, op);
+        if (nullptr == sqe)
+        {
+            FreeOp(op);
+            return false;
+        }
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags |= IOSQE_BUFFER_SELECT;
+        sqe->buf_group = URING_BUF_GROUP;
+        ctx->recv_op = op;
+        return true;
+    }
+
+    bool IOUringCtrl::AddSocketWrite(BaseSocket& socket)
+    {
+        auto* ctx = socket.GetUringSocket();
+        if (nullptr == ctx)
+        {
+            NetworkLogError("[Network] the socket get uring socket failed.");
+            return false;
+        }
+        if (nullptr != ctx->send_op)
+        {
+            // 发送完成后再投递下一段
+            return true;
+        }
+        socket.ResetSendAsyncSocket();
+        if (0 == ctx->send_len)
+        {
+            return true;
+        }
+        bool zero_copy = send_zc_ && nullptr != ctx->send_buffer && ctx->send_len >= URING_SEND_ZC_MIN_SIZE;
+        uint8_t opcode = zero_copy ? IORING_OP_SEND_ZC : (1 == ctx->send_iov_count ? IORING_OP_SEND : IORING_OP_SENDMSG);
+        UringOp* op = AllocOp(zero_copy ? UringOpType::URING_OP_SEND_ZC : UringOpType::URING_OP_SEND, socket.GetConnID());
+        struct io_uring_sqe* sqe = PrepareSqe(socket, opcode, op);
+        if (nullptr == sqe)
+        {
+            FreeOp(op);
+            return false;
+        }
+        if (IORING_OP_SENDMSG == opcode)
+        {
+            // 多段聚合为一次 sendmsg,msghdr 与 iovec 在提交时由内核拷贝
+            sqe->addr = reinterpret_cast<uint64_t>(&ctx->send_msg);
+            sqe->len = 1;
+        }
+        else
+        {
+            sqe->addr = reinterpret_cast<uint64_t>(ctx->send_iov[0].iov_base);
+            sqe->len = ctx->send_len;
+        }
+        sqe->msg_flags = MSG_NOSIGNAL;
+        if (nullptr != ctx->send_buffer)
+        {
+            // 请求持有缓冲区的引用,连接提前关闭也不会释放内核正在使用的内存
+            op->buffer = ctx->send_buffer;
+            op->buffer->AddRef();
+        }
+        ctx->send_op = op;
+        return true;
+    }
+
+    bool IOUringCtrl::AddSocketConnect(BaseSocket& socket)
     {
-        int32_t count = URingWait(URING_WAIT_MSECONDS);
-        if (count < 0)
+        auto* ctx = socket.GetUringSocket();
+        if (nullptr == ctx)
         {
-            NetworkLogError("[Network] the number of SQEs submitted:%u", count);
+            NetworkLogError("[Network] the socket get uring socket failed.");
+            return false;
+        }
+        if (nullptr != ctx->send_op)
+        {
+            return true;
+        }
+        UringOp* op = AllocOp(UringOpType::URING_OP_CONNECT, socket.GetConnID());
+        struct io_uring_sqe* sqe = PrepareSqe(socket, IORING_OP_POLL_ADD, op);
+        if (nullptr == sqe)
+        {
+            FreeOp(op);
             return false;
         }
-        NetworkLogTrace("[Network] the number of SQEs submitted:%u", count);
+        sqe->poll32_events = POLLOUT;
+        ctx->send_op = op;
+        return true;
+    }
+
+    uint32_t IOUringCtrl::ProcessCompletions(std::time_t time_stamp)
+    {
         // io_uring 设置了两个ringbuffer：
         // sq(submission queue):存放提交的IO请求,应用层为生产者操作tail,内核为消费者操作head.其中的entry称为sqe.
         // cq(completion queue):存放处理完成的IO请求,内核为生产者操作tail,应用层为消费者操作head.其中的entry称为cqe.
-        struct io_uring_cqe* cqe;
-        uint16_t head = 0;
-        uint16_t cqe_count = 0;
-
-        // go through all CQEs
-        io_uring_for_each_cqe(ring_, head, cqe)
+        uint32_t total = 0;
+        while (true)
         {
-            ++cqe_count;
-            // usleep(10);
-            UringIOContext* uring_io = reinterpret_cast<UringIOContext*>(cqe->user_data);
-            if (nullptr == uring_io)
+            uint32_t count = ring_.ForeachCqe([this, time_stamp](const struct io_uring_cqe& cqe)
             {
-                NetworkLogError("[Network] convert user_data to UringIOContext failed. cqe:%p, user_data:%p", cqe, cqe->user_data);
-                break;
-            }
-            BaseSocket* socket = uring_io->base_socket;
-            if (nullptr == socket)
+                OnCompletion(cqe, time_stamp);
+            });
+            total += count;
+            if (ring_.CqOverflow())
             {
-                NetworkLogError("[Network] base_socket is nullpter. cqe:%p, user_data:%p", cqe, cqe->user_data);
-                break;
+                // 取回溢出到内核链表中的完成事件
+                ring_.Submit();
+                continue;
             }
-            if (cqe->res == -ENOBUFS)
+            if (0 == count)
             {
-                NetworkLogError("[Network] bufs in automatic buffer selection empty, this should not happen....");
-                socket->UpdateEvent(SOCKET_EVENT_ERR, time_stamp);
                 break;
             }
-            // only read when there is no error, >= 0
-            if (cqe->res < 0)
+        }
+        AddWakeup(total);
+        if (total > 0 && buf_ring_mapped_)
+        {
+            // 处理完的 provided buffer 统一还给内核
+            __atomic_store_n(&buf_ring_->tail, buf_tail_, __ATOMIC_RELEASE);
+        }
+        return total;
+    }
+
+    void IOUringCtrl::OnCompletion(const struct io_uring_cqe& cqe, std::time_t time_stamp)
+    {
+        UringOp* op = reinterpret_cast<UringOp*>(cqe.user_data);
+        if (nullptr == op)
+        {
+            // 异步取消请求自身的完成事件
+            return;
+        }
+        // 没有 IORING_CQE_F_MORE 表示这是请求的最后一个完成事件
+        bool last = 0 == (cqe.flags & IORING_CQE_F_MORE);
+        if (cqe.flags & IORING_CQE_F_NOTIF)
+        {
+            // send_zc 的通知事件: 内核已用完缓冲区
+            if (last)
             {
-                NetworkLogWarn("[Network] io_uring_for_each_cqe error: cqe->res:%d, socket id:%d,uring_io io_type:%d ", cqe->res, socket->GetSocketID(), uring_io->io_type);
-                errno = -cqe->res;
-                socket->UpdateEvent(SOCKET_EVENT_ERR, time_stamp);
-                break;
+                FreeOp(op);
             }
-            else if (cqe->res == 0)
+            return;
+        }
+        BaseSocket* socket = FindSocket(op);
+        UringSockContext* ctx = nullptr != socket ? socket->GetUringSocket() : nullptr;
+        switch (op->type)
+        {
+        case UringOpType::URING_OP_ACCEPT:
+        {
+            uint64_t conn_id = op->conn_id;
+            if (last)
             {
-                NetworkLogDebug("[Network] io_uring_for_each_cqe error: cqe->res:%d, socket id:%d,uring_io io_type:%d ", cqe->res, socket->GetSocketID(), uring_io->io_type);
-                if (SOCK_STATE_SEND == uring_io->io_type)
+                if (nullptr != ctx && ctx->recv_op == op)
                 {
-                    NetworkLogDebug("[Network] io_uring_for_each_cqe connect success.");
-                    socket->UpdateEvent(SOCKET_EVENT_SEND, time_stamp);
+                    ctx->recv_op = nullptr;
                 }
-                else if (SOCK_STATE_RECV == uring_io->io_type)
+                FreeOp(op);
+            }
+            if (nullptr == socket)
+            {
+                if (cqe.res >= 0)
                 {
-                    NetworkLogDebug("[Network] io_uring_for_each_cqe socket disconnected.");
-                    socket->UpdateEvent(SOCKET_EVENT_ERR, time_stamp);
+                    close(cqe.res);
                 }
-
-                break;
+                return;
             }
-
-            NetworkLogTrace("[Network] io_uring_for_each_cqe socket type:%d, uring_io type:%d, io_uring_for_each_cqecqe_count:%u ", socket->GetSocketState(), uring_io->io_type, cqe_count);
-            if (SOCK_STATE_PROV_BUF & uring_io->io_type)
+            if (cqe.res >= 0)
+            {
+                ctx->accept_fd = cqe.res;
+                socket->UpdateEvent(SOCKET_EVENT_RECV, time_stamp);
+                ctx->accept_fd = -1;
+            }
+            else if (-ECANCELED != cqe.res)
             {
-                NetworkLogInfo("[Network] SOCK_STATE_PROV_BUF recv message.");
+                NetworkLogWarn("[Network] multishot accept failed. res:%d, socket id:%d", cqe.res, socket->GetSocketID());
+            }
+            if (last && -ECANCELED != cqe.res && nullptr != (socket = socket_finder_(conn_id)))
+            {
+                AddSocketAccept(*socket);
+            }
+            break;
+        }
+        case UringOpType::URING_OP_RECV:
+        {
+            uint64_t conn_id = op->conn_id;
+            if (last)
+            {
+                if (nullptr != ctx && ctx->recv_op == op)
+                {
+                    ctx->recv_op = nullptr;
+                }
+                FreeOp(op);
             }
-            else if (SOCK_STATE_LISTENING & uring_io->io_type)
+            bool has_buffer = 0 != (cqe.flags & IORING_CQE_F_BUFFER);
+            uint16_t bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+            if (nullptr != socket)
             {
-                NetworkLogDebug("[Network] SOCK_STATE_LISTENING on recvd connect. socket id:%d, socket state:%d", socket->GetSocketID(), socket->GetSocketState());
-                int32_t sock_conn_fd = cqe->res;
-                if (sock_conn_fd >= 0)
+                if (cqe.res > 0 && has_buffer)
                 {
-                    // AddSocketRead(*socket, IOSQE_BUFFER_SELECT);
-                    auto* uring_socket = socket->GetUringSocket();
-                    uring_socket->accept_ex->socket_fd = sock_conn_fd;
+                    ctx->recv_data = bufs_ + static_cast<std::size_t>(bid) * URING_BUF_SIZE;
+                    ctx->recv_len = static_cast<uint32_t>(cqe.res);
                     socket->UpdateEvent(SOCKET_EVENT_RECV, time_stamp);
+                    ctx->recv_data = nullptr;
+                    ctx->recv_len = 0;
+                }
+                else if (0 == cqe.res)
+                {
+                    // 对端关闭
+                    socket->Close(ENetErrCode::NET_RECV_FAILED, 0);
+                }
+                else if (-ENOBUFS == cqe.res)
+                {
+                    NetworkLogDebug("[Network] provided buffers exhausted, re-arm recv. socket id:%d", socket->GetSocketID());
+                }
+                else if (cqe.res < 0 && -ECANCELED != cqe.res)
+                {
+                    errno = -cqe.res;
+                    socket->UpdateEvent(SOCKET_EVENT_ERR, time_stamp);
                 }
             }
-            else if (SOCK_STATE_RECV & uring_io->io_type)
+            if (has_buffer)
             {
-                NetworkLogTrace("[Network] SOCK_STATE_RECV on recvd data. len:%d", cqe->res);
-                // int32_t bytes_read = cqe->res;
-                // int32_t bid = cqe->flags >> 16;
-                // bytes have been read into bufs, now add write to socket sqe
-                // AddSocketWrite(*socket, bid, bytes_read, 0);
-                auto* uring_socket = socket->GetUringSocket();
-                uring_socket->io_recv.len = cqe->res;
-                socket->UpdateEvent(SOCKET_EVENT_RECV, time_stamp);
+                RecycleBuffer(bid);
             }
-            else if (SOCK_STATE_SEND & uring_io->io_type)
+            // 事件处理中连接可能已关闭,重新查找
+            if (last && cqe.res != 0 && -ECANCELED != cqe.res && nullptr != socket_finder_
+                    && nullptr != (socket = socket_finder_(conn_id))
+                    && SocketState::SOCK_STATE_ESTABLISHED == socket->GetSocketState())
             {
-                NetworkLogTrace("[Network] SOCK_STATE_SEND has sended data.");
-                // write has been completed, first re-add the buffer
-                // AddProvideBuf(*socket, uring_io->bid);
-                // add a new read for the existing connection
-                // AddSocketWrite(*socket, uring_io->bid, MAX_MESSAGE_LEN, 0);
-                int32_t bytes_write = cqe->res;
-                auto* uring_socket = socket->GetUringSocket();
-                uring_socket->io_send.len = bytes_write;
-                socket->UpdateEvent(SOCKET_EVENT_SEND, time_stamp);
+                AddSocketRead(*socket);
             }
-
+            break;
         }
-        io_uring_cq_advance(ring_, cqe_count);
-        return true;
-    }
-
-    bool IOUringCtrl::OnRecv(BaseSocket& socket, uint32_t flags)
-    {
-        socket.ResetRecvAsyncSocket();
-        auto* uring_socket = socket.GetUringSocket();
-        if (SocketState::SOCK_STATE_LISTENING == socket.GetSocketState())
+        case UringOpType::URING_OP_SEND:
+        case UringOpType::URING_OP_SEND_ZC:
         {
-            auto& accept_ex = uring_socket->accept_ex;
-            if (nullptr == accept_ex)
+            if (nullptr != ctx && ctx->send_op == op)
+            {
+                ctx->send_op = nullptr;
+            }
+            if (last)
+            {
+                FreeOp(op);
+            }
+            if (nullptr == socket || -ECANCELED == cqe.res)
             {
-                accept_ex = new AcceptEx_t;
+                return;
             }
-            return AddSocketAccept(&socket, flags);
+            if (cqe.res < 0)
+            {
+                errno = -cqe.res;
+                socket->UpdateEvent(SOCKET_EVENT_ERR, time_stamp);
+                return;
+            }
+            ctx->send_len = static_cast<uint32_t>(cqe.res);
+            socket->UpdateEvent(SOCKET_EVENT_SEND, time_stamp);
+            break;
         }
-        else if (SocketState::SOCK_STATE_ESTABLISHED == socket.GetSocketState())
+        case UringOpType::URING_OP_CONNECT:
         {
-            return AddSocketRead(socket, 0);
+            if (nullptr != ctx && ctx->send_op == op)
+            {
+                ctx->send_op = nullptr;
+            }
+            FreeOp(op);
+            if (nullptr == socket || -ECANCELED == cqe.res)
+            {
+                return;
+            }
+            if (cqe.res < 0 || (cqe.res & (POLLERR | POLLHUP)))
+            {
+                socket->UpdateEvent(SOCKET_EVENT_ERR, time_stamp);
+                return;
+            }
+            ctx->send_len = 0;
+            ctx->send_buffer = nullptr;
+            socket->UpdateEvent(SOCKET_EVENT_SEND, time_stamp);
+            break;
+        }
+        default:
+            break;
         }
-        return false;
     }
 
-    bool IOUringCtrl::OnSend(BaseSocket& socket, uint32_t flags)
+    BaseSocket* IOUringCtrl::FindSocket(const UringOp* op)
     {
-        socket.ResetSendAsyncSocket();
-        auto& io_send = socket.GetUringSocket()->io_send;
-        if (SocketState::SOCK_STATE_CONNECTING == socket.GetSocketState())
+        if (nullptr == socket_finder_)
         {
-            io_send.io_type = SocketState::SOCK_STATE_CONNECTING;
+            return nullptr;
         }
-        else if (SocketState::SOCK_STATE_ESTABLISHED == socket.GetSocketState())
-        {
-            io_send.io_type = SocketState::SOCK_STATE_SEND;
-        }
-        return AddSocketWrite(socket, 0, 0);
+        return socket_finder_(op->conn_id);
     }
 
-    bool IOUringCtrl::AddSocketAccept(BaseSocket* socket, uint32_t flags)
+    void IOUringCtrl::RecycleBuffer(uint16_t bid)
     {
-        struct sockaddr_in client_addr;
-        socklen_t client_len = sizeof(client_addr);
-        struct io_uring_sqe* sqe = io_uring_get_sqe(ring_);
-        if (!sqe)
+        if (!buf_ring_mapped_)
         {
-            NetworkLogError("[Network] get sqe from io_uring failed.");
-            return false;
-        }
-
-        auto* uring_socket = socket->GetUringSocket();
-        if (!uring_socket)
-        {
-            NetworkLogError("[Network] the socket get uring socket failed.");
-            return false;
+            // 与重新投递的 recv 在同一次提交中按序执行
+            struct io_uring_sqe* sqe = ring_.GetSqe();
+            if (nullptr == sqe)
+            {
+                NetworkLogError("[Network] get sqe for provide buffer failed. bid:%u", bid);
+                return;
+            }
+            sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+            sqe->fd = 1;
+            sqe->addr = reinterpret_cast<uint64_t>(bufs_ + static_cast<std::size_t>(bid) * URING_BUF_SIZE);
+            sqe->len = static_cast<uint32_t>(URING_BUF_SIZE);
+            sqe->off = bid;
+            sqe->buf_group = URING_BUF_GROUP;
+            return;
         }
-        uring_socket->io_recv.base_socket = socket;
-        uring_socket->io_recv.io_type = SocketState::SOCK_STATE_LISTENING;
-        sqe->user_data = reinterpret_cast<uint64_t>(&uring_socket->io_recv);
-
-
-        io_uring_prep_accept(sqe, socket->GetSocketID(), reinterpret_cast<struct sockaddr*>(&client_addr), &client_len, flags);
-        io_uring_sqe_set_flags(sqe, flags);
-        // io_uring_prep_poll_add(sqe, socket.GetSocketID(), POLLIN);
-
-        NetworkLogDebug("[Network] AddSocketAccept add accept. socket id:%d, socket state:%d", socket->GetSocketID(), socket->GetSocketState());
-        return true;
+        // 不用 buf_ring_->bufs: 头文件的柔性数组宏在 C++ 下会把它放到偏移 8 处,与内核的布局不一致
+        struct io_uring_buf& buf = reinterpret_cast<struct io_uring_buf*>(buf_ring_)[buf_tail_ & (URING_BUF_RING_ENTRIES - 1)];
+        buf.addr = reinterpret_cast<uint64_t>(bufs_ + static_cast<std::size_t>(bid) * URING_BUF_SIZE);
+        buf.len = static_cast<uint32_t>(URING_BUF_SIZE);
+        buf.bid = bid;
+        buf_tail_++;
     }
 
-    bool IOUringCtrl::AddSocketRead(BaseSocket& socket, uint32_t flags)
+    UringOp* IOUringCtrl::AllocOp(UringOpType type, uint64_t conn_id)
     {
-        struct io_uring_sqe* sqe = io_uring_get_sqe(ring_);
-        if (!sqe)
+        UringOp* op = free_ops_;
+        if (nullptr != op)
         {
-            NetworkLogError("[Network] get sqe from io_uring failed.");
-            return false;
+            free_ops_ = op->next;
         }
-
-        auto* uring_socket = socket.GetUringSocket();
-        if (!uring_socket)
+        else
         {
-            NetworkLogError("[Network] the socket get uring socket failed.");
-            return false;
+            ops_.emplace_back(std::make_unique<UringOp>());
+            op = ops_.back().get();
         }
-
-        sqe->buf_group = group_id_;
-        uring_socket->io_recv.base_socket = &socket;
-        uring_socket->io_recv.io_type = SocketState::SOCK_STATE_RECV;
-        sqe->user_data = reinterpret_cast<uint64_t>(&uring_socket->io_recv);
-
-        io_uring_prep_recv(sqe, socket.GetSocketID(), uring_socket->io_recv.buf, uring_socket->io_recv.len, flags);
-        // io_uring_sqe_set_flags(sqe, flags);
-
-        return true;
+        op->type = type;
+        op->conn_id = conn_id;
+        op->buffer = nullptr;
+        op->next = nullptr;
+        return op;
     }
 
-    bool IOUringCtrl::AddSocketWrite(BaseSocket& socket, uint16_t bid, uint32_t flags)
+    void IOUringCtrl::FreeOp(UringOp* op)
     {
-        auto* uring_socket = socket.GetUringSocket();
-        if (!uring_socket)
+        if (nullptr != op->buffer)
         {
-            NetworkLogError("[Network] the socket get uring socket failed.");
-            return false;
+            op->buffer->Release();
+            op->buffer = nullptr;
         }
-        struct io_uring_sqe* sqe = io_uring_get_sqe(ring_);
-
-        uring_socket->io_send.base_socket = &socket;
-        uring_socket->io_send.io_type = SocketState::SOCK_STATE_SEND;
-        uring_socket->io_send.bid = bid;
-        sqe->user_data = reinterpret_cast<uint64_t>( &uring_socket->io_send);
-
-        io_uring_prep_send(sqe, socket.GetSocketID(), uring_socket->io_send.buf, uring_socket->io_send.len, flags);
-        return true;
+        op->next = free_ops_;
+        free_ops_ = op;
     }
+
 };  // ToolBox
 
 #endif  // LINUX_IO_URING
-
-
-
-
-
-
@@ -2,31 +2,36 @@
 
 #ifdef LINUX_IO_URING
 
-#include "tools/singleton.h"
 #include "network/net_imp/net_imp_define.h"
 #include "network/net_imp/base_ctrl.h"
-#include "liburing.h"
+#include "io_uring_ring.h"
+#include <functional>
+#include <memory>
+#include <vector>
 
 
 namespace ToolBox
 {
 
-    struct IOUringConnInfo
-    {
-        uint32_t fd;
-        uint16_t type;
-        uint16_t bid;
-    };
-
     /*
     * io_uring 控制类
+    * 1. 监听 socket 使用 multishot accept,连接使用 multishot recv,一次提交持续产生完成事件.
+    * 2. 接收数据写入按组注册的 provided buffer ring,事件处理完立即归还,不为每个连接预留接收内存.
+    *    不支持 ring 映射的内核上退回 IORING_OP_PROVIDE_BUFFERS.
+    * 3. socket 注册进文件表,请求以 fd 为下标使用注册文件,省去每次请求查找与引用文件的开销.
+    * 4. 提交项在网络循环中累积,每次循环只提交一次;每个完成事件都会处理,单个事件出错不影响其他事件.
+    * 5. 大块的引用计数缓冲区使用 send_zc 发送,缓冲区的引用由请求持有,直到内核通知用完.
     */
     class IOUringCtrl : public IOMultiplexingInterface
     {
     public:
+        /*
+        * 按连接ID查找 socket
+        */
+        using SocketFinder = std::function<BaseSocket*(uint64_t conn_id)>;
         /*
         * 构造
-        * @param max_events 最大事件数量
+        * @param max_events 提交队列长度
         */
         IOUringCtrl(uint32_t max_events);
         /*
@@ -34,78 +39,127 @@ namespace ToolBox
         */
         ~IOUringCtrl();
         /*
-        * 创建 epoll
+        * 设置按连接ID查找 socket 的函数
+        */
+        void SetSocketFinder(SocketFinder finder)
+        {
+            socket_finder_ = std::move(finder);
+        }
+        /*
+        * 创建 io_uring
         * @return 是否成功
         */
         bool CreateIOMultiplexing() override;
         /*
-        * 销毁 epoll
+        * 销毁 io_uring
         */
         void DestroyIOMultiplexing() override;
         /*
-        * 删除事件
+        * 取消 socket 上进行中的请求并移出注册文件表,须在关闭 fd 之前调用
         * @param socket_fd 文件描述符
         */
-        // bool DelEvent(int socket_fd);
+        bool DelEvent(int socket_fd) override;
         /*
         * 处理事件
         */
         bool OperEvent(BaseSocket& socket, EventOperType op_type, int32_t event_type) override;
         /*
-        * epoll_wait
-        * @param msec 等待毫秒数
-        * @return 有读写通知的文件描述符的个数
+        * 处理完成事件并提交本次循环累积的请求
+        */
+        bool RunOnce(std::time_t time_stamp) override;
+        /*
+        * 提交已累积的请求并处理就地完成的事件,不等待
+        * @return 是否成功
         */
-        int32_t URingWait(int msec);
+        bool Flush(std::time_t time_stamp);
         /*
-        * 执行一次 epoll wait
+        * 请求在处理完当前事件后提前提交
         */
-        bool RunOnce(std::time_t time_stamp) override;
+        void RequestFlush()
+        {
+            flush_requested_ = true;
+        }
+        /*
+        * 是否有提前提交的请求
+        */
+        bool IsFlushRequested() const
+        {
+            return flush_requested_;
+        }
+        /*
+        * 交由网络线程统一阻塞等待: 完成队列非空时 io_uring 的 fd 可读
+        */
+        int32_t AttachExternalWait() override;
     private:
         /*
-        * @brief 接收消息
-        * @param socket 客户端连接
-        * @param flags 标记
-        * @return 是否成功
+        * 注册 socket 到文件表
+        * @return 是否使用注册文件
         */
-        bool OnRecv(BaseSocket& socket, uint32_t flags);
+        bool RegisterFile(int32_t fd);
         /*
-        * @brief 发送消息
-        * @param socket 客户端连接
-        * @param flags 标记
-        * @return 是否成功
+        * 准备一个以 socket 为目标的提交项
         */
-        bool OnSend(BaseSocket& socket, uint32_t flags);
+        struct io_uring_sqe* PrepareSqe(BaseSocket& socket, uint8_t opcode, UringOp* op);
         /*
-        * @brief 监听
-        * @param socket 客户端连接
-        * @param message_size 消息大小
-        * @param flags 标记
+        * @brief 投递 multishot accept
         */
-        bool AddSocketAccept(BaseSocket* socket, uint32_t flags);
+        bool AddSocketAccept(BaseSocket& socket);
         /*
-        * @brief 读
-        * @param socket 客户端连接
-        * @param flags 标记
+        * @brief 投递 multishot recv
         */
-        bool AddSocketRead(BaseSocket& socket, uint32_t flags);
+        bool AddSocketRead(BaseSocket& socket);
         /*
-        * @brief 写
-        * @param socket 客户端连接
-        * @param bid
-        * @param flags 标记
+        * @brief 投递发送,同一时刻只有一个发送请求
         */
-        bool AddSocketWrite(BaseSocket& socket, uint16_t bid, uint32_t flags);
+        bool AddSocketWrite(BaseSocket& socket);
+        /*
+        * @brief 投递等待主动连接完成
+        */
+        bool AddSocketConnect(BaseSocket& socket);
+        /*
+        * 处理完成队列中的全部完成事件
+        * @return 处理的个数
+        */
+        uint32_t ProcessCompletions(std::time_t time_stamp);
+        /*
+        * 处理一个完成事件
+        */
+        void OnCompletion(const struct io_uring_cqe& cqe, std::time_t time_stamp);
+        /*
+        * 查找请求所属的 socket,socket 已关闭或槽位已复用时为空
+        */
+        BaseSocket* FindSocket(const UringOp* op);
+        /*
+        * 归还 provided buffer
+        */
+        void RecycleBuffer(uint16_t bid);
+        /*
+        * 分配请求
+        */
+        UringOp* AllocOp(UringOpType type, uint64_t conn_id);
+        /*
+        * 回收请求,释放持有的缓冲区引用
+        */
+        void FreeOp(UringOp* op);
     private:
-        uint32_t max_events_ = 0; // 最大事件数
-        struct io_uring* ring_;       // io_uring 全局句柄
-        char bufs_[BUFFERS_COUNT][MAX_MESSAGE_LEN];
-        int32_t group_id_ = 1337;
-    };
-
-#define EpollCtrlMgr Singleton<ToolBox::EpollCtrl>::Instance(10240)
+        uint32_t max_events_ = 0;                   // 提交队列长度
+        IOUringRing ring_;                          // io_uring 环
+        bool created_ = false;                      // 是否已创建
+        bool external_wait_ = false;                // 是否交由网络线程统一等待
+        bool send_zc_ = false;                      // 内核是否支持 send_zc
+        bool flush_requested_ = false;              // 是否有连接请求提前提交
+        SocketFinder socket_finder_;                // 按连接ID查找 socket
 
+        bool buf_ring_mapped_ = false;              // provided buffer 是否使用 ring 映射,否则逐个提交 IORING_OP_PROVIDE_BUFFERS
+        struct io_uring_buf_ring* buf_ring_ = nullptr;  // provided buffer ring
+        std::size_t buf_ring_size_ = 0;             // provided buffer ring 的映射大小
+        char* bufs_ = nullptr;                      // provided buffer 内存
+        uint16_t buf_tail_ = 0;                     // provided buffer ring 的本地尾部,处理完一批完成事件后发布
 
+        std::vector<uint8_t> fixed_files_;          // 以 fd 为下标,是否已注册进文件表
+        UringOp* free_ops_ = nullptr;               // 空闲请求
+        std::vector<std::unique_ptr<UringOp>> ops_; // 全部请求
+    };
 
 };  // ToolBox
 
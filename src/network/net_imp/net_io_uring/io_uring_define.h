@@ -2,61 +2,67 @@
 
 #ifdef LINUX_IO_URING
 
-#include <bits/stdint-uintn.h>
+#include <cstddef>
+#include <cstdint>
+#include <sys/socket.h>
+#include <sys/uio.h>
 
 namespace ToolBox
 {
 
-    // constexpr std::size_t MAX_MESSAGE_LEN = DEFAULT_RING_BUFF_SIZE;
-    // constexpr std::size_t MAX_CONNECTIONS = MAX_SOCKET_COUNT;
-    // constexpr std::size_t BUFFERS_COUNT = MAX_CONNECTIONS;
+    constexpr uint32_t URING_ENTRIES = 4096;                /* 提交队列长度,完成队列为其 URING_CQ_FACTOR 倍 */
+    constexpr uint32_t URING_CQ_FACTOR = 8;                 /* multishot 请求一次提交产生多个完成事件,完成队列要比提交队列长得多 */
+    constexpr uint32_t URING_EVENTS_PER_FLUSH = 1024;       /* 每处理这么多主线程事件提交并回收一次,突发的发送不会全部积压在发送缓冲区 */
+    constexpr uint32_t URING_FLUSH_ROUNDS = 16;             /* 单次刷新最多提交的轮数,就地完成的发送会投递下一段,需再次提交 */
+    constexpr uint32_t URING_WAIT_MSECONDS = 2;             /* 未交由网络线程统一等待时,单次等待完成事件的毫秒数 */
+    constexpr uint32_t URING_MAX_FIXED_FILES = 65536;       /* 注册文件表的最大长度,以 fd 为下标,同时受进程文件描述符上限限制 */
+    constexpr uint16_t URING_BUF_GROUP = 0;                 /* provided buffer ring 的组号 */
+    constexpr uint32_t URING_BUF_RING_ENTRIES = 1024;       /* provided buffer ring 的缓冲区个数,须为 2 的幂 */
+    constexpr std::size_t URING_BUF_SIZE = DEFAULT_RING_BUFF_SIZE / 16;    /* 单个 provided buffer 的大小,按连接接收缓冲区的默认大小折算 */
+    constexpr std::size_t URING_SEND_ZC_MIN_SIZE = 16 * 1024;  /* 不小于 16k 的引用计数缓冲区才用 send_zc 发送,更小的 page pin 开销大于拷贝 */
 
-    constexpr std::size_t MAX_MESSAGE_LEN = 1024;
-    constexpr std::size_t MAX_CONNECTIONS = 1024;
-    constexpr std::size_t BUFFERS_COUNT = 1024;
-    constexpr std::size_t URING_WAIT_MSECONDS = 2;
+    class NetBuffer;
 
     /*
-    * 定义 io_uring 的上下文状态.
+    * 定义 io_uring 请求的类型
     */
-    enum class UringType : uint8_t
+    enum class UringOpType : uint8_t
     {
-        URING_ACCEPT,
-        URING_READ,
-        URING_WRITE,
-        URING_PROV_BUF,
-    };
-
-    class BaseSocket;
-
-    /*
-    * 定义 io_uring 的上下文
-    */
-    struct UringIOContext
-    {
-        BaseSocket*     base_socket;        // 拥有此上下文的socket.
-        SocketState     io_type;            // 当前的I/O类型. IOCP没有像epoll那样的EPOLLIN,EPOLLOUT,只能通过自身携带的类型做标记.
-        uint16_t        bid;
-        char*           buf;                // 异步缓冲区内存
-        uint32_t        len;                // 异步缓冲区长度
+        URING_OP_ACCEPT,        // multishot accept
+        URING_OP_RECV,          // multishot recv, 数据写入 provided buffer
+        URING_OP_SEND,          // 普通发送[send/sendmsg]
+        URING_OP_SEND_ZC,       // 零拷贝发送,发送完成后另有一个通知事件
+        URING_OP_CONNECT,       // 等待主动连接完成[poll POLLOUT]
     };
 
     /*
-    * 定义 AcceptEx 函数相关
+    * 定义 io_uring 请求,由 IOUringCtrl 分配与回收,作为 user_data 提交.
+    * 请求不指向 socket,完成时按连接ID查找 socket,socket 已关闭或槽位已复用时查不到,完成事件直接丢弃.
     */
-    struct AcceptEx_t
+    struct UringOp
     {
-        uint32_t   socket_fd;               //  当前未决的客户端套接字  -AcceptEx
+        UringOpType     type = UringOpType::URING_OP_RECV;
+        uint64_t        conn_id = 0;        // 发起请求的连接ID
+        NetBuffer*      buffer = nullptr;   // 发送引用计数缓冲区时持有的引用,内核用完后释放
+        UringOp*        next = nullptr;     // 空闲链表
     };
 
     /*
-    * 定义 io_uring 发送和接收的上下文
+    * 定义 socket 上的 io_uring 上下文
     */
     struct UringSockContext
     {
-        AcceptEx_t*      accept_ex = nullptr;       // AcceptEx_t指针
-        UringIOContext   io_recv;                   // 接收请求
-        UringIOContext   io_send;                   // 发送请求
+        UringOp*        recv_op = nullptr;      // 进行中的 multishot accept/recv
+        UringOp*        send_op = nullptr;      // 进行中的发送/连接,同一时刻最多一个
+        int32_t         accept_fd = -1;         // 本次接受的连接
+        const char*     recv_data = nullptr;    // 本次收到的数据[位于 provided buffer 中,事件处理完即回收]
+        uint32_t        recv_len = 0;           // 本次收到的字节数
+        struct iovec    send_iov[MAX_SEND_IOV_COUNT];   // 待提交的发送数据: 发送 ringbuffer 中回绕的两段 + 零拷贝发送队列中的缓冲区
+        struct msghdr   send_msg = {};          // 多段时以 sendmsg 提交,指向 send_iov
+        uint32_t        send_iov_count = 0;     // send_iov 的段数
+        uint32_t        send_len = 0;           // 待提交的发送字节数;发送完成时为实际发送的字节数
+        uint32_t        send_ring_len = 0;      // 发送请求中位于发送 ringbuffer 的字节数,请求完成前 ringbuffer 不能扩容
+        NetBuffer*      send_buffer = nullptr;  // 只有一段且位于引用计数缓冲区时记录该缓冲区,可用 send_zc 发送
     };
 
 }
@@ -0,0 +1,181 @@
+#include "io_uring_ring.h"
+
+#ifdef LINUX_IO_URING
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace ToolBox
+{
+
+    IOUringRing::~IOUringRing()
+    {
+        Exit();
+    }
+
+    bool IOUringRing::Init(uint32_t entries, uint32_t cq_entries)
+    {
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL;
+        params.cq_entries = cq_entries;
+        ring_fd_ = static_cast<int32_t>(syscall(__NR_io_uring_setup, entries, &params));
+        if (ring_fd_ < 0)
+        {
+            ring_fd_ = -1;
+            return false;
+        }
+        features_ = params.features;
+
+        sq_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+        cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        if (features_ & IORING_FEAT_SINGLE_MMAP)
+        {
+            sq_size_ = cq_size_ = (std::max)(sq_size_, cq_size_);
+        }
+        sq_ptr_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+        if (MAP_FAILED == sq_ptr_)
+        {
+            sq_ptr_ = nullptr;
+            Exit();
+            return false;
+        }
+        if (features_ & IORING_FEAT_SINGLE_MMAP)
+        {
+            cq_ptr_ = sq_ptr_;
+        }
+        else
+        {
+            cq_ptr_ = mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+            if (MAP_FAILED == cq_ptr_)
+            {
+                cq_ptr_ = nullptr;
+                Exit();
+                return false;
+            }
+        }
+        sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+        void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+        if (MAP_FAILED == sqes)
+        {
+            Exit();
+            return false;
+        }
+        sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+        char* sq = static_cast<char*>(sq_ptr_);
+        sq_khead_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.head);
+        sq_ktail_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+        sq_kflags_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.flags);
+        sq_mask_ = *reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+        sq_entries_ = *reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_entries);
+        // 提交项下标与数组下标一一对应,之后不再修改
+        uint32_t* sq_array = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+        for (uint32_t i = 0; i < sq_entries_; i++)
+        {
+            sq_array[i] = i;
+        }
+        char* cq = static_cast<char*>(cq_ptr_);
+        cq_khead_ = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+        cq_ktail_ = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+        sqe_head_ = sqe_tail_ = *sq_ktail_;
+        return true;
+    }
+
+    void IOUringRing::Exit()
+    {
+        if (nullptr != sqes_)
+        {
+            munmap(sqes_, sqes_size_);
+            sqes_ = nullptr;
+        }
+        if (nullptr != cq_ptr_ && cq_ptr_ != sq_ptr_)
+        {
+            munmap(cq_ptr_, cq_size_);
+        }
+        cq_ptr_ = nullptr;
+        if (nullptr != sq_ptr_)
+        {
+            munmap(sq_ptr_, sq_size_);
+            sq_ptr_ = nullptr;
+        }
+        if (ring_fd_ >= 0)
+        {
+            close(ring_fd_);
+            ring_fd_ = -1;
+        }
+    }
+
+    struct io_uring_sqe* IOUringRing::GetSqe()
+    {
+        if (sqe_tail_ - __atomic_load_n(sq_khead_, __ATOMIC_ACQUIRE) >= sq_entries_)
+        {
+            // 提交队列满了,先提交一批
+            if (Submit() < 0 || sqe_tail_ - __atomic_load_n(sq_khead_, __ATOMIC_ACQUIRE) >= sq_entries_)
+            {
+                return nullptr;
+            }
+        }
+        struct io_uring_sqe* sqe = &sqes_[sqe_tail_ & sq_mask_];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe_tail_++;
+        return sqe;
+    }
+
+    int32_t IOUringRing::Submit(uint32_t wait_nr /*= 0*/, int32_t timeout_ms /*= -1*/)
+    {
+        uint32_t to_submit = sqe_tail_ - sqe_head_;
+        if (to_submit > 0)
+        {
+            __atomic_store_n(sq_ktail_, sqe_tail_, __ATOMIC_RELEASE);
+            sqe_head_ = sqe_tail_;
+        }
+        uint32_t flags = 0;
+        struct io_uring_getevents_arg arg;
+        struct __kernel_timespec ts;
+        void* argp = nullptr;
+        std::size_t argsz = 0;
+        if (wait_nr > 0 || CqOverflow())
+        {
+            flags |= IORING_ENTER_GETEVENTS;
+        }
+        if (wait_nr > 0 && timeout_ms >= 0)
+        {
+            memset(&arg, 0, sizeof(arg));
+            ts.tv_sec = timeout_ms / 1000;
+            ts.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+            arg.sigmask_sz = _NSIG / 8;
+            arg.ts = reinterpret_cast<uint64_t>(&ts);
+            flags |= IORING_ENTER_EXT_ARG;
+            argp = &arg;
+            argsz = sizeof(arg);
+        }
+        if (0 == to_submit && 0 == flags)
+        {
+            return 0;
+        }
+        int32_t ret = static_cast<int32_t>(syscall(__NR_io_uring_enter, ring_fd_, to_submit, wait_nr, flags, argp, argsz));
+        if (ret < 0)
+        {
+            // 等待超时或被信号打断不算失败
+            return (ETIME == errno || EINTR == errno) ? 0 : -errno;
+        }
+        return ret;
+    }
+
+    int32_t IOUringRing::Register(uint32_t opcode, const void* arg, uint32_t nr_args)
+    {
+        int32_t ret = static_cast<int32_t>(syscall(__NR_io_uring_register, ring_fd_, opcode, arg, nr_args));
+        return ret < 0 ? -errno : ret;
+    }
+
+};  // ToolBox
+
+#endif  // LINUX_IO_URING
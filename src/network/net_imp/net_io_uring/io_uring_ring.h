@@ -0,0 +1,129 @@
+#pragma once
+
+#ifdef LINUX_IO_URING
+
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+
+namespace ToolBox
+{
+
+    /*
+    * io_uring 环的最小封装,直接使用内核接口[io_uring_setup/io_uring_enter/io_uring_register],不依赖 liburing.
+    * 只在所属的网络线程内使用,不加锁.
+    */
+    class IOUringRing
+    {
+    public:
+        /*
+        * 析构
+        */
+        ~IOUringRing();
+        /*
+        * 创建环
+        * @param entries 提交队列长度
+        * @param cq_entries 完成队列长度
+        * @return 是否成功
+        */
+        bool Init(uint32_t entries, uint32_t cq_entries);
+        /*
+        * 销毁环
+        */
+        void Exit();
+        /*
+        * 环的文件描述符,完成队列非空时可读,可交给 epoll 等待
+        */
+        int32_t GetFd() const
+        {
+            return ring_fd_;
+        }
+        /*
+        * 内核支持的特性[IORING_FEAT_*]
+        */
+        uint32_t GetFeatures() const
+        {
+            return features_;
+        }
+        /*
+        * 取一个空闲的提交项,已清零.提交队列满时先提交已有的提交项
+        * @return 提交项,失败时为空
+        */
+        struct io_uring_sqe* GetSqe();
+        /*
+        * 尚未提交的提交项个数
+        */
+        uint32_t Pending() const
+        {
+            return sqe_tail_ - sqe_head_;
+        }
+        /*
+        * 提交全部提交项,并可等待完成事件
+        * @param wait_nr 至少等待的完成事件个数,0 表示不等待
+        * @param timeout_ms 等待的毫秒数,小于 0 表示一直等待
+        * @return 提交的个数,失败时为负的错误码
+        */
+        int32_t Submit(uint32_t wait_nr = 0, int32_t timeout_ms = -1);
+        /*
+        * 完成队列中是否有完成事件
+        */
+        bool HasCqe() const
+        {
+            return __atomic_load_n(cq_ktail_, __ATOMIC_ACQUIRE) != *cq_khead_;
+        }
+        /*
+        * 完成队列是否溢出到内核的溢出链表,需要进入内核取回
+        */
+        bool CqOverflow() const
+        {
+            return 0 != (__atomic_load_n(sq_kflags_, __ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW);
+        }
+        /*
+        * 遍历完成队列中当前的全部完成事件,回调返回后即归还完成项
+        * @return 遍历的个数
+        */
+        template<typename Func>
+        uint32_t ForeachCqe(Func&& func)
+        {
+            uint32_t head = *cq_khead_;
+            uint32_t tail = __atomic_load_n(cq_ktail_, __ATOMIC_ACQUIRE);
+            uint32_t count = 0;
+            for (; head != tail; head++, count++)
+            {
+                func(cqes_[head & cq_mask_]);
+                __atomic_store_n(cq_khead_, head + 1, __ATOMIC_RELEASE);
+            }
+            return count;
+        }
+        /*
+        * io_uring_register
+        * @return 成功时为非负数,失败时为负的错误码
+        */
+        int32_t Register(uint32_t opcode, const void* arg, uint32_t nr_args);
+    private:
+        int32_t ring_fd_ = -1;
+        uint32_t features_ = 0;
+        void* sq_ptr_ = nullptr;
+        std::size_t sq_size_ = 0;
+        void* cq_ptr_ = nullptr;
+        std::size_t cq_size_ = 0;
+        struct io_uring_sqe* sqes_ = nullptr;
+        std::size_t sqes_size_ = 0;
+
+        uint32_t* sq_khead_ = nullptr;
+        uint32_t* sq_ktail_ = nullptr;
+        uint32_t* sq_kflags_ = nullptr;
+        uint32_t sq_mask_ = 0;
+        uint32_t sq_entries_ = 0;
+        uint32_t sqe_head_ = 0;     // 已交给内核的提交项位置
+        uint32_t sqe_tail_ = 0;     // 已取出的提交项位置
+
+        uint32_t* cq_khead_ = nullptr;
+        uint32_t* cq_ktail_ = nullptr;
+        uint32_t cq_mask_ = 0;
+        struct io_uring_cqe* cqes_ = nullptr;
+    };
+
+};  // ToolBox
+
+#endif // LINUX_IO_URING
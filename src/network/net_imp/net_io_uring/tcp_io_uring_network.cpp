@@ -11,7 +11,13 @@ namespace ToolBox
 
     bool TcpIOUringNetwork::Init(NetworkChannel* master, NetworkType network_type, uint32_t net_thread_index)
     {
-        base_ctrl_ = new IOUringCtrl(MAX_SOCKET_COUNT);
+        auto* uring_ctrl = new IOUringCtrl(URING_ENTRIES);
+        // 完成事件按连接ID找回 socket,已关闭的连接查不到
+        uring_ctrl->SetSocketFinder([this](uint64_t conn_id) -> BaseSocket*
+        {
+            return sock_mgr_.GetSocket(conn_id);
+        });
+        base_ctrl_ = uring_ctrl_ = uring_ctrl;
         if (!ImpNetwork<TcpSocket>::Init(master, network_type, net_thread_index))
         {
             NetworkLogError("[Network] Init TcpIOUringNetwork failed. network_type:%d", network_type);
@@ -20,6 +26,22 @@ namespace ToolBox
         return true;
     }
 
+    void TcpIOUringNetwork::Update(std::time_t time_stamp)
+    {
+        // 发送请求每次循环才提交一次,请求完成前同一连接的数据只能积压在发送缓冲区.
+        // 主线程一次发来大量事件时,每处理一批或有连接积压过多时提交并回收一次,让数据尽快交给内核
+        std::size_t handled = 0;
+        while (HandleEvents_(1) > 0)
+        {
+            if (++handled >= URING_EVENTS_PER_FLUSH || uring_ctrl_->IsFlushRequested())
+            {
+                handled = 0;
+                uring_ctrl_->Flush(time_stamp);
+            }
+        }
+        ImpNetwork<TcpSocket>::Update(time_stamp);
+    }
+
 
 };  // ToolBox
 
@@ -5,6 +5,7 @@
 
 namespace ToolBox
 {
+    class IOUringCtrl;
 
     /*
     * 定义基于 TCP 和 io_uring 的网络
@@ -24,6 +25,12 @@ namespace ToolBox
         * 初始化
         */
         virtual bool Init(NetworkChannel* master, NetworkType network_type, uint32_t net_thread_index) override;
+        /*
+        * 运行一次网络循环
+        */
+        virtual void Update(std::time_t time_stamp) override;
+    private:
+        IOUringCtrl* uring_ctrl_ = nullptr;     // 即 base_ctrl_
     };
 
 };  // ToolBox
@@ -185,6 +185,7 @@ namespace ToolBox
             return false;
         }
         per_io->wsa_buf.len = bytes;
+        AddWakeup(1);
         if ((per_io->io_type & SocketState::SOCK_STATE_RECV) || (per_io->io_type & SocketState::SOCK_STATE_LISTENING))
         {
             socket->UpdateEvent(SOCKET_EVENT_RECV, time_stamp);
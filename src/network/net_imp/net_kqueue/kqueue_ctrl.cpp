@@ -73,6 +73,7 @@ namespace ToolBox
         {
             return false;
         }
+        AddWakeup(static_cast<uint32_t>(count));
         for (int32_t i = 0; i < count; i++)
         {
             auto& event = events_[i];
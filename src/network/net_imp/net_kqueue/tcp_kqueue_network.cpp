@@ -8,7 +8,7 @@ namespace ToolBox
 
     bool TcpKqueueNetwork::Init(NetworkChannel* master, NetworkType network_type, uint32_t net_thread_index)
     {
-        base_ctrl_ = new KqueueCtrl(MAX_SOCKET_COUNT);
+        base_ctrl_ = new KqueueCtrl(master->GetMaxSocketCount());
         if (!ImpNetwork<TcpSocket>::Init(master, network_type, net_thread_index))
         {
             NetworkLogError("[Network] Init TcpKqueueNetwork failed. network_type:%d", network_type);
@@ -1,11 +1,9 @@
 #pragma once
 #include <cstdint>
 #include <functional>
-#include <list>
 #include <stdint.h>
 #include <deque>
 #include <vector>
-#include <set>
 #include "net_imp_define.h"
 
 namespace ToolBox
@@ -13,6 +11,10 @@ namespace ToolBox
 
     /*
     * socket 池子
+    * 槽位数组按下标稳定存放 socket,socket 对象随槽位复用;已分配的 socket 另存于紧凑数组,槽位记录其在紧凑数组中的位置,
+    * 释放时与末尾交换后删除.分配、释放、按连接ID查找都是 O(1),遍历只扫描紧凑数组.
+    * 回收的槽位按先进先出复用,槽位每复用一次代数加一,编码进连接ID,过期的连接ID查不到新的 socket.
+    * 另有一个脏列表记录有待处理数据的 socket,定时刷新只遍历脏列表,耗时与活跃连接数成正比而不是与连接总数成正比.
     */
     template<typename SocketType>
     class SocketPool
@@ -32,7 +34,7 @@ namespace ToolBox
         /*
         * 初始化
         * @param max_count 最多可以连接的用户数
-        * @param thread_index 多网络线程下的序号[占8bit]
+        * @param thread_index 多网络线程下的序号[占 CONN_ID_THREAD_BITS 位]
         */
         bool Init(uint32_t max_count, uint32_t thread_index = 0)
         {
@@ -40,61 +42,49 @@ namespace ToolBox
             {
                 return false;
             }
-            if (max_count > UINT16_MAX - 1)
+            // 下标全为 1 的槽位不使用
+            if (max_count > CONN_ID_INDEX_MASK)
             {
-                max_count = UINT16_MAX - 1;
+                max_count = static_cast<uint32_t>(CONN_ID_INDEX_MASK);
             }
             max_socket_count_ = max_count;
             thread_index_ = thread_index;
-            curr_index_ = 0;
-            curr_cycle_ = 0;
-            alloced_socketes_.clear();
-            socket_vector_.resize(max_count, nullptr);
-            for (uint16_t i = 0; i < max_count; i++)
-            {
-                active_slot_list_.emplace_back(i);
-            }
+            slots_.clear();
+            free_slots_.clear();
+            active_sockets_.clear();
+            dirty_conn_ids_.clear();
+            listener_count_ = 0;
             return true;
         }
         /*
-        * 逆初始化
+        * 逆初始化,释放所有槽位上的 socket[包括仍已分配的].调用前应先关闭已分配的 socket
         */
         bool UnInit()
         {
-            for (auto& es : free_list_)
+            for (auto& slot : slots_)
             {
-                if (nullptr != es)
-                {
-                    delete es;
-                    es = nullptr;
-                }
-
+                delete slot.socket;
+                slot.socket = nullptr;
             }
-            free_list_.clear();
-            // FIX ME. udp socket pool 在这里会崩溃,先注释掉.让进程统一回收内存.
-            // for (auto& es : socket_vector_)
-            // {
-            //     if (nullptr != es)
-            //     {
-            //         delete es;
-            //         es = nullptr;
-            //     }
-            // }
-            socket_vector_.clear();
-            alloced_socketes_.clear();
+            slots_.clear();
+            free_slots_.clear();
+            active_sockets_.clear();
+            dirty_conn_ids_.clear();
+            visiting_conn_ids_.clear();
+            listener_count_ = 0;
             return true;
         }
         /*
         * 获取一个 socket
         * @param conn_id 连接ID
-        * @return socket
+        * @return socket,连接ID已失效时返回空
         */
-        SocketType* GetSocket(uint32_t conn_id)
+        SocketType* GetSocket(uint64_t conn_id)
         {
-            uint16_t index = GetLoWord(conn_id);
-            if (index < max_socket_count_)
+            uint64_t index = conn_id & CONN_ID_INDEX_MASK;
+            if (index < slots_.size() && slots_[index].conn_id == conn_id)
             {
-                return socket_vector_[index];
+                return slots_[index].socket;
             }
             return nullptr;
         }
@@ -103,27 +93,32 @@ namespace ToolBox
         */
         SocketType* Alloc()
         {
-            uint32_t conn_id = NewID();
-            if (INVALID_CONN_ID == conn_id)
+            uint32_t index = 0;
+            // 槽位用满前先用新槽位,尽量推迟复用
+            if (slots_.size() < max_socket_count_)
             {
-                return nullptr;
+                index = static_cast<uint32_t>(slots_.size());
+                slots_.emplace_back();
             }
-            SocketType* socket = nullptr;
-            if (!free_list_.empty())
+            else if (!free_slots_.empty())
             {
-                socket = free_list_.front();
-                free_list_.pop_front();
+                index = free_slots_.front();
+                free_slots_.pop_front();
             }
             else
             {
-                socket = new SocketType;
+                return nullptr;
             }
-            socket->SetConnID(conn_id);
-            uint16_t index = GetLoWord(conn_id);
-            socket_vector_[index] = socket;
-            alloced_socketes_.emplace_back(socket);
-
-            return socket;
+            Slot& slot = slots_[index];
+            if (nullptr == slot.socket)
+            {
+                slot.socket = new SocketType;
+            }
+            slot.conn_id = MakeConnID(slot.generation, index);
+            slot.active_pos = static_cast<uint32_t>(active_sockets_.size());
+            active_sockets_.emplace_back(slot.socket);
+            slot.socket->SetConnID(slot.conn_id);
+            return slot.socket;
         }
         /*
         * 归还用过的 socket
@@ -134,99 +129,147 @@ namespace ToolBox
             {
                 return;
             }
-            uint16_t index = GetLoWord(socket->GetConnID());
-            socket_vector_[index] = nullptr;
-            alloced_socketes_.remove(socket);
+            uint64_t conn_id = socket->GetConnID();
+            uint32_t index = static_cast<uint32_t>(conn_id & CONN_ID_INDEX_MASK);
+            if (index >= slots_.size() || slots_[index].conn_id != conn_id)
+            {
+                return;
+            }
+            Slot& slot = slots_[index];
+            // 与紧凑数组末尾交换后删除
+            SocketType* last = active_sockets_.back();
+            active_sockets_[slot.active_pos] = last;
+            slots_[last->GetConnID() & CONN_ID_INDEX_MASK].active_pos = slot.active_pos;
+            active_sockets_.pop_back();
 
-            free_slot_list_.emplace_back(index);
+            if (slot.listener)
+            {
+                slot.listener = false;
+                listener_count_--;
+            }
+            // 脏列表中残留的连接ID已失效,遍历时跳过
+            slot.dirty = false;
+            slot.conn_id = INVALID_CONN_ID;
+            slot.generation = (slot.generation + 1) & ((1u << CONN_ID_GENERATION_BITS) - 1);
+            free_slots_.emplace_back(index);
             socket->Reset();
-            free_list_.emplace_back(socket);
+        }
+        /*
+        * 已分配的 socket 数量
+        */
+        std::size_t Count() const
+        {
+            return active_sockets_.size();
+        }
+        /*
+        * 标记 socket 为监听器,释放时自动取消
+        */
+        void MarkListener(SocketType* socket)
+        {
+            uint64_t conn_id = socket->GetConnID();
+            uint32_t index = static_cast<uint32_t>(conn_id & CONN_ID_INDEX_MASK);
+            if (index >= slots_.size() || slots_[index].conn_id != conn_id || slots_[index].listener)
+            {
+                return;
+            }
+            slots_[index].listener = true;
+            listener_count_++;
+        }
+        /*
+        * 已分配的 socket 中除监听器以外的连接数量
+        */
+        std::size_t ConnectionCount() const
+        {
+            return active_sockets_.size() - listener_count_;
         }
         /*
         * 循环socket
+        * 从后往前遍历紧凑数组,回调中释放当前 socket 不会漏掉其他 socket;回调中新分配的 socket 不会被遍历到.
         */
         void Foreach(const std::function<bool(SocketType* socket)>& func)
         {
-            for (SocketType* p_socket : alloced_socketes_)
+            for (std::size_t pos = active_sockets_.size(); pos > 0; pos--)
             {
-                if (p_socket)
+                if (pos > active_sockets_.size())
+                {
+                    // 回调中一次释放了多个 socket
+                    pos = active_sockets_.size() + 1;
+                    continue;
+                }
+                if (!func(active_sockets_[pos - 1]))
                 {
-                    if (func(p_socket))
-                    {
-                        continue;
-                    }
-                    else
-                    {
-                        break;
-                    }
+                    break;
                 }
             }
         }
-    private:
         /*
-        * 生成新的 index
+        * 标记 socket 有待处理的数据,已在脏列表中时不重复加入
         */
-        uint16_t NewIndex()
+        void MarkDirty(SocketType* socket)
         {
-            if (active_slot_list_.empty())  // 剩余的下标用完了,交换
+            uint64_t conn_id = socket->GetConnID();
+            uint32_t index = static_cast<uint32_t>(conn_id & CONN_ID_INDEX_MASK);
+            if (index >= slots_.size() || slots_[index].conn_id != conn_id || slots_[index].dirty)
             {
-                active_slot_list_.swap(free_slot_list_);
-                curr_cycle_++;
-            }
-
-            if (active_slot_list_.empty())
-            {
-                return UINT16_MAX;
+                return;
             }
-            uint16_t index = active_slot_list_.front();
-            active_slot_list_.pop_front();
-            return index;
+            slots_[index].dirty = true;
+            dirty_conn_ids_.emplace_back(conn_id);
         }
         /*
-        * 生成新的 ID
+        * 取出并遍历脏列表,已释放的 socket 跳过.回调中可以重新标记,重新标记的 socket 留到下一次遍历
+        * @return 遍历到的 socket 数量
         */
-        uint32_t NewID()
+        std::size_t ForeachDirty(const std::function<void(SocketType* socket)>& func)
         {
-            uint16_t index = NewIndex();
-            if (index == UINT16_MAX)
+            visiting_conn_ids_.clear();
+            visiting_conn_ids_.swap(dirty_conn_ids_);
+            std::size_t count = 0;
+            for (uint64_t conn_id : visiting_conn_ids_)
             {
-                return INVALID_CONN_ID;
+                SocketType* socket = GetSocket(conn_id);
+                if (nullptr == socket)
+                {
+                    continue;
+                }
+                slots_[conn_id & CONN_ID_INDEX_MASK].dirty = false;
+                func(socket);
+                count++;
             }
-            return MakeUint32(curr_cycle_, index);
+            return count;
         }
+    private:
         /*
-        * 工具函数 获取低16位
-        * @param val 32位无符号数字
-        * @return 低16位无符号数字
+        * 工具函数,拼接复用代数、网络线程序号与槽位下标为连接ID
         */
-        uint16_t GetLoWord(uint32_t val)
+        uint64_t MakeConnID(uint32_t generation, uint32_t index)
         {
-            return (uint16_t)(val & 0xFFFF);
+            return uint64_t(generation) << (CONN_ID_INDEX_BITS + CONN_ID_THREAD_BITS)
+                   | uint64_t(thread_index_ & (MAX_NET_THREAD_COUNT - 1)) << CONN_ID_INDEX_BITS
+                   | index;
         }
+    private:
         /*
-        * 工具函数,拼接两个uint16_t为一个uint32_t
+        * 槽位
         */
-        uint32_t MakeUint32(uint16_t hi_word, uint16_t lo_word)
+        struct Slot
         {
-            return (((uint32_t)(hi_word & 0x00FF)) << 24 | (thread_index_ & 0x00FF) << 16 | lo_word);
-        }
-    private:
+            SocketType* socket = nullptr;           // 槽位上的 socket 对象,随槽位复用
+            uint64_t conn_id = INVALID_CONN_ID;     // 已分配时的连接ID,空闲时为 INVALID_CONN_ID
+            uint32_t active_pos = 0;                // 在 active_sockets_ 中的位置
+            uint32_t generation = 0;                // 复用代数
+            bool dirty = false;                     // 是否在脏列表中
+            bool listener = false;                  // 是否为监听器
+        };
         uint32_t max_socket_count_ = 0; // 池子最大数量
-        uint16_t curr_index_ = 0;       // 当前用到的索引值
-        uint16_t curr_cycle_ = 0;       // 当前用到的第几轮
-        uint32_t thread_index_ = 0;      // 多网络线程下的序号
-
-        using EpollSocketVector = std::vector<SocketType*>;
-        using EpollSocketList = std::deque<SocketType*>;
-        using SlotIndexList = std::deque<uint16_t>;
-        using AllocedList = std::list<SocketType*>;
-
-        EpollSocketVector socket_vector_;       // socket 管理容器
-        EpollSocketList free_list_;             // 回收的实体socket对象
-        SlotIndexList active_slot_list_;        // 可用的 socket 索引
-        SlotIndexList free_slot_list_;          // 回收的管理器索引
-        AllocedList alloced_socketes_;    // 存放已经分配对象的指针的序号[为了foreach函数]
+        uint32_t thread_index_ = 0;     // 多网络线程下的序号
+        std::size_t listener_count_ = 0;    // 已分配的监听器数量
 
+        std::vector<Slot> slots_;                   // 槽位,下标即连接ID的低位
+        std::deque<uint32_t> free_slots_;           // 回收的槽位下标,先进先出
+        std::vector<SocketType*> active_sockets_;   // 已分配的 socket,紧凑存放[为了foreach函数]
+        std::vector<uint64_t> dirty_conn_ids_;      // 有待处理数据的 socket 的连接ID
+        std::vector<uint64_t> visiting_conn_ids_;   // 正在遍历的脏列表,与 dirty_conn_ids_ 交换复用内存
     };
 
-};  // ToolBox
\ No newline at end of file
+};  // ToolBox
@@ -4,6 +4,7 @@
 #include "tools/time_util.h"
 #include <cstdint>
 #include <system_error>
+#include <vector>
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
 //#include <winsock2.h>
 #pragma comment(lib,"ws2_32.lib")
@@ -12,17 +13,14 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <sys/uio.h>
 #include <linux/tcp.h> // TCP_NODELAY
-
-#ifdef LINUX_IO_URING
-#include "liburing.h"
-#endif  //LINUX_IO_URING
-
 #elif defined(__APPLE__)
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <sys/uio.h>
 #include <netinet/tcp.h>
 #endif
 
@@ -30,10 +28,14 @@
 #include <errno.h>
 #include <fcntl.h>
 #include "network/net_imp/socket_pool.h"
+#if defined (LINUX_IO_URING)
+#include "network/net_imp/net_io_uring/io_uring_ctrl.h"
+#endif
 #include "network/net_imp/net_epoll/tcp_epoll_network.h"
 #include "network/net_imp/net_iocp/tcp_iocp_network.h"
 #include "network/net_imp/net_kqueue/tcp_kqueue_network.h"
 #include "imp_network.h"
+#include "network/net_buffer.h"
 #include "tools/string_util.h"
 
 namespace ToolBox
@@ -49,11 +51,36 @@ namespace ToolBox
 
     TcpSocket::~TcpSocket()
     {
+        // 收发缓冲区随成员析构归还分配器,零拷贝发送队列中的引用在这里释放
+        ReleaseSendBuffer();
     }
     bool TcpSocket::Init(int32_t send_buff_len, int32_t recv_buff_len)
     {
         send_buff_len_ = 0 == send_buff_len ? DEFAULT_CONN_BUFFER_SIZE : send_buff_len;
         recv_buff_len_ = 0 == recv_buff_len ? DEFAULT_CONN_BUFFER_SIZE : recv_buff_len;
+        // 缓冲区的内存块统一从网络线程的分配器获取,缩容时归还复用
+        send_ring_buffer_.SetAllocator(&p_network_->GetBufferSlab());
+        recv_ring_buffer_.SetAllocator(&p_network_->GetBufferSlab());
+        if (p_network_->IsAdaptiveBuffer())
+        {
+            // 从小块开始,读写时按需倍增
+            send_ring_buffer_.Resize(NETWORK_ADAPTIVE_BUFFER_MIN_SIZE);
+            recv_ring_buffer_.Resize(NETWORK_ADAPTIVE_BUFFER_MIN_SIZE);
+        }
+        else
+        {
+            if (send_ring_buffer_.GetBufferSize() < DEFAULT_RING_BUFF_SIZE)
+            {
+                send_ring_buffer_.Resize(DEFAULT_RING_BUFF_SIZE);
+            }
+            if (recv_ring_buffer_.GetBufferSize() < DEFAULT_RING_BUFF_SIZE)
+            {
+                recv_ring_buffer_.Resize(DEFAULT_RING_BUFF_SIZE);
+            }
+        }
+        send_peak_bytes_ = 0;
+        recv_peak_bytes_ = 0;
+        decoder_ = p_network_->CreateDecoder(GetOpaque());
         return true;
     }
     void TcpSocket::UnInit()
@@ -70,7 +97,14 @@ namespace ToolBox
         recv_buff_len_ = 0;
         recv_ring_buffer_.Clear();
         send_ring_buffer_.Clear();
+        ReleaseSendBuffer();
         last_recv_ts_ = 0;
+        last_send_ts_ = 0;
+        send_blocked_since_ = 0;
+        send_blocked_ms_ = 0;
+        adopt_accepted_ = false;
+        decoder_.reset();
+        sim_nagle_ = SimulateNagle();
 
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
         if (nullptr != per_socket_.accept_ex)
@@ -82,8 +116,6 @@ namespace ToolBox
         ResetPerSocket();
 #elif defined(__linux__)
 #if defined (LINUX_IO_URING)
-        delete uring_socket_.accept_ex;
-        uring_socket_.accept_ex = nullptr;
         ResetUringSocket();
 #endif
 #endif
@@ -113,7 +145,10 @@ namespace ToolBox
             if (INVALID_SOCKET == client_fd)
 #elif defined(__linux__) || defined(__APPLE__)
 #if defined (LINUX_IO_URING)
-            client_fd = uring_socket_.accept_ex->socket_fd;
+            client_fd = uring_socket_.accept_fd;
+            socklen_t addr_len = sizeof(SocketAddress);
+            memset(&addr, 0, addr_len);
+            getpeername(client_fd, (sockaddr*)&addr, &addr_len);
 #else
             socklen_t addr_len = sizeof(SocketAddress);
             memset(&addr, 0, addr_len);
@@ -126,8 +161,16 @@ namespace ToolBox
             {
                 break;
             }
-            // 通知主线程有新的客户端连接进来
-            p_network_->OnAccepting(GetOpaque(), client_fd, inet_ntoa(addr.sin_addr), addr.sin_port, send_buff_len_, recv_buff_len_);
+            if (adopt_accepted_)
+            {
+                // SO_REUSEPORT 模式下直接在本网络线程内接管新连接
+                p_network_->OnAdoptAccepted(GetOpaque(), client_fd, inet_ntoa(addr.sin_addr), addr.sin_port, send_buff_len_, recv_buff_len_);
+            }
+            else
+            {
+                // 通知主线程有新的客户端连接进来
+                p_network_->OnAccepting(GetOpaque(), client_fd, inet_ntoa(addr.sin_addr), addr.sin_port, send_buff_len_, recv_buff_len_);
+            }
 
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
             // 将监听socket重新加入iocp
@@ -135,8 +178,7 @@ namespace ToolBox
             break;
 #elif defined(__linux__)
 #if defined (LINUX_IO_URING)
-            // 将监听socket重新加入iocp
-            ReAddSocketToUring(SOCKET_EVENT_RECV);
+            // multishot accept 持续有效,不需要重新投递
             break;
 #endif
 #elif defined(__APPLE__)
@@ -168,6 +210,7 @@ namespace ToolBox
         SetLingerOff(socket_fd);
         SetNagleOff(socket_fd);
         SetTcpBuffSize(socket_fd);
+        SetBusyPoll(socket_fd);
         return true;
     }
 
@@ -189,7 +232,8 @@ namespace ToolBox
         ReAddSocketToIocp(SOCKET_EVENT_RECV);
 #elif defined(__linux__) || defined(__APPLE__)
 #if defined (LINUX_IO_URING)
-        recv_ring_buffer_.AdjustWritePos(uring_socket_.io_recv.len);
+        // 数据已在完成事件中拷入接收缓冲区, multishot recv 持续有效,不需要重新投递
+        sim_nagle_.flag_can_recv = false;
         // 处理数据
         if (ErrCode::ERR_SUCCESS != ProcessRecvData())
         {
@@ -197,15 +241,12 @@ namespace ToolBox
         }
 
         // 检查接收 buffer 是否超限
-        if (!CheckRecvRingBufferSize())
-        {
-            return;
-        }
-        ReAddSocketToUring(SOCKET_EVENT_RECV);
+        CheckRecvRingBufferSize();
 #else
         while (size_t size = recv_ring_buffer_.ContinuouslyWriteableSize())
         {
             int32_t bytes = SocketRecv(socket_id_, recv_ring_buffer_.GetWritePtr(), size);
+            p_network_->AddRecvSyscalls(1);
             if (bytes < 0)
             {
                 NetworkLogError("[network] tcp socket UpdateRecv. SocketRecv failed. errno:%d.", errno);
@@ -277,10 +318,18 @@ namespace ToolBox
 
     ErrCode TcpSocket::ProcessRecvData()
     {
+        if (nullptr != decoder_)
+        {
+            return ProcessRecvDataDecode();
+        }
+        if (p_network_->IsRecvBatch())
+        {
+            return ProcessRecvDataBatch();
+        }
         while (true)
         {
             auto data_size = recv_ring_buffer_.ReadableSize();
-            // 这里暂时采用 len|buff 的方式[len不包含len自身的长度]分割数据.可重构为传入解包方法
+            // 内置格式 len|buff [len不包含len自身的长度],自定义格式见 ProcessRecvDataDecode
             if (data_size < sizeof(uint32_t))
             {
                 // return ErrCode::ERR_INSUFFICIENT_LENGTH;
@@ -305,7 +354,7 @@ namespace ToolBox
                 break;
             }
             recv_ring_buffer_.AdjustReadPos(sizeof(uint32_t));
-            char* buff_block = MemPoolLockFreeMgr->GetMemory(len);
+            char* buff_block = GET_NET_MEMORY(len);
             uint32_t readed_len = recv_ring_buffer_.Read(buff_block, len);
             if (readed_len != len)
             {
@@ -320,6 +369,130 @@ namespace ToolBox
         return ErrCode::ERR_SUCCESS;
     }
 
+    ErrCode TcpSocket::ProcessRecvDataBatch()
+    {
+        // 先扫描长度头,统计缓冲区中完整消息的数量与总长度
+        auto data_size = recv_ring_buffer_.ReadableSize();
+        std::size_t offset = 0;
+        uint32_t frame_count = 0;
+        uint32_t total_size = 0;
+        bool invalid_packet = false;
+        while (data_size - offset >= sizeof(uint32_t))
+        {
+            uint32_t len = 0;
+            recv_ring_buffer_.CopyAt(offset, (char*)&len, sizeof(uint32_t));
+            if (len > static_cast<uint32_t>(recv_buff_len_))
+            {
+                NetworkLogError("[Network][TcpSocket] Packet size is invaliable. socket id:%d, conn_id:%llu, capa:%zu, len:%u, offset:%zu."
+                        , GetSocketID(), GetConnID(), recv_ring_buffer_.GetBufferSize(), len, offset);
+                invalid_packet = true;
+                break;
+            }
+            if (data_size - offset - sizeof(uint32_t) < len)
+            {
+                break;
+            }
+            offset += sizeof(uint32_t) + len;
+            total_size += len;
+            frame_count++;
+        }
+        if (frame_count > 0)
+        {
+            // 偏移表 + 首尾相接的消息放在一块内存中,整批只投递一个事件
+            std::size_t table_size = sizeof(uint32_t) * (frame_count + 1);
+            char* block = GET_NET_MEMORY(table_size + total_size);
+            uint32_t* offsets = reinterpret_cast<uint32_t*>(block);
+            char* frames = block + table_size;
+            uint32_t frame_offset = 0;
+            for (uint32_t index = 0; index < frame_count; index++)
+            {
+                uint32_t len = 0;
+                recv_ring_buffer_.Read((char*)&len, sizeof(uint32_t));
+                recv_ring_buffer_.Read(frames + frame_offset, len);
+                offsets[index] = frame_offset;
+                frame_offset += len;
+            }
+            offsets[frame_count] = frame_offset;
+            p_network_->OnReceivedBatch(GetOpaque(), GetConnID(), block, frame_count, total_size);
+        }
+        if (invalid_packet)
+        {
+            Close(ENetErrCode::NET_INVALID_PACKET_SIZE);
+            return ErrCode::ERR_INVALID_PACKET_SIZE;
+        }
+        return ErrCode::ERR_SUCCESS;
+    }
+
+    ErrCode TcpSocket::ProcessRecvDataDecode()
+    {
+        NetRecvView view;
+        char* segment_data[2] = { nullptr, nullptr };
+        recv_ring_buffer_.ReadableSegments(segment_data, view.size);
+        view.data[0] = segment_data[0];
+        view.data[1] = segment_data[1];
+        bool batch = p_network_->IsRecvBatch();
+        // 批量模式下先记录各消息内容在缓冲区中的位置,再整批拷贝
+        thread_local std::vector<std::pair<std::size_t, uint32_t>> frames;
+        frames.clear();
+        std::size_t offset = 0;
+        uint32_t total_size = 0;
+        bool invalid_packet = false;
+        while (offset < view.Size())
+        {
+            NetRecvView remain = view.Sub(offset);
+            NetDecodedFrame frame;
+            NetDecodeResult result = decoder_->Decode(remain, static_cast<uint32_t>(recv_buff_len_), frame);
+            if (NDR_NEED_MORE == result)
+            {
+                break;
+            }
+            if (NDR_ERROR == result || 0 == frame.frame_size || frame.frame_size > remain.Size()
+                    || uint64_t(frame.header_size) + frame.payload_size > frame.frame_size)
+            {
+                NetworkLogError("[Network][TcpSocket] Decode failed. socket id:%d, conn_id:%llu, result:%d, readable:%zu, header:%u, payload:%u, frame:%u."
+                        , GetSocketID(), GetConnID(), result, remain.Size(), frame.header_size, frame.payload_size, frame.frame_size);
+                invalid_packet = true;
+                break;
+            }
+            if (batch)
+            {
+                frames.emplace_back(offset + frame.header_size, frame.payload_size);
+                total_size += frame.payload_size;
+            }
+            else
+            {
+                char* buff_block = GET_NET_MEMORY(frame.payload_size);
+                remain.Copy(frame.header_size, buff_block, frame.payload_size);
+                p_network_->OnReceived(GetOpaque(), GetConnID(), buff_block, frame.payload_size);
+            }
+            offset += frame.frame_size;
+        }
+        if (!frames.empty())
+        {
+            uint32_t frame_count = static_cast<uint32_t>(frames.size());
+            std::size_t table_size = sizeof(uint32_t) * (frame_count + 1);
+            char* block = GET_NET_MEMORY(table_size + total_size);
+            uint32_t* offsets = reinterpret_cast<uint32_t*>(block);
+            char* payloads = block + table_size;
+            uint32_t payload_offset = 0;
+            for (uint32_t index = 0; index < frame_count; index++)
+            {
+                view.Copy(frames[index].first, payloads + payload_offset, frames[index].second);
+                offsets[index] = payload_offset;
+                payload_offset += frames[index].second;
+            }
+            offsets[frame_count] = payload_offset;
+            p_network_->OnReceivedBatch(GetOpaque(), GetConnID(), block, frame_count, total_size);
+        }
+        recv_ring_buffer_.AdjustReadPos(offset);
+        if (invalid_packet)
+        {
+            Close(ENetErrCode::NET_INVALID_PACKET_SIZE);
+            return ErrCode::ERR_INVALID_PACKET_SIZE;
+        }
+        return ErrCode::ERR_SUCCESS;
+    }
+
     void TcpSocket::UpdateConnect()
     {
         // 完成主动连接后增加可处理"接收"能力.
@@ -351,39 +524,83 @@ namespace ToolBox
     {
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
         send_ring_buffer_.AdjustReadPos(per_socket_.io_send.wsa_buf.len);
-#elif defined(__linux__) || defined(__APPLE__)
-#if defined (LINUX_IO_URING)
-        send_ring_buffer_.AdjustReadPos(uring_socket_.io_send.len);
-#endif
 #endif
-        size_t size = 0;
-        while ((size = send_ring_buffer_.ContinuouslyReadableSize()) != 0)
-        {
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
+        if (false == send_ring_buffer_.Empty())
+        {
             ReAddSocketToIocp(SOCKET_EVENT_SEND);
-            break;  // 做 io_uring 时觉得这里应该添加一个.
+        }
 #elif defined(__linux__) || defined(__APPLE__)
 #if defined (LINUX_IO_URING)
+        // 已完成的发送在完成事件中结算,这里只在没有发送请求时投递下一段
+        if (nullptr == uring_socket_.send_op
+                && (false == send_ring_buffer_.Empty() || false == send_buffer_queue_.empty()))
+        {
             ReAddSocketToUring(SOCKET_EVENT_SEND);
-            break;
+            // 每次刷新提交一个发送请求,与其他请求合并为一次 io_uring_enter
+            p_network_->AddSendSyscalls(nullptr != uring_socket_.send_op ? 1 : 0);
+        }
 #else
-            int32_t bytes = SocketSend(socket_id_, send_ring_buffer_.GetReadPtr(), size);
+        // ringbuffer 回绕后的两段数据与零拷贝发送队列聚合为一次 writev,一轮刷新通常只需一次系统调用
+        uint32_t syscalls = 0;
+        bool writeable = true;
+        while (writeable && (false == send_ring_buffer_.Empty() || false == send_buffer_queue_.empty()))
+        {
+            struct iovec iov[MAX_SEND_IOV_COUNT];
+            int32_t iov_count = 0;
+            std::size_t total = 0;
+            char* ring_data[2] = { nullptr, nullptr };
+            std::size_t ring_segment_size[2] = { 0, 0 };
+            std::size_t ring_segments = send_ring_buffer_.ReadableSegments(ring_data, ring_segment_size);
+            for (std::size_t i = 0; i < ring_segments; i++)
+            {
+                iov[iov_count].iov_base = ring_data[i];
+                iov[iov_count].iov_len = ring_segment_size[i];
+                total += ring_segment_size[i];
+                iov_count++;
+            }
+            std::size_t ring_size = total;
+            uint32_t offset = send_buffer_offset_;
+            for (auto iter = send_buffer_queue_.begin(); iter != send_buffer_queue_.end() && iov_count < MAX_SEND_IOV_COUNT; ++iter)
+            {
+                iov[iov_count].iov_base = (*iter)->Frame() + offset;
+                iov[iov_count].iov_len = (*iter)->FrameSize() - offset;
+                total += iov[iov_count].iov_len;
+                iov_count++;
+                offset = 0;
+            }
+            int32_t bytes = 1 == iov_count
+                            ? SocketSend(socket_id_, static_cast<const char*>(iov[0].iov_base), iov[0].iov_len)
+                            : SocketWritev(socket_id_, iov, iov_count);
+            syscalls++;
             if (bytes < 0)
             {
                 // 发送失败
+                p_network_->AddSendSyscalls(syscalls);
                 Close(ENetErrCode::NET_SEND_FAILED);
+                return;
             }
-            send_ring_buffer_.AdjustReadPos(bytes);
-            if (bytes < static_cast<int32_t>(size))
+            std::size_t ring_sended = static_cast<std::size_t>(bytes) < ring_size ? bytes : ring_size;
+            send_ring_buffer_.AdjustReadPos(ring_sended);
+            ConsumeSendBuffer(bytes - ring_sended);
+            if (bytes > 0)
+            {
+                last_send_ts_ = p_network_->GetNetTime();
+            }
+            if (static_cast<std::size_t>(bytes) < total)
             {
                 sim_nagle_.flag_can_sent = false;           //  模拟nagle 是否可发送置为 false
-                break;
+                writeable = false;
             }
+        }
+        if (syscalls > 0)
+        {
+            UpdateSendBlocked(!writeable);
+        }
+        p_network_->AddSendSyscalls(syscalls);
 #endif  // LINUX_IO_URING
-
 #endif
-        }
-        if (0 == send_ring_buffer_.ContinuouslyReadableSize())
+        if (send_ring_buffer_.Empty() && send_buffer_queue_.empty())
         {
             sim_nagle_.num_of_unsent_packets = 0;       //  模拟nagle 计数置为 0
         }
@@ -426,6 +643,82 @@ namespace ToolBox
         return send_bytes;
     }
 
+#if defined(__linux__) || defined(__APPLE__)
+    int32_t TcpSocket::SocketWritev(int32_t socket_fd, struct iovec* iov, int32_t iov_count)
+    {
+        // 使用 sendmsg 而不是 writev,以便携带 MSG_NOSIGNAL
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iov_count;
+        int32_t send_bytes = sendmsg(socket_fd, &msg, MSG_NOSIGNAL);
+        if (send_bytes < 0)
+        {
+            if ((0 == errno) || (EAGAIN == errno) || (EWOULDBLOCK == errno) || (EINTR == errno))
+            {
+                return 0;
+            }
+            return -1;
+        }
+        return send_bytes;
+    }
+#endif
+
+    void TcpSocket::PushSendBuffer(NetBuffer* buffer, uint32_t offset)
+    {
+        buffer->AddRef();
+        if (send_buffer_queue_.empty())
+        {
+            send_buffer_offset_ = offset;
+        }
+        send_buffer_queue_.push_back(buffer);
+        send_buffer_queue_bytes_ += buffer->FrameSize() - offset;
+    }
+
+    void TcpSocket::WriteSendRing(const char* data, std::size_t len)
+    {
+#if defined (LINUX_IO_URING)
+        if (nullptr != uring_socket_.send_op && uring_socket_.send_ring_len > 0)
+        {
+            // 扩容会使发送请求引用的内存失效,调用方已确认剩余空间足够
+            send_ring_buffer_.WriteNoEnlage(data, len);
+            return;
+        }
+#endif
+        send_ring_buffer_.Write(data, len);
+    }
+
+    void TcpSocket::ConsumeSendBuffer(size_t bytes)
+    {
+        while (bytes > 0 && !send_buffer_queue_.empty())
+        {
+            NetBuffer* buffer = send_buffer_queue_.front();
+            std::size_t left = buffer->FrameSize() - send_buffer_offset_;
+            if (bytes < left)
+            {
+                send_buffer_offset_ += bytes;
+                send_buffer_queue_bytes_ -= bytes;
+                return;
+            }
+            bytes -= left;
+            send_buffer_queue_bytes_ -= left;
+            send_buffer_offset_ = 0;
+            send_buffer_queue_.pop_front();
+            buffer->Release();
+        }
+    }
+
+    void TcpSocket::ReleaseSendBuffer()
+    {
+        for (auto* buffer : send_buffer_queue_)
+        {
+            buffer->Release();
+        }
+        send_buffer_queue_.clear();
+        send_buffer_offset_ = 0;
+        send_buffer_queue_bytes_ = 0;
+    }
+
     void TcpSocket::UpdateError()
     {
         if (SocketState::SOCK_STATE_ESTABLISHED == socket_state_)
@@ -448,27 +741,106 @@ namespace ToolBox
             Close(ENetErrCode::NET_RECV_BUFF_OVERFLOW);
             return false;
         }
+        recv_peak_bytes_ = (std::max)(recv_peak_bytes_, recv_ring_buffer_.ReadableSize());
         return true;
     }
 
     bool TcpSocket::CheckSendRingBufferSize()
     {
-        if (send_ring_buffer_.GetBufferSize() > static_cast<size_t>(send_buff_len_))
+        if (send_ring_buffer_.GetBufferSize() > static_cast<size_t>(send_buff_len_)
+                || send_buffer_queue_bytes_ > static_cast<size_t>(send_buff_len_))
         {
             Close(ENetErrCode::NET_SEND_BUFF_OVERFLOW);
             return false;
         }
+        send_peak_bytes_ = (std::max)(send_peak_bytes_, send_ring_buffer_.ReadableSize());
+#if defined (LINUX_IO_URING)
+        // 发送请求在网络循环末尾才提交,一批事件中积压超过一半上限时提前提交,避免超限
+        if (nullptr != uring_socket_.send_op
+                && send_ring_buffer_.ReadableSize() + send_buffer_queue_bytes_ > static_cast<size_t>(send_buff_len_) / 2)
+        {
+            RequestUringFlush();
+        }
+#endif
+        return true;
+    }
+
+    void TcpSocket::UpdateSendBlocked(bool blocked)
+    {
+        if (blocked)
+        {
+            if (0 == send_blocked_since_)
+            {
+                send_blocked_since_ = p_network_->GetNetTime();
+            }
+        }
+        else if (0 != send_blocked_since_)
+        {
+            send_blocked_ms_ += p_network_->GetNetTime() - send_blocked_since_;
+            send_blocked_since_ = 0;
+        }
+    }
+
+    bool TcpSocket::GetConnMetrics(NetConnMetrics& metrics)
+    {
+        if (SocketState::SOCK_STATE_ESTABLISHED != socket_state_)
+        {
+            return false;
+        }
+        metrics.conn_id = GetConnID();
+        metrics.send_buffered = send_ring_buffer_.ReadableSize() + send_buffer_queue_bytes_;
+        metrics.send_capacity = send_buff_len_;
+        metrics.recv_buffered = recv_ring_buffer_.ReadableSize();
+        metrics.recv_capacity = recv_buff_len_;
+        metrics.send_blocked_ms = send_blocked_ms_;
+        if (0 != send_blocked_since_)
+        {
+            metrics.send_blocked_ms += p_network_->GetNetTime() - send_blocked_since_;
+        }
+        metrics.last_recv_ms = last_recv_ts_;
+        metrics.last_send_ms = last_send_ts_;
         return true;
     }
 
+    void TcpSocket::ShrinkBuffers()
+    {
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__) || defined(LINUX_IO_URING)
+        // 异步 io 投递出去的请求持有缓冲区指针,不能在此重新分配
+        return;
+#else
+        if (SocketState::SOCK_STATE_ESTABLISHED != socket_state_)
+        {
+            return;
+        }
+        // 缩到峰值的 2 倍以内,空闲的连接回到最小块;仍在使用的部分原样保留
+        auto shrink = [](auto& ring_buffer, std::size_t& peak_bytes)
+        {
+            std::size_t target = (std::max)(static_cast<std::size_t>(NETWORK_ADAPTIVE_BUFFER_MIN_SIZE), peak_bytes * 2);
+            if (target < ring_buffer.GetBufferSize())
+            {
+                ring_buffer.Resize(target);
+            }
+            peak_bytes = ring_buffer.ReadableSize();
+        };
+        shrink(send_ring_buffer_, send_peak_bytes_);
+        shrink(recv_ring_buffer_, recv_peak_bytes_);
+#endif
+    }
+
 
     void TcpSocket::Close(ENetErrCode net_err, int32_t sys_err)
     {
         if (IsSocketValid())
         {
             NetworkLogDebug("[Network] socket id:%d, conn_id:%llu, Ready to be free.net_err:%d, sys_err:%d", GetSocketID(), GetConnID(), net_err, sys_err);
+#if defined (LINUX_IO_URING)
+            // 先取消 fd 上进行中的请求并移出注册文件表,再关闭 fd
+            p_network_->CloseListenInMultiplexing(GetSocketID());
+            BaseSocket::Close(net_err, sys_err);
+#else
             BaseSocket::Close(net_err, sys_err);
             p_network_->CloseListenInMultiplexing(GetSocketID());
+#endif
             // 通知主线程 socket 关闭
             p_network_->OnClosed(GetOpaque(), (uint64_t)GetConnID(), net_err, sys_err);
             socket_state_ = SocketState::SOCK_STATE_INVALIED;
@@ -476,16 +848,35 @@ namespace ToolBox
         }
     }
 
-    void TcpSocket::Update(std::time_t time_stamp)
+    bool TcpSocket::Update(std::time_t time_stamp)
     {
+        bool flushed = false;
         if (sim_nagle_.flag_can_sent)
         {
+            flushed = false == send_ring_buffer_.Empty() || false == send_buffer_queue_.empty();
             UpdateSend();
         }
         if (sim_nagle_.flag_can_recv)
         {
+            flushed = true;
             UpdateRecv();
         }
+        // 没有收发完的留到下一次定时刷新
+        MarkNagleDirty();
+        return flushed;
+    }
+
+    void TcpSocket::MarkNagleDirty()
+    {
+        if (nullptr == p_network_ || nullptr == p_sock_pool_ || p_network_->GetSimulateNagleTimeout() <= 0)
+        {
+            return;
+        }
+        if (sim_nagle_.flag_can_recv
+                || (sim_nagle_.flag_can_sent && (false == send_ring_buffer_.Empty() || false == send_buffer_queue_.empty())))
+        {
+            p_sock_pool_->MarkDirty(this);
+        }
     }
 
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
@@ -579,28 +970,44 @@ namespace ToolBox
     /*
     * 重置 PerSocket
     */
-    void TcpSocket:: ResetUringSocket()
-    {
-        ResetRecvAsyncSocket();
-        ResetSendAsyncSocket();
-    }
-    /*
-    * 重置接收 PerSocket
-    */
-    void TcpSocket::ResetRecvAsyncSocket()
+    void TcpSocket::ResetUringSocket()
     {
-        memset(&uring_socket_.io_recv, 0, sizeof(uring_socket_.io_recv));
-        uring_socket_.io_recv.buf = recv_ring_buffer_.GetWritePtr();
-        uring_socket_.io_recv.len = recv_ring_buffer_.ContinuouslyWriteableSize();
+        // 进行中的请求由 IOUringCtrl 持有,完成时按连接ID查不到本连接即丢弃
+        uring_socket_ = UringSockContext();
     }
     /*
-    * 重置发送 PerSocket
+    * 重置发送 PerSocket: 与 epoll 下的 writev 相同,ringbuffer 回绕的两段与零拷贝发送队列聚合为一个请求
     */
     void TcpSocket::ResetSendAsyncSocket()
     {
-        memset(&uring_socket_.io_send, 0, sizeof(uring_socket_.io_send));;
-        uring_socket_.io_send.buf = send_ring_buffer_.GetReadPtr();
-        uring_socket_.io_send.len = send_ring_buffer_.ContinuouslyReadableSize();
+        uint32_t iov_count = 0;
+        std::size_t total = 0;
+        char* ring_data[2] = { nullptr, nullptr };
+        std::size_t ring_segment_size[2] = { 0, 0 };
+        std::size_t ring_segments = send_ring_buffer_.ReadableSegments(ring_data, ring_segment_size);
+        for (std::size_t i = 0; i < ring_segments; i++)
+        {
+            uring_socket_.send_iov[iov_count].iov_base = ring_data[i];
+            uring_socket_.send_iov[iov_count].iov_len = ring_segment_size[i];
+            total += ring_segment_size[i];
+            iov_count++;
+        }
+        uring_socket_.send_ring_len = static_cast<uint32_t>(total);
+        uint32_t offset = send_buffer_offset_;
+        for (auto iter = send_buffer_queue_.begin(); iter != send_buffer_queue_.end() && iov_count < MAX_SEND_IOV_COUNT; ++iter)
+        {
+            uring_socket_.send_iov[iov_count].iov_base = (*iter)->Frame() + offset;
+            uring_socket_.send_iov[iov_count].iov_len = (*iter)->FrameSize() - offset;
+            total += uring_socket_.send_iov[iov_count].iov_len;
+            iov_count++;
+            offset = 0;
+        }
+        uring_socket_.send_iov_count = iov_count;
+        uring_socket_.send_len = static_cast<uint32_t>(total);
+        uring_socket_.send_buffer = (0 == ring_segments && 1 == iov_count) ? send_buffer_queue_.front() : nullptr;
+        uring_socket_.send_msg = {};
+        uring_socket_.send_msg.msg_iov = uring_socket_.send_iov;
+        uring_socket_.send_msg.msg_iovlen = iov_count;
     }
     bool TcpSocket::ReAddSocketToUring(SockEventType event_type)
     {
@@ -612,6 +1019,14 @@ namespace ToolBox
         // 将监听socket重新加入iocp
         return p_uring_network->GetBaseCtrl()->OperEvent(*this, EventOperType::EVENT_OPER_ADD, event_type);
     }
+    void TcpSocket::RequestUringFlush()
+    {
+        auto p_uring_network = dynamic_cast<ImpNetwork<TcpSocket>*>(p_network_);
+        if (nullptr != p_uring_network)
+        {
+            static_cast<IOUringCtrl*>(p_uring_network->GetBaseCtrl())->RequestFlush();
+        }
+    }
 #endif
 
 
@@ -626,6 +1041,39 @@ namespace ToolBox
             // socket 已经关闭
             return;
         }
+#if defined (LINUX_IO_URING)
+        if (SocketState::SOCK_STATE_ESTABLISHED == socket_state_)
+        {
+            // provided buffer 在事件处理完后即归还内核,先拷入接收缓冲区
+            if ((event_type & SOCKET_EVENT_RECV) && uring_socket_.recv_len > 0
+                    && uring_socket_.recv_len != recv_ring_buffer_.Write(uring_socket_.recv_data, uring_socket_.recv_len))
+            {
+                Close(ENetErrCode::NET_RECV_BUFF_OVERFLOW);
+                return;
+            }
+            // 结算已完成的发送
+            if (event_type & SOCKET_EVENT_SEND)
+            {
+                // 只发出了一部分说明内核发送缓冲区已满
+                std::size_t submitted = 0;
+                for (uint32_t i = 0; i < uring_socket_.send_iov_count; i++)
+                {
+                    submitted += uring_socket_.send_iov[i].iov_len;
+                }
+                if (uring_socket_.send_len > 0)
+                {
+                    last_send_ts_ = ts;
+                }
+                UpdateSendBlocked(uring_socket_.send_len < submitted);
+                std::size_t ring_sended = (std::min)(uring_socket_.send_len, uring_socket_.send_ring_len);
+                send_ring_buffer_.AdjustReadPos(ring_sended);
+                ConsumeSendBuffer(uring_socket_.send_len - ring_sended);
+                uring_socket_.send_ring_len = 0;
+                uring_socket_.send_buffer = nullptr;
+                uring_socket_.send_len = 0;
+            }
+        }
+#endif
 
         if (event_type & SOCKET_EVENT_ERR)
         {
@@ -643,6 +1091,7 @@ namespace ToolBox
                 if (p_network_->GetSimulateNagleTimeout() > 0)
                 {
                     sim_nagle_.flag_can_recv = true;
+                    MarkNagleDirty();
                 }
                 else
                 {
@@ -662,6 +1111,7 @@ namespace ToolBox
                 if (p_network_->GetSimulateNaglePacketsNum() > 0 || p_network_->GetSimulateNagleTimeout() > 0)
                 {
                     sim_nagle_.flag_can_sent = true;
+                    MarkNagleDirty();
                 }
                 else
                 {
@@ -672,7 +1122,7 @@ namespace ToolBox
         }
     }
 
-    bool TcpSocket::InitNewAccepter(uint64_t opaque, const std::string& ip, const uint16_t port, int32_t send_buff_size, int32_t recv_buff_size)
+    bool TcpSocket::InitNewAccepter(uint64_t opaque, const std::string& ip, const uint16_t port, int32_t send_buff_size, int32_t recv_buff_size, bool reuse_port)
     {
         if (SocketState::SOCK_STATE_LISTENING == socket_state_)
         {
@@ -711,11 +1161,18 @@ namespace ToolBox
         }
 #endif
         SetReuseAddrOn(socket_id_); // 复用端口
+        if (reuse_port)
+        {
+            if (0 != SetReusePortOn(socket_id_))
+            {
+                p_network_->OnErrored(opaque, 0, ENetErrCode::NET_LISTEN_FAILED, GetSysErrNo());
+                return false;
+            }
+            adopt_accepted_ = true;
+        }
         SetLingerOff(socket_id_);   // 立即关闭该连接
         SetDeferAccept(socket_id_); // 1s 之内没有数据发送，则直接关闭连接
-#if !defined(LINUX_IO_URING)
         SetNonBlocking(socket_id_); // 设置为非阻塞
-#endif
         // 绑定端口
         int32_t error = bind(socket_id_, (struct sockaddr*)&sa, sizeof(struct sockaddr));
         if (error < 0)
@@ -784,6 +1241,7 @@ namespace ToolBox
 #endif
         SetNonBlocking(socket_id_); // 设置为非阻塞
         SetNagleOff(socket_id_);    // 关闭 Nagle
+        SetBusyPoll(socket_id_);    // 低延迟模式下接收时忙轮询
         SetTcpBuffSize(socket_id_);
         int32_t error = connect(socket_id_, (struct sockaddr*)&sa, sizeof(struct sockaddr));
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
@@ -831,9 +1289,33 @@ namespace ToolBox
             debug_statistic_save_ = 0;
             debug_statistic_send_ = 0;
         }
+        bool to_queue = !send_buffer_queue_.empty();
+#if defined (LINUX_IO_URING)
+        // 发送请求引用着 ringbuffer 时不能扩容,剩余空间放不下才追加到队列尾部
+        to_queue = to_queue || (nullptr != uring_socket_.send_op && uring_socket_.send_ring_len > 0
+                                && send_ring_buffer_.WriteableSize() < len);
+#endif
+        if (to_queue)
+        {
+            // 零拷贝发送队列中还有数据,为保证顺序,拷贝一份追加到队列尾部
+            NetBuffer* buffer = NetBuffer::CreateFrame(data, len);
+            PushSendBuffer(buffer, 0);
+            buffer->Release();
+            if (!CheckSendRingBufferSize())
+            {
+                return;
+            }
+            if (p_network_->GetSimulateNaglePacketsNum() > 0
+                    && ++sim_nagle_.num_of_unsent_packets >= uint32_t(p_network_->GetSimulateNaglePacketsNum()))
+            {
+                UpdateSend();
+            }
+            MarkNagleDirty();
+            return;
+        }
         if (p_network_->GetSimulateNaglePacketsNum() > 0)
         {
-            send_ring_buffer_.Write(data, len);
+            WriteSendRing(data, len);
             sim_nagle_.num_of_unsent_packets++; // 模拟nagle 计数增加
             if (sim_nagle_.num_of_unsent_packets < uint32_t(p_network_->GetSimulateNaglePacketsNum()))
             {
@@ -842,6 +1324,7 @@ namespace ToolBox
                 {
                     return;
                 }
+                MarkNagleDirty();
                 return;
             }
             else
@@ -856,11 +1339,12 @@ namespace ToolBox
         {
             if (false == send_ring_buffer_.Empty())
             {
-                send_ring_buffer_.Write(data, len);
+                WriteSendRing(data, len);
                 if (!CheckSendRingBufferSize())
                 {
                     return;
                 }
+                MarkNagleDirty();
                 return;
             }
             int32_t sended = SocketSend(GetSocketID(), data, len);
@@ -870,13 +1354,22 @@ namespace ToolBox
                 Close(ENetErrCode::NET_SYS_ERROR, errno);
                 return;
             }
-            else if ((int32_t)len == sended)
+#if !defined(WIN32) && !defined(_WIN32) && !defined(__WIN32__) && !defined(__NT__) && !defined(LINUX_IO_URING)
+            // 异步IO模式下 SocketSend 不发起系统调用,由发送请求完成时统计
+            p_network_->AddSendSyscalls(1);
+            if (sended > 0)
+            {
+                last_send_ts_ = p_network_->GetNetTime();
+            }
+            UpdateSendBlocked((int32_t)len > sended);
+#endif
+            if ((int32_t)len == sended)
             {
                 return;
             }
             else if ((int32_t)len > sended)
             {
-                send_ring_buffer_.Write(data + sended, len - sended);
+                WriteSendRing(data + sended, len - sended);
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
                 ReAddSocketToIocp(SOCKET_EVENT_SEND);
 #elif defined(__linux__) || defined(__APPLE__)
@@ -888,6 +1381,83 @@ namespace ToolBox
         }
     }
 
+    void TcpSocket::SendBuffer(NetBuffer* buffer, bool by_reference)
+    {
+        if (nullptr == buffer)
+        {
+            return;
+        }
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
+        // 异步IO模式下发送数据必须驻留在 ringbuffer 中,退化为拷贝发送
+        (void)by_reference;
+        Send(buffer->Frame(), buffer->FrameSize());
+#elif defined(LINUX_IO_URING)
+        if (!by_reference && buffer->FrameSize() < ZERO_COPY_SEND_MIN_SIZE)
+        {
+            // 小包拷贝进 ringbuffer,可与其他小包合并发送;广播的缓冲区由各连接共享,按引用排队
+            Send(buffer->Frame(), buffer->FrameSize());
+            return;
+        }
+        // 大包排进发送队列,由发送请求持有引用直接从缓冲区发送
+        PushSendBuffer(buffer, 0);
+        if (!CheckSendRingBufferSize())
+        {
+            return;
+        }
+        if (p_network_->GetSimulateNaglePacketsNum() > 0
+                && ++sim_nagle_.num_of_unsent_packets < uint32_t(p_network_->GetSimulateNaglePacketsNum()))
+        {
+            MarkNagleDirty();
+            return;
+        }
+        UpdateSend();
+#else
+        if (!by_reference && buffer->FrameSize() < ZERO_COPY_SEND_MIN_SIZE)
+        {
+            // 小包拷贝进 ringbuffer,可与其他小包合并发送;广播的缓冲区由各连接共享,按引用排队
+            Send(buffer->Frame(), buffer->FrameSize());
+            return;
+        }
+        if (p_network_->GetSimulateNaglePacketsNum() > 0)
+        {
+            PushSendBuffer(buffer, 0);
+            if (!CheckSendRingBufferSize())
+            {
+                return;
+            }
+            sim_nagle_.num_of_unsent_packets++; // 模拟nagle 计数增加
+            if (sim_nagle_.num_of_unsent_packets >= uint32_t(p_network_->GetSimulateNaglePacketsNum()))
+            {
+                UpdateSend();
+            }
+            MarkNagleDirty();
+            return;
+        }
+        if (false == send_ring_buffer_.Empty() || false == send_buffer_queue_.empty())
+        {
+            // 前面还有未发送完的数据,排队等待可写事件
+            PushSendBuffer(buffer, 0);
+            if (CheckSendRingBufferSize())
+            {
+                MarkNagleDirty();
+            }
+            return;
+        }
+        int32_t sended = SocketSend(GetSocketID(), buffer->Frame(), buffer->FrameSize());
+        if (-1 == sended)
+        {
+            NetworkLogError("[Network][TcpSocket] SocketSend buffer failed. socket id:%d, conn_id:%llu, errno:%d, len:%u.", GetSocketID(), GetConnID(), errno, buffer->FrameSize());
+            Close(ENetErrCode::NET_SYS_ERROR, errno);
+            return;
+        }
+        else if (buffer->FrameSize() > static_cast<uint32_t>(sended))
+        {
+            // 未发完的部分不拷贝,直接持有缓冲区等待可写事件
+            PushSendBuffer(buffer, sended);
+        }
+#endif
+    }
+
     int32_t TcpSocket::SetNonBlocking(int32_t fd)
     {
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
@@ -937,6 +1507,16 @@ namespace ToolBox
         return setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (char*)&reuse_addr, sizeof(reuse_addr));
     }
 
+    int32_t TcpSocket::SetReusePortOn(int32_t fd)
+    {
+#if defined(SO_REUSEPORT)
+        int32_t reuse_port = 1;
+        return setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (char*)&reuse_port, sizeof(reuse_port));
+#else
+        return -1;
+#endif
+    }
+
     int32_t TcpSocket::SetDeferAccept(int32_t fd)
     {
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cstdint>
+#include <deque>
+#include <memory>
 #include <stdint.h>
 #include <time.h>
 #include "network/net_imp/base_socket.h"
@@ -8,12 +10,14 @@
 #include "socket_pool.h"
 #include "network/net_imp/net_imp_define.h"
 #include "network/network_def_internal.h"
+#include "network/net_decoder.h"
 
 namespace ToolBox
 {
 
     class TcpEpollNetwork;
     class TcpSocket;
+    class NetBuffer;
 
     using TCPSocketPool = SocketPool<TcpSocket>;
 
@@ -109,17 +113,17 @@ namespace ToolBox
         */
         inline void ResetUringSocket();
         /*
-        * 重置接收 AsyncSocket
-        */
-        void ResetRecvAsyncSocket() override;
-        /*
-        * 重置发送 AsyncSocket
+        * 重置发送 AsyncSocket,填入下一段待发送的数据
         */
         void ResetSendAsyncSocket() override;
         /*
         * 将 socket 重新监听读写事件
         */
         bool ReAddSocketToUring(SockEventType event_type);
+        /*
+        * 发送数据积压过多时请求网络线程尽快提交
+        */
+        void RequestUringFlush();
 #endif
         /*
         * 设置socket状态
@@ -147,7 +151,7 @@ namespace ToolBox
         * @param port 监听端口
         * @retval 初始化是否成功
         */
-        bool InitNewAccepter(uint64_t opaque, const std::string& ip, const uint16_t port, int32_t send_buff_size, int32_t recv_buff_size) override;
+        bool InitNewAccepter(uint64_t opaque, const std::string& ip, const uint16_t port, int32_t send_buff_size, int32_t recv_buff_size, bool reuse_port) override;
 
         /*
         *  初始化从accpet函数接收得来的socket
@@ -167,13 +171,27 @@ namespace ToolBox
         */
         void Send(const char* data, size_t len) override;
         /*
+        * 发送引用计数缓冲区[零拷贝],小包或 iocp 模式下退化为拷贝发送
+        * @param buffer 已成帧的缓冲区
+        * @param by_reference 为 true 时[广播]小包也按引用排队,各连接共享同一个缓冲区
+        */
+        void SendBuffer(NetBuffer* buffer, bool by_reference) override;
+        /*
         * 关闭套接字
         */
         void Close(ENetErrCode net_err, int32_t sys_err = 0) override;
         /*
-        * Update
+        * 模拟 Nagle 的定时刷新,发送积攒的数据、读取延后的数据
+        */
+        bool Update(std::time_t time_stamp) override;
+        /*
+        * 按上一个检查间隔内的使用峰值缩容收发缓冲区
+        */
+        void ShrinkBuffers() override;
+        /*
+        * 获取连接指标,监听器与未建立的连接不提供
         */
-        void Update(std::time_t time_stamp) override;
+        bool GetConnMetrics(NetConnMetrics& metrics) override;
 
 
     private:
@@ -186,6 +204,10 @@ namespace ToolBox
         */
         void UpdateRecv();
         /*
+        * 记录一次发送后是否仍有数据因内核发送缓冲区满而积压,累计积压时长
+        */
+        void UpdateSendBlocked(bool blocked);
+        /*
         * 套接字接收数据
         */
         int32_t SocketRecv(int32_t socket_fd, char* data, size_t size);
@@ -194,6 +216,14 @@ namespace ToolBox
         */
         ErrCode ProcessRecvData();
         /*
+        * 批量接收模式下处理接收到的数据: 本次读取中的所有完整消息合并为一个接收事件
+        */
+        ErrCode ProcessRecvDataBatch();
+        /*
+        * 使用自定义解码器处理接收到的数据,按批量接收开关逐条或整批投递
+        */
+        ErrCode ProcessRecvDataDecode();
+        /*
         * 处理主动链接
         */
         void UpdateConnect();
@@ -205,6 +235,30 @@ namespace ToolBox
         * 套接字发送数据
         */
         int32_t SocketSend(int32_t socket_fd, const char* data, size_t size);
+#if defined(__linux__) || defined(__APPLE__)
+        /*
+        * 套接字聚合发送数据
+        */
+        int32_t SocketWritev(int32_t socket_fd, struct iovec* iov, int32_t iov_count);
+#endif
+        /*
+        * 将缓冲区追加到零拷贝发送队列尾部
+        * @param buffer 缓冲区,队列持有一个引用
+        * @param offset 已经发送出去的字节数
+        */
+        void PushSendBuffer(NetBuffer* buffer, uint32_t offset);
+        /*
+        * 写入发送 ringbuffer. io_uring 下有发送请求引用着 ringbuffer 时不扩容
+        */
+        void WriteSendRing(const char* data, std::size_t len);
+        /*
+        * 从零拷贝发送队列头部消耗已发送的字节
+        */
+        void ConsumeSendBuffer(size_t bytes);
+        /*
+        * 释放零拷贝发送队列中所有的缓冲区
+        */
+        void ReleaseSendBuffer();
         /*
         * 处理错误事件
         */
@@ -218,6 +272,10 @@ namespace ToolBox
         */
         bool CheckSendRingBufferSize();
         /*
+        * 模拟 Nagle 定时刷新时,有积攒的数据或延后的读取则加入 socket 池的脏列表,等待下一次定时刷新
+        */
+        void MarkNagleDirty();
+        /*
         * 设置 非阻塞
         */
         int32_t SetNonBlocking(int32_t fd);
@@ -238,6 +296,10 @@ namespace ToolBox
         */
         int32_t SetReuseAddrOn(int32_t fd);
         /*
+        * 允许多个 socket 监听同一端口,由内核在它们之间分配新连接
+        */
+        int32_t SetReusePortOn(int32_t fd);
+        /*
         * 设置 TCP_DEFER_ACCEPT
         */
         int32_t SetDeferAccept(int32_t fd);
@@ -258,9 +320,18 @@ namespace ToolBox
 
         int32_t send_buff_len_ = 0;                     // 接收缓冲区大小
         int32_t recv_buff_len_ = 0;                     // 接收缓冲区大小
-        RingBuffer<char, DEFAULT_RING_BUFF_SIZE> send_ring_buffer_; // 发送缓冲区
-        RingBuffer<char, DEFAULT_RING_BUFF_SIZE> recv_ring_buffer_; // 接收缓冲区
+        RingBuffer<char, NETWORK_ADAPTIVE_BUFFER_MIN_SIZE> send_ring_buffer_; // 发送缓冲区,非自适应模式下初始化时扩到 DEFAULT_RING_BUFF_SIZE
+        RingBuffer<char, NETWORK_ADAPTIVE_BUFFER_MIN_SIZE> recv_ring_buffer_; // 接收缓冲区,非自适应模式下初始化时扩到 DEFAULT_RING_BUFF_SIZE
+        std::size_t send_peak_bytes_ = 0;               // 上次缩容检查以来发送缓冲区数据量的峰值
+        std::size_t recv_peak_bytes_ = 0;               // 上次缩容检查以来接收缓冲区数据量的峰值
+        std::unique_ptr<NetDecoder> decoder_;           // 自定义消息解码器,为空时使用内置的 uint32 长度头格式
+        std::deque<NetBuffer*> send_buffer_queue_;      // 零拷贝发送队列,排在发送缓冲区之后发送
+        uint32_t send_buffer_offset_ = 0;               // 零拷贝发送队列头部缓冲区已发送的字节数
+        std::size_t send_buffer_queue_bytes_ = 0;       // 零拷贝发送队列中尚未发送的字节数
         time_t last_recv_ts_ = 0;                       // 最后一次读到数据的时间戳
+        time_t last_send_ts_ = 0;                       // 最后一次发出数据的时间戳
+        time_t send_blocked_since_ = 0;                 // 本次因内核发送缓冲区满而积压的开始时间戳,0 为未积压
+        uint64_t send_blocked_ms_ = 0;                  // 已结束的积压累计毫秒数
 
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
         PerSockContext per_socket_;
@@ -271,6 +342,7 @@ namespace ToolBox
 #endif  // WIN32
 
         SocketState socket_state_ = SocketState::SOCK_STATE_INVALIED;  // socket 状态
+        bool adopt_accepted_ = false;           // 监听 socket 接受的连接是否直接在本网络线程内加入io多路复用[SO_REUSEPORT 模式]
         SimulateNagle sim_nagle_;             // 模拟 Nagle
         uint32_t debug_statistic_save_ = 0;   // 测试统计字段
         uint32_t debug_statistic_send_ = 0;   // 测试统计字段
@@ -46,6 +46,128 @@ namespace ToolBox
         return id_;
     }
 
+    void UdpBatchIO::SetBatchSize(uint32_t batch_size, uint32_t datagram_size)
+    {
+        if (datagram_size != config_datagram_size_)
+        {
+            // 配置变化时丢弃截断后加倍的大小
+            config_datagram_size_ = datagram_size;
+            datagram_size_ = datagram_size;
+        }
+        if (batch_size == batch_size_)
+        {
+            return;
+        }
+        batch_size_ = batch_size;
+        msgs_.resize(batch_size_);
+        iovs_.resize(batch_size_);
+        recv_address_.resize(batch_size_);
+    }
+
+    int32_t UdpBatchIO::Recv(int32_t socket_fd)
+    {
+        // 接收缓冲区在批量接收时按需(重新)申请,只在这里改变大小,上一批数据报在此之前已处理完
+        std::size_t data_size = std::size_t(batch_size_) * datagram_size_;
+        if (recv_data_.size() != data_size)
+        {
+            std::vector<char>(data_size).swap(recv_data_);
+        }
+        for (uint32_t i = 0; i < batch_size_; i++)
+        {
+            iovs_[i].iov_base = recv_data_.data() + std::size_t(i) * datagram_size_;
+            iovs_[i].iov_len = datagram_size_;
+            memset(&msgs_[i], 0, sizeof(mmsghdr));
+            msgs_[i].msg_hdr.msg_iov = &iovs_[i];
+            msgs_[i].msg_hdr.msg_iovlen = 1;
+            msgs_[i].msg_hdr.msg_name = &recv_address_[i];
+            msgs_[i].msg_hdr.msg_namelen = sizeof(SocketAddress);
+        }
+        int32_t count = recvmmsg(socket_fd, msgs_.data(), batch_size_, MSG_DONTWAIT, nullptr);
+        if (count < 0)
+        {
+            return (EWOULDBLOCK == errno || EAGAIN == errno || EINTR == errno) ? 0 : -1;
+        }
+        return count;
+    }
+
+    const char* UdpBatchIO::GetRecvData(int32_t index, std::size_t& size, SocketAddress& address)
+    {
+        size = msgs_[index].msg_len;
+        address = recv_address_[index];
+        if (msgs_[index].msg_hdr.msg_flags & MSG_TRUNC)
+        {
+            // 数据报比预留的大小长,已被截断.之后的批量接收预留加倍
+            datagram_size_ = std::min<uint32_t>(datagram_size_ * 2, UDP_MAX_DATAGRAM_SIZE);
+            return nullptr;
+        }
+        return static_cast<const char*>(iovs_[index].iov_base);
+    }
+
+    bool UdpBatchIO::QueueSend(int32_t socket_fd, const SocketAddress& address, uint64_t opaque, uint64_t address_id, uint64_t conn_id, const char* data, std::size_t size)
+    {
+        Datagram datagram;
+        datagram.socket_fd = socket_fd;
+        datagram.address = address;
+        datagram.opaque = opaque;
+        datagram.address_id = address_id;
+        datagram.conn_id = conn_id;
+        datagram.offset = send_data_.size();
+        datagram.size = size;
+        send_queue_.emplace_back(datagram);
+        send_data_.insert(send_data_.end(), data, data + size);
+        return send_queue_.size() >= batch_size_;
+    }
+
+    void UdpBatchIO::FlushSend(UdpEpollNetwork* network)
+    {
+        uint32_t syscalls = 0;
+        std::size_t index = 0;
+        while (index < send_queue_.size())
+        {
+            // 同一套接字的连续数据报合并为一次 sendmmsg
+            int32_t socket_fd = send_queue_[index].socket_fd;
+            uint32_t count = 0;
+            while (count < batch_size_ && index + count < send_queue_.size() && send_queue_[index + count].socket_fd == socket_fd)
+            {
+                auto& datagram = send_queue_[index + count];
+                iovs_[count].iov_base = send_data_.data() + datagram.offset;
+                iovs_[count].iov_len = datagram.size;
+                memset(&msgs_[count], 0, sizeof(mmsghdr));
+                msgs_[count].msg_hdr.msg_iov = &iovs_[count];
+                msgs_[count].msg_hdr.msg_iovlen = 1;
+                msgs_[count].msg_hdr.msg_name = &datagram.address;
+                msgs_[count].msg_hdr.msg_namelen = sizeof(SocketAddress);
+                count++;
+            }
+            int32_t sended = sendmmsg(socket_fd, msgs_.data(), count, MSG_DONTWAIT);
+            syscalls++;
+            if (sended > 0)
+            {
+                // 部分发送时,剩余的数据报在下一轮重试,若仍然出错会返回 -1
+                index += sended;
+                continue;
+            }
+            if (EWOULDBLOCK == errno || EAGAIN == errno || ENOBUFS == errno)
+            {
+                // 内核发送缓冲区已满,本批剩余的数据报交回各自的 socket 排队,之后重试
+                NetworkLogTrace("[Network][UdpBatchIO] sendmmsg would block, requeue %u datagrams. socket id:%d", count, socket_fd);
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    auto& datagram = send_queue_[index + i];
+                    network->RequeueSend(datagram.conn_id, send_data_.data() + datagram.offset, datagram.size);
+                }
+                index += count;
+                continue;
+            }
+            auto& datagram = send_queue_[index];
+            network->OnErrored(datagram.opaque, datagram.address_id, ENetErrCode::NET_SYS_ERROR, errno);
+            index++;
+        }
+        send_queue_.clear();
+        send_data_.clear();
+        network->AddSendSyscalls(syscalls);
+    }
+
     UdpSocket::Buffer::Buffer(const char* data, std::size_t size)
     {
         data_ = buffer_;
@@ -67,7 +189,7 @@ namespace ToolBox
         BaseSocket::Reset();
         for (const auto& buffer : send_list_)
         {
-            GiveBackObjectLockFree(buffer);
+            GIVE_BACK_OBJECT(buffer);
         }
 
         send_list_.clear();
@@ -79,6 +201,9 @@ namespace ToolBox
             ikcp_release(kcp_);
             kcp_ = nullptr;
         }
+        kcp_timer_ = INVALID_HTIMER;
+        kcp_dirty_ = false;
+        send_pending_ = false;
         p_network_ = nullptr;
         p_sock_pool_ = nullptr;
     }
@@ -101,9 +226,13 @@ namespace ToolBox
     }
 
 
-    bool UdpSocket::InitNewAccepter(uint64_t opaque, const std::string& ip, uint16_t port, int32_t send_buff_size, int32_t recv_buff_size)
+    bool UdpSocket::InitNewAccepter(uint64_t opaque, const std::string& ip, uint16_t port, int32_t send_buff_size, int32_t recv_buff_size, bool reuse_port)
     {
-        Bind(ip, port);
+        if (!Bind(ip, port, reuse_port))
+        {
+            return false;
+        }
+        SetBusyPoll(socket_id_);
         type_ = UdpType::ACCEPTOR;
         local_address_.SetAddress(ip, port);
         event_type_ = SOCKET_EVENT_RECV | SOCKET_EVENT_ERR;
@@ -112,9 +241,22 @@ namespace ToolBox
     }
     bool UdpSocket::InitNewConnecter(uint64_t opaque, const std::string& ip, uint16_t port, int32_t send_buff_size, int32_t recv_buff_size)
     {
-        Bind();
+        if (!Bind())
+        {
+            return false;
+        }
+        SetBusyPoll(socket_id_);
         type_ = UdpType::CONNECTOR;
         remote_address_.SetAddress(ip, port);
+        // 主动连接的会话以本地端口区分,同一进程可以向同一远端建立多个会话
+        SocketAddress local_address;
+        socklen_t address_len = sizeof(local_address);
+        if (getsockname(socket_id_, (struct sockaddr*)&local_address, &address_len) < 0)
+        {
+            p_network_->OnErrored(GetOpaque(), 0, ENetErrCode::NET_CONNECT_FAILED, errno);
+            return false;
+        }
+        local_address_.SetAddress(local_address);
         event_type_ = SOCKET_EVENT_RECV | SOCKET_EVENT_SEND | SOCKET_EVENT_ERR;
         return true;
     }
@@ -128,28 +270,58 @@ namespace ToolBox
         NetworkLogTrace("[Network][UdpSocket] Send udp data. socket id:%d, conn_id:%llu, len.%zu", GetSocketID(), GetConnID(), length);
         if (false == send_list_.empty())
         {
-            send_list_.emplace_back(GET_NET_OBJECT(Buffer, buffer, length));
+            // 已有发送阻塞的数据报,排在其后保持顺序
+            QueueUnsent(buffer, length);
             UpdateSend();
             return;
         }
-        auto send_length = length;
-        auto success = SocketSend(GetSocketID(), buffer, length);
-        if (success && length)
+        auto* p_udp_network = GetUdpNetwork_();
+        auto& batch_io = p_udp_network->GetBatchIO();
+        if (batch_io.GetBatchSize() > 1)
         {
-            if (length < send_length)
+            // 批量模式: 排队到本帧末尾统一 sendmmsg,攒满一批时立即发送
+            if (batch_io.QueueSend(GetSocketID(), remote_address_.GetAddress(), GetOpaque(), GetSessionID(), GetConnID(), buffer, length))
             {
-                send_list_.emplace_back(GET_NET_OBJECT(Buffer, buffer + length, send_length - length));
+                batch_io.FlushSend(p_udp_network);
             }
+            return;
         }
-        else
+        auto send_length = length;
+        auto success = SocketSend(GetSocketID(), buffer, length);
+        p_network_->AddSendSyscalls(1);
+        if (false == success)
         {
             Close(ENetErrCode::NET_SYS_ERROR, errno);
+            return;
         }
+        if (length < send_length)
+        {
+            // 发送阻塞[length 为 0]或只发出一部分,剩余的排队重试
+            QueueUnsent(buffer + length, send_length - length);
+        }
+    }
+
+    void UdpSocket::QueueUnsent(const char* buffer, std::size_t length)
+    {
+        send_list_.emplace_back(GET_NET_OBJECT(Buffer, buffer, length));
+        GetUdpNetwork_()->MarkSendPending(this);
+    }
+
+    bool UdpSocket::FlushUnsent()
+    {
+        UpdateSend();
+        return false == send_list_.empty();
+    }
+
+    UdpEpollNetwork* UdpSocket::GetUdpNetwork_()
+    {
+        return static_cast<UdpEpollNetwork*>(p_network_);
     }
 
     void UdpSocket::KcpSendTo(const char* buffer, std::size_t length)
     {
         ikcp_send(kcp_, buffer, length);
+        GetUdpNetwork_()->MarkKcpDirty(this);
     }
 
     UdpType UdpSocket::GetType()
@@ -161,23 +333,25 @@ namespace ToolBox
     {
         if (IsSocketValid())
         {
-            BaseSocket::Close(net_err, sys_err);
-            if (p_network_)
+            int32_t socket_fd = GetSocketID();
+            if (UdpType::REMOTE == type_)
             {
-                // 通知主线程 socket 关闭
-                if (UdpType::ACCEPTOR == type_)
-                {
-                    p_network_->OnClosed(GetOpaque(), GetLocalAddressID(), net_err, sys_err);
-                    p_network_->CloseListenInMultiplexing(GetSocketID());
-                }
-                else
+                // 被动接受的会话与监听器共用同一个 fd,不能关闭
+                socket_id_ = -1;
+            }
+            else
+            {
+                if (p_network_)
                 {
-                    if (UdpType::CONNECTOR == type_)
-                    {
-                        p_network_->CloseListenInMultiplexing(GetSocketID());
-                    }
-                    p_network_->OnClosed(GetOpaque(), GetRemoteAddressID(), net_err, sys_err);
+                    p_network_->CloseListenInMultiplexing(socket_fd);
                 }
+                BaseSocket::Close(net_err, sys_err);
+            }
+            if (p_network_)
+            {
+                // 通知主线程 socket 关闭
+                GetUdpNetwork_()->DeleteSession(GetSessionID());
+                p_network_->OnClosed(GetOpaque(), GetSessionID(), net_err, sys_err);
                 p_sock_pool_->Free(this);
             }
 
@@ -185,7 +359,7 @@ namespace ToolBox
     }
 
 
-    bool UdpSocket::Bind(const std::string& ip, uint16_t port)
+    bool UdpSocket::Bind(const std::string& ip, uint16_t port, bool reuse_port)
     {
         socket_id_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
         if (socket_id_ < 0)
@@ -193,6 +367,16 @@ namespace ToolBox
             p_network_->OnErrored(GetOpaque(), 0, ENetErrCode::NET_LISTEN_FAILED, errno);
             return false;
         }
+        if (reuse_port)
+        {
+            // 每个网络线程各自绑定同一端口,内核按四元组哈希把同一远端固定分给其中一个 socket
+            int32_t reuse = 1;
+            if (setsockopt(socket_id_, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) < 0)
+            {
+                p_network_->OnErrored(GetOpaque(), socket_id_, ENetErrCode::NET_LISTEN_FAILED, errno);
+                return false;
+            }
+        }
 
         SocketAddress sa;
         memset(&sa, 0, sizeof(sa));
@@ -240,7 +424,7 @@ namespace ToolBox
         // 设置 MTU
         ikcp_setmtu(kcp_, KCP_TRANSPORT_MTU);
         // 极速模式,官方推荐
-        ikcp_nodelay(kcp_, 1, 10, 2, 1);
+        ikcp_nodelay(kcp_, 1, KCP_UPDATE_INTERVAL, 2, 1);
         return;
     }
 
@@ -253,18 +437,27 @@ namespace ToolBox
         }
     }
 
-    void UdpSocket::KcpRecv(const char* buffer, std::size_t length, const UdpAddress&& address)
+    bool UdpSocket::IsKcpIdle() const
+    {
+        return nullptr == kcp_ || (0 == ikcp_waitsnd(kcp_) && 0 == kcp_->ackcount && 0 == kcp_->probe);
+    }
+
+    void UdpSocket::KcpRecv(const char* buffer, std::size_t length)
     {
-        // 将收到的数据输入到 kcp
+        // 将收到的数据输入到 kcp,需要尽快回复 ack
         ikcp_input(kcp_, buffer, length);
-        // 从 KCP 返回可靠包
-        char out_buffer[DEFAULT_CONN_BUFFER_SIZE];
-        auto bytes_size = ikcp_recv(kcp_, out_buffer, sizeof(out_buffer));
-        if (bytes_size > 0)
+        GetUdpNetwork_()->MarkKcpDirty(this);
+        // 从 KCP 取出所有已就绪的可靠包,一个数据报可能同时补齐多个包
+        int32_t bytes_size = 0;
+        while ((bytes_size = ikcp_peeksize(kcp_)) > 0)
         {
             char* buff_block = GET_NET_MEMORY(bytes_size);
-            memcpy(buff_block, out_buffer, bytes_size);
-            p_network_->OnReceived(GetOpaque(), UdpAddress(address).GetID(), buff_block, bytes_size);
+            if (ikcp_recv(kcp_, buff_block, bytes_size) <= 0)
+            {
+                GIVE_BACK_MEMORY(buff_block, "UdpSocket::KcpRecv");
+                break;
+            }
+            p_network_->OnReceived(GetOpaque(), GetSessionID(), buff_block, bytes_size);
         }
     }
 
@@ -275,37 +468,50 @@ namespace ToolBox
 
     void UdpSocket::UpdateRecv()
     {
-        SocketAddress address;
-        std::array<char, DEFAULT_CONN_BUFFER_SIZE> array;
-        auto size = array.size();
-        while (true)
+        auto& batch_io = GetUdpNetwork_()->GetBatchIO();
+        if (batch_io.GetBatchSize() > 1)
         {
-            auto success = SocketRecv(socket_id_, array.data(), size, address);
-            if (success && size)
+            // 批量模式: 一次 recvmmsg 读取多个数据报,读满一批说明可能还有数据,继续读
+            SocketAddress address;
+            std::size_t size = 0;
+            while (true)
             {
-                auto* p_udp_epoll_network = dynamic_cast<UdpEpollNetwork*>(p_network_);
-                auto* udp_socket = p_udp_epoll_network->GetSocketByUdpAddress(address);
-                if (nullptr == udp_socket)
+                int32_t count = batch_io.Recv(socket_id_);
+                p_network_->AddRecvSyscalls(1);
+                if (count < 0)
                 {
-                    udp_socket = UpdateAccept(address);
-                }
-                if (nullptr == kcp_)    // 原始 udp 模式
-                {
-                    char* buff_block = GET_NET_MEMORY(size);
-                    memcpy(buff_block, array.data(), size);
-                    NetworkLogTrace("[Network][UdpSocket] Receive udp data. socket id:%d, conn_id:%llu, len.%zu", GetSocketID(), GetConnID(), size);
-                    p_network_->OnReceived(GetOpaque(), UdpAddress(address).GetID(), buff_block, size);
+                    p_network_->OnErrored(GetOpaque(), GetLocalAddressID(), ENetErrCode::NET_SYS_ERROR, errno);
+                    break;
                 }
-                else                    // 开启了kcp
+                for (int32_t i = 0; i < count; i++)
                 {
-                    if (nullptr != udp_socket)
+                    const char* data = batch_io.GetRecvData(i, size, address);
+                    if (nullptr == data)
                     {
-                        NetworkLogTrace("[Network][UdpSocket] Receive kcp data. socket id:%d, conn_id:%llu, len.%zu", GetSocketID(), GetConnID(), size);
-                        udp_socket->KcpRecv(array.data(), size, UdpAddress(address));
+                        NetworkLogError("[Network][UdpSocket] Udp datagram truncated, dropped. socket id:%d, size:%zu", socket_id_, size);
+                        p_network_->OnErrored(GetOpaque(), GetLocalAddressID(), ENetErrCode::NET_RECV_BUFF_OVERFLOW, EMSGSIZE);
+                        continue;
                     }
-
+                    OnDatagram(data, size, address);
+                }
+                if (count < static_cast<int32_t>(batch_io.GetBatchSize()))
+                {
+                    break;
                 }
             }
+            return;
+        }
+        SocketAddress address;
+        std::array<char, DEFAULT_CONN_BUFFER_SIZE> array;
+        while (true)
+        {
+            auto size = array.size();
+            auto success = SocketRecv(socket_id_, array.data(), size, address);
+            p_network_->AddRecvSyscalls(1);
+            if (success && size)
+            {
+                OnDatagram(array.data(), size, address);
+            }
             else
             {
                 break;
@@ -313,13 +519,45 @@ namespace ToolBox
         }
     }
 
+    void UdpSocket::OnDatagram(const char* data, std::size_t size, const SocketAddress& address)
+    {
+        // 主动连接的 socket 只与一个远端通信,数据报就属于自身;监听器按来源地址找到会话,没有则建立新会话
+        UdpSocket* udp_socket = this;
+        if (UdpType::ACCEPTOR == type_)
+        {
+            udp_socket = GetUdpNetwork_()->GetSocketByUdpAddress(address);
+            if (nullptr == udp_socket)
+            {
+                udp_socket = UpdateAccept(address);
+            }
+        }
+        if (nullptr == udp_socket)
+        {
+            return;
+        }
+        if (nullptr == kcp_)    // 原始 udp 模式
+        {
+            char* buff_block = GET_NET_MEMORY(size);
+            memcpy(buff_block, data, size);
+            NetworkLogTrace("[Network][UdpSocket] Receive udp data. socket id:%d, conn_id:%llu, len.%zu", GetSocketID(), GetConnID(), size);
+            p_network_->OnReceived(GetOpaque(), udp_socket->GetSessionID(), buff_block, size);
+        }
+        else                    // 开启了kcp
+        {
+            NetworkLogTrace("[Network][UdpSocket] Receive kcp data. socket id:%d, conn_id:%llu, len.%zu", GetSocketID(), GetConnID(), size);
+            udp_socket->KcpRecv(data, size);
+        }
+    }
+
     void UdpSocket::UpdateSend()
     {
+        uint32_t syscalls = 0;
         for (auto iter = send_list_.begin(); iter != send_list_.end();)
         {
             auto buffer = *iter;
             size_t size = buffer->size_;
             auto success = SocketSend(socket_id_, buffer->data_, size);
+            syscalls++;
             if (success && size)
             {
                 if (size == buffer->size_)
@@ -339,6 +577,7 @@ namespace ToolBox
                 break;
             }
         }
+        p_network_->AddSendSyscalls(syscalls);
     }
 
     UdpSocket* UdpSocket::UpdateAccept(const SocketAddress& address)
@@ -350,21 +589,22 @@ namespace ToolBox
             return nullptr;
         }
         InitAccpetSocket(new_socket, address);
-        auto* p_udp_epoll_network = dynamic_cast<UdpEpollNetwork*>(p_network_);
+        auto* p_udp_epoll_network = GetUdpNetwork_();
         if (p_udp_epoll_network->IsKcpModeOpen())
         {
             new_socket->OpenKcpMode();
         }
         NetworkLogDebug("[Network][UdpEpollNetwork] on new client.address_ip:%s, address_port:%u remote_address_id:%llu, conn_id:%llu", inet_ntoa(address.sin_addr), address.sin_port, new_socket->GetRemoteAddressID(), new_socket->GetConnID());
         // 通知主线程有新的客户端连接进来
-        p_udp_epoll_network->OnAccepted(GetOpaque(), new_socket->GetRemoteAddressID());
-        p_udp_epoll_network->AddUdpAddress(address, new_socket->GetConnID());
+        p_udp_epoll_network->AddSession(new_socket->GetSessionID(), new_socket->GetConnID());
+        p_udp_epoll_network->OnAccepted(GetOpaque(), new_socket->GetSessionID());
         return new_socket;
     }
 
     void UdpSocket::InitAccpetSocket(UdpSocket* socket, const SocketAddress& address)
     {
         socket->SetSocketID(socket_id_);
+        socket->SetOpaque(GetOpaque());
         socket->SetRemoteAddress(UdpAddress(address));
         socket->SetSocketMgr(p_sock_pool_);
         socket->SetNetwork(p_network_);
@@ -372,6 +612,16 @@ namespace ToolBox
         socket->SetType(UdpType::REMOTE);
     }
 
+    void UdpSocket::CloseWithoutNotify()
+    {
+        if (UdpType::REMOTE == type_)
+        {
+            socket_id_ = -1;
+            return;
+        }
+        BaseSocket::Close(ENetErrCode::NET_SUCCESS, 0);
+    }
+
     bool UdpSocket::SocketRecv(int32_t socket_fd, char* data, size_t& size,  SocketAddress& address)
     {
         socklen_t fromlen = sizeof(address);
@@ -406,7 +656,7 @@ namespace ToolBox
             }
             else
             {
-                p_network_->OnErrored(GetOpaque(), GetRemoteAddressID(), ENetErrCode::NET_SYS_ERROR, errno);
+                p_network_->OnErrored(GetOpaque(), GetSessionID(), ENetErrCode::NET_SYS_ERROR, errno);
                 return false;
             }
         }
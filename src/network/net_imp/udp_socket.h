@@ -4,11 +4,13 @@
 
 #include <list>
 #include <string>
+#include <vector>
 #include "network/net_imp/base_socket.h"
 #include "net_imp_define.h"
 #include "network/net_imp/socket_pool.h"
 //#include "udp_epoll_network.h"
 #include "kcp/ikcp.h"
+#include "tools/timer.h"
 
 namespace ToolBox
 {
@@ -72,6 +74,82 @@ namespace ToolBox
         SocketAddress address_;     // 地址
     };
 
+    class UdpEpollNetwork;
+    /*
+    * UDP 批量收发[每个网络线程一份]:
+    * 可读时用 recvmmsg 一次读取多个数据报;发送的数据报先排队,到网络线程每帧末尾(或攒满一批)时用 sendmmsg 一次发出.
+    * 内核发送缓冲区已满时,未发出的数据报交回各自的 socket 排队,之后每帧重试,与逐个发送时的行为一致.
+    */
+    class UdpBatchIO
+    {
+    public:
+        /*
+        * @brief 设置单次批量处理的数据报数量和每个数据报预留的接收大小,接收缓冲区在下一次 Recv 时按新的大小申请
+        * @param batch_size 数据报数量
+        * @param datagram_size 每个数据报预留的接收大小
+        */
+        void SetBatchSize(uint32_t batch_size, uint32_t datagram_size);
+        /*
+        * @brief 单次批量处理的数据报数量
+        */
+        uint32_t GetBatchSize() const
+        {
+            return batch_size_;
+        }
+        /*
+        * @brief 一次读取多个数据报
+        * @param socket_fd 套接字
+        * @return 读到的数据报数量,0:暂无数据,-1:出错(errno)
+        */
+        int32_t Recv(int32_t socket_fd);
+        /*
+        * @brief 获取最近一次 Recv 读到的第 index 个数据报
+        * @param index 序号
+        * @param size 数据报长度
+        * @param address 数据报来源地址
+        * @return 数据指针,数据报被截断时返回 nullptr,之后的 Recv 预留加倍
+        */
+        const char* GetRecvData(int32_t index, std::size_t& size, SocketAddress& address);
+        /*
+        * @brief 数据报排队等待批量发送
+        * @param socket_fd 套接字
+        * @param address 目标地址
+        * @param opaque 信道标记,发送出错时上报
+        * @param address_id 目标地址ID,发送出错时上报
+        * @param conn_id 发送数据报的 socket 的连接ID,发送阻塞时交回该 socket 排队
+        * @param data 数据指针
+        * @param size 数据长度
+        * @return 队列是否攒满一批
+        */
+        bool QueueSend(int32_t socket_fd, const SocketAddress& address, uint64_t opaque, uint64_t address_id, uint64_t conn_id, const char* data, std::size_t size);
+        /*
+        * @brief 用 sendmmsg 发送排队的数据报,连续的同一套接字的数据报合并为一次系统调用
+        * @param network 所属网络,用于上报错误与统计,以及交回发送阻塞的数据报
+        */
+        void FlushSend(UdpEpollNetwork* network);
+    private:
+        // 排队待发送的数据报
+        struct Datagram
+        {
+            int32_t socket_fd = -1;     // 套接字
+            SocketAddress address;      // 目标地址
+            uint64_t opaque = 0;        // 信道标记
+            uint64_t address_id = 0;    // 目标地址ID
+            uint64_t conn_id = INVALID_CONN_ID; // 发送数据报的 socket 的连接ID
+            std::size_t offset = 0;     // 在 send_data_ 中的偏移
+            std::size_t size = 0;       // 长度
+        };
+        uint32_t batch_size_ = 0;                   // 单次批量处理的数据报数量
+        uint32_t config_datagram_size_ = 0;         // 配置的每个数据报预留的接收大小
+        uint32_t datagram_size_ = 0;                // 当前每个数据报预留的接收大小,截断后加倍
+        std::vector<mmsghdr> msgs_;                 // recvmmsg/sendmmsg 的消息头
+        std::vector<iovec> iovs_;                   // 消息头对应的内存段
+        std::vector<SocketAddress> recv_address_;   // 接收到的数据报来源地址
+        std::vector<char> recv_data_;               // 一批数据报共用的接收缓冲区,每个数据报预留 datagram_size_
+        std::vector<Datagram> send_queue_;          // 待发送的数据报
+        std::vector<char> send_data_;               // 待发送的数据报内容
+    };
+
     /*
     * 定义一个UDP连接
     */
@@ -102,7 +180,7 @@ namespace ToolBox
         * @param ip 地址
         * @param port 端口
         */
-        bool InitNewAccepter(uint64_t opaque, const std::string& ip, uint16_t port, int32_t send_buff_size, int32_t recv_buff_size) override;
+        bool InitNewAccepter(uint64_t opaque, const std::string& ip, uint16_t port, int32_t send_buff_size, int32_t recv_buff_size, bool reuse_port) override;
 
         /*
         *  初始化从accpet函数接收得来的socket
@@ -150,6 +228,10 @@ namespace ToolBox
         */
         void Close(ENetErrCode net_err, int32_t sys_err = 0) override;
         /*
+        * @brief 网络线程退出后释放文件描述符,被动接受的会话与监听器共用 fd,只由监听器关闭
+        */
+        void CloseWithoutNotify() override;
+        /*
         * @brief 设置远端地址
         */
         void SetRemoteAddress(const UdpAddress&& remote_address)
@@ -184,6 +266,13 @@ namespace ToolBox
         {
             return local_address_.GetID();
         }
+        /*
+        * @brief 获取会话ID,即逻辑线程看到的连接ID: 被动接受的会话为远端地址ID,监听器与主动连接的会话为本地地址ID
+        */
+        uint64_t GetSessionID()
+        {
+            return UdpType::REMOTE == type_ ? remote_address_.GetID() : local_address_.GetID();
+        }
     public:
         /*
         * @brief 开启Kcp模式
@@ -208,21 +297,78 @@ namespace ToolBox
         */
         void KcpUpdate(std::time_t current);
         /*
+        * @brief kcp 会话是否空闲: 没有待发送/待确认的数据,也没有待回复的 ack 与窗口探测.空闲的会话无需定时驱动
+        */
+        bool IsKcpIdle() const;
+        /*
+        * @brief 设置驱动本会话的定时器句柄
+        */
+        void SetKcpTimer(HTIMER timer)
+        {
+            kcp_timer_ = timer;
+        }
+        /*
+        * @brief 获取驱动本会话的定时器句柄
+        */
+        HTIMER GetKcpTimer() const
+        {
+            return kcp_timer_;
+        }
+        /*
+        * @brief 设置本会话是否已在待更新列表中
+        */
+        void SetKcpDirty(bool dirty)
+        {
+            kcp_dirty_ = dirty;
+        }
+        /*
+        * @brief 本会话是否已在待更新列表中
+        */
+        bool IsKcpDirty() const
+        {
+            return kcp_dirty_;
+        }
+        /*
+        * @brief 发送阻塞的数据报排队,由网络线程每帧重试直到发完
+        * @param buffer 数据指针
+        * @param length 数据长度
+        */
+        void QueueUnsent(const char* buffer, std::size_t length);
+        /*
+        * @brief 重试发送排队的数据报
+        * @return 是否仍有数据报未发出
+        */
+        bool FlushUnsent();
+        /*
+        * @brief 设置本 socket 是否已在待重发列表中
+        */
+        void SetSendPending(bool pending)
+        {
+            send_pending_ = pending;
+        }
+        /*
+        * @brief 本 socket 是否已在待重发列表中
+        */
+        bool IsSendPending() const
+        {
+            return send_pending_;
+        }
+        /*
         * @brief KCP 接收数据
         * @param buffer 数据指针
         * @param length 数据长度
-        * @param address 数据来源地址
         */
-        void KcpRecv(const char* buffer, std::size_t length, const UdpAddress&& address);
+        void KcpRecv(const char* buffer, std::size_t length);
 
     private:
         /*
         * @brief 绑定ip地址和端口.[用于监听]
         * @param ip 地址
         * @param port 端口
+        * @param reuse_port 是否开启 SO_REUSEPORT,多个网络线程各自监听同一端口
         * @return 是否成功
         */
-        bool Bind(const std::string& ip, uint16_t port);
+        bool Bind(const std::string& ip, uint16_t port, bool reuse_port);
         /*
         * @brief 绑定到本地任意地址和端口.[用于主动连接]
         * @return 是否成功
@@ -237,10 +383,21 @@ namespace ToolBox
         */
         void UpdateRecv();
         /*
+        * @brief 处理收到的一个数据报
+        * @param data 数据指针
+        * @param size 数据长度
+        * @param address 数据报来源地址
+        */
+        void OnDatagram(const char* data, std::size_t size, const SocketAddress& address);
+        /*
         * @brief 处理发送消息
         */
         void UpdateSend();
         /*
+        * @brief 所属的网络,UDP 只运行在 epoll 网络上
+        */
+        UdpEpollNetwork* GetUdpNetwork_();
+        /*
         * @brief 处理接受客户端连接的情况
         * @param address 远端地址
         * @return UdpSocket* 新socket,如果失败则为nullptr
@@ -274,6 +431,9 @@ namespace ToolBox
         UdpAddress local_address_;  // 本地地址
         UdpType type_ = UdpType::UNKNOWN;               // 管道类型
         ikcpcb* kcp_ = nullptr;     // kcp实例
+        HTIMER kcp_timer_ = INVALID_HTIMER;             // 驱动本会话的定时器
+        bool kcp_dirty_ = false;    // 是否已在待更新列表中
+        bool send_pending_ = false; // 是否已在待重发列表中
         UdpSocketPool* p_sock_pool_ = nullptr;          // socket 池子
     };
 
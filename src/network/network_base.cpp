@@ -1,5 +1,8 @@
 #include "network_base.h"
 #include "network_def_internal.h"
+#include "network/net_buffer.h"
+#include "network/net_imp/net_imp_define.h"
+#include <algorithm>
 #include <functional>
 #include "event.h"
 
@@ -13,8 +16,13 @@ namespace ToolBox
         event_dispatcher_->RegistereventHandler(EID_MainToWorkerJoinIOMultiplexing, std::bind(&INetwork::OnMainToWorkerJoinIOMultiplexing_, this, std::placeholders::_1));
         event_dispatcher_->RegistereventHandler(EID_MainToWorkerNewConnecter, std::bind(&INetwork::OnMainToWorkerNewConnecter_, this, std::placeholders::_1));
         event_dispatcher_->RegistereventHandler(EID_MainToWorkerSend, std::bind(&INetwork::OnMainToWorkerSend_, this, std::placeholders::_1));
+        event_dispatcher_->RegistereventHandler(EID_MainToWorkerSendBuffer, std::bind(&INetwork::OnMainToWorkerSendBuffer_, this, std::placeholders::_1));
+        event_dispatcher_->RegistereventHandler(EID_MainToWorkerBroadcast, std::bind(&INetwork::OnMainToWorkerBroadcast_, this, std::placeholders::_1));
         event_dispatcher_->RegistereventHandler(EID_MainToWorkerClose, std::bind(&INetwork::OnMainToWorkerClose_, this, std::placeholders::_1));
         event_dispatcher_->RegistereventHandler(EID_MainToWorkerSetSimulateNagle, std::bind(&INetwork::SetSimulateNagle_, this, std::placeholders::_1));
+        event_dispatcher_->RegistereventHandler(EID_MainToWorkerSetUdpBatchSize, std::bind(&INetwork::SetUdpBatchSize_, this, std::placeholders::_1));
+        event_dispatcher_->RegistereventHandler(EID_MainToWorkerSetAdaptiveBuffer, std::bind(&INetwork::SetAdaptiveBuffer_, this, std::placeholders::_1));
+        event_dispatcher_->RegistereventHandler(EID_MainToWorkerSetRecvBatch, std::bind(&INetwork::SetRecvBatch_, this, std::placeholders::_1));
 
     }
 
@@ -50,6 +58,23 @@ namespace ToolBox
         update_timestamp_ = time_stamp;
         // 处理主线程发来的事件
         HandleEvents_();
+        if (conn_metrics_requested_.load(std::memory_order_relaxed) && conn_metrics_requested_.exchange(false))
+        {
+            std::vector<NetConnMetrics> metrics;
+            CollectConnMetrics(metrics);
+            for (auto& conn_metrics : metrics)
+            {
+                conn_metrics.net_thread_index = net_thread_index_;
+            }
+            std::lock_guard<std::mutex> lock(conn_metrics_mutex_);
+            conn_metrics_.swap(metrics);
+        }
+    }
+
+    void INetwork::CopyConnMetrics(std::vector<NetConnMetrics>& metrics)
+    {
+        std::lock_guard<std::mutex> lock(conn_metrics_mutex_);
+        metrics.insert(metrics.end(), conn_metrics_.begin(), conn_metrics_.end());
     }
 
     void INetwork::PushEvent(NetEventWorker* event)
@@ -57,10 +82,19 @@ namespace ToolBox
         if (event2worker_.Full())
         {
             NetworkLogError("[Network] Event queue is full. Drop event. network_type_:%u", GetNetworkType());
+            event2worker_dropped_++;
             GIVE_BACK_OBJECT(event);
             return;
         }
         event2worker_.Push(std::move(event));
+        // 网络线程可能阻塞在 io 多路复用上,唤醒它
+        master_->WakeUpWorker(net_thread_index_);
+    }
+
+    int32_t INetwork::GetWaitTimeout()
+    {
+        // 模拟 Nagle 时需要按超时时间刷新发送缓冲区
+        return nagle_timeout_ > 0 ? nagle_timeout_ : -1;
     }
 
     void INetwork::OnAccepting(uint64_t opaque, int32_t fd, const std::string& ip, const uint16_t port, int32_t send_buff_size, int32_t recv_buff_size)
@@ -72,21 +106,30 @@ namespace ToolBox
         accept_event->net_evt_.accepting_.port_ = port;
         accept_event->net_evt_.accepting_.send_buff_size_ = send_buff_size;
         accept_event->net_evt_.accepting_.recv_buff_size_ = recv_buff_size;
-        master_->NotifyMain(accept_event);
+        NotifyMain_(accept_event);
+    }
+    void INetwork::OnAdoptAccepted(uint64_t opaque, int32_t fd, const std::string& ip, const uint16_t port, int32_t send_buff_size, int32_t recv_buff_size)
+    {
+        // 加入成功后由实现层通过 OnAccepted 通知主线程
+        if (INVALID_CONN_ID == OnJoinIOMultiplexing(opaque, fd, ip, port, send_buff_size, recv_buff_size))
+        {
+            NetworkLogError("[Network] adopt accepted fd failed. fd:%d, network_type:%d", fd, network_type_);
+        }
     }
+
     void INetwork::OnAccepted(uint64_t opaque, uint64_t connect_id)
     {
         auto* accept_event = GET_NET_OBJECT(NetEventMain, EID_WorkerToMainAccepted, opaque);
         accept_event->network_type_ = network_type_;
         accept_event->net_evt_.accept_.connect_id_ = connect_id;
-        master_->NotifyMain(accept_event);
+        NotifyMain_(accept_event);
     }
     void INetwork::OnConnected(uint64_t opaque, uint64_t connect_id)
     {
         auto* connected_event = GET_NET_OBJECT(NetEventMain, EID_WorkerToMainConnected, opaque);
         connected_event->network_type_ = network_type_;
         connected_event->net_evt_.connect_sucessed_.connect_id_ = connect_id;
-        master_->NotifyMain(connected_event);
+        NotifyMain_(connected_event);
     }
 
     void INetwork::OnConnectedFailed(uint64_t opaque, ENetErrCode err_code, int32_t err_no)
@@ -95,7 +138,7 @@ namespace ToolBox
         connected_failed_event->network_type_ = network_type_;
         connected_failed_event->net_evt_.connect_failed_.net_err_code = err_code;
         connected_failed_event->net_evt_.connect_failed_.sys_err_code = err_no;
-        master_->NotifyMain(connected_failed_event);
+        NotifyMain_(connected_failed_event);
     }
 
     void INetwork::OnErrored(uint64_t opaque, uint64_t connect_id, ENetErrCode err_code, int32_t err_no)
@@ -105,7 +148,7 @@ namespace ToolBox
         errored_event->net_evt_.error_.connect_id_ = connect_id;
         errored_event->net_evt_.error_.net_err_code = err_code;
         errored_event->net_evt_.error_.sys_err_code = err_no;
-        master_->NotifyMain(errored_event);
+        NotifyMain_(errored_event);
     }
 
     void INetwork::OnClosed(uint64_t opaque, uint64_t connect_id, ENetErrCode err_code, int32_t err_no)
@@ -123,7 +166,7 @@ namespace ToolBox
         close_event->net_evt_.close_.connect_id_ = connect_id;
         close_event->net_evt_.close_.net_err_ = err_code;
         close_event->net_evt_.close_.sys_err_ = err_no;
-        master_->NotifyMain(close_event);
+        NotifyMain_(close_event);
     }
 
     void INetwork::OnReceived(uint64_t opaque, uint64_t connect_id, const char* data, uint32_t size)
@@ -133,7 +176,28 @@ namespace ToolBox
         receive_event->net_evt_.recv_.connect_id_ = connect_id;
         receive_event->net_evt_.recv_.data_ = data;
         receive_event->net_evt_.recv_.size_ = size;
-        master_->NotifyMain(receive_event);
+        receive_event->net_evt_.recv_.frame_count_ = 0;
+        recv_bytes_.store(recv_bytes_.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+        recv_packets_.store(recv_packets_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        NotifyMain_(receive_event);
+    }
+
+    void INetwork::OnReceivedBatch(uint64_t opaque, uint64_t connect_id, const char* block, uint32_t frame_count, uint32_t size)
+    {
+        auto* receive_event = GET_NET_OBJECT(NetEventMain, EID_WorkerToMainRecv, opaque);
+        receive_event->network_type_ = network_type_;
+        receive_event->net_evt_.recv_.connect_id_ = connect_id;
+        receive_event->net_evt_.recv_.data_ = block;
+        receive_event->net_evt_.recv_.size_ = size;
+        receive_event->net_evt_.recv_.frame_count_ = frame_count;
+        recv_bytes_.store(recv_bytes_.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+        recv_packets_.store(recv_packets_.load(std::memory_order_relaxed) + frame_count, std::memory_order_relaxed);
+        NotifyMain_(receive_event);
+    }
+
+    void INetwork::NotifyMain_(NetEventMain* event)
+    {
+        master_->NotifyMain(event, net_thread_index_);
     }
 
     int32_t INetwork::GetSimulateNaglePacketsNum()
@@ -144,6 +208,28 @@ namespace ToolBox
     {
         return nagle_timeout_;
     }
+    uint32_t INetwork::GetUdpBatchSize()
+    {
+        return udp_batch_size_;
+    }
+
+    uint32_t INetwork::GetUdpDatagramSize()
+    {
+        return udp_datagram_size_;
+    }
+    bool INetwork::IsAdaptiveBuffer()
+    {
+        return adaptive_buffer_;
+    }
+    bool INetwork::IsRecvBatch()
+    {
+        return recv_batch_;
+    }
+
+    std::unique_ptr<NetDecoder> INetwork::CreateDecoder(uint64_t opaque)
+    {
+        return master_->CreateDecoder(opaque);
+    }
 
     void INetwork::OnMainToWorkerNewAccepter_(Event* event)
     {
@@ -153,13 +239,14 @@ namespace ToolBox
             NetworkLogError("[Network] event is null.");
             return;
         }
-        auto conn_id = OnNewAccepter(accepter_event->GetOpaque(), accepter_event->GetIP(), accepter_event->GetPort(), accepter_event->GetSendBuffSize(), accepter_event->GetRecvBuffSize());
+        auto conn_id = OnNewAccepter(accepter_event->GetOpaque(), accepter_event->GetIP(), accepter_event->GetPort(), accepter_event->GetSendBuffSize(), accepter_event->GetRecvBuffSize(), accepter_event->IsReusePort());
         auto bind_tcp = GET_NET_OBJECT(NetEventMain, EID_WorkerToMainBinded, accepter_event->GetOpaque());
         bind_tcp->network_type_ = network_type_;
         bind_tcp->net_evt_.bind_.connect_id_ = conn_id;
         bind_tcp->SetBindIP(accepter_event->GetIP());
         bind_tcp->net_evt_.bind_.port_ = accepter_event->GetPort();
-        master_->NotifyMain(bind_tcp);
+        bind_tcp->net_evt_.bind_.reuse_port_ = accepter_event->IsReusePort();
+        NotifyMain_(bind_tcp);
     }
 
     void INetwork::OnMainToWorkerJoinIOMultiplexing_(Event* event)
@@ -172,6 +259,7 @@ namespace ToolBox
         }
         NetworkLogTrace("[Network] OnMainToWorkerJoinIOMultiplexing_,opaque:%d,  fd:%d", accepting_event->GetOpaque(), accepting_event->GetFd());
         OnJoinIOMultiplexing(accepting_event->GetOpaque(), accepting_event->GetFd(), accepting_event->GetIP(), accepting_event->GetPort(), accepting_event->GetSendBuffSize(), accepting_event->GetRecvBuffSize());
+        OnPlacementHandled_();
     }
 
     void INetwork::OnMainToWorkerNewConnecter_(Event* event)
@@ -183,6 +271,15 @@ namespace ToolBox
             return;
         }
         OnNewConnecter(connecter_tcp->GetOpaque(), connecter_tcp->GetIP(), connecter_tcp->GetPort(), connecter_tcp->GetSendBuffSize(), connecter_tcp->GetRecvBuffSize());
+        OnPlacementHandled_();
+    }
+
+    void INetwork::OnPlacementHandled_()
+    {
+        // 先于 Update 发布实际的连接数,再发布已处理的分配数,逻辑线程据此计算尚未处理的分配.
+        // 连接数只取自 socket 池,建立失败或已关闭的连接不会被多算
+        SetLiveConnections(CountConnections());
+        placements_handled_.store(placements_handled_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
     }
 
     void INetwork::OnMainToWorkerClose_(Event* event)
@@ -204,9 +301,45 @@ namespace ToolBox
             NetworkLogError("[Network] event is null.");
             return;
         }
+        AddSendBytes(send->GetDataSize());
         OnSend(send->GetConnectID(), send->GetData(), send->GetDataSize());
     }
 
+    void INetwork::OnMainToWorkerSendBuffer_(Event* event)
+    {
+        auto send = dynamic_cast<NetEventWorker*>(event);
+        if (nullptr == send || nullptr == send->GetBuffer())
+        {
+            NetworkLogError("[Network] event is null.");
+            return;
+        }
+        // 事件析构时释放事件持有的引用,实现层需要延后发送时自行 AddRef
+        AddSendBytes(send->GetBuffer()->FrameSize());
+        OnSendBuffer(send->GetConnectID(), send->GetBuffer(), false);
+    }
+
+    void INetwork::OnMainToWorkerBroadcast_(Event* event)
+    {
+        auto broadcast = dynamic_cast<NetEventWorker*>(event);
+        if (nullptr == broadcast || nullptr == broadcast->GetBuffer())
+        {
+            NetworkLogError("[Network] event is null.");
+            return;
+        }
+        // 所有目标连接共享同一个缓冲区,无论大小都按引用排队,需要延后发送的连接各自 AddRef
+        const uint64_t* conn_ids = broadcast->GetBroadcastConnIDs();
+        AddSendBytes(uint64_t(broadcast->GetBuffer()->FrameSize()) * broadcast->GetBroadcastConnCount(), broadcast->GetBroadcastConnCount());
+        for (uint32_t index = 0; index < broadcast->GetBroadcastConnCount(); index++)
+        {
+            OnSendBuffer(conn_ids[index], broadcast->GetBuffer(), true);
+        }
+    }
+
+    void INetwork::OnSendBuffer(uint64_t connect_id, NetBuffer* buffer, bool /*by_reference*/)
+    {
+        OnSend(connect_id, buffer->Frame(), buffer->FrameSize());
+    }
+
     void INetwork::SetSimulateNagle_(Event* event)
     {
         auto set_nagle_event = dynamic_cast<NetEventWorker*>(event);
@@ -221,9 +354,53 @@ namespace ToolBox
         NetworkLogDebug("[Network] Set nagle_packets_num_:%d, set nagle_timeout_:%d.", nagle_packets_num_, nagle_timeout_);
     }
 
+    void INetwork::SetUdpBatchSize_(Event* event)
+    {
+        auto set_batch_event = dynamic_cast<NetEventWorker*>(event);
+        if (nullptr == set_batch_event)
+        {
+            NetworkLogError("[Network] event is null.");
+            return;
+        }
+        auto [batch_size, datagram_size] = set_batch_event->GetFeatureParam();
+        udp_batch_size_ = std::clamp<int32_t>(batch_size, 1, NETWORK_UDP_BATCH_MAX);
+        udp_datagram_size_ = std::clamp<int32_t>(datagram_size, 1, UDP_MAX_DATAGRAM_SIZE);
+        NetworkLogDebug("[Network] Set udp_batch_size_:%u, udp_datagram_size_:%u.", udp_batch_size_, udp_datagram_size_);
+    }
+
+    void INetwork::SetAdaptiveBuffer_(Event* event)
+    {
+        auto set_adaptive_event = dynamic_cast<NetEventWorker*>(event);
+        if (nullptr == set_adaptive_event)
+        {
+            NetworkLogError("[Network] event is null.");
+            return;
+        }
+        adaptive_buffer_ = 0 != std::get<0>(set_adaptive_event->GetFeatureParam());
+        NetworkLogDebug("[Network] Set adaptive_buffer_:%d.", adaptive_buffer_);
+    }
+
+    void INetwork::SetRecvBatch_(Event* event)
+    {
+        auto set_batch_event = dynamic_cast<NetEventWorker*>(event);
+        if (nullptr == set_batch_event)
+        {
+            NetworkLogError("[Network] event is null.");
+            return;
+        }
+        recv_batch_ = 0 != std::get<0>(set_batch_event->GetFeatureParam());
+        NetworkLogDebug("[Network] Set recv_batch_:%d.", recv_batch_);
+    }
+
     void INetwork::HandleEvents_()
     {
-        while (!event2worker_.Empty())
+        HandleEvents_(SIZE_MAX);
+    }
+
+    std::size_t INetwork::HandleEvents_(std::size_t max_count)
+    {
+        std::size_t count = 0;
+        while (count < max_count && !event2worker_.Empty())
         {
             NetEventWorker* event = event2worker_.Pop();
             if (nullptr != event)
@@ -235,7 +412,9 @@ namespace ToolBox
             {
                 OnErrored(0, 0, ENetErrCode::NET_INVALID_EVENT, 0);
             }
+            count++;
         }
+        return count;
     }
 
     uint32_t INetwork::GetThreadIndex()
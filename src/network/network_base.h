@@ -4,9 +4,12 @@
 #include "tools/memory_pool_lock_free.h"
 #include "network_channel.h"
 #include "network_def_internal.h"
+#include <atomic>
 #include <cstdint>
 #include <functional>
+#include <mutex>
 #include <stdint.h>
+#include <vector>
 
 namespace ToolBox
 {
@@ -14,9 +17,11 @@ namespace ToolBox
     class NetworkChannel;
     class EventDispatcher;
     class NetEventWorker;
+    class NetEventMain;
     class Event;
+    class NetBuffer;
     /// 事件队列
-    using Event2Worker = RingBufferSPSC<NetEventWorker*, NETWORK_EVENT_QUEUE_MAX_COUNT>;
+    using Event2Worker = RingBufferSPSCCached<NetEventWorker*, NETWORK_EVENT_QUEUE_MAX_COUNT>;
     /// 事件处理函数
     using EventHandler = std::function<void(Event* event)>;
     /*
@@ -54,6 +59,194 @@ namespace ToolBox
         * 加入事件
         */
         void PushEvent(NetEventWorker* event);
+        /*
+        * @brief 交由网络线程统一阻塞等待,返回可等待的句柄,不支持时返回 -1
+        */
+        virtual int32_t AttachWaiter()
+        {
+            return -1;
+        }
+        /*
+        * @brief 网络线程最长可阻塞等待的毫秒数,-1 表示可以无限等待直到有 io 或事件到来
+        */
+        virtual int32_t GetWaitTimeout();
+        /*
+        * @brief 设置新连接的 SO_BUSY_POLL 微秒数,0 为不设置.在网络对网络线程可见之前设置
+        */
+        void SetBusyPoll(uint32_t busy_poll_usecs)
+        {
+            busy_poll_usecs_ = busy_poll_usecs;
+        }
+        /*
+        * 存活连接数[网络线程发布,任意线程读取]
+        */
+        uint32_t GetLiveConnections() const
+        {
+            return live_connections_.load(std::memory_order_relaxed);
+        }
+        /*
+        * 累计接收字节数[网络线程发布,任意线程读取]
+        */
+        uint64_t GetRecvBytes() const
+        {
+            return recv_bytes_.load(std::memory_order_relaxed);
+        }
+        /*
+        * 累计发送字节数[网络线程发布,任意线程读取]
+        */
+        uint64_t GetSendBytes() const
+        {
+            return send_bytes_.load(std::memory_order_relaxed);
+        }
+        /*
+        * 累计投递给逻辑线程的消息数[网络线程发布,任意线程读取]
+        */
+        uint64_t GetRecvPackets() const
+        {
+            return recv_packets_.load(std::memory_order_relaxed);
+        }
+        /*
+        * 累计逻辑线程请求发送的消息数[网络线程发布,任意线程读取]
+        */
+        uint64_t GetSendPackets() const
+        {
+            return send_packets_.load(std::memory_order_relaxed);
+        }
+        /*
+        * 累计接收系统调用次数[网络线程发布,任意线程读取]
+        */
+        uint64_t GetRecvSyscalls() const
+        {
+            return recv_syscalls_.load(std::memory_order_relaxed);
+        }
+        /*
+        * io 多路复用返回了 io 事件的次数[网络线程发布,任意线程读取]
+        */
+        virtual uint64_t GetIoWakeups() const
+        {
+            return 0;
+        }
+        /*
+        * io 多路复用累计处理的 io 事件数[网络线程发布,任意线程读取]
+        */
+        virtual uint64_t GetIoEvents() const
+        {
+            return 0;
+        }
+        /*
+        * 累计有数据可发的发送刷新次数[网络线程发布,任意线程读取]
+        */
+        uint64_t GetSendFlushes() const
+        {
+            return send_flushes_.load(std::memory_order_relaxed);
+        }
+        /*
+        * 累计发送系统调用次数[网络线程发布,任意线程读取],与 GetSendFlushes 之比即每次刷新的系统调用数
+        */
+        uint64_t GetSendSyscalls() const
+        {
+            return send_syscalls_.load(std::memory_order_relaxed);
+        }
+        /*
+        * 累计 ikcp_update 调用次数[网络线程发布,任意线程读取]
+        */
+        uint64_t GetKcpUpdates() const
+        {
+            return kcp_updates_.load(std::memory_order_relaxed);
+        }
+        /*
+        * 模拟 Nagle 定时刷新累计遍历的 socket 数[网络线程发布,任意线程读取]
+        */
+        uint64_t GetNagleScanned() const
+        {
+            return nagle_scanned_.load(std::memory_order_relaxed);
+        }
+        /*
+        * 模拟 Nagle 定时刷新累计有数据收发的 socket 数[网络线程发布,任意线程读取]
+        */
+        uint64_t GetNagleFlushed() const
+        {
+            return nagle_flushed_.load(std::memory_order_relaxed);
+        }
+        /*
+        * 连接收发缓冲区占用的字节数[网络线程发布,任意线程读取]
+        */
+        uint64_t GetBufferBytes() const
+        {
+            return buffer_bytes_.load(std::memory_order_relaxed);
+        }
+        /*
+        * 缩容归还后缓存待复用的缓冲区字节数[网络线程发布,任意线程读取]
+        */
+        uint64_t GetBufferCachedBytes() const
+        {
+            return buffer_cached_bytes_.load(std::memory_order_relaxed);
+        }
+        /*
+        * 连接收发缓冲区的分配器,只在网络线程内使用
+        */
+        RingBufferSlab& GetBufferSlab()
+        {
+            return buffer_slab_;
+        }
+        /*
+        * 记录一次发送刷新消耗的系统调用数,由 socket 在网络线程内调用.无数据可发的刷新不计入
+        */
+        void AddSendSyscalls(uint32_t syscalls)
+        {
+            if (0 == syscalls)
+            {
+                return;
+            }
+            send_flushes_.store(send_flushes_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            send_syscalls_.store(send_syscalls_.load(std::memory_order_relaxed) + syscalls, std::memory_order_relaxed);
+        }
+        /*
+        * 时间函数,统一更新,减少系统调用
+        */
+        std::time_t GetNetTime() const
+        {
+            return update_timestamp_;
+        }
+        /*
+        * 累加接收系统调用次数,由 socket 在网络线程内调用
+        */
+        void AddRecvSyscalls(uint32_t syscalls)
+        {
+            recv_syscalls_.store(recv_syscalls_.load(std::memory_order_relaxed) + syscalls, std::memory_order_relaxed);
+        }
+        /*
+        * 请求网络线程在下一次循环发布连接指标,在逻辑线程调用
+        */
+        void RequestConnMetrics()
+        {
+            conn_metrics_requested_.store(true, std::memory_order_relaxed);
+        }
+        /*
+        * 追加网络线程上一次发布的连接指标,在逻辑线程调用
+        */
+        void CopyConnMetrics(std::vector<NetConnMetrics>& metrics);
+        /*
+        * 已处理的新连接分配事件数[建立连接器/加入io多路复用,无论成功与否]
+        */
+        uint64_t GetPlacementsHandled() const
+        {
+            return placements_handled_.load(std::memory_order_acquire);
+        }
+        /*
+        * 主线程到工作线程的事件队列当前深度
+        */
+        std::size_t GetEventQueueDepth() const
+        {
+            return event2worker_.Count();
+        }
+        /*
+        * 主线程到工作线程的事件队列因满而丢弃的事件数[逻辑线程读写]
+        */
+        uint64_t GetEventQueueDropped() const
+        {
+            return event2worker_dropped_;
+        }
 
     public:
         /*
@@ -62,6 +255,10 @@ namespace ToolBox
         */
         void OnAccepting(uint64_t opaque, int32_t fd, const std::string& ip, const uint16_t port, int32_t send_buff_size, int32_t recv_buff_size);
         /*
+        * 工作线程内接收到新连接,直接在本网络线程内加入io多路复用[SO_REUSEPORT 模式,不经过主线程]
+        */
+        void OnAdoptAccepted(uint64_t opaque, int32_t fd, const std::string& ip, const uint16_t port, int32_t send_buff_size, int32_t recv_buff_size);
+        /*
         * 工作线程内接收到新连接,通知主线程[已加入监听]
         */
         void OnAccepted(uint64_t opaque, uint64_t connect_id);
@@ -85,6 +282,13 @@ namespace ToolBox
         * 工作线程内接收到数据,通知主线程
         */
         void OnReceived(uint64_t opaque, uint64_t connect_id, const char* data, uint32_t size);
+        /*
+        * 工作线程内批量接收事件
+        * @param block 偏移表[frame_count + 1] + 首尾相接的消息,所有权交给逻辑线程
+        * @param frame_count 消息数量
+        * @param size 所有消息的总长度
+        */
+        void OnReceivedBatch(uint64_t opaque, uint64_t connect_id, const char* block, uint32_t frame_count, uint32_t size);
     public:
         /*
         * @brief 获取网络库特性参数->最大累计包数.网络线程模拟 Nagle 算法,减少系统调用,代价是在通信不够频繁的情况下可能会增加延迟.
@@ -94,6 +298,33 @@ namespace ToolBox
         * @brief 获取网络库特性参数->超时时间,单位毫秒(ms).网络线程模拟 Nagle 算法,减少系统调用,代价是在通信不够频繁的情况下可能会增加延迟.
         */
         int32_t GetSimulateNagleTimeout();
+        /*
+        * @brief 获取网络库特性参数->UDP/KCP 单次批量收发的数据报数量,为 1 时逐个数据报 recvfrom/sendto.
+        */
+        uint32_t GetUdpBatchSize();
+        /*
+        * @brief 获取网络库特性参数->原始 UDP 批量接收时每个数据报预留的大小.
+        */
+        uint32_t GetUdpDatagramSize();
+        /*
+        * @brief 获取网络库特性参数->是否开启自适应缓冲区.开启后连接的收发缓冲区从小块开始按需倍增,空闲时缩容.
+        */
+        bool IsAdaptiveBuffer();
+        /*
+        * @brief 获取网络库特性参数->是否开启批量接收.开启后一次读取解出的所有完整消息合并为一个接收事件.
+        */
+        bool IsRecvBatch();
+        /*
+        * @brief 获取网络库特性参数->新连接的 SO_BUSY_POLL 微秒数,0 为不设置.
+        */
+        uint32_t GetBusyPoll() const
+        {
+            return busy_poll_usecs_;
+        }
+        /*
+        * @brief 为 opaque 对应的新连接创建消息解码器,没有设置时返回空,使用内置的长度头格式.
+        */
+        std::unique_ptr<NetDecoder> CreateDecoder(uint64_t opaque);
 
 
 
@@ -101,7 +332,7 @@ namespace ToolBox
         /*
         * 主线程通知,工作线程内建立监听器
         */
-        virtual uint64_t OnNewAccepter(uint64_t opaque, const std::string& ip, const uint16_t port, int32_t send_buff_size, int32_t recv_buff_size) = 0;
+        virtual uint64_t OnNewAccepter(uint64_t opaque, const std::string& ip, const uint16_t port, int32_t send_buff_size, int32_t recv_buff_size, bool reuse_port) = 0;
         /*
         * 主线程通知,将fd加入io多路复用
         */
@@ -118,15 +349,68 @@ namespace ToolBox
         * 主线程通知,工作线程内工作线程内发送
         */
         virtual void OnSend(uint64_t connect_id, const char* data, uint32_t size) = 0;
+        /*
+        * 主线程通知,工作线程内发送引用计数缓冲区.默认退化为拷贝发送,支持零拷贝的实现层需重写
+        * @param buffer 已成帧的缓冲区,本函数不接管其引用
+        * @param by_reference 为 true 时[广播]无论大小都按引用排队,不拷贝进各连接的发送缓冲区
+        */
+        virtual void OnSendBuffer(uint64_t connect_id, NetBuffer* buffer, bool by_reference);
 
     protected:
         /*
-        * 时间函数,统一更新,减少系统调用
+        * 除监听器以外的连接数,由实现层在网络线程内统计
         */
-        std::time_t GetNetTime() const
+        virtual uint32_t CountConnections() const
         {
-            return update_timestamp_;
+            return 0;
+        }
+        /*
+        * 发布存活连接数,由实现层在网络线程内调用
+        */
+        void SetLiveConnections(uint32_t count)
+        {
+            live_connections_.store(count, std::memory_order_relaxed);
+        }
+        /*
+        * 累加发送字节数与消息数,只有网络线程写,无需原子加
+        */
+        void AddSendBytes(uint64_t size, uint64_t packets = 1)
+        {
+            send_bytes_.store(send_bytes_.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+            send_packets_.store(send_packets_.load(std::memory_order_relaxed) + packets, std::memory_order_relaxed);
+        }
+        /*
+        * 采集本网络各连接的指标,由 Update 在收到逻辑线程的请求后调用
+        */
+        virtual void CollectConnMetrics(std::vector<NetConnMetrics>& metrics) {}
+        /*
+        * 发布连接收发缓冲区的内存占用,由实现层在每次网络循环末尾调用
+        */
+        void PublishBufferBytes()
+        {
+            buffer_bytes_.store(buffer_slab_.GetInUseBytes(), std::memory_order_relaxed);
+            buffer_cached_bytes_.store(buffer_slab_.GetCachedBytes(), std::memory_order_relaxed);
+        }
+        /*
+        * 累加 ikcp_update 调用次数,只有网络线程写,无需原子加
+        */
+        void AddKcpUpdates(uint64_t count)
+        {
+            kcp_updates_.store(kcp_updates_.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+        }
+        /*
+        * 累加一次模拟 Nagle 定时刷新遍历与实际收发的 socket 数,只有网络线程写,无需原子加
+        */
+        void AddNagleTick(uint64_t scanned, uint64_t flushed)
+        {
+            nagle_scanned_.store(nagle_scanned_.load(std::memory_order_relaxed) + scanned, std::memory_order_relaxed);
+            nagle_flushed_.store(nagle_flushed_.load(std::memory_order_relaxed) + flushed, std::memory_order_relaxed);
         }
+        /*
+        * 处理主线程发来的事件,最多处理 max_count 个
+        * @return 处理的个数
+        */
+        std::size_t HandleEvents_(std::size_t max_count);
 
     private:
         /*
@@ -150,13 +434,41 @@ namespace ToolBox
         */
         void OnMainToWorkerSend_(Event* event);
         /*
+        * 通知网络线程发送引用计数缓冲区
+        */
+        void OnMainToWorkerSendBuffer_(Event* event);
+        /*
+        * 通知网络线程将同一个缓冲区广播给多个连接
+        */
+        void OnMainToWorkerBroadcast_(Event* event);
+        /*
         * 通知网络线程设置模拟Nagle算法
         */
         void SetSimulateNagle_(Event* event);
         /*
+        * 通知网络线程设置 UDP/KCP 批量收发的数据报数量
+        */
+        void SetUdpBatchSize_(Event* event);
+        /*
+        * 通知网络线程设置自适应缓冲区
+        */
+        void SetAdaptiveBuffer_(Event* event);
+        /*
+        * 通知网络线程设置批量接收
+        */
+        void SetRecvBatch_(Event* event);
+        /*
+        * 处理完一个新连接分配事件后发布计数
+        */
+        void OnPlacementHandled_();
+        /*
         * 处理需要在网络线程中处理的事件
         */
         void HandleEvents_();
+        /*
+        * 投递事件到逻辑线程
+        */
+        void NotifyMain_(NetEventMain* event);
 
     public:
         /*
@@ -174,12 +486,36 @@ namespace ToolBox
     private:
         NetworkType network_type_;          // 网络类型: TCP,UDP,KCP
         Event2Worker event2worker_;         // 主线程到工作线程的事件队列
+        uint64_t event2worker_dropped_ = 0; // 主线程到工作线程的事件队列满而丢弃的事件数
         EventDispatcher* event_dispatcher_;  // 事件分发器
         NetworkChannel* master_;            // 主线程中的网络管理器
         uint32_t net_thread_index_ = 0;     // 网络线程序号
         std::time_t update_timestamp_ = 0;  // 由Update更新的时间
         int32_t nagle_packets_num_ = -1;    // 模拟Nagle 参数,累计 packets_num_ 包后再进行发送操作.
         int32_t nagle_timeout_ = -1;        // 模拟Nagle 参数,timeout_ 后触发发送操作.单位毫秒(ms)
+        uint32_t udp_batch_size_ = NETWORK_UDP_BATCH_SIZE;  // UDP/KCP 单次批量收发的数据报数量
+        uint32_t udp_datagram_size_ = NETWORK_UDP_DATAGRAM_SIZE;    // 原始 UDP 批量接收时每个数据报预留的大小
+        bool adaptive_buffer_ = false;      // 是否开启自适应缓冲区
+        bool recv_batch_ = false;           // 是否开启批量接收
+        uint32_t busy_poll_usecs_ = 0;      // 新连接的 SO_BUSY_POLL 微秒数
+        RingBufferSlab buffer_slab_{ NETWORK_ADAPTIVE_BUFFER_SLAB_CACHE_SIZE };    // 连接收发缓冲区的分配器
+        std::atomic<uint32_t> live_connections_ = 0;    // 存活连接数
+        std::atomic<uint64_t> recv_bytes_ = 0;          // 累计接收字节数
+        std::atomic<uint64_t> send_bytes_ = 0;          // 累计发送字节数
+        std::atomic<uint64_t> recv_packets_ = 0;        // 累计投递给逻辑线程的消息数
+        std::atomic<uint64_t> send_packets_ = 0;        // 累计逻辑线程请求发送的消息数
+        std::atomic<uint64_t> recv_syscalls_ = 0;       // 累计接收系统调用次数
+        std::atomic<uint64_t> placements_handled_ = 0;  // 已处理的新连接分配事件数
+        std::atomic<uint64_t> send_flushes_ = 0;        // 累计有数据可发的发送刷新次数
+        std::atomic<uint64_t> send_syscalls_ = 0;       // 累计发送系统调用次数
+        std::atomic<uint64_t> kcp_updates_ = 0;         // 累计 ikcp_update 调用次数
+        std::atomic<uint64_t> nagle_scanned_ = 0;       // 模拟 Nagle 定时刷新累计遍历的 socket 数
+        std::atomic<uint64_t> nagle_flushed_ = 0;       // 模拟 Nagle 定时刷新累计有数据收发的 socket 数
+        std::atomic<uint64_t> buffer_bytes_ = 0;        // 连接收发缓冲区占用的字节数
+        std::atomic<uint64_t> buffer_cached_bytes_ = 0; // 缓存待复用的缓冲区字节数
+        std::atomic_bool conn_metrics_requested_ = false;   // 逻辑线程是否请求了连接指标
+        std::mutex conn_metrics_mutex_;                 // 保护 conn_metrics_
+        std::vector<NetConnMetrics> conn_metrics_;      // 网络线程上一次发布的连接指标
     };
 
 };  // ToolBox
\ No newline at end of file
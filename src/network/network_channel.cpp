@@ -1,8 +1,11 @@
 #include "network_channel.h"
 #include "network/network_def.h"
 #include "network_def_internal.h"
+#include "network/net_imp/net_imp_define.h"
 #include "tools/time_util.h"
 #include "event.h"
+#include <algorithm>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <random>
@@ -10,7 +13,12 @@
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
 #include "network/net_imp/net_iocp/tcp_iocp_network.h"
 #elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
 #include <sys/resource.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 #if defined(LINUX_IO_URING)
 #include "network/net_imp/net_io_uring/tcp_io_uring_network.h"
 #else
@@ -40,7 +48,9 @@ namespace ToolBox
 
     NetworkChannel::~NetworkChannel()
     {
-        event2main_.Clear();
+        ReleaseWorkerWaiters_();
+        ClearMainEvent_();
+        event2main_.clear();
         delete event_dispatcher_;
         event_dispatcher_ = nullptr;
     }
@@ -50,32 +60,54 @@ namespace ToolBox
         // 设置进程可打开的最大文件描述符数量[需要root权限才可成功]
         // SetSystemMaxOpenFiles();
 
+        // 网络线程序号编码在连接ID中,见 net_imp_define.h CONN_ID_THREAD_BITS
+        if (net_thread_num > MAX_NET_THREAD_COUNT)
+        {
+            NetworkLogError("[Network] invalid net_thread_num:%zu, max:%u", net_thread_num, MAX_NET_THREAD_COUNT);
+            return false;
+        }
         stop_.store(false);
         networks_.resize(net_thread_num);
+        // 每个网络线程独占一个到逻辑线程的队列,须在网络线程启动前建立
+        ClearMainEvent_();
+        event2main_.clear();
+        for (std::size_t i = 0; i < net_thread_num; i++)
+        {
+            event2main_.emplace_back(std::make_unique<MainEventQueue>());
+        }
+        CreateWorkerWaiters_(net_thread_num);
+        thread_loads_.assign(net_thread_num, NetThreadLoadState());
+        load_window_start_ = GetMillSecondTimeStamp();
+        BuildHashRing_(net_thread_num);
         for (std::size_t i = 0; i < net_thread_num; i++)
         {
             NetworkLogInfo("[Network] start thread. network_thread_index:%zu", i);
             workers_.emplace_back(new std::thread([this, i]()
             {
+                PinWorker_(i);
                 while (!stop_.load())
                 {
                     std::time_t timetamp = GetMillSecondTimeStamp();
                     bool loaded_network = false;
+                    bool blockable = true;
+                    int32_t wait_timeout = -1;
                     // NetworkLogError("[Network] networks_ size :%zu", networks_.size());
                     // 驱动网络更新
                     for (auto& network : networks_[i])
                     {
                         if (network)
                         {
+                            blockable = AttachWorkerWaiter_(i, network.get()) && blockable;
                             network->Update(timetamp);
                             loaded_network = true;
+                            int32_t timeout = network->GetWaitTimeout();
+                            if (timeout >= 0 && (wait_timeout < 0 || timeout < wait_timeout))
+                            {
+                                wait_timeout = timeout;
+                            }
                         }
                     }
-                    if (!loaded_network)
-                    {
-                        // NetworkLogWarn("[Network] Sleep. networks_ size :%zu", networks_.size());
-                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                    }
+                    WaitWorker_(i, loaded_network, blockable, wait_timeout);
                 }
                 NetworkLogWarn("[Network] network has stoped. networks_ size :%zu", networks_.size());
             }));
@@ -83,6 +115,25 @@ namespace ToolBox
         // 将缓存的事件应用到对应的网络线程
         for (const auto& iter : cached_event_to_worker_)
         {
+            // 启动前发起的连接同样计入分配数,与网络线程的已处理数保持一致
+            auto* cached_event = std::get<2>(iter);
+            auto event_id = cached_event->GetID();
+            if (EID_MainToWorkerNewAccepter == event_id && cached_event->IsReusePort())
+            {
+                for (uint32_t net_thread_index = 1; net_thread_index < net_thread_num; net_thread_index++)
+                {
+                    auto* event = GET_NET_OBJECT(NetEventWorker, EID_MainToWorkerNewAccepter, cached_event->GetOpaque());
+                    event->SetIP(cached_event->GetIP());
+                    event->SetAddressPort(cached_event->GetPort());
+                    event->SetBuffSize(cached_event->GetSendBuffSize(), cached_event->GetRecvBuffSize());
+                    event->SetReusePort(true);
+                    NotifyWorker(event, std::get<1>(iter), net_thread_index);
+                }
+            }
+            if ((EID_MainToWorkerNewConnecter == event_id || EID_MainToWorkerJoinIOMultiplexing == event_id) && std::get<0>(iter) < thread_loads_.size())
+            {
+                thread_loads_[std::get<0>(iter)].placed++;
+            }
             NotifyWorker(std::get<2>(iter), std::get<1>(iter), std::get<0>(iter));
         }
         cached_event_to_worker_.clear();
@@ -93,9 +144,26 @@ namespace ToolBox
         DispatchMainEvent_();
     }
 
+    std::size_t NetworkChannel::SpinUpdate(uint32_t spin_usecs)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(spin_usecs);
+        std::size_t count = DispatchMainEvent_();
+        while (0 == count && std::chrono::steady_clock::now() < deadline)
+        {
+            count = DispatchMainEvent_();
+        }
+        return count;
+    }
+
     void NetworkChannel::StopWait()
     {
         stop_.store(true);
+        // 唤醒所有阻塞等待中的网络线程
+        for (uint32_t net_thread_index = 0; net_thread_index < waiters_.size(); net_thread_index++)
+        {
+            waiters_[net_thread_index]->sleeping.store(true);
+            WakeUpWorker(net_thread_index);
+        }
         for (auto& workder : workers_)
         {
             if (workder)
@@ -105,11 +173,9 @@ namespace ToolBox
             }
         }
         workers_.clear();
+        ReleaseWorkerWaiters_();
 
-        while (!event2main_.Empty())
-        {
-            GIVE_BACK_OBJECT(event2main_.Pop());
-        }
+        ClearMainEvent_();
         for (auto& networks : networks_)
         {
             for (auto& network : networks)
@@ -123,6 +189,11 @@ namespace ToolBox
         }
         networks_.clear();
         conn_type_.clear();
+        udp_listeners_.clear();
+        for (auto& directory : session_directories_)
+        {
+            directory.reset();
+        }
     }
     ENetErrCode NetworkChannel::Close(uint64_t conn_id)
     {
@@ -131,9 +202,33 @@ namespace ToolBox
         {
             return ENetErrCode::NET_INVALID_CONNID;
         }
+        auto listener = udp_listeners_.find(conn_id);
+        if (listener != udp_listeners_.end() && listener->second && networks_.size() > 1)
+        {
+            // 以 SO_REUSEPORT 监听的 udp/kcp 监听器每个网络线程各有一个,逐个关闭
+            for (uint32_t net_thread_index = 0; net_thread_index < networks_.size(); net_thread_index++)
+            {
+                auto* event = GET_NET_OBJECT(NetEventWorker, EID_MainToWorkerClose);
+                event->SetConnectID(conn_id);
+                NotifyWorker(event, iter->second, net_thread_index);
+            }
+            udp_listeners_.erase(listener);
+            conn_type_.erase(iter);
+            return ENetErrCode::NET_SUCCESS;
+        }
+        uint32_t net_thread_index = GetNetThreadIndex(iter->second, conn_id);
+        if (INVALID_NET_THREAD_INDEX == net_thread_index)
+        {
+            NetworkLogError("[network] Close conn_id:%lu not found in any network thread", conn_id);
+            return ENetErrCode::NET_INVALID_CONNID;
+        }
         auto* event = GET_NET_OBJECT(NetEventWorker, EID_MainToWorkerClose);
         event->SetConnectID(conn_id);
-        NotifyWorker(event, iter->second, GetNetThreadIndex(conn_id));
+        NotifyWorker(event, iter->second, net_thread_index);
+        if (listener != udp_listeners_.end())
+        {
+            udp_listeners_.erase(listener);
+        }
         conn_type_.erase(iter);
         return ENetErrCode::NET_SUCCESS;
     }
@@ -145,29 +240,638 @@ namespace ToolBox
             NetworkLogError("[network] invalid conn_id:%lu", conn_id);
             return ENetErrCode::NET_INVALID_CONNID;
         }
+        uint32_t net_thread_index = GetNetThreadIndex(iter->second, conn_id);
+        if (INVALID_NET_THREAD_INDEX == net_thread_index)
+        {
+            NetworkLogError("[network] Send conn_id:%lu not found in any network thread", conn_id);
+            return ENetErrCode::NET_INVALID_CONNID;
+        }
         auto* data_to_worker = GET_NET_MEMORY(size+sizeof(uint32_t));
         memcpy(data_to_worker, (char*)&size, sizeof(uint32_t));
         memcpy(data_to_worker + sizeof(uint32_t), data, size);
         auto* event = GET_NET_OBJECT(NetEventWorker, EID_MainToWorkerSend);
         event->SetConnectID(conn_id);
         event->SetData(data_to_worker, size+sizeof(uint32_t));
-        NotifyWorker(event, iter->second, GetNetThreadIndex(conn_id));
+        NotifyWorker(event, iter->second, net_thread_index);
         return ENetErrCode::NET_SUCCESS;
     }
 
-    bool NetworkChannel::NotifyMain(NetEventMain* event)
+    ENetErrCode NetworkChannel::Send(uint64_t conn_id, NetBuffer* buffer)
+    {
+        if (nullptr == buffer)
+        {
+            return ENetErrCode::NET_INVALID_PACKET_SIZE;
+        }
+        auto iter = conn_type_.find(conn_id);
+        if (iter == conn_type_.end())
+        {
+            NetworkLogError("[network] invalid conn_id:%lu", conn_id);
+            buffer->Release();
+            return ENetErrCode::NET_INVALID_CONNID;
+        }
+        uint32_t net_thread_index = GetNetThreadIndex(iter->second, conn_id);
+        if (INVALID_NET_THREAD_INDEX == net_thread_index)
+        {
+            NetworkLogError("[network] Send conn_id:%lu not found in any network thread", conn_id);
+            buffer->Release();
+            return ENetErrCode::NET_INVALID_CONNID;
+        }
+        auto* event = GET_NET_OBJECT(NetEventWorker, EID_MainToWorkerSendBuffer);
+        event->SetConnectID(conn_id);
+        event->SetBuffer(buffer);
+        NotifyWorker(event, iter->second, net_thread_index);
+        return ENetErrCode::NET_SUCCESS;
+    }
+
+    ENetErrCode NetworkChannel::Broadcast(const std::vector<uint64_t>& conn_ids, const char* data, uint32_t size)
+    {
+        ENetErrCode result = ENetErrCode::NET_SUCCESS;
+        // 按网络线程与网络类型分组
+        for (auto conn_id : conn_ids)
+        {
+            auto iter = conn_type_.find(conn_id);
+            if (iter == conn_type_.end())
+            {
+                NetworkLogError("[network] Broadcast invalid conn_id:%lu", conn_id);
+                result = ENetErrCode::NET_INVALID_CONNID;
+                continue;
+            }
+            uint32_t net_thread_index = GetNetThreadIndex(iter->second, conn_id);
+            if (INVALID_NET_THREAD_INDEX == net_thread_index)
+            {
+                NetworkLogError("[network] Broadcast conn_id:%lu not found in any network thread", conn_id);
+                result = ENetErrCode::NET_INVALID_CONNID;
+                continue;
+            }
+            std::size_t group_index = std::size_t(net_thread_index) * NT_MAX + iter->second;
+            if (group_index >= broadcast_groups_.size())
+            {
+                broadcast_groups_.resize(group_index + 1);
+            }
+            broadcast_groups_[group_index].emplace_back(conn_id);
+        }
+        // 只序列化一次,每个分组持有一个引用
+        NetBuffer* buffer = NetBuffer::Create(data, size);
+        for (std::size_t group_index = 0; group_index < broadcast_groups_.size(); group_index++)
+        {
+            auto& group = broadcast_groups_[group_index];
+            if (group.empty())
+            {
+                continue;
+            }
+            buffer->AddRef();
+            auto* event = GET_NET_OBJECT(NetEventWorker, EID_MainToWorkerBroadcast);
+            event->SetBuffer(buffer);
+            event->SetBroadcastConnIDs(group);
+            NotifyWorker(event, NetworkType(group_index % NT_MAX), uint32_t(group_index / NT_MAX));
+            group.clear();
+        }
+        buffer->Release();
+        return result;
+    }
+
+    bool NetworkChannel::NotifyMain(NetEventMain* event, uint32_t net_thread_index)
     {
-        std::lock_guard<std::mutex> lock(lock_);
-        if (event2main_.Full())
+        if (net_thread_index >= event2main_.size())
         {
-            NetworkLogError("[Network] Event queue is full. Drop event. network_type_:%u", event->network_type_);
+            NetworkLogError("[Network] NotifyMain invalid net_thread_index:%u, event2main_.size():%zu", net_thread_index, event2main_.size());
             GIVE_BACK_OBJECT(event);
             return false;
         }
-        event2main_.Push(std::move(event));
+        auto& main_queue = *event2main_[net_thread_index];
+        if (main_queue.queue.Full())
+        {
+            NetworkLogError("[Network] Event queue is full. Drop event. network_type_:%u, net_thread_index:%u", event->network_type_, net_thread_index);
+            main_queue.dropped.fetch_add(1, std::memory_order_relaxed);
+            GIVE_BACK_OBJECT(event);
+            return false;
+        }
+        main_queue.queue.Push(std::move(event));
+        main_queue.pushed.fetch_add(1, std::memory_order_relaxed);
+        // 只有本网络线程写 max_depth,无需 CAS
+        std::size_t depth = main_queue.queue.Count();
+        if (depth > main_queue.max_depth.load(std::memory_order_relaxed))
+        {
+            main_queue.max_depth.store(depth, std::memory_order_relaxed);
+        }
         return true;
     }
 
+    std::vector<NetEventQueueStat> NetworkChannel::GetEventQueueStats()
+    {
+        std::vector<NetEventQueueStat> stats(event2main_.size());
+        for (std::size_t index = 0; index < event2main_.size(); index++)
+        {
+            auto& stat = stats[index];
+            auto& main_queue = *event2main_[index];
+            stat.net_thread_index = static_cast<uint32_t>(index);
+            stat.to_main_depth = main_queue.queue.Count();
+            stat.to_main_max_depth = main_queue.max_depth.load(std::memory_order_relaxed);
+            stat.to_main_pushed = main_queue.pushed.load(std::memory_order_relaxed);
+            stat.to_main_dropped = main_queue.dropped.load(std::memory_order_relaxed);
+            if (index >= networks_.size())
+            {
+                continue;
+            }
+            for (auto& network : networks_[index])
+            {
+                if (network)
+                {
+                    stat.to_worker_depth += network->GetEventQueueDepth();
+                    stat.to_worker_dropped += network->GetEventQueueDropped();
+                }
+            }
+        }
+        return stats;
+    }
+
+    NetMetricsSnapshot NetworkChannel::GetMetricsSnapshot(bool with_connections /*= false*/)
+    {
+        NetMetricsSnapshot snapshot;
+        snapshot.timestamp_ms = GetMillSecondTimeStamp();
+        auto queue_stats = GetEventQueueStats();
+        snapshot.workers.resize(queue_stats.size());
+        for (std::size_t index = 0; index < queue_stats.size(); index++)
+        {
+            auto& worker = snapshot.workers[index];
+            worker.net_thread_index = static_cast<uint32_t>(index);
+            worker.to_main_depth = queue_stats[index].to_main_depth;
+            worker.to_main_dropped = queue_stats[index].to_main_dropped;
+            worker.to_worker_depth = queue_stats[index].to_worker_depth;
+            worker.to_worker_dropped = queue_stats[index].to_worker_dropped;
+            if (index >= networks_.size())
+            {
+                continue;
+            }
+            for (auto& network : networks_[index])
+            {
+                if (!network)
+                {
+                    continue;
+                }
+                worker.connections += network->GetLiveConnections();
+                worker.recv_bytes += network->GetRecvBytes();
+                worker.send_bytes += network->GetSendBytes();
+                worker.recv_packets += network->GetRecvPackets();
+                worker.send_packets += network->GetSendPackets();
+                worker.recv_syscalls += network->GetRecvSyscalls();
+                worker.send_syscalls += network->GetSendSyscalls();
+                worker.wakeups += network->GetIoWakeups();
+                worker.io_events += network->GetIoEvents();
+                if (with_connections && NT_TCP == network->GetNetworkType())
+                {
+                    network->CopyConnMetrics(snapshot.connections);
+                    network->RequestConnMetrics();
+                }
+            }
+            if (worker.wakeups > 0)
+            {
+                worker.events_per_wakeup = double(worker.io_events) / double(worker.wakeups);
+            }
+            if (with_connections)
+            {
+                // 阻塞等待中的网络线程需要唤醒才会发布
+                WakeUpWorker(static_cast<uint32_t>(index));
+            }
+        }
+        return snapshot;
+    }
+
+    void NetworkChannel::WakeUpWorker(uint32_t net_thread_index)
+    {
+#if defined(__linux__)
+        if (net_thread_index >= waiters_.size())
+        {
+            return;
+        }
+        auto& waiter = *waiters_[net_thread_index];
+        // 与网络线程的 sleeping.store -> 检查队列 配对,保证事件入队与读取休眠标记的顺序
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiter.sleeping.load(std::memory_order_relaxed) && waiter.sleeping.exchange(false))
+        {
+            uint64_t one = 1;
+            if (write(waiter.event_fd, &one, sizeof(one)) < 0)
+            {
+                NetworkLogError("[Network] write eventfd failed. network_thread_index:%u, errno:%d", net_thread_index, errno);
+            }
+        }
+#endif // __linux__
+    }
+
+    void NetworkChannel::SetWorkerBlockingWait(bool enable /*= true*/)
+    {
+        blocking_wait_ = enable;
+    }
+
+    void NetworkChannel::SetMaxSocketCount(uint32_t max_socket_count /*= NETWORK_MAX_SOCKET_COUNT*/)
+    {
+        if (!workers_.empty())
+        {
+            NetworkLogError("[Network] SetMaxSocketCount must be called before Start.");
+            return;
+        }
+        if (0 == max_socket_count)
+        {
+            NetworkLogError("[Network] invalid max_socket_count:%u", max_socket_count);
+            return;
+        }
+        max_socket_count_ = max_socket_count;
+    }
+
+    void NetworkChannel::SetLatencyMode(const NetLatencyMode& mode)
+    {
+        if (!workers_.empty())
+        {
+            NetworkLogError("[Network] SetLatencyMode must be called before Start.");
+            return;
+        }
+        latency_mode_ = mode;
+    }
+
+    void NetworkChannel::CreateWorkerWaiters_(std::size_t net_thread_num)
+    {
+        ReleaseWorkerWaiters_();
+#if defined(__linux__)
+        if (!blocking_wait_)
+        {
+            return;
+        }
+        for (std::size_t i = 0; i < net_thread_num; i++)
+        {
+            auto waiter = std::make_unique<WorkerWaiter>();
+            waiter->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            waiter->poll_fd = epoll_create1(EPOLL_CLOEXEC);
+            epoll_event event;
+            memset(&event, 0, sizeof(event));
+            event.events = EPOLLIN;
+            event.data.u32 = NT_MAX;
+            if (waiter->event_fd < 0 || waiter->poll_fd < 0 || 0 != epoll_ctl(waiter->poll_fd, EPOLL_CTL_ADD, waiter->event_fd, &event))
+            {
+                // 建立失败则全部退化为轮询
+                NetworkLogError("[Network] create worker waiter failed, fall back to polling. network_thread_index:%zu, errno:%d", i, errno);
+                waiters_.emplace_back(std::move(waiter));
+                ReleaseWorkerWaiters_();
+                return;
+            }
+            waiters_.emplace_back(std::move(waiter));
+        }
+#endif // __linux__
+    }
+
+    void NetworkChannel::ReleaseWorkerWaiters_()
+    {
+#if defined(__linux__)
+        for (auto& waiter : waiters_)
+        {
+            if (waiter->event_fd >= 0)
+            {
+                close(waiter->event_fd);
+            }
+            if (waiter->poll_fd >= 0)
+            {
+                close(waiter->poll_fd);
+            }
+        }
+#endif // __linux__
+        waiters_.clear();
+    }
+
+    bool NetworkChannel::AttachWorkerWaiter_(uint32_t net_thread_index, INetwork* network)
+    {
+#if defined(__linux__)
+        if (net_thread_index >= waiters_.size())
+        {
+            return false;
+        }
+        auto& waiter = *waiters_[net_thread_index];
+        auto type = network->GetNetworkType();
+        if (0 != waiter.attached[type])
+        {
+            return waiter.attached[type] > 0;
+        }
+        int32_t wait_fd = network->AttachWaiter();
+        waiter.attached[type] = -1;
+        if (wait_fd >= 0)
+        {
+            epoll_event event;
+            memset(&event, 0, sizeof(event));
+            event.events = EPOLLIN;
+            event.data.u32 = type;
+            if (0 == epoll_ctl(waiter.poll_fd, EPOLL_CTL_ADD, wait_fd, &event))
+            {
+                waiter.attached[type] = 1;
+            }
+            else
+            {
+                NetworkLogError("[Network] attach network to worker waiter failed. network_thread_index:%u, network_type:%d, errno:%d", net_thread_index, type, errno);
+            }
+        }
+        return waiter.attached[type] > 0;
+#else
+        return false;
+#endif // __linux__
+    }
+
+    void NetworkChannel::WaitWorker_(uint32_t net_thread_index, bool loaded_network, bool blockable, int32_t timeout)
+    {
+#if defined(__linux__)
+        if (blockable && net_thread_index < waiters_.size())
+        {
+            if (latency_mode_.spin_usecs > 0)
+            {
+                auto spin_start = std::chrono::steady_clock::now();
+                if (SpinWorker_(net_thread_index, timeout))
+                {
+                    return;
+                }
+                if (timeout > 0)
+                {
+                    // 忙轮询已经等了一段时间,阻塞等待只等剩下的部分
+                    auto spin_msecs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - spin_start).count();
+                    timeout = static_cast<int32_t>((std::max)(int64_t(timeout) - int64_t(spin_msecs), int64_t(0)));
+                }
+            }
+            auto& waiter = *waiters_[net_thread_index];
+            // 先宣告休眠,再检查一次事件队列,避免与 WakeUpWorker 之间丢失唤醒
+            waiter.sleeping.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            bool pending = stop_.load();
+            for (auto& network : networks_[net_thread_index])
+            {
+                if (network && network->GetEventQueueDepth() > 0)
+                {
+                    pending = true;
+                }
+            }
+            if (!pending)
+            {
+                epoll_event events[NT_MAX + 1];
+                int32_t count = epoll_wait(waiter.poll_fd, events, NT_MAX + 1, timeout);
+                for (int32_t i = 0; i < count; i++)
+                {
+                    if (NT_MAX == events[i].data.u32)
+                    {
+                        uint64_t value = 0;
+                        [[maybe_unused]] auto ret = read(waiter.event_fd, &value, sizeof(value));
+                    }
+                }
+            }
+            waiter.sleeping.store(false, std::memory_order_relaxed);
+            return;
+        }
+#endif // __linux__
+        if (!loaded_network)
+        {
+            // NetworkLogWarn("[Network] Sleep. networks_ size :%zu", networks_.size());
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    bool NetworkChannel::SpinWorker_(uint32_t net_thread_index, int32_t timeout)
+    {
+#if defined(__linux__)
+        auto& waiter = *waiters_[net_thread_index];
+        int64_t spin_usecs = latency_mode_.spin_usecs;
+        if (timeout >= 0)
+        {
+            spin_usecs = (std::min)(spin_usecs, int64_t(timeout) * 1000);
+        }
+        // 忙轮询期间不宣告休眠,逻辑线程投递事件不会写 eventfd,需直接检查事件队列
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(spin_usecs);
+        epoll_event events[NT_MAX + 1];
+        do
+        {
+            if (stop_.load(std::memory_order_relaxed))
+            {
+                return true;
+            }
+            for (auto& network : networks_[net_thread_index])
+            {
+                if (network && network->GetEventQueueDepth() > 0)
+                {
+                    return true;
+                }
+            }
+            int32_t count = epoll_wait(waiter.poll_fd, events, NT_MAX + 1, 0);
+            for (int32_t i = 0; i < count; i++)
+            {
+                if (NT_MAX == events[i].data.u32)
+                {
+                    uint64_t value = 0;
+                    [[maybe_unused]] auto ret = read(waiter.event_fd, &value, sizeof(value));
+                }
+            }
+            if (count > 0)
+            {
+                return true;
+            }
+        } while (std::chrono::steady_clock::now() < deadline);
+#endif // __linux__
+        return false;
+    }
+
+    void NetworkChannel::PinWorker_(uint32_t net_thread_index)
+    {
+#if defined(__linux__)
+        if (net_thread_index >= latency_mode_.cpu_affinity.size() || latency_mode_.cpu_affinity[net_thread_index] < 0)
+        {
+            return;
+        }
+        int32_t cpu = latency_mode_.cpu_affinity[net_thread_index];
+        if (cpu >= CPU_SETSIZE)
+        {
+            NetworkLogError("[Network] invalid cpu affinity. network_thread_index:%u, cpu:%d", net_thread_index, cpu);
+            return;
+        }
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(cpu, &cpu_set);
+        int32_t ret = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+        if (0 != ret)
+        {
+            NetworkLogError("[Network] set cpu affinity failed. network_thread_index:%u, cpu:%d, errno:%d", net_thread_index, cpu, ret);
+            return;
+        }
+        NetworkLogInfo("[Network] network thread pinned. network_thread_index:%u, cpu:%d", net_thread_index, cpu);
+#endif // __linux__
+    }
+
+    void NetworkChannel::SetPlacementPolicy(NetPlacementPolicy policy)
+    {
+        if (policy >= NPP_MAX)
+        {
+            NetworkLogError("[Network] invalid placement policy:%d", policy);
+            return;
+        }
+        placement_policy_ = policy;
+    }
+
+    void NetworkChannel::SetAcceptMode(NetAcceptMode mode)
+    {
+        if (mode >= NAM_MAX)
+        {
+            NetworkLogError("[Network] invalid accept mode:%d", mode);
+            return;
+        }
+        accept_mode_ = mode;
+    }
+
+    std::vector<NetThreadLoad> NetworkChannel::GetThreadLoadStats()
+    {
+        RollLoadWindow_();
+        std::vector<NetThreadLoad> loads(networks_.size());
+        for (uint32_t index = 0; index < networks_.size(); index++)
+        {
+            loads[index] = CollectThreadLoad_(index);
+            if (index < thread_loads_.size())
+            {
+                loads[index].window_bytes = thread_loads_[index].window_bytes;
+                loads[index].placed = thread_loads_[index].placed;
+            }
+        }
+        return loads;
+    }
+
+    uint32_t NetworkChannel::SelectNetThread_(uint64_t opaque, const std::string& ip, uint16_t port)
+    {
+        if (networks_.empty() || thread_loads_.size() != networks_.size())
+        {
+            // 尚未启动,事件缓存在第0个网络线程,启动时再计入分配数
+            return 0;
+        }
+        uint32_t net_thread_index = 0;
+        switch (placement_policy_)
+        {
+            case NPP_LEAST_CONNECTIONS:
+            case NPP_LEAST_BYTES:
+            {
+                RollLoadWindow_();
+                // 网络线程发布的连接数滞后于分配,加上已分配但网络线程尚未处理的连接,避免突发的连接都落到同一个线程
+                uint64_t best_bytes = UINT64_MAX;
+                uint64_t best_connections = UINT64_MAX;
+                for (uint32_t index = 0; index < networks_.size(); index++)
+                {
+                    auto load = CollectThreadLoad_(index);
+                    auto& state = thread_loads_[index];
+                    uint64_t connections = uint64_t(load.connections) + (state.placed > load.placements_handled ? state.placed - load.placements_handled : 0);
+                    uint64_t bytes = 0;
+                    if (NPP_LEAST_BYTES == placement_policy_)
+                    {
+                        bytes = state.window_bytes + (load.recv_bytes + load.send_bytes - state.window_start_bytes);
+                    }
+                    if (bytes < best_bytes || (bytes == best_bytes && connections < best_connections))
+                    {
+                        best_bytes = bytes;
+                        best_connections = connections;
+                        net_thread_index = index;
+                    }
+                }
+                break;
+            }
+            case NPP_CONSISTENT_HASH:
+            {
+                // FNV-1a: 信道标记 + 远端地址
+                uint64_t hash = 14695981039346656037ULL;
+                auto mix = [&hash](const void* data, std::size_t size)
+                {
+                    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+                    for (std::size_t i = 0; i < size; i++)
+                    {
+                        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+                    }
+                };
+                mix(&opaque, sizeof(opaque));
+                mix(ip.data(), ip.size());
+                mix(&port, sizeof(port));
+                auto iter = std::lower_bound(hash_ring_.begin(), hash_ring_.end(), std::make_pair(hash, uint32_t(0)));
+                if (iter == hash_ring_.end())
+                {
+                    iter = hash_ring_.begin();
+                }
+                net_thread_index = iter == hash_ring_.end() ? 0 : iter->second;
+                break;
+            }
+            case NPP_RANDOM:
+            default:
+            {
+                static std::default_random_engine dre(time(0));  // 稍微随机些的种子
+                std::uniform_int_distribution<unsigned > uid(0, networks_.size() - 1);
+                net_thread_index = uid(dre);
+                break;
+            }
+        }
+        thread_loads_[net_thread_index].placed++;
+        return net_thread_index;
+    }
+
+    NetThreadLoad NetworkChannel::CollectThreadLoad_(uint32_t net_thread_index)
+    {
+        NetThreadLoad load;
+        load.net_thread_index = net_thread_index;
+        load.policy = placement_policy_;
+        if (net_thread_index >= networks_.size())
+        {
+            return load;
+        }
+        for (auto& network : networks_[net_thread_index])
+        {
+            if (network)
+            {
+                // 先读已处理的分配数,读到的连接数不会早于与之配对发布的值,尚未处理的分配不会被漏算
+                load.placements_handled += network->GetPlacementsHandled();
+                load.connections += network->GetLiveConnections();
+                load.recv_bytes += network->GetRecvBytes();
+                load.send_bytes += network->GetSendBytes();
+                load.send_flushes += network->GetSendFlushes();
+                load.send_syscalls += network->GetSendSyscalls();
+                load.kcp_updates += network->GetKcpUpdates();
+                load.nagle_scanned += network->GetNagleScanned();
+                load.nagle_flushed += network->GetNagleFlushed();
+                load.buffer_bytes += network->GetBufferBytes();
+                load.buffer_cached_bytes += network->GetBufferCachedBytes();
+            }
+        }
+        return load;
+    }
+
+    void NetworkChannel::RollLoadWindow_()
+    {
+        std::time_t now = GetMillSecondTimeStamp();
+        std::time_t elapsed = now - load_window_start_;
+        if (elapsed < std::time_t(NETWORK_LOAD_WINDOW_MS))
+        {
+            return;
+        }
+        load_window_start_ = now;
+        for (uint32_t index = 0; index < thread_loads_.size(); index++)
+        {
+            auto load = CollectThreadLoad_(index);
+            auto& state = thread_loads_[index];
+            uint64_t total_bytes = load.recv_bytes + load.send_bytes;
+            // 长时间未滚动时折算为一个窗口的字节数
+            state.window_bytes = (total_bytes - state.window_start_bytes) * NETWORK_LOAD_WINDOW_MS / elapsed;
+            state.window_start_bytes = total_bytes;
+        }
+    }
+
+    void NetworkChannel::BuildHashRing_(std::size_t net_thread_num)
+    {
+        hash_ring_.clear();
+        for (uint32_t index = 0; index < net_thread_num; index++)
+        {
+            for (uint32_t node = 0; node < NETWORK_HASH_VIRTUAL_NODES; node++)
+            {
+                // splitmix64 打散虚拟节点
+                uint64_t hash = (uint64_t(index) << 32 | node) + 0x9E3779B97F4A7C15ULL;
+                hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBULL;
+                hash = hash ^ (hash >> 31);
+                hash_ring_.emplace_back(hash, index);
+            }
+        }
+        std::sort(hash_ring_.begin(), hash_ring_.end());
+    }
+
     void NetworkChannel::SetSimulateNagle(uint32_t packets_num /* = 10*/, uint32_t timeout/* = 2*/)
     {
         for (uint32_t net_index = 0; net_index < networks_.size(); net_index++)
@@ -178,6 +882,81 @@ namespace ToolBox
         }
     }
 
+    void NetworkChannel::SetUdpBatchSize(uint32_t batch_size /* = NETWORK_UDP_BATCH_SIZE*/, uint32_t datagram_size /* = NETWORK_UDP_DATAGRAM_SIZE*/)
+    {
+        udp_batch_size_ = std::clamp<uint32_t>(batch_size, 1, NETWORK_UDP_BATCH_MAX);
+        udp_datagram_size_ = std::clamp<uint32_t>(datagram_size, 1, UDP_MAX_DATAGRAM_SIZE);
+        for (uint32_t net_index = 0; net_index < networks_.size(); net_index++)
+        {
+            for (auto type : { NT_UDP, NT_KCP })
+            {
+                if (nullptr == networks_[net_index][type])
+                {
+                    // 尚未建立的网络在建立时设置
+                    continue;
+                }
+                auto* event = GET_NET_OBJECT(NetEventWorker, EID_MainToWorkerSetUdpBatchSize);
+                event->SetFeatureParam(static_cast<int32_t>(udp_batch_size_), static_cast<int32_t>(udp_datagram_size_));
+                NotifyWorker(event, type, net_index);
+            }
+        }
+    }
+
+    void NetworkChannel::SetAdaptiveBuffer(bool enable /* = true*/)
+    {
+        for (uint32_t net_index = 0; net_index < networks_.size(); net_index++)
+        {
+            auto* event = GET_NET_OBJECT(NetEventWorker, EID_MainToWorkerSetAdaptiveBuffer);
+            event->SetFeatureParam(enable ? 1 : 0, 0);
+            NotifyWorker(event, NT_TCP, net_index);
+        }
+    }
+
+    void NetworkChannel::SetRecvBatch(bool enable /* = true*/)
+    {
+        recv_batch_ = enable;
+        for (uint32_t net_index = 0; net_index < networks_.size(); net_index++)
+        {
+            if (nullptr == networks_[net_index][NT_TCP])
+            {
+                // 尚未建立的网络在建立时设置
+                continue;
+            }
+            auto* event = GET_NET_OBJECT(NetEventWorker, EID_MainToWorkerSetRecvBatch);
+            event->SetFeatureParam(enable ? 1 : 0, 0);
+            NotifyWorker(event, NT_TCP, net_index);
+        }
+    }
+
+    void NetworkChannel::SetDecoder(uint64_t opaque, NetDecoderCreator creator)
+    {
+        std::lock_guard<std::mutex> lock(decoder_mutex_);
+        if (creator)
+        {
+            decoder_creators_[opaque] = std::move(creator);
+        }
+        else
+        {
+            decoder_creators_.erase(opaque);
+        }
+        has_decoder_.store(!decoder_creators_.empty(), std::memory_order_release);
+    }
+
+    std::unique_ptr<NetDecoder> NetworkChannel::CreateDecoder(uint64_t opaque)
+    {
+        if (!has_decoder_.load(std::memory_order_acquire))
+        {
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(decoder_mutex_);
+        auto iter = decoder_creators_.find(opaque);
+        if (iter == decoder_creators_.end())
+        {
+            return nullptr;
+        }
+        return iter->second();
+    }
+
     /*
     * @brief 设置绑定成功的回调
     */
@@ -242,14 +1021,32 @@ namespace ToolBox
         received_ = received_method;
         return *this;
     }
+    /*
+    * @brief 设置批量接收的回调
+    */
+    NetworkChannel& NetworkChannel::SetOnReceivedBatch(ReceivedBatchMethod received_batch_method)
+    {
+        received_batch_ = received_batch_method;
+        return *this;
+    }
 
     void NetworkChannel::Accept(NetworkType type, uint64_t opaque, const std::string& ip, uint16_t port, int32_t send_buff_size, int32_t recv_buff_size)
     {
-        auto* event = GET_NET_OBJECT(NetEventWorker, EID_MainToWorkerNewAccepter, opaque);
-        event->SetIP(ip);
-        event->SetAddressPort(port);
-        event->SetBuffSize(send_buff_size, recv_buff_size);
-        NotifyWorker(event, type, 0);   // 多网络线程下,第0个线程专门作为 acceptor
+        bool reuse_port = NAM_REUSEPORT == accept_mode_;
+#if !defined(__linux__)
+        reuse_port = false;
+#endif
+        // SO_REUSEPORT 模式下每个网络线程各自监听;尚未启动时先缓存一个,启动时再扩散到所有网络线程
+        std::size_t accepter_num = reuse_port && !networks_.empty() ? networks_.size() : 1;
+        for (std::size_t net_thread_index = 0; net_thread_index < accepter_num; net_thread_index++)
+        {
+            auto* event = GET_NET_OBJECT(NetEventWorker, EID_MainToWorkerNewAccepter, opaque);
+            event->SetIP(ip);
+            event->SetAddressPort(port);
+            event->SetBuffSize(send_buff_size, recv_buff_size);
+            event->SetReusePort(reuse_port);
+            NotifyWorker(event, type, net_thread_index);   // 多网络线程下,默认第0个线程专门作为 acceptor
+        }
     }
     void NetworkChannel::Connect(NetworkType type, uint64_t opaque, const std::string& ip, uint16_t port, int32_t send_buff_size, int32_t recv_buff_size)
     {
@@ -257,21 +1054,17 @@ namespace ToolBox
         event->SetIP(ip);
         event->SetAddressPort(port);
         event->SetBuffSize(send_buff_size, recv_buff_size);
-        static std::default_random_engine dre(time(0));  // 稍微随机些的种子
-        std::uniform_int_distribution<unsigned > uid(0, networks_.size() - 1);
-        uint32_t random_thread_index = uid(dre);
-        if (0 == networks_.size())
-        {
-            random_thread_index = 0;
-        }
-        NetworkLogInfo("[Network] Push connect event to network_thread_index:%u", random_thread_index);
-        NotifyWorker(event, type, random_thread_index);      //随机去某个线程中去连接.
+        uint32_t net_thread_index = SelectNetThread_(opaque, ip, port);
+        NetworkLogInfo("[Network] Push connect event to network_thread_index:%u", net_thread_index);
+        NotifyWorker(event, type, net_thread_index);      // 按分配策略去某个线程中去连接.
     }
     void NetworkChannel::NotifyWorker(NetEventWorker* event, NetworkType type, uint32_t net_thread_index)
     {
+        // 出错时归还事件,事件析构时释放其持有的缓冲区引用
         if (type >= NT_MAX || type <= NT_UNKNOWN )
         {
             OnErrored(type, 0, 0, ENetErrCode::NET_INVALID_NETWORK_TYPE, 0);
+            GIVE_BACK_OBJECT(event);
             return;
         }
 
@@ -281,6 +1074,7 @@ namespace ToolBox
             {
                 NetworkLogError("[Network] Vector of cache event to net thread is overflow. network_thread_index:%zu", net_thread_index);
                 OnErrored(type, 0, 0, ENetErrCode::NET_CACHED_EVENT_OVERFLOW, 0);
+                GIVE_BACK_OBJECT(event);
                 return;
             }
             NetworkLogInfo("[Network] Cache event for net thread. network_thread_index:%zu", net_thread_index);
@@ -292,6 +1086,7 @@ namespace ToolBox
         {
             NetworkLogError("[Network] NotifyWorker net_thread_index:%u, networks_.size():%zu", net_thread_index, networks_.size());
             OnErrored(type, 0, 0, ENetErrCode::NET_INVALID_NET_THREAD_INDEX, 0);
+            GIVE_BACK_OBJECT(event);
             return;
         }
 
@@ -300,7 +1095,29 @@ namespace ToolBox
         auto index = static_cast<size_t>(type);
         if (nullptr == network_type[index])
         {
-            network_type[index].reset(GetNetwork_(type, net_thread_index));
+            auto* network = GetNetwork_(type, net_thread_index);
+            if (nullptr == network)
+            {
+                NetworkLogError("[Network] NotifyWorker unsupported network type:%d", type);
+                OnErrored(type, 0, 0, ENetErrCode::NET_INVALID_NETWORK_TYPE, 0);
+                GIVE_BACK_OBJECT(event);
+                return;
+            }
+            // 网络线程只读,须在网络对其可见之前设置
+            network->SetBusyPoll(latency_mode_.busy_poll_usecs);
+            network_type[index].reset(network);
+            if (NT_TCP == type && recv_batch_)
+            {
+                auto* batch_event = GET_NET_OBJECT(NetEventWorker, EID_MainToWorkerSetRecvBatch);
+                batch_event->SetFeatureParam(1, 0);
+                network_type[index]->PushEvent(std::move(batch_event));
+            }
+            if ((NT_UDP == type || NT_KCP == type) && (NETWORK_UDP_BATCH_SIZE != udp_batch_size_ || NETWORK_UDP_DATAGRAM_SIZE != udp_datagram_size_))
+            {
+                auto* batch_event = GET_NET_OBJECT(NetEventWorker, EID_MainToWorkerSetUdpBatchSize);
+                batch_event->SetFeatureParam(static_cast<int32_t>(udp_batch_size_), static_cast<int32_t>(udp_datagram_size_));
+                network_type[index]->PushEvent(std::move(batch_event));
+            }
         }
         network_type[index]->PushEvent(std::move(event));
     }
@@ -319,6 +1136,11 @@ namespace ToolBox
                  , event_main->net_evt_.bind_.port_);
         // 建立 conn_id 到 network_type 的映射
         conn_type_[event_main->net_evt_.bind_.connect_id_] = event_main->network_type_;
+        if (NT_UDP == event_main->network_type_ || NT_KCP == event_main->network_type_)
+        {
+            // 记录监听时的方式,关闭时据此决定是否需要关闭每个网络线程上的监听器
+            udp_listeners_[event_main->net_evt_.bind_.connect_id_] = event_main->net_evt_.bind_.reuse_port_;
+        }
         // 回调
         if (binded_)
         {
@@ -389,6 +1211,7 @@ namespace ToolBox
                 , event_main->net_evt_.error_.sys_err_code);
         // 删除映射
         conn_type_.erase(event_main->net_evt_.error_.connect_id_);
+        udp_listeners_.erase(event_main->net_evt_.error_.connect_id_);
         // 回调
         if (close_)
         {
@@ -471,35 +1294,75 @@ namespace ToolBox
         {
             return;
         }
-        OnReceived(event_main->network_type_
-                   , event_main->GetOpaque()
-                   , event_main->net_evt_.recv_.connect_id_
-                   , event_main->net_evt_.recv_.data_
-                   , event_main->net_evt_.recv_.size_);
-        if (received_)
+        const auto& recv = event_main->net_evt_.recv_;
+        NetRecvBatch batch;
+        uint32_t single_offsets[2] = { 0, recv.size_ };
+        if (recv.frame_count_ > 0)
         {
-            received_(event_main->network_type_
-                      , event_main->GetOpaque()
-                      , event_main->net_evt_.recv_.connect_id_
-                      , event_main->net_evt_.recv_.data_
-                      , event_main->net_evt_.recv_.size_);
+            batch.offsets = reinterpret_cast<const uint32_t*>(recv.data_);
+            batch.data = recv.data_ + sizeof(uint32_t) * (recv.frame_count_ + 1);
+            batch.count = recv.frame_count_;
+        }
+        else
+        {
+            batch.offsets = single_offsets;
+            batch.data = recv.data_;
+            batch.count = 1;
+        }
+        if (received_batch_)
+        {
+            received_batch_(event_main->network_type_, event_main->GetOpaque(), recv.connect_id_, batch);
+        }
+        for (uint32_t index = 0; index < batch.count; index++)
+        {
+            OnReceived(event_main->network_type_, event_main->GetOpaque(), recv.connect_id_, batch.Frame(index), batch.FrameSize(index));
+            if (received_ && !received_batch_)
+            {
+                received_(event_main->network_type_, event_main->GetOpaque(), recv.connect_id_, batch.Frame(index), batch.FrameSize(index));
+            }
         }
     }
 
 
 
-    void NetworkChannel::DispatchMainEvent_()
+    std::size_t NetworkChannel::DispatchMainEvent_()
     {
-        while (!event2main_.Empty())
+        // 轮流从各网络线程的队列中批量取出事件,避免单个繁忙线程饿死其他线程
+        NetEventMain* events[NETWORK_EVENT_DISPATCH_BATCH];
+        std::size_t dispatched = 0;
+        bool has_event = true;
+        while (has_event)
         {
-            NetEventMain* event = event2main_.Pop();
-            if (nullptr == event)
+            has_event = false;
+            for (auto& main_queue : event2main_)
             {
-                OnErrored(NT_UNKNOWN, 0, 0, ENetErrCode::NET_INVALID_EVENT, 0);
-                continue;
+                std::size_t count = main_queue->queue.PopBulk(events, NETWORK_EVENT_DISPATCH_BATCH);
+                has_event = has_event || count > 0;
+                dispatched += count;
+                for (std::size_t index = 0; index < count; index++)
+                {
+                    NetEventMain* event = events[index];
+                    if (nullptr == event)
+                    {
+                        OnErrored(NT_UNKNOWN, 0, 0, ENetErrCode::NET_INVALID_EVENT, 0);
+                        continue;
+                    }
+                    event_dispatcher_ ->HandleEvent(event);
+                    GIVE_BACK_OBJECT(event);
+                }
+            }
+        }
+        return dispatched;
+    }
+
+    void NetworkChannel::ClearMainEvent_()
+    {
+        for (auto& main_queue : event2main_)
+        {
+            while (!main_queue->queue.Empty())
+            {
+                GIVE_BACK_OBJECT(main_queue->queue.Pop());
             }
-            event_dispatcher_ ->HandleEvent(event);
-            GIVE_BACK_OBJECT(event);
         }
     }
 
@@ -529,6 +1392,7 @@ namespace ToolBox
 #if defined(__linux__)
                 auto* udp_network = new UdpEpollNetwork();
                 udp_network->Init(this, type, net_thread_index);
+                udp_network->SetSessionDirectory(GetSessionDirectory_(type));
                 return udp_network;
 #endif // __linux__
                 break;
@@ -539,6 +1403,7 @@ namespace ToolBox
                 auto* udp_network = new UdpEpollNetwork();
                 udp_network->Init(this, type, net_thread_index);
                 udp_network->OpenKcpMode();
+                udp_network->SetSessionDirectory(GetSessionDirectory_(type));
                 return udp_network;
 #endif // __linux__
                 break;
@@ -551,10 +1416,38 @@ namespace ToolBox
         return nullptr;
     }
 
-    uint32_t NetworkChannel::GetNetThreadIndex(uint64_t conn_id)
+    UdpSessionDirectory* NetworkChannel::GetSessionDirectory_(NetworkType type)
     {
-        //这里是解码,编码方式见 socket_pool.h  MakeUint32
-        return (conn_id >> 16) & 0x00FF;
+        auto& directory = session_directories_[type];
+        if (nullptr == directory)
+        {
+            // 网络在逻辑线程中建立,此时网络线程尚未写入目录
+            directory = std::make_unique<UdpSessionDirectory>(std::size_t(max_socket_count_) * (std::max)(networks_.size(), std::size_t(1)));
+        }
+        return directory.get();
+    }
+
+    uint32_t NetworkChannel::GetNetThreadIndex(NetworkType type, uint64_t conn_id)
+    {
+        if (NT_UDP == type || NT_KCP == type)
+        {
+            // udp/kcp 的连接ID是会话的地址ID,所在网络线程由会话目录给出
+            uint32_t net_thread_index = 0;
+            uint64_t session_conn_id = 0;
+            auto* directory = session_directories_[type].get();
+            if (nullptr != directory && directory->Find(conn_id, net_thread_index, session_conn_id))
+            {
+                return net_thread_index;
+            }
+            // 不在会话目录中的只能是监听器,非 SO_REUSEPORT 的监听器都在第0个网络线程
+            if (udp_listeners_.contains(conn_id))
+            {
+                return 0;
+            }
+            return INVALID_NET_THREAD_INDEX;
+        }
+        //这里是解码,编码方式见 socket_pool.h  MakeConnID
+        return GetConnIDThreadIndex(conn_id);
     }
 
     void NetworkChannel::JoinIOMultiplexing(NetworkType type, uint64_t opaque, int32_t fd, const std::string& ip, const uint16_t port, int32_t send_buff_size, int32_t recv_buff_size)
@@ -564,10 +1457,7 @@ namespace ToolBox
         event->SetIP(ip);
         event->SetAddressPort(port);
         event->SetBuffSize(send_buff_size, recv_buff_size);
-        static std::default_random_engine dre(time(0));  // 稍微随机些的种子
-        std::uniform_int_distribution<unsigned > uid(0, networks_.size() - 1);
-        uint32_t random_thread_index = uid(dre);
-        NotifyWorker(event, type, random_thread_index);      //随机去某个线程中去连接.
+        NotifyWorker(event, type, SelectNetThread_(opaque, ip, port));      // 按分配策略选择网络线程.
     }
 
     void NetworkChannel::SetSystemMaxOpenFiles()
@@ -618,6 +1508,11 @@ namespace ToolBox
         network_channel_->Update();
     }
 
+    std::size_t Network::SpinUpdate(uint32_t spin_usecs)
+    {
+        return network_channel_->SpinUpdate(spin_usecs);
+    }
+
     void Network::StopWait()
     {
         network_channel_->StopWait();
@@ -633,6 +1528,21 @@ namespace ToolBox
         return network_channel_->Send(conn_id, data, size);
     }
 
+    ENetErrCode Network::Send(uint64_t conn_id, NetBuffer* buffer)
+    {
+        return network_channel_->Send(conn_id, buffer);
+    }
+
+    ENetErrCode Network::Broadcast(const std::vector<uint64_t>& conn_ids, const char* data, uint32_t size)
+    {
+        return network_channel_->Broadcast(conn_ids, data, size);
+    }
+
+    std::vector<NetEventQueueStat> Network::GetEventQueueStats()
+    {
+        return network_channel_->GetEventQueueStats();
+    }
+
     void Network::Accept(NetworkType type, uint64_t opaque, const std::string& ip, uint16_t port, int32_t send_buff_size /*= 0*/, int32_t recv_buff_size /*= 0*/)
     {
         network_channel_->Accept(type, opaque, ip, port, send_buff_size, recv_buff_size);
@@ -648,6 +1558,61 @@ namespace ToolBox
         network_channel_->SetSimulateNagle(packets_num, timeout);
     }
 
+    void Network::SetUdpBatchSize(uint32_t batch_size /*= NETWORK_UDP_BATCH_SIZE*/, uint32_t datagram_size /*= NETWORK_UDP_DATAGRAM_SIZE*/)
+    {
+        network_channel_->SetUdpBatchSize(batch_size, datagram_size);
+    }
+
+    void Network::SetAdaptiveBuffer(bool enable /*= true*/)
+    {
+        network_channel_->SetAdaptiveBuffer(enable);
+    }
+
+    void Network::SetRecvBatch(bool enable /*= true*/)
+    {
+        network_channel_->SetRecvBatch(enable);
+    }
+
+    void Network::SetDecoder(uint64_t opaque, NetDecoderCreator creator)
+    {
+        network_channel_->SetDecoder(opaque, std::move(creator));
+    }
+
+    void Network::SetWorkerBlockingWait(bool enable /*= true*/)
+    {
+        network_channel_->SetWorkerBlockingWait(enable);
+    }
+
+    void Network::SetMaxSocketCount(uint32_t max_socket_count /*= NETWORK_MAX_SOCKET_COUNT*/)
+    {
+        network_channel_->SetMaxSocketCount(max_socket_count);
+    }
+
+    void Network::SetLatencyMode(const NetLatencyMode& mode)
+    {
+        network_channel_->SetLatencyMode(mode);
+    }
+
+    void Network::SetPlacementPolicy(NetPlacementPolicy policy)
+    {
+        network_channel_->SetPlacementPolicy(policy);
+    }
+
+    void Network::SetAcceptMode(NetAcceptMode mode)
+    {
+        network_channel_->SetAcceptMode(mode);
+    }
+
+    NetMetricsSnapshot Network::GetMetricsSnapshot(bool with_connections /*= false*/)
+    {
+        return network_channel_->GetMetricsSnapshot(with_connections);
+    }
+
+    std::vector<NetThreadLoad> Network::GetThreadLoadStats()
+    {
+        return network_channel_->GetThreadLoadStats();
+    }
+
     Network& Network::SetOnBinded(BindedMethod binded_method)
     {
         network_channel_->SetOnBinded(binded_method);
@@ -696,4 +1661,10 @@ namespace ToolBox
         return *this;
     };
 
+    Network& Network::SetOnReceivedBatch(ReceivedBatchMethod receive_batch_method)
+    {
+        network_channel_->SetOnReceivedBatch(receive_batch_method);
+        return *this;
+    };
+
 };  // ToolBox
\ No newline at end of file
@@ -1,4 +1,5 @@
 #pragma once
+#include <array>
 #include <atomic>
 #include <cstdint>
 #include <stdint.h>
@@ -10,6 +11,7 @@
 #include "network/network_api.h"
 #include "network_def_internal.h"
 #include "tools/ringbuffer.h"
+#include "udp_session_directory.h"
 
 namespace ToolBox
 {
@@ -20,7 +22,7 @@ namespace ToolBox
     class EventDispatcher;
 
     /// 事件队列
-    using Event2Main = RingBufferSPSC<NetEventMain*, NETWORK_EVENT_QUEUE_MAX_COUNT>;
+    using Event2Main = RingBufferSPSCCached<NetEventMain*, NETWORK_EVENT_QUEUE_MAX_COUNT>;
     /// 事件处理函数
     using EventHandler = std::function<void(Event* event)>;
     /*
@@ -47,6 +49,12 @@ namespace ToolBox
         */
         virtual void Update();
         /*
+        * @brief 忙等并分发事件,一有事件即返回
+        * @param spin_usecs 最长忙等的微秒数
+        * @return 分发的事件数
+        */
+        std::size_t SpinUpdate(uint32_t spin_usecs);
+        /*
         * @brief 结束并等待工作线程结束,在主线程内调用
         */
         virtual void StopWait();
@@ -66,6 +74,21 @@ namespace ToolBox
         */
         ENetErrCode Send(uint64_t conn_id, const char* data, uint32_t size);
         /*
+        * @brief 通知工作线程发送引用计数缓冲区[零拷贝].长度头已预留在缓冲区中,网络线程直接交给 writev,不再拷贝进发送缓冲区.
+        *        小于 ZERO_COPY_SEND_MIN_SIZE 的包在网络线程内仍走拷贝路径.
+        * @param conn_id 连接id
+        * @param buffer 由 NetBuffer::Create 申请并填充好数据的缓冲区,调用者持有的一个引用被接管,无论成功与否调用后都不可再使用
+        */
+        ENetErrCode Send(uint64_t conn_id, NetBuffer* buffer);
+        /*
+        * @brief 广播:数据只序列化一次,按网络线程分组后每个网络线程只投递一个事件,各连接共享同一个缓冲区
+        * @param conn_ids 目标连接id列表
+        * @param data 被发送数据的指针
+        * @param size 被发送数据的长度
+        * @return 存在无效连接时返回 NET_INVALID_CONNID,有效的连接仍会发送
+        */
+        ENetErrCode Broadcast(const std::vector<uint64_t>& conn_ids, const char* data, uint32_t size);
+        /*
         * 通知网络线程建立一个监听器
         * @param type 网络类型
         * @param opaque 信道标记,主动建立的连接会携带此标记
@@ -85,11 +108,17 @@ namespace ToolBox
         */
         void Connect(NetworkType type, uint64_t opaque, const std::string& ip, uint16_t port, int32_t send_buff_size = 0, int32_t recv_buff_size = 0);
         /*
-        * @brief 网络线程投递事件到逻辑线程接口
+        * @brief 网络线程投递事件到逻辑线程接口.每个网络线程独占一个 SPSC 队列,无需加锁
         * @param event 事件
+        * @param net_thread_index 投递事件的网络线程序号
         * @return bool 是否成功
         */
-        bool NotifyMain(NetEventMain* event);
+        bool NotifyMain(NetEventMain* event, uint32_t net_thread_index);
+        /*
+        * @brief 唤醒阻塞等待中的网络线程,仅在网络线程宣告休眠时才写 eventfd
+        * @param net_thread_index 网络线程序号
+        */
+        void WakeUpWorker(uint32_t net_thread_index);
     public:
         /*
         * @brief 网络库特性:网络线程模拟 Nagle 算法,减少系统调用,代价是在通信不够频繁的情况下可能会增加延迟.
@@ -98,6 +127,74 @@ namespace ToolBox
         * @param timeout 默认超过2毫秒就进行发送.
         */
         void SetSimulateNagle(uint32_t packets_num = 10, uint32_t timeout = 2);
+        /*
+        * @brief 网络库特性:UDP/KCP 批量收发.可读时用 recvmmsg 一次读取多个数据报,发送的数据报(含 KCP 的输出分片)
+        *        攒到网络线程每帧末尾用 sendmmsg 一次发出,减少每个数据报的系统调用.之后建立的网络也会沿用.
+        * @param batch_size 单次批量处理的数据报数量,默认 NETWORK_UDP_BATCH_SIZE,为 1 时退化为逐个数据报 recvfrom/sendto.
+        * @param datagram_size 原始 UDP 批量接收时每个数据报预留的大小
+        */
+        void SetUdpBatchSize(uint32_t batch_size = NETWORK_UDP_BATCH_SIZE, uint32_t datagram_size = NETWORK_UDP_DATAGRAM_SIZE);
+        /*
+        * @brief 设置 TCP 连接的自适应缓冲区
+        */
+        void SetAdaptiveBuffer(bool enable = true);
+        /*
+        * @brief 设置 TCP 批量接收,之后建立的网络也会沿用
+        */
+        void SetRecvBatch(bool enable = true);
+        /*
+        * @brief 设置 opaque 对应的 TCP 消息解码器
+        */
+        void SetDecoder(uint64_t opaque, NetDecoderCreator creator);
+        /*
+        * @brief 网络线程中为新连接创建解码器,没有设置时返回空
+        * @param opaque 监听器/连接器的 opaque
+        */
+        std::unique_ptr<NetDecoder> CreateDecoder(uint64_t opaque);
+        /*
+        * @brief 网络库特性:网络线程空闲时阻塞等待,直到有 io 就绪或逻辑线程投递了事件才被唤醒[默认开启].
+        *        关闭后退化为固定超时的轮询.需在 Start 之前调用.
+        */
+        void SetWorkerBlockingWait(bool enable = true);
+        /*
+        * @brief 设置每个网络线程每种网络最多可以同时存在的 socket 数量.需在 Start 之前调用.
+        */
+        void SetMaxSocketCount(uint32_t max_socket_count = NETWORK_MAX_SOCKET_COUNT);
+        /*
+        * @brief 每个网络线程每种网络最多可以同时存在的 socket 数量,网络线程建立网络时读取
+        */
+        uint32_t GetMaxSocketCount() const
+        {
+            return max_socket_count_;
+        }
+        /*
+        * @brief 设置低延迟模式[cpu 绑定,阻塞前忙轮询,SO_BUSY_POLL].需在 Start 之前调用.
+        */
+        void SetLatencyMode(const NetLatencyMode& mode);
+        /*
+        * @brief 设置新连接在网络线程之间的分配策略,默认随机.监听器仍固定在第0个网络线程
+        * @param policy 分配策略
+        */
+        void SetPlacementPolicy(NetPlacementPolicy policy);
+        /*
+        * @brief 设置 tcp 监听器接受新连接的方式,对之后调用的 Accept 生效,默认 NAM_HANDSHAKE.
+        *        NAM_REUSEPORT 下每个网络线程都会回调一次 OnBinded,且不再回调 OnAccepting,新连接也不经过分配策略.
+        * @param mode 接受新连接的方式
+        */
+        void SetAcceptMode(NetAcceptMode mode);
+        /*
+        * @brief 获取每个网络线程的负载快照,在逻辑线程调用
+        */
+        std::vector<NetThreadLoad> GetThreadLoadStats();
+        /*
+        * @brief 获取每个网络线程与逻辑线程之间事件队列的深度与丢弃统计,在逻辑线程调用
+        */
+        std::vector<NetEventQueueStat> GetEventQueueStats();
+        /*
+        * @brief 获取网络指标快照,在逻辑线程调用
+        * @param with_connections 是否附带各网络线程上一次发布的连接指标,并请求下一次发布
+        */
+        NetMetricsSnapshot GetMetricsSnapshot(bool with_connections = false);
     public: // 回调函数方式的回调
         /*
         * @brief 设置绑定成功的回调
@@ -131,6 +228,10 @@ namespace ToolBox
         * @brief 设置接收的回调
         */
         NetworkChannel& SetOnReceived(ReceivedMethod received_method);
+        /*
+        * @brief 设置批量接收的回调
+        */
+        NetworkChannel& SetOnReceivedBatch(ReceivedBatchMethod received_batch_method);
 
     protected:  // 继承方式的回调
         /*
@@ -218,17 +319,78 @@ namespace ToolBox
 
         /*
         * 处理需要在逻辑线程处理的事件
+        * @return 处理的事件数
+        */
+        std::size_t DispatchMainEvent_();
+        /*
+        * 释放逻辑线程事件队列中未处理的事件
         */
-        void DispatchMainEvent_();
+        void ClearMainEvent_();
+        /*
+        * @brief 建立每个网络线程的等待器[eventfd + 线程级 epoll]
+        */
+        void CreateWorkerWaiters_(std::size_t net_thread_num);
+        /*
+        * @brief 释放网络线程的等待器
+        */
+        void ReleaseWorkerWaiters_();
+        /*
+        * @brief 将网络的 io 多路复用句柄加入网络线程的等待器,在网络线程调用
+        * @return 该网络是否交由等待器统一等待
+        */
+        bool AttachWorkerWaiter_(uint32_t net_thread_index, INetwork* network);
+        /*
+        * @brief 网络线程空闲等待,在网络线程调用
+        * @param blockable 所有网络都已交由等待器时才可阻塞
+        * @param timeout 最长等待毫秒数,-1 为无限等待
+        */
+        void WaitWorker_(uint32_t net_thread_index, bool loaded_network, bool blockable, int32_t timeout);
+        /*
+        * @brief 低延迟模式下阻塞前的忙轮询,在网络线程调用
+        * @param timeout 最长等待毫秒数,-1 为无限等待
+        * @return 忙轮询期间是否有 io 就绪或事件到达
+        */
+        bool SpinWorker_(uint32_t net_thread_index, int32_t timeout);
+        /*
+        * @brief 按低延迟模式的设置把网络线程绑定到 cpu,在网络线程调用
+        */
+        void PinWorker_(uint32_t net_thread_index);
+        /*
+        * @brief 按分配策略为新连接选择网络线程
+        * @param opaque 信道标记
+        * @param ip 远端ip
+        * @param port 远端端口
+        */
+        uint32_t SelectNetThread_(uint64_t opaque, const std::string& ip, uint16_t port);
+        /*
+        * @brief 汇总单个网络线程内各网络发布的计数
+        */
+        NetThreadLoad CollectThreadLoad_(uint32_t net_thread_index);
+        /*
+        * @brief 统计窗口到期时滚动窗口
+        */
+        void RollLoadWindow_();
+        /*
+        * @brief 按网络线程数量建立一致性哈希环
+        */
+        void BuildHashRing_(std::size_t net_thread_num);
         /*
         * 根据类型获取网络实例
         * @param type 网络类型
         */
         INetwork* GetNetwork_(NetworkType type, uint32_t net_thread_index);
         /*
+        * @brief 获取 udp/kcp 的会话目录,不存在时建立
+        * @param type 网络类型
+        */
+        UdpSessionDirectory* GetSessionDirectory_(NetworkType type);
+        /*
         * @brief 根据connid获取网络线程序号
+        * @param type 网络类型, udp/kcp 的会话按会话目录查找
+        * @param conn_id 连接ID
+        * @return 网络线程序号,找不到 udp/kcp 会话或监听器时返回 INVALID_NET_THREAD_INDEX
         */
-        uint32_t GetNetThreadIndex(uint64_t conn_id);
+        uint32_t GetNetThreadIndex(NetworkType type, uint64_t conn_id);
 
         /*
         * @brief 将文件描述符加入
@@ -241,14 +403,61 @@ namespace ToolBox
         void SetSystemMaxOpenFiles();
 
     private:
-        Event2Main event2main_;     // 主线程网络事件队列
+        /*
+        * 单个网络线程到逻辑线程的事件队列及其统计
+        */
+        struct MainEventQueue
+        {
+            Event2Main queue;                           // 事件队列,网络线程写,逻辑线程读
+            std::atomic<std::size_t> max_depth = 0;     // 历史最大深度
+            std::atomic<uint64_t> pushed = 0;           // 累计投递数量
+            std::atomic<uint64_t> dropped = 0;          // 队列满丢弃数量
+        };
+        std::vector<std::unique_ptr<MainEventQueue>> event2main_;     // 主线程网络事件队列,每个网络线程一个
+        /*
+        * 单个网络线程的等待器.网络线程把 eventfd 与各网络的 io 多路复用句柄放进同一个线程级 epoll 阻塞等待,
+        * 逻辑线程投递事件后,仅当网络线程宣告休眠时才写 eventfd 唤醒,避免每个事件都产生一次系统调用.
+        */
+        struct WorkerWaiter
+        {
+            int32_t event_fd = -1;                      // 唤醒用的 eventfd
+            int32_t poll_fd = -1;                       // 线程级 epoll
+            std::atomic_bool sleeping = false;          // 网络线程是否即将/正在阻塞
+            std::array<int8_t, NT_MAX> attached {};     // 各网络的等待句柄状态: 0 尚未加入; 1 已加入; -1 不支持
+        };
+        std::vector<std::unique_ptr<WorkerWaiter>> waiters_;    // 网络线程等待器,每个网络线程一个
+        bool blocking_wait_ = true;     // 网络线程空闲时是否阻塞等待
+        uint32_t max_socket_count_ = NETWORK_MAX_SOCKET_COUNT;  // 每个网络线程每种网络的 socket 数量上限
+        NetLatencyMode latency_mode_;   // 低延迟模式的参数
+        /*
+        * 逻辑线程维护的单个网络线程负载状态
+        */
+        struct NetThreadLoadState
+        {
+            uint64_t window_start_bytes = 0;    // 窗口开始时的累计收发字节数
+            uint64_t window_bytes = 0;          // 上一个完整窗口内的收发字节数
+            uint64_t placed = 0;                // 累计分配的连接数
+        };
+        NetPlacementPolicy placement_policy_ = NPP_RANDOM;      // 新连接分配策略
+        NetAcceptMode accept_mode_ = NAM_HANDSHAKE;             // 监听器接受新连接的方式
+        bool recv_batch_ = false;                               // tcp 是否批量接收
+        uint32_t udp_batch_size_ = NETWORK_UDP_BATCH_SIZE;      // udp/kcp 单次批量收发的数据报数量
+        uint32_t udp_datagram_size_ = NETWORK_UDP_DATAGRAM_SIZE;    // udp 批量接收时每个数据报预留的大小
+        std::mutex decoder_mutex_;                              // 保护 decoder_creators_,网络线程建立连接时读取
+        std::unordered_map<uint64_t, NetDecoderCreator> decoder_creators_;  // opaque 到 tcp 消息解码器的映射
+        std::atomic_bool has_decoder_ = false;                  // 是否设置过解码器,未设置时建立连接不加锁
+        std::vector<NetThreadLoadState> thread_loads_;          // 各网络线程的负载状态
+        std::time_t load_window_start_ = 0;                     // 当前统计窗口的开始时间
+        std::vector<std::pair<uint64_t, uint32_t>> hash_ring_;  // 一致性哈希环: 哈希值 -> 网络线程序号
         EventDispatcher* event_dispatcher_;  // 事件分发器
-        std::mutex lock_;           // 多网络线程需要锁.
         std::atomic_bool stop_;     // 网络线程是否退出
         std::vector<std::unique_ptr<std::thread>> workers_;   // 工作线程,执行网络动作.
         using NetworkArray = std::vector<std::array<std::unique_ptr<INetwork>, NetworkType::NT_MAX>>;
         NetworkArray networks_;     // 网络实现
         std::unordered_map<uint64_t, NetworkType> conn_type_;   // conn_id 到 NetworkType的映射
+        std::unordered_map<uint64_t, bool> udp_listeners_;      // udp/kcp 监听器的 conn_id 到是否以 SO_REUSEPORT 监听的映射,监听器不在会话目录中
+        std::array<std::unique_ptr<UdpSessionDirectory>, NetworkType::NT_MAX> session_directories_;  // udp/kcp 会话所在网络线程的目录,按网络类型区分
+        std::vector<std::vector<uint64_t>> broadcast_groups_;   // 广播时按 网络线程*NT_MAX+网络类型 分组的连接,复用以减少分配
         std::vector<std::tuple<uint32_t, NetworkType, NetEventWorker*>> cached_event_to_worker_; // 当网络线程没有建立时,缓存发往网络线程的事件.以消除 Start 与 Connect/Accept 之间的先后依赖性
     private:    // 回调函数
         BindedMethod binded_;           // 绑定的回调
@@ -259,6 +468,7 @@ namespace ToolBox
         ErroredMethod errored_;         // 发生错误
         CloseMethod close_;             // 关闭事件的回调
         ReceivedMethod received_;       // 接收事件
+        ReceivedBatchMethod received_batch_;    // 批量接收事件
     };
 
 };  // ToolBox
\ No newline at end of file
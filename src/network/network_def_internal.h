@@ -1,8 +1,10 @@
 #pragma once
 #include "tools/object_pool.h"
 #include "tools/object_pool_lock_free.h"
+#include "tools/object_pool_thread_local.h"
 #include "tools/memory_pool.h"
 #include "tools/memory_pool_lock_free.h"
+#include "tools/memory_pool_thread_cache.h"
 #include "tools/log.h"
 #include "network/network_def.h"
 namespace ToolBox
@@ -75,17 +77,17 @@ namespace ToolBox
 #define NUM_OF_CACHED_EVENT_TO_WORKER 1024  // 逻辑线程缓存的即将发向网络线程的事件个数
 
     /************************************************************
-    **********     网络库获取对象的三种方法       ****************
+    **********     网络库获取对象的四种方法       ****************
     ************************************************************/
 
     // 宏定义获取对象的方法[调用入口]
 #define GET_NET_OBJECT(OBJECT_TYPE, ...) \
-    GET_NET_OBJECT_RAW(OBJECT_TYPE, __VA_ARGS__)
+    GET_NET_OBJECT_OPTL(OBJECT_TYPE, __VA_ARGS__)
     // 宏定义释放对象的方法[调用入口]
 #define GIVE_BACK_OBJECT(POINTER)   \
-    GIVE_BACK_OBJECT_RAW(POINTER)
+    GIVE_BACK_OBJECT_OPTL(POINTER)
 
-    //-----------[下面是三种内部实现选项]-----------------
+    //-----------[下面是四种内部实现选项]-----------------
 
     // 宏定义获取原生网络事件对象[选项1]
 #define GET_NET_OBJECT_RAW(OBJECT_TYPE, ...) \
@@ -109,18 +111,25 @@ namespace ToolBox
 #define GIVE_BACK_OBJECT_OPLF(POINTER)  \
     GiveBackObjectLockFree(POINTER);
 
+    // 宏定义从线程本地对象池中获取网络事件对象[选项4]
+#define GET_NET_OBJECT_OPTL(OBJECT_TYPE, ...) \
+    GetObjectThreadLocal<OBJECT_TYPE>(__VA_ARGS__)
+    // 宏定义释放对象到线程本地对象池中[选项4],跨线程归还的对象按批还给分配它的线程
+#define GIVE_BACK_OBJECT_OPTL(POINTER)  \
+    GiveBackObjectThreadLocal(POINTER);
+
     /************************************************************
-    **********     网络库获取内存的三种方法       ****************
+    **********     网络库获取内存的四种方法       ****************
     ************************************************************/
 
     // 宏定义获取对象的方法[调用入口]
 #define GET_NET_MEMORY(SIZE) \
-    GET_NET_MEMORY_RAW(SIZE)
+    GET_NET_MEMORY_MPTC(SIZE)
     // 宏定义释放对象的方法[调用入口]
 #define GIVE_BACK_MEMORY(POINTER, ...)   \
-    GIVE_BACK_MEMORY_RAW(POINTER, __VA_ARGS__)
+    GIVE_BACK_MEMORY_MPTC(POINTER, __VA_ARGS__)
 
-    //-----------[下面是三种内部实现选项]-----------------
+    //-----------[下面是四种内部实现选项]-----------------
 
     // 宏定义获取原生内存[选项1]
 #define GET_NET_MEMORY_RAW(SIZE) \
@@ -144,5 +153,12 @@ namespace ToolBox
 #define GIVE_BACK_OBJECT_MPLF(POINTER,...)  \
     MemPoolLockFreeMgr->GiveBack((char*)POINTER, __VA_ARGS__);
 
+    // 宏定义从线程缓存内存池中获取内存[选项4]
+#define GET_NET_MEMORY_MPTC(SIZE) \
+    MemPoolThreadCacheMgr->GetMemory(SIZE)
+    // 宏定义释放内存到线程缓存内存池中[选项4],网络线程申请、逻辑线程释放时不加锁
+#define GIVE_BACK_MEMORY_MPTC(POINTER,...)  \
+    MemPoolThreadCacheMgr->GiveBack((char*)POINTER);
+
 };  // ToolBox
 
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "network/net_imp/net_imp_define.h"
+
+namespace ToolBox
+{
+
+    /*
+    * @brief UDP/KCP 会话目录: 远端地址ID(UdpAddress::GetID) -> 所属网络线程与连接ID.
+    * 多个网络线程各自以 SO_REUSEPORT 监听同一端口时,同一远端固定落在某个网络线程上,
+    * 网络线程建立/关闭会话时写入目录,逻辑线程按目录把发送、关闭等事件路由到会话所在的网络线程.
+    *
+    * 无锁的开放寻址哈希表,容量固定:
+    * 槽位的 key 一旦占用不再清空,删除只把 value 置为 0,之后可被其他 key 回收;
+    * value 的 CAS 决定槽位归属,回收时先把 value 置为保留值,再改写 key,避免与同 key 的重新写入冲突.
+    * 同一个地址ID同一时刻只由一个网络线程写入.
+    */
+    class UdpSessionDirectory
+    {
+    public:
+        /*
+        * @brief 构造
+        * @param capacity 最多同时存在的会话数量,实际槽位数为其 2 倍向上取 2 的幂
+        */
+        explicit UdpSessionDirectory(std::size_t capacity)
+        {
+            std::size_t slot_count = 16;
+            while (slot_count < capacity * 2)
+            {
+                slot_count <<= 1;
+            }
+            mask_ = slot_count - 1;
+            slots_ = std::make_unique<Slot[]>(slot_count);
+        }
+        /*
+        * @brief 写入会话,已存在时覆盖
+        * @param address_id 地址ID,不能为 0
+        * @param conn_id 会话在网络线程内的连接ID,其中编码了所在的网络线程
+        * @return 目录已满时返回 false
+        */
+        bool Insert(uint64_t address_id, uint64_t conn_id)
+        {
+            if (EMPTY_KEY == address_id)
+            {
+                return false;
+            }
+            uint64_t value = MakeValue(conn_id);
+            // 已存在(含已删除)的同 key 槽位直接复用
+            for (std::size_t i = Hash(address_id), probes = 0; probes <= mask_; i = (i + 1) & mask_, probes++)
+            {
+                uint64_t key = slots_[i].key.load(std::memory_order_acquire);
+                if (EMPTY_KEY == key)
+                {
+                    break;
+                }
+                if (key != address_id)
+                {
+                    continue;
+                }
+                uint64_t old_value = slots_[i].value.load(std::memory_order_acquire);
+                while (RESERVED_VALUE != old_value)
+                {
+                    if (slots_[i].value.compare_exchange_weak(old_value, value, std::memory_order_acq_rel))
+                    {
+                        if (slots_[i].key.load(std::memory_order_acquire) == address_id)
+                        {
+                            if (DELETED_VALUE == old_value)
+                            {
+                                size_.fetch_add(1, std::memory_order_relaxed);
+                            }
+                            return true;
+                        }
+                        // 比较期间槽位被回收给了其他 key 又被删除,把它恢复为已删除状态
+                        slots_[i].value.store(DELETED_VALUE, std::memory_order_release);
+                        break;
+                    }
+                }
+            }
+            // 占用一个空槽位或回收一个已删除的槽位
+            for (std::size_t i = Hash(address_id), probes = 0; probes <= mask_; i = (i + 1) & mask_, probes++)
+            {
+                uint64_t key = slots_[i].key.load(std::memory_order_acquire);
+                if (EMPTY_KEY == key)
+                {
+                    if (claimed_.load(std::memory_order_relaxed) * 4 >= (mask_ + 1) * 3)
+                    {
+                        // 负载过高,探测链太长
+                        return false;
+                    }
+                    uint64_t expected = DELETED_VALUE;
+                    if (!slots_[i].value.compare_exchange_strong(expected, RESERVED_VALUE, std::memory_order_acq_rel))
+                    {
+                        continue;
+                    }
+                    uint64_t empty_key = EMPTY_KEY;
+                    if (!slots_[i].key.compare_exchange_strong(empty_key, address_id, std::memory_order_acq_rel))
+                    {
+                        // 持有保留值期间 key 不会被他人改写,保险起见归还槽位
+                        slots_[i].value.store(DELETED_VALUE, std::memory_order_release);
+                        continue;
+                    }
+                    claimed_.fetch_add(1, std::memory_order_relaxed);
+                    slots_[i].value.store(value, std::memory_order_release);
+                    size_.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+                uint64_t expected = DELETED_VALUE;
+                if (slots_[i].value.load(std::memory_order_acquire) != DELETED_VALUE
+                        || !slots_[i].value.compare_exchange_strong(expected, RESERVED_VALUE, std::memory_order_acq_rel))
+                {
+                    continue;
+                }
+                slots_[i].key.store(address_id, std::memory_order_release);
+                slots_[i].value.store(value, std::memory_order_release);
+                size_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            return false;
+        }
+        /*
+        * @brief 删除会话
+        * @param address_id 地址ID
+        */
+        void Erase(uint64_t address_id)
+        {
+            for (std::size_t i = Hash(address_id), probes = 0; probes <= mask_; i = (i + 1) & mask_, probes++)
+            {
+                uint64_t key = slots_[i].key.load(std::memory_order_acquire);
+                if (EMPTY_KEY == key)
+                {
+                    return;
+                }
+                if (key != address_id)
+                {
+                    continue;
+                }
+                uint64_t value = slots_[i].value.load(std::memory_order_acquire);
+                if (DELETED_VALUE == value || RESERVED_VALUE == value)
+                {
+                    continue;
+                }
+                if (slots_[i].value.compare_exchange_strong(value, DELETED_VALUE, std::memory_order_acq_rel))
+                {
+                    size_.fetch_sub(1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+        }
+        /*
+        * @brief 查找会话
+        * @param address_id 地址ID
+        * @param net_thread_index 会话所在的网络线程
+        * @param conn_id 会话在网络线程内的连接ID
+        * @return 是否找到
+        */
+        bool Find(uint64_t address_id, uint32_t& net_thread_index, uint64_t& conn_id) const
+        {
+            for (std::size_t i = Hash(address_id), probes = 0; probes <= mask_; i = (i + 1) & mask_, probes++)
+            {
+                uint64_t key = slots_[i].key.load(std::memory_order_acquire);
+                if (EMPTY_KEY == key)
+                {
+                    return false;
+                }
+                if (key != address_id)
+                {
+                    continue;
+                }
+                uint64_t value = slots_[i].value.load(std::memory_order_acquire);
+                // 读取 value 期间槽位可能被回收给其他 key,需要再确认一次
+                if (DELETED_VALUE == value || RESERVED_VALUE == value || slots_[i].key.load(std::memory_order_acquire) != address_id)
+                {
+                    continue;
+                }
+                conn_id = value - 1;
+                net_thread_index = GetConnIDThreadIndex(conn_id);
+                return true;
+            }
+            return false;
+        }
+        /*
+        * @brief 当前会话数量
+        */
+        std::size_t Size() const
+        {
+            return size_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        /*
+        * @brief value 的编码: 连接ID + 1,保证非 0.连接ID的最高位保留为 0,加 1 后也不会与保留值冲突
+        */
+        static uint64_t MakeValue(uint64_t conn_id)
+        {
+            return conn_id + 1;
+        }
+        /*
+        * @brief 地址ID的低位是端口,高位是ip,先打散再取槽位
+        */
+        std::size_t Hash(uint64_t address_id) const
+        {
+            uint64_t x = address_id + 0x9E3779B97F4A7C15ULL;
+            x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+            return static_cast<std::size_t>(x ^ (x >> 31)) & mask_;
+        }
+
+    private:
+        static constexpr uint64_t EMPTY_KEY = 0;                // 空槽位
+        static constexpr uint64_t DELETED_VALUE = 0;            // 已删除,可被回收
+        static constexpr uint64_t RESERVED_VALUE = UINT64_MAX;  // 正在被回收
+        /*
+        * 槽位
+        */
+        struct Slot
+        {
+            std::atomic<uint64_t> key = EMPTY_KEY;      // 地址ID
+            std::atomic<uint64_t> value = DELETED_VALUE;    // 网络线程序号与连接ID
+        };
+        std::unique_ptr<Slot[]> slots_;                 // 槽位数组
+        std::size_t mask_ = 0;                          // 槽位数 - 1
+        std::atomic<std::size_t> claimed_ = 0;          // 已占用 key 的槽位数量
+        std::atomic<std::size_t> size_ = 0;             // 会话数量
+    };
+
+};  // ToolBox
@@ -600,4 +600,32 @@ CASE(TestPerformanceManyTasks) {
     fprintf(stderr, "cpp20 coroutine. expected sum: %d\n", task_count * (task_count - 1) / 2);
 }
 
+// ============================================================================
+// 执行器关闭测试用例
+// ============================================================================
+
+template<typename Executor>
+static bool ExecutorShutdownDrains(int32_t count) {
+    std::atomic<int32_t> executed = 0;
+    Executor executor;
+    for (int32_t i = 0; i < count; ++i) {
+        executor.execute([&executed] { executed.fetch_add(1, std::memory_order_relaxed); });
+    }
+    executor.shutdown(true);
+    executor.join();
+    // 关闭后不再接受新任务
+    executor.execute([&executed] { executed.fetch_add(1, std::memory_order_relaxed); });
+    return executed.load() == count;
+}
+
+CASE(TestExecutorShutdownWaitForComplete) {
+    // shutdown(true) 先执行完队列中的任务再退出事件循环
+    if (!ExecutorShutdownDrains<ToolBox::coro::RingBufferSPSCEventExecutor>(1000)) {
+        SetError("RingBufferSPSCEventExecutor shutdown(true) 丢弃了未执行的任务.");
+    }
+    if (!ExecutorShutdownDrains<ToolBox::coro::LooperExecutor>(1000)) {
+        SetError("LooperExecutor shutdown(true) 丢弃了未执行的任务.");
+    }
+}
+
 FIXTURE_END(TestCpp20Coroutine)
\ No newline at end of file
@@ -1,5 +1,10 @@
 #include "src/network/network_channel.h"
+#include "network/network_api.h"
 #include "unit_test_frame/unittest.h"
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
 #ifdef USE_GPERF_TOOLS
 #include <gperftools/profiler.h>
 #endif // USE_GPERF_TOOLS
@@ -219,6 +224,174 @@ CASE(test_kcp_forward)
     return;
 }
 
+/*
+* 统计所有网络线程累计的 ikcp_update 调用次数
+*/
+static uint64_t GetKcpUpdates(ToolBox::Network& network)
+{
+    uint64_t kcp_updates = 0;
+    for (const auto& load : network.GetThreadLoadStats())
+    {
+        kcp_updates += load.kcp_updates;
+    }
+    return kcp_updates;
+}
+
+CASE(test_kcp_idle_sessions)
+{
+    /*
+    * 本机回环测试 kcp 会话的调度: 收发完成后空闲的会话不再被每帧更新,更新次数只与活跃会话相关
+    */
+    fprintf(stderr, "网络库测试用例: test_kcp_idle_sessions \n");
+    const uint32_t session_num = 200;
+    std::vector<uint64_t> client_conn_ids;
+    uint32_t received = 0;
+    uint32_t echoed = 0;
+    ToolBox::Network network_server;
+    ToolBox::Network network_client;
+    network_server.SetOnReceived([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, const char* data, size_t size)
+    {
+        received++;
+        network_server.Send(conn_id, data + sizeof(uint32_t), size - sizeof(uint32_t));
+    });
+    network_client.SetOnConnected([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id)
+    {
+        client_conn_ids.emplace_back(conn_id);
+    });
+    network_client.SetOnReceived([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, const char* data, size_t size)
+    {
+        echoed++;
+    });
+    network_server.Accept(ToolBox::NT_KCP, 9720, "127.0.0.1", 9720);
+    network_server.Start(1);
+    network_client.Start(1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    for (uint32_t i = 0; i < session_num; i++)
+    {
+        network_client.Connect(ToolBox::NT_KCP, 9720, "127.0.0.1", 9720);
+    }
+    for (uint32_t i = 0; i < 1000 && client_conn_ids.size() < session_num; i++)
+    {
+        network_client.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const char ping[] = "kcp idle session";
+    for (auto conn_id : client_conn_ids)
+    {
+        network_client.Send(conn_id, ping, sizeof(ping));
+    }
+    for (uint32_t i = 0; i < 3000 && echoed < session_num; i++)
+    {
+        network_server.Update();
+        network_client.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (received != session_num || echoed != session_num)
+    {
+        SetError("kcp 会话收发不完整.");
+    }
+    // 等待最后的 ack 发出,会话进入空闲
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    uint64_t server_updates = GetKcpUpdates(network_server);
+    uint64_t client_updates = GetKcpUpdates(network_client);
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    uint64_t server_idle_updates = GetKcpUpdates(network_server) - server_updates;
+    uint64_t client_idle_updates = GetKcpUpdates(network_client) - client_updates;
+    fprintf(stderr, "[kcp] 会话数:%u 活跃期更新次数 服务器:%llu 客户端:%llu, 空闲 500ms 内更新次数 服务器:%llu 客户端:%llu\n", session_num,
+            (unsigned long long)server_updates, (unsigned long long)client_updates,
+            (unsigned long long)server_idle_updates, (unsigned long long)client_idle_updates);
+    // 每帧更新所有会话时,空闲 500ms 内的更新次数约为 会话数 * 50
+    if (server_idle_updates + client_idle_updates >= session_num)
+    {
+        SetError("空闲的 kcp 会话仍在被定时更新.");
+    }
+    network_client.StopWait();
+    network_server.StopWait();
+}
+
+CASE(test_kcp_reuseport)
+{
+    /*
+    * 本机回环测试多网络线程的 kcp 服务器: 各网络线程以 SO_REUSEPORT 监听同一端口,会话分散到多个线程上,回包按会话目录路由
+    */
+    fprintf(stderr, "网络库测试用例: test_kcp_reuseport \n");
+    const uint32_t server_thread_num = 4;
+    const uint32_t session_num = 64;
+    const uint32_t round_num = 20;
+    std::vector<uint64_t> client_conn_ids;
+    uint32_t received = 0;
+    uint32_t echoed = 0;
+    ToolBox::Network network_server;
+    ToolBox::Network network_client;
+    network_server.SetOnReceived([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, const char* data, size_t size)
+    {
+        received++;
+        network_server.Send(conn_id, data + sizeof(uint32_t), size - sizeof(uint32_t));
+    });
+    network_client.SetOnConnected([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id)
+    {
+        client_conn_ids.emplace_back(conn_id);
+    });
+    network_client.SetOnReceived([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, const char* data, size_t size)
+    {
+        echoed++;
+    });
+    network_server.SetAcceptMode(ToolBox::NAM_REUSEPORT);
+    network_server.Accept(ToolBox::NT_KCP, 9721, "127.0.0.1", 9721);
+    network_server.Start(server_thread_num);
+    network_client.Start(2);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    for (uint32_t i = 0; i < session_num; i++)
+    {
+        network_client.Connect(ToolBox::NT_KCP, 9721, "127.0.0.1", 9721);
+    }
+    for (uint32_t i = 0; i < 1000 && client_conn_ids.size() < session_num; i++)
+    {
+        network_client.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (client_conn_ids.size() != session_num)
+    {
+        SetError("kcp 会话建立不完整.");
+    }
+    const char ping[] = "kcp reuseport session";
+    auto begin = std::chrono::steady_clock::now();
+    for (uint32_t round = 0; round < round_num; round++)
+    {
+        for (auto conn_id : client_conn_ids)
+        {
+            network_client.Send(conn_id, ping, sizeof(ping));
+        }
+    }
+    uint32_t expect = session_num * round_num;
+    for (uint32_t i = 0; i < 5000 && echoed < expect; i++)
+    {
+        network_server.Update();
+        network_client.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    auto cost_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count();
+    uint32_t busy_thread_num = 0;
+    for (const auto& load : network_server.GetThreadLoadStats())
+    {
+        // 连接数不含监听器,即为分到此线程的会话
+        fprintf(stderr, "[kcp] 服务器网络线程:%u 会话数:%u 接收字节:%llu\n", load.net_thread_index, load.connections,
+                (unsigned long long)load.recv_bytes);
+        busy_thread_num += load.connections > 0 ? 1 : 0;
+    }
+    fprintf(stderr, "[kcp] 会话数:%u 收到:%u 回显:%u 耗时:%lldms\n", session_num, received, echoed, (long long)cost_ms);
+    if (received != expect || echoed != expect)
+    {
+        SetError("kcp 会话收发不完整.");
+    }
+    if (busy_thread_num < 2)
+    {
+        SetError("kcp 会话没有分散到多个网络线程.");
+    }
+    network_client.StopWait();
+    network_server.StopWait();
+}
+
 FIXTURE_END(KcpEpollNetwork)
 
 #endif // __linux__
@@ -0,0 +1,182 @@
+#include "tools/memory_pool_thread_cache.h"
+#include "tools/memory_pool_lock_free.h"
+#include "tools/ringbuffer.h"
+#include "unit_test_frame/unittest.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <thread>
+#include <vector>
+
+FIXTURE_BEGIN(MemPoolThreadCache)
+
+CASE(TestMemPoolThreadCacheSizeClass)
+{
+    /*
+    * 测试分级: 级别单调递增,内存块不小于申请大小,128 字节以上最多浪费 25%
+    */
+    std::size_t last_size = 0;
+    for (uint32_t index = 0; index < ToolBox::ThreadCacheSizeClass::CLASS_COUNT; index++)
+    {
+        std::size_t size = ToolBox::ThreadCacheSizeClass::Size(index);
+        if (size <= last_size || ToolBox::ThreadCacheSizeClass::Index(size) != index)
+        {
+            SetError("级别与内存块大小不对应.");
+        }
+        last_size = size;
+    }
+    if (ToolBox::ThreadCacheSizeClass::MAX_SIZE != last_size)
+    {
+        SetError("最大级别的内存块大小错误.");
+    }
+    for (std::size_t size = 1; size <= ToolBox::ThreadCacheSizeClass::MAX_SIZE; size++)
+    {
+        std::size_t alloc_size = ToolBox::MemoryPoolThreadCache::AllocSize(size);
+        if (alloc_size < size || (size > 128 && alloc_size * 4 > size * 5 + 4))
+        {
+            SetError("内存块大小不满足申请或浪费过多.");
+            break;
+        }
+    }
+}
+
+CASE(TestMemPoolThreadCache1)
+{
+    /*
+    * 测试申请归还: 小内存块复用,大内存块直接向系统申请与归还
+    */
+    char* mem = ToolBox::MemPoolThreadCacheMgr->GetMemory(1);
+    memset(mem, 'a', 1);
+    ToolBox::MemPoolThreadCacheMgr->GiveBack(mem);
+    char* again = ToolBox::MemPoolThreadCacheMgr->GetMemory(8);
+    if (again != mem)
+    {
+        SetError("同级别的内存块没有被复用.");
+    }
+    ToolBox::MemPoolThreadCacheMgr->GiveBack(again);
+
+    std::size_t mapped = ToolBox::MemPoolThreadCacheMgr->GetMappedBytes();
+    mem = ToolBox::MemPoolThreadCacheMgr->GetMemory(2 * 1000 * 1000);
+    memset(mem, 'b', 2 * 1000 * 1000);
+    if (ToolBox::MemPoolThreadCacheMgr->GetMappedBytes() < mapped + 2 * 1000 * 1000)
+    {
+        SetError("大内存块统计错误.");
+    }
+    ToolBox::MemPoolThreadCacheMgr->GiveBack(mem);
+    if (ToolBox::MemPoolThreadCacheMgr->GetMappedBytes() != mapped)
+    {
+        SetError("大内存块没有归还给系统.");
+    }
+}
+
+/*
+* 网络库的使用模式: 网络线程申请并写入,经 SPSC 队列交给逻辑线程读取后释放,返回耗时微秒
+*/
+static int64_t RunProducerConsumer(const std::vector<uint32_t>& sizes, std::function<char*(std::size_t)> alloc, std::function<void(char*)> free, bool& bad)
+{
+    static ToolBox::RingBufferSPSC<char*, 4096> queue;
+    auto begin = std::chrono::steady_clock::now();
+    std::thread producer([&]()
+    {
+        for (uint32_t size : sizes)
+        {
+            char* mem = alloc(size);
+            memset(mem, char(size), size);
+            while (queue.Full())
+            {
+                std::this_thread::yield();
+            }
+            queue.Push(std::move(mem));
+        }
+    });
+    std::thread consumer([&]()
+    {
+        for (uint32_t size : sizes)
+        {
+            while (queue.Empty())
+            {
+                std::this_thread::yield();
+            }
+            char* mem = queue.Pop();
+            if (mem[0] != char(size) || mem[size - 1] != char(size))
+            {
+                bad = true;
+            }
+            free(mem);
+        }
+    });
+    producer.join();
+    consumer.join();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+}
+
+CASE(TestMemPoolThreadCacheBenchmark)
+{
+    /*
+    * 跨线程申请释放的性能对比: 线程缓存内存池、现有无锁内存池、new、malloc,以及按分级/2的幂取整的内存占用
+    */
+    const uint32_t count = 1000000;
+    std::mt19937 random(20260101);
+    std::vector<uint32_t> sizes(count);
+    uint64_t requested = 0, class_bytes = 0, pow2_bytes = 0;
+    for (auto& size : sizes)
+    {
+        // 网络消息以小包为主,夹杂少量大包
+        size = random() % 10 == 0 ? 1024 + random() % 15360 : 16 + random() % 496;
+        requested += size;
+        class_bytes += ToolBox::MemoryPoolThreadCache::AllocSize(size);
+        std::size_t pow2 = 1;
+        while (pow2 < size + sizeof(uint32_t))
+        {
+            pow2 <<= 1;
+        }
+        pow2_bytes += pow2;
+    }
+    bool bad = false;
+    int64_t thread_cache_us = RunProducerConsumer(sizes, [](std::size_t size)
+    {
+        return ToolBox::MemPoolThreadCacheMgr->GetMemory(size);
+    }, [](char* mem)
+    {
+        ToolBox::MemPoolThreadCacheMgr->GiveBack(mem);
+    }, bad);
+    // ENABLE_MEMORY_POOL_LOCK_FREE 为 0 时退化为 2的幂取整后 new
+    int64_t lock_free_us = RunProducerConsumer(sizes, [](std::size_t size)
+    {
+        return ToolBox::MemPoolLockFreeMgr->GetMemory(size);
+    }, [](char* mem)
+    {
+        ToolBox::MemPoolLockFreeMgr->GiveBack(mem);
+    }, bad);
+    int64_t new_us = RunProducerConsumer(sizes, [](std::size_t size)
+    {
+        return new char[size];
+    }, [](char* mem)
+    {
+        delete[] mem;
+    }, bad);
+    int64_t malloc_us = RunProducerConsumer(sizes, [](std::size_t size)
+    {
+        return static_cast<char*>(malloc(size));
+    }, [](char* mem)
+    {
+        free(mem);
+    }, bad);
+    fprintf(stderr, "[内存池] %u 次跨线程申请释放, 线程缓存:%lldms 无锁内存池:%lldms new:%lldms malloc:%lldms\n", count,
+            (long long)thread_cache_us / 1000, (long long)lock_free_us / 1000, (long long)new_us / 1000, (long long)malloc_us / 1000);
+    fprintf(stderr, "[内存池] 申请 %llu 字节, 分级占用 %llu 字节(%.1f%%), 2的幂取整占用 %llu 字节(%.1f%%), 向系统申请 %zu 字节\n",
+            (unsigned long long)requested, (unsigned long long)class_bytes, 100.0 * class_bytes / requested,
+            (unsigned long long)pow2_bytes, 100.0 * pow2_bytes / requested, ToolBox::MemPoolThreadCacheMgr->GetMappedBytes());
+    if (bad)
+    {
+        SetError("跨线程传递的内存内容错误.");
+    }
+    if (class_bytes >= pow2_bytes)
+    {
+        SetError("分级占用没有少于2的幂取整.");
+    }
+}
+
+FIXTURE_END(MemPoolThreadCache)
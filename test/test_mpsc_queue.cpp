@@ -0,0 +1,290 @@
+#include "tools/mpsc_queue.h"
+#include "unit_test_frame/unittest.h"
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+FIXTURE_BEGIN(MPSCQueue)
+
+/*
+* 多个生产者各自按序投递,消费者检查每个生产者的数据都按序到达且不丢不重
+*/
+static bool CheckProducerOrder(const std::vector<uint64_t>& received, uint32_t producers, uint64_t per_producer)
+{
+    std::vector<uint64_t> next(producers, 0);
+    for (uint64_t value : received)
+    {
+        uint32_t producer = uint32_t(value >> 32);
+        if (producer >= producers || (value & 0xFFFFFFFF) != next[producer])
+        {
+            return false;
+        }
+        next[producer]++;
+    }
+    for (uint64_t count : next)
+    {
+        if (count != per_producer)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+CASE(mpsc_ring_multi_producer)
+{
+    /*
+    * 测试有界多生产者单消费者队列: 队列远小于数据量,生产者在队列满时重试
+    */
+    const uint32_t producers = 4;
+    const uint64_t per_producer = 200000;
+    auto queue = std::make_unique<ToolBox::MPSCRingBuffer<uint64_t, 1000>>();
+    if (1024 != queue->CAPACITY)
+    {
+        SetError("MPSCRingBuffer 长度没有取2的幂.");
+    }
+    std::vector<std::thread> threads;
+    for (uint32_t producer = 0; producer < producers; producer++)
+    {
+        threads.emplace_back([&, producer]()
+        {
+            for (uint64_t seq = 0; seq < per_producer; seq++)
+            {
+                while (!queue->Push((uint64_t(producer) << 32) | seq))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    std::vector<uint64_t> received;
+    received.reserve(producers * per_producer);
+    uint64_t batch[64];
+    while (received.size() < producers * per_producer)
+    {
+        std::size_t count = received.size() % 2 ? queue->PopBulk(batch, 64) : (queue->Empty() ? 0 : (batch[0] = queue->Pop(), 1));
+        received.insert(received.end(), batch, batch + count);
+        if (0 == count)
+        {
+            std::this_thread::yield();
+        }
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    if (!CheckProducerOrder(received, producers, per_producer) || !queue->Empty() || 0 != queue->Count())
+    {
+        SetError("MPSCRingBuffer 数据顺序或数量错误.");
+    }
+}
+
+struct TestMPSCNode : public ToolBox::MPSCNode
+{
+    uint64_t value = 0;
+};
+
+CASE(mpsc_intrusive_multi_producer)
+{
+    /*
+    * 测试无界侵入式多生产者单消费者队列
+    */
+    const uint32_t producers = 4;
+    const uint64_t per_producer = 200000;
+    std::vector<TestMPSCNode> nodes(producers * per_producer);
+    ToolBox::MPSCIntrusiveList<TestMPSCNode> queue;
+    if (!queue.Empty() || nullptr != queue.Pop())
+    {
+        SetError("MPSCIntrusiveList 初始不为空.");
+    }
+    std::vector<std::thread> threads;
+    for (uint32_t producer = 0; producer < producers; producer++)
+    {
+        threads.emplace_back([&, producer]()
+        {
+            for (uint64_t seq = 0; seq < per_producer; seq++)
+            {
+                auto& node = nodes[producer * per_producer + seq];
+                node.value = (uint64_t(producer) << 32) | seq;
+                queue.Push(&node);
+            }
+        });
+    }
+    std::vector<uint64_t> received;
+    received.reserve(nodes.size());
+    TestMPSCNode* batch[64];
+    while (received.size() < nodes.size())
+    {
+        std::size_t count = queue.PopBulk(batch, 64);
+        for (std::size_t index = 0; index < count; index++)
+        {
+            received.emplace_back(batch[index]->value);
+        }
+        if (0 == count)
+        {
+            std::this_thread::yield();
+        }
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    if (!CheckProducerOrder(received, producers, per_producer) || !queue.Empty() || nullptr != queue.Pop())
+    {
+        SetError("MPSCIntrusiveList 数据顺序或数量错误.");
+    }
+    // 取空后仍可继续使用
+    queue.Push(&nodes[0]);
+    if (queue.Empty() || &nodes[0] != queue.Pop() || !queue.Empty())
+    {
+        SetError("MPSCIntrusiveList 取空后再次入队错误.");
+    }
+}
+
+CASE(mpsc_blocking_wait)
+{
+    /*
+    * 测试阻塞等待: 超时返回、入队唤醒、WakeUp 唤醒且不丢失
+    */
+    ToolBox::MPSCRingBuffer<uint64_t, 64, true> ring;
+    auto begin = std::chrono::steady_clock::now();
+    if (ring.Wait(20))
+    {
+        SetError("MPSCRingBuffer 空队列等待没有超时.");
+    }
+    if (std::chrono::steady_clock::now() - begin < std::chrono::milliseconds(15))
+    {
+        SetError("MPSCRingBuffer 等待提前返回.");
+    }
+    std::thread producer([&]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ring.Push(uint64_t(7));
+    });
+    if (!ring.Wait() || 7 != ring.Pop())
+    {
+        SetError("MPSCRingBuffer 入队没有唤醒等待.");
+    }
+    producer.join();
+    // 先 WakeUp 后等待,等待立即返回
+    ring.WakeUp();
+    begin = std::chrono::steady_clock::now();
+    ring.Wait(1000);
+    if (std::chrono::steady_clock::now() - begin > std::chrono::milliseconds(500))
+    {
+        SetError("MPSCRingBuffer 丢失了 WakeUp.");
+    }
+
+    ToolBox::MPSCIntrusiveList<TestMPSCNode, true> list;
+    TestMPSCNode node;
+    std::thread list_producer([&]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        list.Push(&node);
+    });
+    if (!list.Wait() || &node != list.Pop())
+    {
+        SetError("MPSCIntrusiveList 入队没有唤醒等待.");
+    }
+    list_producer.join();
+}
+
+/*
+* 多生产者单消费者吞吐,返回耗时微秒
+* push(producer, seq) 投递一个元素,失败时返回 false; pop(batch) 取出一批,返回个数
+*/
+template<typename PushFunc, typename PopFunc>
+static int64_t RunMPSCThroughput(uint32_t producers, uint64_t per_producer, PushFunc&& push, PopFunc&& pop)
+{
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (uint32_t producer = 0; producer < producers; producer++)
+    {
+        threads.emplace_back([&, producer]()
+        {
+            for (uint64_t seq = 0; seq < per_producer; seq++)
+            {
+                while (!push(producer, seq))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (uint64_t received = 0; received < producers * per_producer;)
+    {
+        std::size_t count = pop();
+        received += count;
+        if (0 == count)
+        {
+            std::this_thread::yield();
+        }
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+}
+
+CASE(mpsc_benchmark)
+{
+    /*
+    * 多生产者单消费者的性能对比: 互斥锁+std::queue、有界 MPSCRingBuffer、无界 MPSCIntrusiveList
+    */
+    const uint32_t producers = 4;
+    const uint64_t per_producer = 1000000;
+    const std::size_t batch_size = 64;
+
+    std::mutex mutex;
+    std::queue<uint64_t> locked_queue;
+    int64_t mutex_us = RunMPSCThroughput(producers, per_producer, [&](uint32_t producer, uint64_t seq)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        locked_queue.push(seq);
+        return true;
+    }, [&]()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::size_t count = 0;
+        while (count < batch_size && !locked_queue.empty())
+        {
+            locked_queue.pop();
+            count++;
+        }
+        return count;
+    });
+
+    auto ring = std::make_unique<ToolBox::MPSCRingBuffer<uint64_t, 4096>>();
+    uint64_t ring_batch[batch_size];
+    int64_t ring_us = RunMPSCThroughput(producers, per_producer, [&](uint32_t producer, uint64_t seq)
+    {
+        return ring->Push(uint64_t(seq));
+    }, [&]()
+    {
+        return ring->PopBulk(ring_batch, batch_size);
+    });
+
+    std::vector<TestMPSCNode> nodes(producers * per_producer);
+    ToolBox::MPSCIntrusiveList<TestMPSCNode> list;
+    TestMPSCNode* list_batch[batch_size];
+    int64_t list_us = RunMPSCThroughput(producers, per_producer, [&](uint32_t producer, uint64_t seq)
+    {
+        list.Push(&nodes[producer * per_producer + seq]);
+        return true;
+    }, [&]()
+    {
+        return list.PopBulk(list_batch, batch_size);
+    });
+
+    auto mops = [&](int64_t us)
+    {
+        return us > 0 ? double(producers * per_producer) / double(us) : 0.0;
+    };
+    fprintf(stderr, "[%u 生产者] 互斥锁队列 %.1f M/s, MPSCRingBuffer %.1f M/s, MPSCIntrusiveList %.1f M/s\n", producers, mops(mutex_us), mops(ring_us), mops(list_us));
+}
+
+FIXTURE_END(MPSCQueue)
@@ -0,0 +1,72 @@
+#include "network/net_buffer.h"
+#include "unit_test_frame/unittest.h"
+#include <cstring>
+#include <thread>
+#include <vector>
+
+FIXTURE_BEGIN(NetBuffer)
+
+CASE(net_buffer_frame)
+{
+    /*
+    * 测试成帧: 长度头写在 payload 之前,且随 SetSize 更新
+    */
+    const char payload[] = "hello net buffer";
+    uint32_t payload_size = sizeof(payload);
+    auto* buffer = ToolBox::NetBuffer::Create(payload, payload_size);
+    if (buffer->Size() != payload_size || buffer->FrameSize() != payload_size + sizeof(uint32_t))
+    {
+        SetError("NetBuffer 长度错误.");
+    }
+    uint32_t len = 0;
+    memcpy(&len, buffer->Frame(), sizeof(uint32_t));
+    if (len != payload_size)
+    {
+        SetError("NetBuffer 长度头错误.");
+    }
+    if (0 != memcmp(buffer->Data(), payload, payload_size))
+    {
+        SetError("NetBuffer 数据错误.");
+    }
+
+    auto* copy = ToolBox::NetBuffer::CreateFrame(buffer->Frame(), buffer->FrameSize());
+    if (copy->FrameSize() != buffer->FrameSize() || 0 != memcmp(copy->Frame(), buffer->Frame(), buffer->FrameSize()))
+    {
+        SetError("NetBuffer CreateFrame 拷贝错误.");
+    }
+    copy->Release();
+    buffer->Release();
+}
+
+CASE(net_buffer_ref_count)
+{
+    /*
+    * 测试多线程共享引用计数
+    */
+    const uint32_t thread_num = 4;
+    const uint32_t ref_per_thread = 10000;
+    auto* buffer = ToolBox::NetBuffer::Create(1024);
+    buffer->AddRef(thread_num * ref_per_thread);
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < thread_num; i++)
+    {
+        threads.emplace_back([buffer]()
+        {
+            for (uint32_t j = 0; j < ref_per_thread; j++)
+            {
+                buffer->Release();
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    if (1 != buffer->RefCount())
+    {
+        SetError("NetBuffer 引用计数错误.");
+    }
+    buffer->Release();
+}
+
+FIXTURE_END(NetBuffer)
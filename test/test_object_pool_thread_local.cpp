@@ -0,0 +1,143 @@
+#include "tools/object_pool_thread_local.h"
+#include "tools/object_pool_lock_free.h"
+#include "tools/ringbuffer.h"
+#include "unit_test_frame/unittest.h"
+#include <chrono>
+#include <functional>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+FIXTURE_BEGIN(ObjectPoolThreadLocal)
+
+/*
+测试类
+*/
+class TestObjectPoolThreadLocal
+{
+public:
+    TestObjectPoolThreadLocal(uint64_t id, uint64_t check)
+        : id_(id), check_(check)
+    {}
+    bool Check() const
+    {
+        return id_ == check_;
+    }
+    uint64_t id_ = 0;
+private:
+    uint64_t check_ = 0;
+    char payload_[48] = { 0 };  // 与网络事件对象大小相近
+};
+
+// 测试 本线程取出与归还,归还的槽位被复用
+CASE(ObjectPoolThreadLocal1)
+{
+    auto& pool = ToolBox::GetObjectPoolThreadLocalMgrRef<TestObjectPoolThreadLocal>();
+    std::size_t capacity = pool.GetCapacity();
+    auto* object = pool.GetObject(1, 1);
+    pool.GiveBack(object);
+    auto* again = pool.GetObject(2, 2);
+    if (again != object || !again->Check())
+    {
+        SetError("本线程归还的对象没有被复用.");
+    }
+    std::vector<TestObjectPoolThreadLocal*> objects;
+    for (uint64_t i = 0; i < 1000; i++)
+    {
+        objects.emplace_back(pool.GetObject(i, i));
+    }
+    for (auto* item : objects)
+    {
+        pool.GiveBack(item);
+    }
+    pool.GiveBack(again);
+    if (pool.GetCapacity() - capacity != 1024)
+    {
+        SetError("对象池扩容数量错误.");
+    }
+}
+
+/*
+* 一个线程取出对象,经 SPSC 队列交给另一个线程检查后归还,返回耗时微秒
+*/
+static int64_t RunProducerConsumer(uint32_t count, std::function<TestObjectPoolThreadLocal*(uint64_t)> get, std::function<void(TestObjectPoolThreadLocal*)> give_back, bool& bad)
+{
+    static ToolBox::RingBufferSPSC<TestObjectPoolThreadLocal*, 4096> queue;
+    auto begin = std::chrono::steady_clock::now();
+    std::thread producer([&]()
+    {
+        for (uint64_t i = 0; i < count; i++)
+        {
+            auto* object = get(i);
+            while (queue.Full())
+            {
+                std::this_thread::yield();
+            }
+            queue.Push(std::move(object));
+        }
+    });
+    std::thread consumer([&]()
+    {
+        for (uint64_t i = 0; i < count; i++)
+        {
+            while (queue.Empty())
+            {
+                std::this_thread::yield();
+            }
+            auto* object = queue.Pop();
+            if (!object->Check() || object->id_ != i)
+            {
+                bad = true;
+            }
+            give_back(object);
+        }
+    });
+    producer.join();
+    consumer.join();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// 测试 跨线程归还的对象按批回到分配线程,对象池不会无限扩容;并与 new、无锁对象池对比
+CASE(ObjectPoolThreadLocal2)
+{
+    const uint32_t count = 2000000;
+    bool bad = false;
+    auto& pool = ToolBox::GetObjectPoolThreadLocalMgrRef<TestObjectPoolThreadLocal>();
+    std::size_t capacity_before = pool.GetCapacity();
+    int64_t thread_local_us = RunProducerConsumer(count, [](uint64_t i)
+    {
+        return ToolBox::GetObjectThreadLocal<TestObjectPoolThreadLocal>(i, i);
+    }, [](TestObjectPoolThreadLocal * object)
+    {
+        ToolBox::GiveBackObjectThreadLocal(object);
+    }, bad);
+    std::size_t capacity = pool.GetCapacity() - capacity_before;
+    // ENABLE_OBJECT_POOL_LOCK_FREE 为 0 时退化为 new
+    int64_t lock_free_us = RunProducerConsumer(count, [](uint64_t i)
+    {
+        return ToolBox::GetObjectLockFree<TestObjectPoolThreadLocal>(i, i);
+    }, [](TestObjectPoolThreadLocal * object)
+    {
+        ToolBox::GiveBackObjectLockFree(object);
+    }, bad);
+    int64_t new_us = RunProducerConsumer(count, [](uint64_t i)
+    {
+        return new TestObjectPoolThreadLocal(i, i);
+    }, [](TestObjectPoolThreadLocal * object)
+    {
+        delete object;
+    }, bad);
+    fprintf(stderr, "[对象池] %u 次跨线程取出归还, 线程本地对象池:%lldms(槽位:%zu) 无锁对象池:%lldms new:%lldms\n", count,
+            (long long)thread_local_us / 1000, capacity, (long long)lock_free_us / 1000, (long long)new_us / 1000);
+    if (bad)
+    {
+        SetError("跨线程传递的对象内容错误.");
+    }
+    // 队列长度 4096,加上每批攒着的对象,槽位数应远小于对象总数
+    if (capacity > 16 * 1024)
+    {
+        SetError("跨线程归还的对象没有回到分配线程.");
+    }
+}
+
+FIXTURE_END(ObjectPoolThreadLocal)
@@ -0,0 +1,207 @@
+#include "tools/parallel_algorithm.h"
+#include "tools/md5.h"
+#include "unit_test_frame/unittest.h"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+FIXTURE_BEGIN(TestParallelAlgorithm)
+
+CASE(TestParallelForAndTransform)
+{
+    /*
+    * 测试 ParallelFor / ParallelForRange / ParallelTransform: 每个下标恰好处理一次,空区间不调用
+    */
+    ToolBox::ThreadPoolWorkStealing thread_pool(4);
+    const std::size_t size = 100003;
+    std::vector<int32_t> hits(size, 0);
+    ToolBox::ParallelFor(thread_pool, std::size_t(0), size, [&](std::size_t index) { hits[index]++; }, 64);
+    if (std::any_of(hits.begin(), hits.end(), [](int32_t hit) { return 1 != hit; }))
+    {
+        SetError("ParallelFor 下标处理次数错误.");
+    }
+    std::atomic<std::size_t> ranges_total = 0;
+    ToolBox::ParallelForRange(thread_pool, std::size_t(0), size, [&](std::size_t begin, std::size_t end)
+    {
+        ranges_total.fetch_add(end - begin, std::memory_order_relaxed);
+    });
+    if (size != ranges_total.load())
+    {
+        SetError("ParallelForRange 区间总长错误.");
+    }
+    ToolBox::ParallelFor(thread_pool, 5, 5, [&](int32_t) { SetError("ParallelFor 空区间被调用."); });
+
+    std::vector<int64_t> input(size);
+    std::iota(input.begin(), input.end(), int64_t(0));
+    std::vector<int64_t> output(size, -1);
+    auto out_end = ToolBox::ParallelTransform(thread_pool, input.begin(), input.end(), output.begin(), [](int64_t value) { return value * 3; });
+    if (out_end != output.end())
+    {
+        SetError("ParallelTransform 返回的迭代器错误.");
+    }
+    for (std::size_t index = 0; index < size; index++)
+    {
+        if (output[index] != int64_t(index) * 3)
+        {
+            SetError("ParallelTransform 结果错误.");
+            break;
+        }
+    }
+}
+
+CASE(TestParallelReduce)
+{
+    /*
+    * 测试 ParallelReduce: 求和、自定义归约、空区间返回单位元,以及在工作线程内嵌套调用
+    */
+    ToolBox::ThreadPoolWorkStealing thread_pool(4);
+    std::vector<uint64_t> data(1 << 20);
+    std::iota(data.begin(), data.end(), uint64_t(1));
+    uint64_t expect = uint64_t(data.size()) * (data.size() + 1) / 2;
+    if (expect != ToolBox::ParallelReduce(thread_pool, data.begin(), data.end(), uint64_t(0)))
+    {
+        SetError("ParallelReduce 求和错误.");
+    }
+    uint64_t max_value = ToolBox::ParallelReduce(thread_pool, data.begin(), data.end(), uint64_t(0),
+        [](uint64_t lhs, uint64_t rhs) { return (std::max)(lhs, rhs); }, 1000);
+    if (data.size() != max_value)
+    {
+        SetError("ParallelReduce 取最大值错误.");
+    }
+    if (7 != ToolBox::ParallelReduce(thread_pool, data.begin(), data.begin(), uint64_t(7)))
+    {
+        SetError("ParallelReduce 空区间没有返回单位元.");
+    }
+    uint64_t nested = thread_pool.Add([&]
+    {
+        return ToolBox::ParallelReduce(thread_pool, data.begin(), data.end(), uint64_t(0));
+    }).get();
+    if (expect != nested)
+    {
+        SetError("ParallelReduce 在工作线程内调用错误.");
+    }
+}
+
+CASE(TestParallelSort)
+{
+    /*
+    * 测试 ParallelSort: 结果与 std::stable_sort 一致(含大量相等键,检查稳定性),自定义比较与小区间
+    */
+    ToolBox::ThreadPoolWorkStealing thread_pool(4);
+    std::mt19937 rng(12345);
+    std::vector<std::pair<int32_t, int32_t>> data(200001);
+    for (std::size_t index = 0; index < data.size(); index++)
+    {
+        data[index] = { int32_t(rng() % 1000), int32_t(index) };
+    }
+    auto expect = data;
+    auto by_key = [](const std::pair<int32_t, int32_t>& lhs, const std::pair<int32_t, int32_t>& rhs) { return lhs.first < rhs.first; };
+    std::stable_sort(expect.begin(), expect.end(), by_key);
+    ToolBox::ParallelSort(thread_pool, data.begin(), data.end(), by_key, 256);
+    if (data != expect)
+    {
+        SetError("ParallelSort 结果与 std::stable_sort 不一致.");
+    }
+
+    std::vector<std::string> names = { "delta", "alpha", "echo", "charlie", "bravo" };
+    ToolBox::ParallelSort(thread_pool, names.begin(), names.end(), std::greater<>());
+    if (names != std::vector<std::string>{ "echo", "delta", "charlie", "bravo", "alpha" })
+    {
+        SetError("ParallelSort 自定义比较错误.");
+    }
+    std::vector<int32_t> single = { 1 };
+    ToolBox::ParallelSort(thread_pool, single.begin(), single.end());
+
+    // 没有默认构造函数、只能移动的元素
+    struct MoveOnly
+    {
+        explicit MoveOnly(int32_t value) : value(std::make_unique<int32_t>(value)) {}
+        std::unique_ptr<int32_t> value;
+    };
+    std::vector<MoveOnly> move_only;
+    for (int32_t index = 0; index < 10000; index++)
+    {
+        move_only.emplace_back(int32_t(rng() % 100000));
+    }
+    ToolBox::ParallelSort(thread_pool, move_only.begin(), move_only.end(), [](const MoveOnly& lhs, const MoveOnly& rhs) { return *lhs.value < *rhs.value; }, 64);
+    if (!std::is_sorted(move_only.begin(), move_only.end(), [](const MoveOnly& lhs, const MoveOnly& rhs) { return *lhs.value < *rhs.value; }))
+    {
+        SetError("ParallelSort 只能移动的元素排序错误.");
+    }
+}
+
+CASE(TestParallelAlgorithmBenchmark)
+{
+    /*
+    * 线程数从 1 增加到硬件线程数[至少 2]的加速比: 批量 MD5、求和归约、排序(对比单线程 std::sort)
+    */
+    const std::size_t md5_count = 200000;
+    const std::size_t sum_count = 1 << 24;
+    const std::size_t sort_count = 1 << 22;
+    std::vector<std::string> keys(md5_count);
+    for (std::size_t index = 0; index < md5_count; index++)
+    {
+        keys[index] = "player_" + std::to_string(index) + "_inventory_snapshot";
+    }
+    std::vector<uint64_t> hashes(md5_count);
+    std::vector<uint64_t> numbers(sum_count);
+    std::iota(numbers.begin(), numbers.end(), uint64_t(1));
+    uint64_t expect_sum = uint64_t(sum_count) * (sum_count + 1) / 2;
+    std::vector<uint32_t> unsorted(sort_count);
+    std::mt19937 rng(54321);
+    std::generate(unsorted.begin(), unsorted.end(), rng);
+
+    auto elapsed_ms = [](auto&& func)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        func();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    };
+    std::vector<uint32_t> sorted = unsorted;
+    double std_sort_ms = elapsed_ms([&] { std::sort(sorted.begin(), sorted.end()); });
+
+    double base_md5_ms = 0;
+    double base_sum_ms = 0;
+    double base_sort_ms = 0;
+    int32_t max_threads = (std::max)(2, int32_t(std::thread::hardware_concurrency()));
+    for (int32_t threads = 1; threads <= max_threads; threads *= 2)
+    {
+        ToolBox::ThreadPoolWorkStealing thread_pool(threads);
+        double md5_ms = elapsed_ms([&]
+        {
+            ToolBox::ParallelTransform(thread_pool, keys.begin(), keys.end(), hashes.begin(),
+                [](const std::string& key) { return MD5Hash64Constexpr(key); });
+        });
+        if (hashes[md5_count - 1] != MD5Hash64Constexpr(keys[md5_count - 1]))
+        {
+            SetError("并行 MD5 结果错误.");
+        }
+        uint64_t sum = 0;
+        double sum_ms = elapsed_ms([&] { sum = ToolBox::ParallelReduce(thread_pool, numbers.begin(), numbers.end(), uint64_t(0)); });
+        if (sum != expect_sum)
+        {
+            SetError("并行求和结果错误.");
+        }
+        std::vector<uint32_t> parallel_sorted = unsorted;
+        double sort_ms = elapsed_ms([&] { ToolBox::ParallelSort(thread_pool, parallel_sorted.begin(), parallel_sorted.end()); });
+        if (parallel_sorted != sorted)
+        {
+            SetError("并行排序结果错误.");
+        }
+        if (1 == threads)
+        {
+            base_md5_ms = md5_ms;
+            base_sum_ms = sum_ms;
+            base_sort_ms = sort_ms;
+        }
+        fprintf(stderr, "[%d 线程] MD5 %zu 个: %.1f ms(x%.2f), 求和 %zu 个: %.1f ms(x%.2f), 排序 %zu 个: %.1f ms(x%.2f, 单线程 std::sort %.1f ms)\n",
+                threads, md5_count, md5_ms, md5_ms > 0 ? base_md5_ms / md5_ms : 0, sum_count, sum_ms, sum_ms > 0 ? base_sum_ms / sum_ms : 0,
+                sort_count, sort_ms, sort_ms > 0 ? base_sort_ms / sort_ms : 0, std_sort_ms);
+    }
+}
+
+FIXTURE_END(TestParallelAlgorithm)
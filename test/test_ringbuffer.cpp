@@ -2,6 +2,9 @@
 #include "unit_test_frame/unittest.h"
 #include <vector>
 #include <thread>
+#include <chrono>
+#include <random>
+#include <memory>
 
 FIXTURE_BEGIN(RingBuffer)
 
@@ -132,6 +135,265 @@ CASE(ringbuffer_copy_write)
     }
 }
 
+CASE(ringbuffer_readable_segments)
+{
+    /*
+    * 测试回绕后的可读分段: 两段首尾相接即为全部可读数据
+    */
+    const size_t config_buffer_size = 64;
+    ToolBox::RingBuffer<char, config_buffer_size> ring_buffer;
+    char data[config_buffer_size] = { 0 };
+    for (size_t i = 0; i < config_buffer_size; i++)
+    {
+        data[i] = char('a' + (i % 26));
+    }
+    char* segment_data[2] = { nullptr, nullptr };
+    size_t segment_size[2] = { 0, 0 };
+    if (0 != ring_buffer.ReadableSegments(segment_data, segment_size))
+    {
+        SetError("ringbuffer 空时分段数错误.");
+    }
+    ring_buffer.Write(data, 40);
+    if (1 != ring_buffer.ReadableSegments(segment_data, segment_size) || 40 != segment_size[0])
+    {
+        SetError("ringbuffer 未回绕时分段错误.");
+    }
+    char discard[32];
+    ring_buffer.Read(discard, sizeof(discard));
+    ring_buffer.Write(data, 40);
+    if (2 != ring_buffer.ReadableSegments(segment_data, segment_size)
+            || segment_size[0] + segment_size[1] != ring_buffer.ReadableSize()
+            || segment_size[0] != ring_buffer.ContinuouslyReadableSize())
+    {
+        SetError("ringbuffer 回绕时分段错误.");
+    }
+    std::vector<char> expect(data + 32, data + 40);
+    expect.insert(expect.end(), data, data + 40);
+    std::vector<char> actual(segment_data[0], segment_data[0] + segment_size[0]);
+    actual.insert(actual.end(), segment_data[1], segment_data[1] + segment_size[1]);
+    if (expect != actual)
+    {
+        SetError("ringbuffer 分段数据错误.");
+    }
+}
+
+CASE(ringbuffer_resize_slab)
+{
+    /*
+    * 测试缩容/扩容保留数据,以及分配器缓存归还的内存块
+    */
+    ToolBox::RingBufferSlab slab;
+    ToolBox::RingBuffer<char, 4096> ring_buffer;
+    ring_buffer.SetAllocator(&slab);
+    if (4096 != slab.GetInUseBytes())
+    {
+        SetError("ringbuffer 切换分配器后内存块大小错误.");
+    }
+    std::vector<char> data(20000);
+    for (size_t i = 0; i < data.size(); i++)
+    {
+        data[i] = char('a' + (i % 26));
+    }
+    ring_buffer.Write(data.data(), data.size());
+    if (32768 != ring_buffer.GetBufferSize() || 32768 != slab.GetInUseBytes())
+    {
+        SetError("ringbuffer 扩容大小错误.");
+    }
+    // 有数据时不能缩到数据量以下
+    ring_buffer.Resize(4096);
+    if (32768 != ring_buffer.GetBufferSize() || data.size() != ring_buffer.ReadableSize())
+    {
+        SetError("ringbuffer 有数据时缩容错误.");
+    }
+    std::vector<char> out(data.size());
+    ring_buffer.Read(out.data(), 15000);
+    ring_buffer.Resize(4096);
+    if (8192 != ring_buffer.GetBufferSize() || 5000 != ring_buffer.ReadableSize())
+    {
+        SetError("ringbuffer 缩容大小错误.");
+    }
+    ring_buffer.Read(out.data() + 15000, 5000);
+    if (out != data)
+    {
+        SetError("ringbuffer 缩容后数据错误.");
+    }
+    // 扩容与缩容归还的 4K/16K/32K 内存块都被缓存,缩容时的 8K 取自缓存
+    if (8192 != slab.GetInUseBytes() || 4096 + 16384 + 32768 != slab.GetCachedBytes())
+    {
+        SetError("ringbuffer 分配器缓存统计错误.");
+    }
+    ring_buffer.Resize(32768);
+    if (4096 + 16384 + 8192 != slab.GetCachedBytes() || 32768 != slab.GetInUseBytes())
+    {
+        SetError("ringbuffer 分配器没有复用缓存的内存块.");
+    }
+}
+
+#if defined(__linux__) || defined(__APPLE__)
+CASE(ringbuffer_mirrored)
+{
+    /*
+    * 测试镜像环形队列: 回绕处的数据仍是一段连续内存,扩容/缩容保留数据
+    */
+    ToolBox::MirroredRingBuffer<char, 4096> ring_buffer;
+    if (!ring_buffer.Valid())
+    {
+        SetError("镜像 ringbuffer 映射失败.");
+        return;
+    }
+    const std::size_t buffer_size = ring_buffer.GetBufferSize();
+    std::vector<char> data(buffer_size);
+    for (size_t i = 0; i < data.size(); i++)
+    {
+        data[i] = char('a' + (i % 26));
+    }
+    // 读写位置推到末尾附近,再写入跨越回绕点的数据
+    ring_buffer.Write(data.data(), buffer_size - 100);
+    ring_buffer.Remove(buffer_size - 100);
+    ring_buffer.Write(data.data(), 1000);
+    char* segment_data[2] = { nullptr, nullptr };
+    size_t segment_size[2] = { 0, 0 };
+    if (1 != ring_buffer.ReadableSegments(segment_data, segment_size) || 1000 != segment_size[0]
+            || 1000 != ring_buffer.ContinuouslyReadableSize())
+    {
+        SetError("镜像 ringbuffer 回绕时不连续.");
+    }
+    if (0 != memcmp(ring_buffer.GetReadPtr(), data.data(), 1000))
+    {
+        SetError("镜像 ringbuffer 回绕处数据错误.");
+    }
+    // 写指针之后的全部可写空间同样连续
+    if (ring_buffer.ContinuouslyWriteableSize() != ring_buffer.WriteableSize())
+    {
+        SetError("镜像 ringbuffer 可写空间不连续.");
+    }
+    uint32_t header = 0;
+    ring_buffer.CopyAt(96, (char*)&header, sizeof(header));
+    if (0 != memcmp(&header, data.data() + 96, sizeof(header)))
+    {
+        SetError("镜像 ringbuffer 偏移拷贝错误.");
+    }
+    // 扩容后数据不变
+    std::vector<char> big(buffer_size * 3);
+    for (size_t i = 0; i < big.size(); i++)
+    {
+        big[i] = char(i * 7);
+    }
+    ring_buffer.Write(big.data(), big.size());
+    if (ring_buffer.GetBufferSize() <= buffer_size * 3 || 1000 + big.size() != ring_buffer.ReadableSize()
+            || 0 != memcmp(ring_buffer.GetReadPtr(), data.data(), 1000)
+            || 0 != memcmp(ring_buffer.GetReadPtr() + 1000, big.data(), big.size()))
+    {
+        SetError("镜像 ringbuffer 扩容后数据错误.");
+    }
+    // 读空后缩容
+    std::vector<char> out(1000 + big.size());
+    ring_buffer.Read(out.data(), out.size());
+    ring_buffer.Resize(0);
+    if (buffer_size != ring_buffer.GetBufferSize() || !ring_buffer.Empty())
+    {
+        SetError("镜像 ringbuffer 缩容错误.");
+    }
+    if (0 != memcmp(out.data() + 1000, big.data(), big.size()))
+    {
+        SetError("镜像 ringbuffer 读出数据错误.");
+    }
+}
+
+/*
+* 模拟网络接收: 每次"recv"最多填满连续可写空间,随后解析出全部完整的 len|buff 帧并累加校验和
+* 返回耗时微秒, recv_calls 为写入次数
+*/
+template<typename Ring, bool InPlace>
+static int64_t RunRecvParse(Ring& ring, const std::vector<char>& stream, std::size_t max_recv, uint64_t& recv_calls, uint64_t& frames, uint64_t& checksum)
+{
+    std::vector<char> scratch(64 * 1024);
+    std::size_t offset = 0;
+    auto begin = std::chrono::steady_clock::now();
+    while (offset < stream.size())
+    {
+        std::size_t size = (std::min)({ ring.ContinuouslyWriteableSize(), max_recv, stream.size() - offset });
+        memcpy(ring.GetWritePtr(), stream.data() + offset, size);
+        ring.AdjustWritePos(size);
+        offset += size;
+        recv_calls++;
+        while (ring.ReadableSize() >= sizeof(uint32_t))
+        {
+            uint32_t len = 0;
+            const char* payload = nullptr;
+            if constexpr (InPlace)
+            {
+                // 帧头与帧体都在连续内存中,原地解析
+                memcpy(&len, ring.GetReadPtr(), sizeof(len));
+                if (ring.ReadableSize() - sizeof(uint32_t) < len)
+                {
+                    break;
+                }
+                payload = ring.GetReadPtr() + sizeof(uint32_t);
+                ring.AdjustReadPos(sizeof(uint32_t) + len);
+            }
+            else
+            {
+                // 回绕时帧头与帧体都可能被拆开,先拷贝出来
+                ring.Copy((char*)&len, sizeof(len));
+                if (ring.ReadableSize() - sizeof(uint32_t) < len)
+                {
+                    break;
+                }
+                ring.AdjustReadPos(sizeof(uint32_t));
+                ring.Read(scratch.data(), len);
+                payload = scratch.data();
+            }
+            checksum += uint8_t(payload[0]) + uint8_t(payload[len - 1]);
+            frames++;
+        }
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+}
+
+CASE(ringbuffer_mirrored_benchmark)
+{
+    /*
+    * 接收与拆包的性能对比: 普通环形队列拷贝出帧 vs 镜像环形队列原地解析
+    */
+    const std::size_t total_bytes = 128 * 1024 * 1024;
+    std::mt19937 random(20260101);
+    std::vector<char> stream;
+    stream.reserve(total_bytes + 4096);
+    uint64_t expect_frames = 0;
+    while (stream.size() < total_bytes)
+    {
+        // 游戏消息以小包为主,夹杂少量大包
+        uint32_t len = random() % 10 == 0 ? 1024 + random() % 7168 : 16 + random() % 496;
+        stream.insert(stream.end(), (const char*)&len, (const char*)&len + sizeof(len));
+        stream.insert(stream.end(), len, char(len));
+        expect_frames++;
+    }
+    // 单次接收量与缓冲区大小不成倍数,普通环形队列在回绕处要多接收一次
+    const std::size_t max_recv = 60 * 1024;
+    uint64_t ring_calls = 0, ring_frames = 0, ring_checksum = 0;
+    uint64_t mirror_calls = 0, mirror_frames = 0, mirror_checksum = 0;
+    ToolBox::RingBuffer<char, 256 * 1024> ring;
+    ToolBox::MirroredRingBuffer<char, 256 * 1024> mirror;
+    int64_t ring_us = RunRecvParse<decltype(ring), false>(ring, stream, max_recv, ring_calls, ring_frames, ring_checksum);
+    int64_t mirror_us = RunRecvParse<decltype(mirror), true>(mirror, stream, max_recv, mirror_calls, mirror_frames, mirror_checksum);
+    auto mbps = [&](int64_t us)
+    {
+        return us > 0 ? double(stream.size()) / double(us) : 0.0;
+    };
+    fprintf(stderr, "[普通 ringbuffer] %lld us, %.1f MB/s, 写入 %llu 次\n", (long long)ring_us, mbps(ring_us), (unsigned long long)ring_calls);
+    fprintf(stderr, "[镜像 ringbuffer] %lld us, %.1f MB/s, 写入 %llu 次\n", (long long)mirror_us, mbps(mirror_us), (unsigned long long)mirror_calls);
+    if (ring_frames != expect_frames || mirror_frames != expect_frames || ring_checksum != mirror_checksum)
+    {
+        SetError("ringbuffer 拆包结果不一致.");
+    }
+    if (mirror_calls > ring_calls)
+    {
+        SetError("镜像 ringbuffer 写入次数多于普通 ringbuffer.");
+    }
+}
+#endif
+
 std::vector<int32_t> product;
 std::vector<int32_t> result;
 ToolBox::RingBufferSPSC<int32_t, 17> ring_buffer;
@@ -198,4 +460,192 @@ CASE(ringbuffer_spsc)
 }
 
 
+CASE(ringbuffer_spsc_cached)
+{
+    /*
+    * 测试缓存位置的单生产者单消费者队列: 单个与批量混合收发,顺序与数量不变
+    */
+    const uint64_t count = 1000000;
+    auto queue = std::make_unique<ToolBox::RingBufferSPSCCached<uint64_t, 1000>>();
+    bool bad = false;
+    std::thread producer([&]()
+    {
+        uint64_t batch[37];
+        uint64_t next = 0;
+        while (next < count)
+        {
+            if (next % 2 == 0)
+            {
+                std::size_t num = 0;
+                for (; num < 37 && next + num < count; num++)
+                {
+                    batch[num] = next + num;
+                }
+                next += queue->PushBulk(batch, num);
+            }
+            else if (queue->Push(uint64_t(next)))
+            {
+                next++;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+    uint64_t expect = 0;
+    uint64_t batch[53];
+    while (expect < count)
+    {
+        std::size_t num = 0;
+        if (expect % 3 == 0)
+        {
+            num = queue->PopBulk(batch, 53);
+        }
+        else if (!queue->Empty())
+        {
+            batch[0] = queue->Pop();
+            num = 1;
+        }
+        for (std::size_t index = 0; index < num; index++)
+        {
+            bad = bad || batch[index] != expect++;
+        }
+        if (0 == num)
+        {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    if (bad || !queue->Empty() || 0 != queue->Count())
+    {
+        SetError("ringbuffer_spsc_cached 结果与原始数据不一致.");
+    }
+}
+
+/*
+* 单生产者单消费者吞吐: 逐个或按 batch 个一批收发 count 个元素,返回耗时微秒
+*/
+template<std::size_t Batch, typename Queue>
+static int64_t RunSPSCThroughput(Queue& queue, uint64_t count, bool& bad)
+{
+    auto begin = std::chrono::steady_clock::now();
+    std::thread producer([&]()
+    {
+        uint64_t values[Batch];
+        for (uint64_t next = 0; next < count;)
+        {
+            if constexpr (Batch > 1)
+            {
+                std::size_t num = (std::min)(uint64_t(Batch), count - next);
+                for (std::size_t index = 0; index < num; index++)
+                {
+                    values[index] = next + index;
+                }
+                std::size_t pushed = queue.PushBulk(values, num);
+                next += pushed;
+                if (0 == pushed)
+                {
+                    std::this_thread::yield();
+                }
+            }
+            else
+            {
+                while (queue.Full())
+                {
+                    std::this_thread::yield();
+                }
+                queue.Push(uint64_t(next++));
+            }
+        }
+    });
+    uint64_t values[Batch];
+    for (uint64_t expect = 0; expect < count;)
+    {
+        std::size_t num = 0;
+        if constexpr (Batch > 1)
+        {
+            num = queue.PopBulk(values, Batch);
+        }
+        else if (!queue.Empty())
+        {
+            values[0] = queue.Pop();
+            num = 1;
+        }
+        for (std::size_t index = 0; index < num; index++)
+        {
+            bad = bad || values[index] != expect++;
+        }
+        if (0 == num)
+        {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+}
+
+/*
+* 单生产者单消费者往返延迟: 两个队列组成乒乓,返回每次往返的平均纳秒
+*/
+template<typename Queue>
+static int64_t RunSPSCPingPong(Queue& ping, Queue& pong, uint64_t rounds)
+{
+    std::thread echo([&]()
+    {
+        for (uint64_t round = 0; round < rounds; round++)
+        {
+            while (ping.Empty())
+            {
+                std::this_thread::yield();
+            }
+            pong.Push(ping.Pop());
+        }
+    });
+    auto begin = std::chrono::steady_clock::now();
+    for (uint64_t round = 0; round < rounds; round++)
+    {
+        ping.Push(uint64_t(round));
+        while (pong.Empty())
+        {
+            std::this_thread::yield();
+        }
+        pong.Pop();
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+    echo.join();
+    return elapsed / int64_t(rounds);
+}
+
+CASE(ringbuffer_spsc_benchmark)
+{
+    /*
+    * 单生产者单消费者队列的性能对比: 共享计数的 RingBufferSPSC vs 分离缓存行、缓存位置的 RingBufferSPSCCached
+    */
+    const uint64_t count = 10000000;
+    const uint64_t rounds = 100000;
+    bool bad = false;
+    auto old_queue = std::make_unique<ToolBox::RingBufferSPSC<uint64_t, 4096>>();
+    auto new_queue = std::make_unique<ToolBox::RingBufferSPSCCached<uint64_t, 4096>>();
+    int64_t old_us = RunSPSCThroughput<1>(*old_queue, count, bad);
+    int64_t new_us = RunSPSCThroughput<1>(*new_queue, count, bad);
+    int64_t bulk_us = RunSPSCThroughput<32>(*new_queue, count, bad);
+    auto mops = [&](int64_t us)
+    {
+        return us > 0 ? double(count) / double(us) : 0.0;
+    };
+    fprintf(stderr, "[吞吐] RingBufferSPSC %.1f M/s, RingBufferSPSCCached %.1f M/s, 批量[32] %.1f M/s\n", mops(old_us), mops(new_us), mops(bulk_us));
+    auto old_ping = std::make_unique<ToolBox::RingBufferSPSC<uint64_t, 4096>>();
+    auto old_pong = std::make_unique<ToolBox::RingBufferSPSC<uint64_t, 4096>>();
+    auto new_ping = std::make_unique<ToolBox::RingBufferSPSCCached<uint64_t, 4096>>();
+    auto new_pong = std::make_unique<ToolBox::RingBufferSPSCCached<uint64_t, 4096>>();
+    int64_t old_rtt = RunSPSCPingPong(*old_ping, *old_pong, rounds);
+    int64_t new_rtt = RunSPSCPingPong(*new_ping, *new_pong, rounds);
+    fprintf(stderr, "[往返延迟] RingBufferSPSC %lld ns, RingBufferSPSCCached %lld ns\n", (long long)old_rtt, (long long)new_rtt);
+    if (bad)
+    {
+        SetError("ringbuffer_spsc_benchmark 收到的数据顺序错误.");
+    }
+}
+
 FIXTURE_END(RingBuffer)
\ No newline at end of file
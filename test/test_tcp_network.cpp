@@ -2,6 +2,20 @@
 #include "unit_test_frame/unittest.h"
 #include "tools/log.h"
 #include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 #include "tools/time_util.h"
 #include "tools/memory_pool_lock_free.h"
 #ifdef USE_GPERF_TOOLS
@@ -430,4 +444,1443 @@ CASE(test_tcp_forward)
     return;
 }
 
+CASE(test_tcp_broadcast)
+{
+    /*
+    * 本机回环测试广播: 一次序列化,按网络线程分组后分发给所有连接
+    */
+    fprintf(stderr, "网络库测试用例: test_tcp_broadcast \n");
+    const uint32_t client_num = 8;
+    const uint32_t broadcast_times = 50;
+    std::vector<uint64_t> accepted_conn_ids;
+    uint32_t recv_packets = 0;
+    bool data_error = false;
+    ToolBox::Network network_server;
+    ToolBox::Network network_client;
+    network_server.SetOnAccepted([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id)
+    {
+        accepted_conn_ids.emplace_back(conn_id);
+    });
+    network_client.SetOnReceived([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, const char* data, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            if (data[i] != char('a' + i % 26))
+            {
+                data_error = true;
+                break;
+            }
+        }
+        recv_packets++;
+    });
+    network_server.Start(3);
+    network_client.Start(2);
+    network_server.Accept(ToolBox::NT_TCP, 9700, "127.0.0.1", 9700);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    for (uint32_t i = 0; i < client_num; i++)
+    {
+        network_client.Connect(ToolBox::NT_TCP, 9700, "127.0.0.1", 9700);
+    }
+    for (uint32_t i = 0; i < 1000 && accepted_conn_ids.size() < client_num; i++)
+    {
+        network_server.Update();
+        network_client.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (accepted_conn_ids.size() != client_num)
+    {
+        SetError("广播测试建立连接失败.");
+    }
+    // 大包走零拷贝队列,小包走拷贝路径
+    std::string payload(16 * 1024, 0);
+    for (size_t i = 0; i < payload.size(); i++)
+    {
+        payload[i] = char('a' + i % 26);
+    }
+    for (uint32_t i = 0; i < broadcast_times; i++)
+    {
+        network_server.Broadcast(accepted_conn_ids, payload.data(), i % 2 ? 64 : payload.size());
+    }
+    for (uint32_t i = 0; i < 3000 && recv_packets < client_num * broadcast_times; i++)
+    {
+        network_server.Update();
+        network_client.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (recv_packets != client_num * broadcast_times || data_error)
+    {
+        SetError("广播测试收包数量或内容错误.");
+    }
+    // 每个网络线程各有一个到逻辑线程的队列,收包事件全部经由客户端的队列投递
+    auto queue_stats = network_client.GetEventQueueStats();
+    uint64_t pushed = 0;
+    for (const auto& stat : queue_stats)
+    {
+        pushed += stat.to_main_pushed;
+        if (stat.to_main_dropped > 0 || stat.to_main_depth > 0)
+        {
+            SetError("事件队列统计错误.");
+        }
+    }
+    if (queue_stats.size() != 2 || pushed < client_num * broadcast_times)
+    {
+        SetError("事件队列统计数量错误.");
+    }
+    network_client.StopWait();
+    network_server.StopWait();
+}
+
+
+CASE(test_tcp_placement)
+{
+    /*
+    * 本机回环测试新连接的分配策略: 服务器按最少连接数分配被动连接,客户端按一致性哈希分配主动连接
+    */
+    fprintf(stderr, "网络库测试用例: test_tcp_placement \n");
+    const uint32_t server_thread_num = 4;
+    const uint32_t client_num = 40;
+    uint32_t accepted = 0;
+    uint32_t connected = 0;
+    ToolBox::Network network_server;
+    ToolBox::Network network_client;
+    network_server.SetPlacementPolicy(ToolBox::NPP_LEAST_CONNECTIONS);
+    network_client.SetPlacementPolicy(ToolBox::NPP_CONSISTENT_HASH);
+    network_server.SetOnAccepted([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id)
+    {
+        accepted++;
+    });
+    network_client.SetOnConnected([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id)
+    {
+        connected++;
+    });
+    network_server.Start(server_thread_num);
+    network_client.Start(3);
+    network_server.Accept(ToolBox::NT_TCP, 9703, "127.0.0.1", 9703);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    for (uint32_t i = 0; i < client_num; i++)
+    {
+        network_client.Connect(ToolBox::NT_TCP, 9703, "127.0.0.1", 9703);
+    }
+    for (uint32_t i = 0; i < 2000 && (accepted < client_num || connected < client_num); i++)
+    {
+        network_server.Update();
+        network_client.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (accepted != client_num || connected != client_num)
+    {
+        SetError("分配策略测试建立连接失败.");
+    }
+    // 等待网络线程发布连接数
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    auto server_loads = network_server.GetThreadLoadStats();
+    uint64_t placed = 0;
+    for (const auto& load : server_loads)
+    {
+        placed += load.placed;
+        // 连接数不含第0个网络线程上的监听器
+        uint32_t connections = load.connections;
+        fprintf(stderr, "[服务器] 网络线程:%u 策略:%d 连接数:%u 分配次数:%llu\n", load.net_thread_index, load.policy, connections, (unsigned long long)load.placed);
+        if (load.policy != ToolBox::NPP_LEAST_CONNECTIONS || connections != client_num / server_thread_num)
+        {
+            SetError("最少连接数策略分配不均衡.");
+        }
+    }
+    if (server_loads.size() != server_thread_num || placed != client_num)
+    {
+        SetError("负载快照数量错误.");
+    }
+    // 相同的 信道标记+远端地址 一致性哈希到同一个网络线程
+    uint32_t hashed_threads = 0;
+    for (const auto& load : network_client.GetThreadLoadStats())
+    {
+        if (load.placed > 0)
+        {
+            hashed_threads++;
+            if (load.placed != client_num || load.connections != client_num)
+            {
+                SetError("一致性哈希策略分配错误.");
+            }
+        }
+    }
+    if (1 != hashed_threads)
+    {
+        SetError("一致性哈希策略分配到了多个网络线程.");
+    }
+    network_client.StopWait();
+    network_server.StopWait();
+}
+
+CASE(test_tcp_reuseport)
+{
+    /*
+    * 本机回环测试 SO_REUSEPORT 模式: 每个网络线程各自监听,新连接不经过逻辑线程,直接在接受它的网络线程内收发
+    */
+    fprintf(stderr, "网络库测试用例: test_tcp_reuseport \n");
+    const uint32_t server_thread_num = 4;
+    const uint32_t client_num = 64;
+    uint32_t binded = 0;
+    uint32_t accepting = 0;
+    uint32_t accepted = 0;
+    uint32_t echoed = 0;
+    std::vector<uint64_t> client_conn_ids;
+    ToolBox::Network network_server;
+    ToolBox::Network network_client;
+    network_server.SetAcceptMode(ToolBox::NAM_REUSEPORT);
+    network_server.SetOnBinded([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, const std::string & ip, uint16_t port)
+    {
+        binded++;
+    });
+    network_server.SetOnAccepting([&](ToolBox::NetworkType type, uint64_t opaque, int32_t fd)
+    {
+        accepting++;
+    });
+    network_server.SetOnAccepted([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id)
+    {
+        accepted++;
+    });
+    network_server.SetOnReceived([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, const char* data, size_t size)
+    {
+        network_server.Send(conn_id, data, size);
+    });
+    network_client.SetOnConnected([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id)
+    {
+        client_conn_ids.emplace_back(conn_id);
+    });
+    network_client.SetOnReceived([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, const char* data, size_t size)
+    {
+        echoed++;
+    });
+    // 启动前调用 Accept,启动时扩散到所有网络线程
+    network_server.Accept(ToolBox::NT_TCP, 9704, "127.0.0.1", 9704);
+    network_server.Start(server_thread_num);
+    network_client.Start(2);
+    for (uint32_t i = 0; i < 1000 && binded < server_thread_num; i++)
+    {
+        network_server.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    for (uint32_t i = 0; i < client_num; i++)
+    {
+        network_client.Connect(ToolBox::NT_TCP, 9704, "127.0.0.1", 9704);
+    }
+    for (uint32_t i = 0; i < 2000 && (accepted < client_num || client_conn_ids.size() < client_num); i++)
+    {
+        network_server.Update();
+        network_client.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const char ping[] = "reuseport";
+    for (auto conn_id : client_conn_ids)
+    {
+        network_client.Send(conn_id, ping, sizeof(ping));
+    }
+    for (uint32_t i = 0; i < 2000 && echoed < client_num; i++)
+    {
+        network_server.Update();
+        network_client.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (binded != server_thread_num || accepting != 0 || accepted != client_num || echoed != client_num)
+    {
+        SetError("SO_REUSEPORT 模式监听或收发错误.");
+    }
+    // 内核按四元组哈希在各监听器之间分配连接
+    uint32_t busy_threads = 0;
+    for (const auto& load : network_server.GetThreadLoadStats())
+    {
+        fprintf(stderr, "[服务器] 网络线程:%u 连接数:%u\n", load.net_thread_index, load.connections);
+        busy_threads += load.connections > 0 ? 1 : 0;
+    }
+    if (busy_threads < 2)
+    {
+        SetError("SO_REUSEPORT 模式没有把连接分散到多个网络线程.");
+    }
+    network_client.StopWait();
+    network_server.StopWait();
+}
+
+CASE(test_tcp_send_syscalls)
+{
+    /*
+    * 本机回环测试发送刷新的系统调用数: 开启模拟 Nagle 后,ringbuffer 回绕的两段数据通过一次 writev 发出
+    */
+    fprintf(stderr, "网络库测试用例: test_tcp_send_syscalls \n");
+    const uint32_t packet_num = 20000;
+    const uint32_t packet_size = 100;
+    uint64_t received = 0;
+    bool connected = false;
+    uint64_t client_conn_id = 0;
+    ToolBox::Network network_server;
+    ToolBox::Network network_client;
+    network_server.SetOnReceived([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, const char* data, size_t size)
+    {
+        received += size;
+    });
+    network_client.SetOnConnected([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id)
+    {
+        connected = true;
+        client_conn_id = conn_id;
+    });
+    network_server.Start(1);
+    network_client.Start(1);
+    network_client.SetSimulateNagle(8, 2);
+    network_server.Accept(ToolBox::NT_TCP, 9705, "127.0.0.1", 9705);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    network_client.Connect(ToolBox::NT_TCP, 9705, "127.0.0.1", 9705);
+    for (uint32_t i = 0; i < 1000 && !connected; i++)
+    {
+        network_client.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    char packet[packet_size];
+    memset(packet, 'w', sizeof(packet));
+    for (uint32_t i = 0; i < packet_num && connected; i++)
+    {
+        network_client.Send(client_conn_id, packet, sizeof(packet));
+        if (0 == i % 64)
+        {
+            network_server.Update();
+        }
+    }
+    for (uint32_t i = 0; i < 3000 && received < uint64_t(packet_num) * packet_size; i++)
+    {
+        network_server.Update();
+        network_client.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (received != uint64_t(packet_num) * packet_size)
+    {
+        SetError("发送刷新测试数据接收不完整.");
+    }
+    uint64_t flushes = 0;
+    uint64_t syscalls = 0;
+    for (const auto& load : network_client.GetThreadLoadStats())
+    {
+        flushes += load.send_flushes;
+        syscalls += load.send_syscalls;
+    }
+    fprintf(stderr, "[客户端] 发送刷新次数:%llu 系统调用次数:%llu 每次刷新系统调用数:%.3f\n",
+            (unsigned long long)flushes, (unsigned long long)syscalls, flushes > 0 ? double(syscalls) / double(flushes) : 0.0);
+    // 每次刷新最多一次 ringbuffer 的系统调用,只有零拷贝队列超过 iov 上限时才会多于一次
+    if (0 == flushes || syscalls != flushes)
+    {
+        SetError("发送刷新的系统调用数不为 1.");
+    }
+    network_client.StopWait();
+    network_server.StopWait();
+}
+/*
+* 统计进程消耗的 cpu 时间(用户态+内核态),单位微秒
+*/
+static int64_t GetProcessCpuMicroSeconds()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+CASE(test_tcp_worker_wait)
+{
+    /*
+    * 对比网络线程空闲时 阻塞等待+eventfd唤醒 与 固定超时轮询 的空闲cpu占用与指令延迟
+    * 指令延迟: 逻辑线程忙等驱动 Update,测量本机回环 ping-pong 的往返时间,其中包含两次 逻辑线程->网络线程 的投递
+    */
+    fprintf(stderr, "网络库测试用例: test_tcp_worker_wait \n");
+    const uint32_t idle_msec = 1000;
+    const uint32_t round_trips = 200;
+    for (bool blocking_wait : {false, true})
+    {
+        bool accepted = false;
+        bool connected = false;
+        uint64_t client_conn_id = 0;
+        uint32_t pongs = 0;
+        ToolBox::Network network_server;
+        ToolBox::Network network_client;
+        network_server.SetWorkerBlockingWait(blocking_wait);
+        network_client.SetWorkerBlockingWait(blocking_wait);
+        network_server.SetOnAccepted([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id)
+        {
+            accepted = true;
+        });
+        network_server.SetOnReceived([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, const char* data, size_t size)
+        {
+            network_server.Send(conn_id, data, size);
+        });
+        network_client.SetOnConnected([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id)
+        {
+            client_conn_id = conn_id;
+            connected = true;
+        });
+        network_client.SetOnReceived([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, const char* data, size_t size)
+        {
+            pongs++;
+        });
+        network_server.Start(1);
+        network_client.Start(1);
+        // 两轮使用不同的端口
+        uint16_t port = blocking_wait ? 9702 : 9701;
+        network_server.Accept(ToolBox::NT_TCP, port, "127.0.0.1", port);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        network_client.Connect(ToolBox::NT_TCP, port, "127.0.0.1", port);
+        for (uint32_t i = 0; i < 1000 && (!accepted || !connected); i++)
+        {
+            network_server.Update();
+            network_client.Update();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (!accepted || !connected)
+        {
+            SetError("建立连接失败.");
+            network_client.StopWait();
+            network_server.StopWait();
+            continue;
+        }
+        // 空闲cpu: 逻辑线程休眠,只统计网络线程的消耗
+        int64_t cpu_begin = GetProcessCpuMicroSeconds();
+        std::this_thread::sleep_for(std::chrono::milliseconds(idle_msec));
+        int64_t idle_cpu = GetProcessCpuMicroSeconds() - cpu_begin;
+        // 指令延迟
+        const char ping[64] = "ping";
+        auto begin = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < round_trips; i++)
+        {
+            uint32_t expect = pongs + 1;
+            network_client.Send(client_conn_id, ping, sizeof(ping));
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+            while (pongs < expect && std::chrono::steady_clock::now() < deadline)
+            {
+                network_client.Update();
+                network_server.Update();
+            }
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+        fprintf(stderr, "[%s] 空闲 %u ms 消耗cpu %lld us, %u 次往返平均耗时 %lld us\n", blocking_wait ? "阻塞等待" : "定时轮询",
+                idle_msec, (long long)idle_cpu, round_trips, (long long)(elapsed / round_trips));
+        if (pongs != round_trips)
+        {
+            SetError("往返次数错误.");
+        }
+        network_client.StopWait();
+        network_server.StopWait();
+    }
+}
+
+/*
+* 本机回环 ping-pong,服务器与客户端各有一个逻辑线程忙等驱动 Update,返回每次往返的微秒数,建立连接失败时为空
+* 低延迟模式下网络线程阻塞前忙轮询,cpu 足够时各自绑核,逻辑线程改用 SpinUpdate
+*/
+static std::vector<int64_t> RunTcpPingPong(bool latency_mode, uint32_t round_trips, uint16_t port)
+{
+    std::vector<int64_t> rtts;
+    std::atomic_bool accepted = false;
+    std::atomic_bool server_stop = false;
+    bool connected = false;
+    uint64_t client_conn_id = 0;
+    uint32_t pongs = 0;
+    ToolBox::Network network_server;
+    ToolBox::Network network_client;
+    if (latency_mode)
+    {
+        ToolBox::NetLatencyMode server_mode;
+        ToolBox::NetLatencyMode client_mode;
+        // 两个网络线程与两个逻辑线程都在忙等,cpu 不够时绑核只会互相抢占
+        if (std::thread::hardware_concurrency() >= 4)
+        {
+            server_mode.cpu_affinity = { 1 };
+            client_mode.cpu_affinity = { 2 };
+        }
+        server_mode.spin_usecs = client_mode.spin_usecs = 100;
+        server_mode.busy_poll_usecs = client_mode.busy_poll_usecs = 50;
+        network_server.SetLatencyMode(server_mode);
+        network_client.SetLatencyMode(client_mode);
+    }
+    network_server.SetOnAccepted([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id)
+    {
+        accepted = true;
+    });
+    network_server.SetOnReceived([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, const char* data, size_t size)
+    {
+        network_server.Send(conn_id, data, size);
+    });
+    network_client.SetOnConnected([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id)
+    {
+        client_conn_id = conn_id;
+        connected = true;
+    });
+    network_client.SetOnReceived([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, const char* data, size_t size)
+    {
+        pongs++;
+    });
+    network_server.Start(1);
+    network_client.Start(1);
+    network_server.Accept(ToolBox::NT_TCP, port, "127.0.0.1", port);
+    std::thread server_logic([&]()
+    {
+        while (!server_stop.load(std::memory_order_relaxed))
+        {
+            if (latency_mode)
+            {
+                network_server.SpinUpdate(100);
+            }
+            else
+            {
+                network_server.Update();
+                std::this_thread::yield();
+            }
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    network_client.Connect(ToolBox::NT_TCP, port, "127.0.0.1", port);
+    for (uint32_t i = 0; i < 1000 && (!accepted || !connected); i++)
+    {
+        network_client.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const char ping[64] = "ping";
+    for (uint32_t i = 0; i < round_trips && accepted && connected; i++)
+    {
+        uint32_t expect = pongs + 1;
+        auto begin = std::chrono::steady_clock::now();
+        network_client.Send(client_conn_id, ping, sizeof(ping));
+        auto deadline = begin + std::chrono::seconds(1);
+        while (pongs < expect && std::chrono::steady_clock::now() < deadline)
+        {
+            if (latency_mode)
+            {
+                network_client.SpinUpdate(100);
+            }
+            else
+            {
+                network_client.Update();
+                std::this_thread::yield();
+            }
+        }
+        if (pongs < expect)
+        {
+            break;
+        }
+        rtts.emplace_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count());
+    }
+    server_stop = true;
+    server_logic.join();
+    network_client.StopWait();
+    network_server.StopWait();
+    return rtts;
+}
+
+CASE(test_tcp_latency_mode)
+{
+    /*
+    * ping-pong 往返时延的分布: 默认的阻塞等待 与 低延迟模式[忙轮询+绑核+SO_BUSY_POLL+逻辑线程 SpinUpdate]
+    * cpu 少于 4 个时忙等的线程互相抢占,低延迟模式反而更慢,只打印结果不做比较
+    */
+    fprintf(stderr, "网络库测试用例: test_tcp_latency_mode \n");
+    for (bool latency_mode : {false, true})
+    {
+        // cpu 不够时低延迟模式每次往返要等调度时间片,减少次数以免用例过慢
+        const uint32_t round_trips = (latency_mode && std::thread::hardware_concurrency() < 4) ? 200 : 5000;
+        // 两轮使用不同的端口
+        auto rtts = RunTcpPingPong(latency_mode, round_trips, latency_mode ? 9722 : 9719);
+        if (rtts.size() != round_trips)
+        {
+            SetError("往返次数错误.");
+            continue;
+        }
+        std::sort(rtts.begin(), rtts.end());
+        auto percentile = [&](double p)
+        {
+            return double(rtts[std::min<std::size_t>(rtts.size() - 1, std::size_t(p * rtts.size()))]) / 1000.0;
+        };
+        fprintf(stderr, "[%s] cpu:%u, %u 次往返 p50:%.1f us, p99:%.1f us, p999:%.1f us, max:%.1f us\n", latency_mode ? "低延迟模式" : "阻塞等待",
+                std::thread::hardware_concurrency(), round_trips, percentile(0.5), percentile(0.99), percentile(0.999), double(rtts.back()) / 1000.0);
+    }
+}
+
+/*
+* 客户端连续发送大量小包,服务器按条或批量接收,返回 [接收事件数, 收完耗时微秒],内容或数量不对时事件数为 0
+*/
+static std::pair<uint64_t, int64_t> RunTcpRecvBatch(bool batch, uint32_t packet_num, uint16_t port)
+{
+    const uint32_t packet_size = 32;
+    uint32_t frames = 0;
+    uint64_t events = 0;
+    bool bad = false;
+    bool connected = false;
+    uint64_t client_conn_id = 0;
+    ToolBox::Network network_server;
+    ToolBox::Network network_client;
+    auto on_frame = [&](const char* data, size_t size)
+    {
+        uint32_t seq = 0;
+        if (size != packet_size || (memcpy(&seq, data, sizeof(seq)), seq != frames))
+        {
+            bad = true;
+        }
+        frames++;
+    };
+    if (batch)
+    {
+        network_server.SetRecvBatch(true);
+        network_server.SetOnReceivedBatch([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, const ToolBox::NetRecvBatch & recv_batch)
+        {
+            events++;
+            for (uint32_t index = 0; index < recv_batch.count; index++)
+            {
+                on_frame(recv_batch.Frame(index), recv_batch.FrameSize(index));
+            }
+        });
+    }
+    else
+    {
+        network_server.SetOnReceived([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, const char* data, size_t size)
+        {
+            events++;
+            on_frame(data, size);
+        });
+    }
+    network_client.SetOnConnected([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id)
+    {
+        connected = true;
+        client_conn_id = conn_id;
+    });
+    network_server.Start(1);
+    network_client.Start(1);
+    // 客户端攒包发送,服务器一次读取能解出多个小包
+    network_client.SetSimulateNagle(64, 2);
+    network_server.Accept(ToolBox::NT_TCP, port, "127.0.0.1", port);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    network_client.Connect(ToolBox::NT_TCP, port, "127.0.0.1", port);
+    for (uint32_t i = 0; i < 1000 && !connected; i++)
+    {
+        network_client.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    char packet[packet_size];
+    memset(packet, 'b', sizeof(packet));
+    auto begin = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < packet_num && connected; i++)
+    {
+        memcpy(packet, &i, sizeof(i));
+        network_client.Send(client_conn_id, packet, sizeof(packet));
+        // 不超过逻辑线程到网络线程的事件队列长度
+        for (uint32_t j = 0; j < 5000 && i >= frames + 16384; j++)
+        {
+            network_server.Update();
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+    for (uint32_t i = 0; i < 5000 && frames < packet_num; i++)
+    {
+        network_server.Update();
+        network_client.Update();
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    int64_t cost_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+    network_client.StopWait();
+    network_server.StopWait();
+    return std::make_pair(bad || frames != packet_num ? 0 : events, cost_us);
+}
+
+CASE(test_tcp_recv_batch)
+{
+    /*
+    * 批量接收: 一次读取解出的所有小包合并为一个接收事件,比较事件数与收完的耗时
+    */
+    fprintf(stderr, "网络库测试用例: test_tcp_recv_batch \n");
+    const uint32_t packet_num = 200000;
+    auto single = RunTcpRecvBatch(false, packet_num, 9708);
+    auto batch = RunTcpRecvBatch(true, packet_num, 9709);
+    fprintf(stderr, "[接收] 小包数:%u 按条: 事件数:%llu 耗时:%lldms, 批量: 事件数:%llu 耗时:%lldms 平均每批:%.1f条\n", packet_num,
+            (unsigned long long)single.first, (long long)single.second / 1000,
+            (unsigned long long)batch.first, (long long)batch.second / 1000, batch.first > 0 ? double(packet_num) / double(batch.first) : 0.0);
+    if (single.first != packet_num)
+    {
+        SetError("按条接收的数据不完整.");
+    }
+    if (0 == batch.first || batch.first >= packet_num)
+    {
+        SetError("批量接收的数据不完整或没有合并.");
+    }
+}
+
+/*
+* 服务器为 opaque 设置解码器,原始套接字客户端把 stream 分成小段发出,返回服务器按顺序收到的消息
+*/
+static std::vector<std::string> RunTcpDecoder(ToolBox::NetDecoderCreator creator, bool batch, const std::string& stream, uint16_t port)
+{
+    std::vector<std::string> messages;
+    ToolBox::Network network_server;
+    network_server.SetDecoder(port, creator);
+    network_server.SetRecvBatch(batch);
+    network_server.SetOnReceived([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, const char* data, size_t size)
+    {
+        messages.emplace_back(data, size);
+    });
+    network_server.Start(1);
+    network_server.Accept(ToolBox::NT_TCP, port, "127.0.0.1", port);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (0 == connect(fd, (sockaddr*)&addr, sizeof(addr)))
+    {
+        // 每段 7 字节,消息头与消息体都会被拆开
+        for (std::size_t offset = 0; offset < stream.size(); offset += 7)
+        {
+            send(fd, stream.data() + offset, (std::min)(std::size_t(7), stream.size() - offset), 0);
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            network_server.Update();
+        }
+    }
+    for (uint32_t i = 0; i < 200; i++)
+    {
+        network_server.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    close(fd);
+    network_server.StopWait();
+    return messages;
+}
+
+CASE(test_tcp_decoder)
+{
+    /*
+    * 自定义消息格式: varint 长度头逐条接收, HTTP 风格的消息批量接收
+    */
+    fprintf(stderr, "网络库测试用例: test_tcp_decoder \n");
+    std::vector<std::string> expect;
+    std::string stream;
+    for (uint32_t i = 0; i < 50; i++)
+    {
+        std::string payload(i * 7, char('a' + i % 26));
+        expect.push_back(payload);
+        for (uint32_t len = static_cast<uint32_t>(payload.size()); ; len >>= 7)
+        {
+            stream.push_back(char((len & 0x7F) | (len >= 0x80 ? 0x80 : 0)));
+            if (len < 0x80)
+            {
+                break;
+            }
+        }
+        stream += payload;
+    }
+    auto varint_messages = RunTcpDecoder([]
+    {
+        return std::make_unique<ToolBox::NetVarintDecoder>();
+    }, false, stream, 9712);
+    if (varint_messages != expect)
+    {
+        SetError("varint 格式的消息解码错误.");
+    }
+
+    expect.clear();
+    stream.clear();
+    for (uint32_t i = 0; i < 20; i++)
+    {
+        std::string body(i * 3, char('A' + i % 26));
+        std::string message = "POST /echo HTTP/1.1\r\nHost: localhost\r\ncontent-length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+        expect.push_back(message);
+        stream += message;
+    }
+    auto http_messages = RunTcpDecoder([]
+    {
+        return std::make_unique<ToolBox::NetHttpDecoder>();
+    }, true, stream, 9713);
+    if (http_messages != expect)
+    {
+        SetError("HTTP 格式的消息解码错误.");
+    }
+    fprintf(stderr, "[解码] varint 消息数:%zu, HTTP 消息数:%zu\n", varint_messages.size(), http_messages.size());
+
+    // 超长的 Content-Length 溢出后不能变成较小的长度
+    for (const char* content_length : { "18446744073709551626", "99999999999" })
+    {
+        std::string header = std::string("POST / HTTP/1.1\r\nContent-Length: ") + content_length + "\r\n\r\n0123456789";
+        ToolBox::NetRecvView view;
+        view.data[0] = header.data();
+        view.size[0] = header.size();
+        ToolBox::NetDecodedFrame frame;
+        ToolBox::NetHttpDecoder decoder;
+        if (ToolBox::NDR_ERROR != decoder.Decode(view, 1024 * 1024, frame))
+        {
+            SetError("HTTP 超长 Content-Length 没有被拒绝.");
+        }
+    }
+}
+
+/*
+* 回声吞吐: 客户端保持 window 个包在途,服务器逐条回显,返回 [回显包数, 耗时微秒]
+* 每个包在两端各经过一次发送事件与接收事件,用于比较网络事件对象与内存的分配方式
+*/
+static std::pair<uint32_t, int64_t> RunTcpEchoThroughput(uint32_t packet_num, uint32_t window, uint16_t port)
+{
+    const uint32_t packet_size = 64;
+    uint32_t sent = 0;
+    uint32_t echoed = 0;
+    bool connected = false;
+    uint64_t client_conn_id = 0;
+    ToolBox::Network network_server;
+    ToolBox::Network network_client;
+    network_server.SetOnReceived([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, const char* data, size_t size)
+    {
+        network_server.Send(conn_id, data, size);
+    });
+    network_client.SetOnConnected([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id)
+    {
+        connected = true;
+        client_conn_id = conn_id;
+    }).SetOnReceived([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, const char* data, size_t size)
+    {
+        echoed++;
+    });
+    network_server.Start(1);
+    network_client.Start(1);
+    network_server.Accept(ToolBox::NT_TCP, port, "127.0.0.1", port);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    network_client.Connect(ToolBox::NT_TCP, port, "127.0.0.1", port);
+    for (uint32_t i = 0; i < 1000 && !connected; i++)
+    {
+        network_client.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::thread server_thread([&]()
+    {
+        auto begin = std::chrono::steady_clock::now();
+        while (echoed < packet_num && std::chrono::steady_clock::now() - begin < std::chrono::seconds(20))
+        {
+            network_server.Update();
+        }
+    });
+    char packet[packet_size];
+    memset(packet, 'e', sizeof(packet));
+    auto begin = std::chrono::steady_clock::now();
+    while (connected && echoed < packet_num && std::chrono::steady_clock::now() - begin < std::chrono::seconds(20))
+    {
+        while (sent < packet_num && sent - echoed < window)
+        {
+            network_client.Send(client_conn_id, packet, sizeof(packet));
+            sent++;
+        }
+        network_client.Update();
+    }
+    int64_t cost_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+    server_thread.join();
+    network_client.StopWait();
+    network_server.StopWait();
+    return std::make_pair(echoed, cost_us);
+}
+
+CASE(test_tcp_echo_throughput)
+{
+    /*
+    * 单连接回声吞吐,打印每秒回显包数
+    */
+    fprintf(stderr, "网络库测试用例: test_tcp_echo_throughput \n");
+    const uint32_t packet_num = 500000;
+    auto result = RunTcpEchoThroughput(packet_num, 1024, 9714);
+    fprintf(stderr, "[回声] 包数:%u 回显:%u 耗时:%lldms 每秒:%.0f\n", packet_num, result.first, (long long)result.second / 1000,
+            result.second > 0 ? result.first * 1000000.0 / result.second : 0.0);
+    if (result.first != packet_num)
+    {
+        SetError("回声数据不完整.");
+    }
+}
+
+/*
+* 建立 conn_num 个连接同时回声,每个连接保持 window 个包在途,返回 [回显包数, 耗时微秒]
+*/
+static std::pair<uint64_t, int64_t> RunTcpEchoMultiConn(uint32_t conn_num, uint32_t packets_per_conn, uint32_t window, uint16_t port)
+{
+    const uint32_t packet_size = 64;
+    const uint64_t packet_num = uint64_t(conn_num) * packets_per_conn;
+    uint64_t echoed_total = 0;
+    std::vector<uint64_t> client_conn_ids;
+    std::unordered_map<uint64_t, uint32_t> echoed;
+    ToolBox::Network network_server;
+    ToolBox::Network network_client;
+    network_server.SetOnReceived([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, const char* data, size_t size)
+    {
+        network_server.Send(conn_id, data, size);
+    });
+    network_client.SetOnConnected([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id)
+    {
+        client_conn_ids.emplace_back(conn_id);
+        echoed[conn_id] = 0;
+    }).SetOnReceived([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, const char* data, size_t size)
+    {
+        echoed[conn_id]++;
+        echoed_total++;
+    });
+    network_server.Start(2);
+    network_client.Start(2);
+    network_server.Accept(ToolBox::NT_TCP, port, "127.0.0.1", port);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    // 分批连接,避免超过监听队列
+    for (uint32_t i = 0; i < conn_num; i++)
+    {
+        network_client.Connect(ToolBox::NT_TCP, port, "127.0.0.1", port);
+        if (0 == (i + 1) % 100)
+        {
+            for (uint32_t j = 0; j < 1000 && client_conn_ids.size() < i + 1; j++)
+            {
+                network_client.Update();
+                network_server.Update();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+    for (uint32_t i = 0; i < 3000 && client_conn_ids.size() < conn_num; i++)
+    {
+        network_client.Update();
+        network_server.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    bool connected = client_conn_ids.size() == conn_num;
+    std::thread server_thread([&]()
+    {
+        auto begin = std::chrono::steady_clock::now();
+        while (connected && echoed_total < packet_num && std::chrono::steady_clock::now() - begin < std::chrono::seconds(20))
+        {
+            network_server.Update();
+        }
+    });
+    char packet[packet_size];
+    memset(packet, 'm', sizeof(packet));
+    std::vector<uint32_t> sent(conn_num, 0);
+    auto begin = std::chrono::steady_clock::now();
+    while (connected && echoed_total < packet_num && std::chrono::steady_clock::now() - begin < std::chrono::seconds(20))
+    {
+        for (uint32_t i = 0; i < conn_num; i++)
+        {
+            uint64_t conn_id = client_conn_ids[i];
+            while (sent[i] < packets_per_conn && sent[i] - echoed[conn_id] < window)
+            {
+                network_client.Send(conn_id, packet, sizeof(packet));
+                sent[i]++;
+            }
+        }
+        network_client.Update();
+    }
+    int64_t cost_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+    server_thread.join();
+    network_client.StopWait();
+    network_server.StopWait();
+    return std::make_pair(echoed_total, cost_us);
+}
+
+CASE(test_tcp_echo_multi_conn)
+{
+    /*
+    * 多连接回声吞吐,用于对比 epoll 与 io_uring 后端[CMAKE_USE_LIBIOURING],打印每秒回显包数
+    */
+    fprintf(stderr, "网络库测试用例: test_tcp_echo_multi_conn \n");
+    const uint32_t conn_num = 200;
+    const uint32_t packets_per_conn = 2000;
+    auto result = RunTcpEchoMultiConn(conn_num, packets_per_conn, 16, 9718);
+    fprintf(stderr, "[多连接回声] 连接数:%u 包数:%u 回显:%llu 耗时:%lldms 每秒:%.0f\n", conn_num, conn_num * packets_per_conn,
+            (unsigned long long)result.first, (long long)result.second / 1000,
+            result.second > 0 ? result.first * 1000000.0 / result.second : 0.0);
+    if (result.first != uint64_t(conn_num) * packets_per_conn)
+    {
+        SetError("多连接回声数据不完整.");
+    }
+}
+
+/*
+* 建立 conn_num 个连接,其中十分之一发送一段数据后全部空闲,返回服务器每个连接的缓冲区字节数[活跃时,空闲缩容后]
+*/
+static std::pair<uint64_t, uint64_t> RunTcpBufferMemory(bool adaptive, uint32_t conn_num, uint16_t port)
+{
+    const uint32_t burst_size = 64 * 1024;
+    uint32_t accepted = 0;
+    uint64_t received = 0;
+    std::vector<uint64_t> client_conn_ids;
+    ToolBox::Network network_server;
+    ToolBox::Network network_client;
+    network_server.SetOnAccepted([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id)
+    {
+        accepted++;
+    });
+    network_server.SetOnReceived([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, const char* data, size_t size)
+    {
+        received += size;
+    });
+    network_client.SetOnConnected([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id)
+    {
+        client_conn_ids.emplace_back(conn_id);
+    });
+    network_server.Start(2);
+    network_client.Start(2);
+    network_server.SetAdaptiveBuffer(adaptive);
+    network_server.Accept(ToolBox::NT_TCP, port, "127.0.0.1", port);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    // 分批连接,避免超过监听队列
+    for (uint32_t i = 0; i < conn_num; i++)
+    {
+        network_client.Connect(ToolBox::NT_TCP, port, "127.0.0.1", port);
+        if (0 == (i + 1) % 100)
+        {
+            for (uint32_t j = 0; j < 1000 && client_conn_ids.size() < i + 1; j++)
+            {
+                network_client.Update();
+                network_server.Update();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+    for (uint32_t i = 0; i < 3000 && (client_conn_ids.size() < conn_num || accepted < conn_num); i++)
+    {
+        network_client.Update();
+        network_server.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::vector<char> burst(burst_size, 'm');
+    uint64_t expect = 0;
+    for (std::size_t i = 0; i < client_conn_ids.size(); i += 10)
+    {
+        network_client.Send(client_conn_ids[i], burst.data(), burst_size);
+        expect += burst_size;
+    }
+    for (uint32_t i = 0; i < 3000 && received < expect; i++)
+    {
+        network_client.Update();
+        network_server.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    auto bytes_per_conn = [&]() -> uint64_t
+    {
+        uint64_t buffer_bytes = 0;
+        for (const auto& load : network_server.GetThreadLoadStats())
+        {
+            buffer_bytes += load.buffer_bytes;
+        }
+        return accepted > 0 ? buffer_bytes / accepted : 0;
+    };
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    uint64_t active_bytes = bytes_per_conn();
+    // 第一次检查按本轮峰值保留,第二次检查时空闲的缓冲区回到最小块
+    std::this_thread::sleep_for(std::chrono::milliseconds(3000));
+    uint64_t idle_bytes = bytes_per_conn();
+    if (accepted != conn_num || received != expect)
+    {
+        fprintf(stderr, "[缓冲区] 连接或数据不完整 accepted:%u received:%llu expect:%llu\n", accepted, (unsigned long long)received, (unsigned long long)expect);
+        active_bytes = idle_bytes = 0;
+    }
+    network_client.StopWait();
+    network_server.StopWait();
+    return std::make_pair(active_bytes, idle_bytes);
+}
+
+CASE(test_tcp_adaptive_buffer_memory)
+{
+    /*
+    * 每连接缓冲区内存: 固定模式每连接预留 2 个 256K,自适应模式从 4K 开始按需倍增,空闲后缩容.
+    * 受进程文件描述符上限所限,实测 2000 个连接,再按每连接字节数折算到 1万/5万 连接
+    */
+    fprintf(stderr, "网络库测试用例: test_tcp_adaptive_buffer_memory \n");
+    const uint32_t conn_num = 2000;
+    auto fixed = RunTcpBufferMemory(false, conn_num, 9706);
+    auto adaptive = RunTcpBufferMemory(true, conn_num, 9707);
+    for (const auto& [name, result] : { std::make_pair("固定", fixed), std::make_pair("自适应", adaptive) })
+    {
+        fprintf(stderr, "[缓冲区][%s] 每连接 活跃时:%lluB 空闲后:%lluB, 折算 1万连接:%lluMB 5万连接:%lluMB\n", name,
+                (unsigned long long)result.first, (unsigned long long)result.second,
+                (unsigned long long)(result.second * 10000 >> 20), (unsigned long long)(result.second * 50000 >> 20));
+    }
+    if (0 == fixed.second || 0 == adaptive.second)
+    {
+        SetError("缓冲区内存测试连接或数据不完整.");
+    }
+    else if (adaptive.second * 16 > fixed.second)
+    {
+        SetError("自适应缓冲区空闲后没有缩容.");
+    }
+}
+
+/*
+* 服务器一次关闭全部连接,返回 <关闭回调数, 从发起关闭到全部回调完成的耗时微秒>
+*/
+static std::pair<uint32_t, int64_t> RunTcpMassClose(uint32_t conn_num, uint16_t port)
+{
+    std::vector<uint64_t> server_conn_ids;
+    uint32_t connected = 0;
+    uint32_t closed = 0;
+    ToolBox::Network network_server;
+    ToolBox::Network network_client;
+    network_server.SetOnAccepted([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id)
+    {
+        server_conn_ids.emplace_back(conn_id);
+    });
+    network_server.SetOnClose([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, ToolBox::ENetErrCode net_err, int32_t sys_err)
+    {
+        closed++;
+    });
+    network_client.SetOnConnected([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id)
+    {
+        connected++;
+    });
+    // 单个网络线程,所有连接落在同一个 socket 池中
+    network_server.Start(1);
+    network_client.Start(2);
+    network_server.Accept(ToolBox::NT_TCP, port, "127.0.0.1", port);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    for (uint32_t i = 0; i < conn_num; i++)
+    {
+        network_client.Connect(ToolBox::NT_TCP, port, "127.0.0.1", port);
+        if (0 == (i + 1) % 100)
+        {
+            for (uint32_t j = 0; j < 1000 && connected < i + 1; j++)
+            {
+                network_client.Update();
+                network_server.Update();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+    for (uint32_t i = 0; i < 3000 && server_conn_ids.size() < conn_num; i++)
+    {
+        network_client.Update();
+        network_server.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    auto begin = std::chrono::steady_clock::now();
+    for (auto conn_id : server_conn_ids)
+    {
+        network_server.Close(conn_id);
+    }
+    while (closed < server_conn_ids.size() && std::chrono::steady_clock::now() - begin < std::chrono::seconds(10))
+    {
+        network_client.Update();
+        network_server.Update();
+    }
+    int64_t cost_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+    // 已关闭的连接ID不能再找到复用槽位上的新连接
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        network_client.Connect(ToolBox::NT_TCP, port, "127.0.0.1", port);
+    }
+    for (uint32_t i = 0; i < 1000 && server_conn_ids.size() < conn_num + 100; i++)
+    {
+        network_client.Update();
+        network_server.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    uint32_t stale_closed = closed;
+    for (uint32_t i = 0; i < conn_num && i < server_conn_ids.size(); i++)
+    {
+        network_server.Close(server_conn_ids[i]);
+    }
+    for (uint32_t i = 0; i < 200; i++)
+    {
+        network_client.Update();
+        network_server.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (server_conn_ids.size() != conn_num + 100 || closed != stale_closed)
+    {
+        fprintf(stderr, "[批量关闭] 重连数或过期连接ID关闭错误 accepted:%zu closed:%u->%u\n", server_conn_ids.size(), stale_closed, closed);
+        closed = 0;
+    }
+    network_client.StopWait();
+    network_server.StopWait();
+    return std::make_pair(closed, cost_us);
+}
+
+CASE(test_tcp_mass_close)
+{
+    /*
+    * 一个网络线程上的大量连接同时关闭,socket 池的分配、归还都是 O(1),总耗时随连接数线性增长;
+    * 过期的连接ID不会关闭复用同一槽位的新连接
+    */
+    fprintf(stderr, "网络库测试用例: test_tcp_mass_close \n");
+    uint16_t port = 9715;
+    for (uint32_t conn_num : { 2000u, 8000u })
+    {
+        auto [closed, cost_us] = RunTcpMassClose(conn_num, port++);
+        fprintf(stderr, "[批量关闭] %u 个连接全部关闭耗时:%lldms\n", conn_num, (long long)cost_us / 1000);
+        if (closed != conn_num)
+        {
+            SetError("批量关闭的连接数错误.");
+        }
+    }
+}
+
+/*
+* 服务器开启模拟 Nagle,大量空闲连接中只有少数连接收发数据,返回服务器网络线程的负载统计与回显字节数
+*/
+static std::pair<ToolBox::NetThreadLoad, uint64_t> RunTcpNagleDirty(uint32_t conn_num, uint32_t active_num, uint16_t port)
+{
+    const uint32_t packet_size = 64;
+    const uint32_t rounds = 500;
+    std::vector<uint64_t> client_conn_ids;
+    uint32_t accepted = 0;
+    uint64_t echoed = 0;
+    ToolBox::Network network_server;
+    ToolBox::Network network_client;
+    network_server.SetOnAccepted([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id)
+    {
+        accepted++;
+    });
+    network_server.SetOnReceived([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, const char* data, size_t size)
+    {
+        network_server.Send(conn_id, data, size);
+    });
+    network_client.SetOnConnected([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id)
+    {
+        client_conn_ids.emplace_back(conn_id);
+    }).SetOnReceived([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, const char* data, size_t size)
+    {
+        echoed += size;
+    });
+    network_server.Start(1);
+    network_client.Start(2);
+    // 攒满 1000 个包之前只靠 2ms 的定时刷新发送
+    network_server.SetSimulateNagle(1000, 2);
+    network_server.Accept(ToolBox::NT_TCP, port, "127.0.0.1", port);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    for (uint32_t i = 0; i < conn_num; i++)
+    {
+        network_client.Connect(ToolBox::NT_TCP, port, "127.0.0.1", port);
+        if (0 == (i + 1) % 100)
+        {
+            for (uint32_t j = 0; j < 1000 && client_conn_ids.size() < i + 1; j++)
+            {
+                network_client.Update();
+                network_server.Update();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+    for (uint32_t i = 0; i < 3000 && (client_conn_ids.size() < conn_num || accepted < conn_num); i++)
+    {
+        network_client.Update();
+        network_server.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    auto before = network_server.GetThreadLoadStats()[0];
+    char packet[packet_size];
+    memset(packet, 'n', sizeof(packet));
+    uint64_t expect = 0;
+    for (uint32_t round = 0; round < rounds; round++)
+    {
+        for (uint32_t i = 0; i < active_num && i < client_conn_ids.size(); i++)
+        {
+            network_client.Send(client_conn_ids[i], packet, sizeof(packet));
+            expect += packet_size;
+        }
+        network_client.Update();
+        network_server.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    for (uint32_t i = 0; i < 3000 && echoed < expect; i++)
+    {
+        network_client.Update();
+        network_server.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    auto load = network_server.GetThreadLoadStats()[0];
+    load.nagle_scanned -= before.nagle_scanned;
+    load.nagle_flushed -= before.nagle_flushed;
+    if (accepted != conn_num || echoed != expect)
+    {
+        fprintf(stderr, "[模拟Nagle] 连接或数据不完整 accepted:%u echoed:%llu expect:%llu\n", accepted, (unsigned long long)echoed, (unsigned long long)expect);
+        echoed = 0;
+    }
+    network_client.StopWait();
+    network_server.StopWait();
+    return std::make_pair(load, echoed);
+}
+
+CASE(test_tcp_nagle_dirty)
+{
+    /*
+    * 模拟 Nagle 的定时刷新只遍历有积攒数据或延后读取的 socket,遍历数与活跃连接数成正比,与空闲连接数无关
+    */
+    fprintf(stderr, "网络库测试用例: test_tcp_nagle_dirty \n");
+    const uint32_t conn_num = 2000;
+    const uint32_t active_num = 20;
+    auto [load, echoed] = RunTcpNagleDirty(conn_num, active_num, 9717);
+    fprintf(stderr, "[模拟Nagle] %u 个连接中 %u 个活跃, 定时刷新遍历 socket:%llu 有数据收发:%llu\n", conn_num, active_num,
+            (unsigned long long)load.nagle_scanned, (unsigned long long)load.nagle_flushed);
+    if (0 == echoed)
+    {
+        SetError("模拟 Nagle 回显数据不完整.");
+    }
+    else if (0 == load.nagle_flushed || load.nagle_scanned > load.nagle_flushed * 2)
+    {
+        SetError("模拟 Nagle 定时刷新遍历了没有数据的 socket.");
+    }
+    // 按全部连接遍历时每次定时刷新至少遍历 conn_num 个,这里平均每次远小于 conn_num
+    else if (load.nagle_scanned > uint64_t(active_num) * 2 * 1000)
+    {
+        SetError("模拟 Nagle 定时刷新的遍历数与空闲连接数有关.");
+    }
+}
+
+CASE(test_tcp_metrics)
+{
+    /*
+    * 指标快照: 网络线程的收发消息数、系统调用与唤醒次数;
+    * 不读取数据的原始套接字客户端,服务器侧连接的待发送字节与积压时长持续增长,可据此找出消费慢的对端
+    */
+    fprintf(stderr, "网络库测试用例: test_tcp_metrics \n");
+    const uint16_t port = 9723;
+    const uint32_t ping_num = 100;
+    uint64_t server_conn_id = 0;
+    uint32_t pings = 0;
+    ToolBox::Network network_server;
+    network_server.SetOnAccepted([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id)
+    {
+        server_conn_id = conn_id;
+    });
+    network_server.SetOnReceived([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, const char* data, size_t size)
+    {
+        pings++;
+    });
+    network_server.Start(1);
+    network_server.Accept(ToolBox::NT_TCP, port, "127.0.0.1", port, 4 * 1024 * 1024, 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int32_t rcv_size = 4096;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcv_size, sizeof(rcv_size));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (0 != connect(fd, (sockaddr*)&addr, sizeof(addr)))
+    {
+        SetError("连接失败.");
+    }
+    for (uint32_t i = 0; i < 1000 && 0 == server_conn_id; i++)
+    {
+        network_server.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    // 客户端发送 ping_num 条消息
+    char frame[sizeof(uint32_t) + 8];
+    uint32_t frame_len = 8;
+    memcpy(frame, &frame_len, sizeof(frame_len));
+    memset(frame + sizeof(uint32_t), 'p', frame_len);
+    for (uint32_t i = 0; i < ping_num && 0 != server_conn_id; i++)
+    {
+        send(fd, frame, sizeof(frame), 0);
+    }
+    for (uint32_t i = 0; i < 1000 && pings < ping_num; i++)
+    {
+        network_server.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    // 服务器发送远超内核缓冲区的数据[回环上约数百K],对端不读取,剩余部分积压在连接的发送缓冲区
+    std::vector<char> chunk(16 * 1024, 'm');
+    ToolBox::NetConnMetrics conn;
+    auto find_conn = [&](const ToolBox::NetMetricsSnapshot & snapshot)
+    {
+        for (auto& conn_metrics : snapshot.connections)
+        {
+            if (conn_metrics.conn_id == server_conn_id)
+            {
+                conn = conn_metrics;
+                return true;
+            }
+        }
+        return false;
+    };
+    for (uint32_t i = 0; i < 128 && 0 != server_conn_id; i++)
+    {
+        network_server.Send(server_conn_id, chunk.data(), static_cast<uint32_t>(chunk.size()));
+        network_server.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    // 积压一段时间后再取一次
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    network_server.GetMetricsSnapshot(true);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    auto snapshot = network_server.GetMetricsSnapshot(true);
+    bool found = find_conn(snapshot);
+    if (snapshot.workers.size() != 1)
+    {
+        SetError("网络线程指标数量错误.");
+    }
+    else
+    {
+        auto& worker = snapshot.workers[0];
+        fprintf(stderr, "[网络线程] 连接:%u, 收:%llu 条/%llu 字节, 发:%llu 条/%llu 字节, 接收系统调用:%llu, 发送系统调用:%llu, 唤醒:%llu 次, 每次唤醒 %.2f 个事件, 队列深度 %zu/%zu, 丢弃 %llu/%llu\n",
+                worker.connections, (unsigned long long)worker.recv_packets, (unsigned long long)worker.recv_bytes,
+                (unsigned long long)worker.send_packets, (unsigned long long)worker.send_bytes,
+                (unsigned long long)worker.recv_syscalls, (unsigned long long)worker.send_syscalls,
+                (unsigned long long)worker.wakeups, worker.events_per_wakeup, worker.to_main_depth, worker.to_worker_depth,
+                (unsigned long long)worker.to_main_dropped, (unsigned long long)worker.to_worker_dropped);
+        if (worker.recv_packets != ping_num || worker.send_packets == 0 || worker.wakeups == 0 || worker.events_per_wakeup <= 0)
+        {
+            SetError("网络线程指标错误.");
+        }
+    }
+    fprintf(stderr, "[连接] 找到:%d, 待发送 %llu/%llu 字节, 接收缓冲 %llu/%llu 字节, 积压 %llu ms, 最后接收 %lld, 最后发送 %lld\n", found,
+            (unsigned long long)conn.send_buffered, (unsigned long long)conn.send_capacity,
+            (unsigned long long)conn.recv_buffered, (unsigned long long)conn.recv_capacity,
+            (unsigned long long)conn.send_blocked_ms, (long long)conn.last_recv_ms, (long long)conn.last_send_ms);
+    if (!found || 0 == conn.send_buffered || 0 == conn.send_blocked_ms || 0 == conn.last_recv_ms || 0 == conn.last_send_ms)
+    {
+        SetError("连接指标错误.");
+    }
+    close(fd);
+    network_server.StopWait();
+}
+
+CASE(test_tcp_max_socket_count)
+{
+    /*
+    * 每个网络线程的 socket 数量上限可配置: 上限为 3 时监听器占 1 个,只能再接受 2 个连接
+    */
+    fprintf(stderr, "网络库测试用例: test_tcp_max_socket_count \n");
+    const uint32_t max_socket_count = 3;
+    const uint32_t client_num = 5;
+    uint32_t accepted = 0;
+    uint32_t connected = 0;
+    ToolBox::Network network_server;
+    ToolBox::Network network_client;
+    network_server.SetMaxSocketCount(max_socket_count);
+    network_server.SetOnAccepted([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id)
+    {
+        accepted++;
+    });
+    network_client.SetOnConnected([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id)
+    {
+        connected++;
+    });
+    network_server.Start(1);
+    network_client.Start(1);
+    network_server.Accept(ToolBox::NT_TCP, 9730, "127.0.0.1", 9730);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    for (uint32_t i = 0; i < client_num; i++)
+    {
+        network_client.Connect(ToolBox::NT_TCP, 9730, "127.0.0.1", 9730);
+    }
+    for (uint32_t i = 0; i < 2000 && (connected < client_num || accepted < max_socket_count - 1); i++)
+    {
+        network_server.Update();
+        network_client.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    // 超出上限的连接不会被接受
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        network_server.Update();
+        network_client.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    fprintf(stderr, "上限:%u 接受连接数:%u 发起连接数:%u\n", max_socket_count, accepted, connected);
+    if (accepted != max_socket_count - 1)
+    {
+        SetError("socket 数量上限没有生效.");
+    }
+    network_client.StopWait();
+    network_server.StopWait();
+}
+
 FIXTURE_END(TcpNetwork)
\ No newline at end of file
@@ -0,0 +1,153 @@
+#include "tools/thread_pool_work_stealing.h"
+#include "tools/thread_pool.h"
+#include "unit_test_frame/unittest.h"
+#include <array>
+#include <chrono>
+#include <numeric>
+#include <vector>
+
+FIXTURE_BEGIN(TestThreadPoolWorkStealing)
+
+CASE(TestThreadPoolWorkStealingPostAdd)
+{
+    /*
+    * 测试 Post 与 Add: 任务全部执行,future 取得结果,超过就地存放大小的任务同样可用
+    */
+    ToolBox::ThreadPoolWorkStealing thread_pool(4);
+    std::atomic<int32_t> counter = 0;
+    const int32_t count = 100000;
+    for (int32_t i = 0; i < count; i++)
+    {
+        thread_pool.Post([&counter] { counter.fetch_add(1, std::memory_order_relaxed); });
+    }
+    std::vector<std::future<int32_t>> v_future;
+    for (int32_t i = 0; i < 10; i++)
+    {
+        v_future.emplace_back(thread_pool.Add([](int32_t answer)->int32_t { return answer * 2; }, i));
+    }
+    std::array<int64_t, 32> big = {};
+    big[31] = 7;
+    auto big_future = thread_pool.Add([big] { return big[31]; });
+    for (int32_t i = 0; i < 10; i++)
+    {
+        if (v_future[i].get() != i * 2)
+        {
+            SetError("ThreadPoolWorkStealing Add 结果错误.");
+        }
+    }
+    if (7 != big_future.get())
+    {
+        SetError("ThreadPoolWorkStealing 大任务结果错误.");
+    }
+    while (counter.load() < count)
+    {
+        std::this_thread::yield();
+    }
+}
+
+/*
+* fork-join 求和: 左半部分作为任务提交,右半部分就地计算,等待时帮忙执行其他任务
+*/
+static uint64_t ParallelSum(ToolBox::ThreadPoolWorkStealing& pool, const uint64_t* data, std::size_t size, std::size_t grain)
+{
+    if (size <= grain)
+    {
+        return std::accumulate(data, data + size, uint64_t(0));
+    }
+    std::atomic<bool> done = false;
+    uint64_t left = 0;
+    pool.Post([&]
+    {
+        left = ParallelSum(pool, data, size / 2, grain);
+        done.store(true, std::memory_order_release);
+    });
+    uint64_t right = ParallelSum(pool, data + size / 2, size - size / 2, grain);
+    while (!done.load(std::memory_order_acquire))
+    {
+        if (!pool.RunPendingTask())
+        {
+            std::this_thread::yield();
+        }
+    }
+    return left + right;
+}
+
+CASE(TestThreadPoolWorkStealingForkJoin)
+{
+    /*
+    * 测试 fork-join: 任务在工作线程中递归提交子任务并等待
+    */
+    std::vector<uint64_t> data(1 << 20);
+    std::iota(data.begin(), data.end(), uint64_t(1));
+    uint64_t expect = uint64_t(data.size()) * (data.size() + 1) / 2;
+    ToolBox::ThreadPoolWorkStealing thread_pool(4);
+    uint64_t sum = thread_pool.Add([&] { return ParallelSum(thread_pool, data.data(), data.size(), 1024); }).get();
+    if (sum != expect)
+    {
+        SetError("ThreadPoolWorkStealing fork-join 结果错误.");
+    }
+}
+
+CASE(TestThreadPoolWorkStealingBenchmark)
+{
+    /*
+    * 线程数从 1 增加到硬件线程数[至少 2]的扩展性: 外部提交的微小任务、工作线程内 fork-join,
+    * 以及原 ThreadPool 提交微小任务的对比
+    */
+    const int32_t tiny_count = 1000000;
+    const int32_t old_count = 200000;
+    std::vector<uint64_t> data(1 << 24);
+    std::iota(data.begin(), data.end(), uint64_t(1));
+    uint64_t expect = uint64_t(data.size()) * (data.size() + 1) / 2;
+    int32_t max_threads = (std::max)(2, int32_t(std::thread::hardware_concurrency()));
+    for (int32_t threads = 1; threads <= max_threads; threads *= 2)
+    {
+        double tiny_mops = 0;
+        double fork_join_ms = 0;
+        {
+            ToolBox::ThreadPoolWorkStealing thread_pool(threads);
+            std::atomic<int32_t> counter = 0;
+            auto begin = std::chrono::steady_clock::now();
+            for (int32_t i = 0; i < tiny_count; i++)
+            {
+                thread_pool.Post([&counter] { counter.fetch_add(1, std::memory_order_relaxed); });
+            }
+            while (counter.load(std::memory_order_relaxed) < tiny_count)
+            {
+                std::this_thread::yield();
+            }
+            auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+            tiny_mops = us > 0 ? double(tiny_count) / double(us) : 0;
+
+            begin = std::chrono::steady_clock::now();
+            uint64_t sum = thread_pool.Add([&] { return ParallelSum(thread_pool, data.data(), data.size(), 4096); }).get();
+            fork_join_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+            if (sum != expect)
+            {
+                SetError("ThreadPoolWorkStealing fork-join 结果错误.");
+            }
+        }
+        double old_mops = 0;
+        {
+            ToolBox::ThreadPool thread_pool(threads);
+            std::atomic<int32_t> counter = 0;
+            std::vector<std::future<void>> futures;
+            futures.reserve(old_count);
+            auto begin = std::chrono::steady_clock::now();
+            for (int32_t i = 0; i < old_count; i++)
+            {
+                futures.emplace_back(thread_pool.Add([&counter] { counter.fetch_add(1, std::memory_order_relaxed); }));
+            }
+            for (auto& future : futures)
+            {
+                future.get();
+            }
+            auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+            old_mops = us > 0 ? double(old_count) / double(us) : 0;
+        }
+        fprintf(stderr, "[%d 线程] 微小任务: 工作窃取 %.2f M/s, 原线程池 %.2f M/s; fork-join 求和 %zu 个数: %.1f ms\n",
+                threads, tiny_mops, old_mops, data.size(), fork_join_ms);
+    }
+}
+
+FIXTURE_END(TestThreadPoolWorkStealing)
@@ -1,5 +1,9 @@
 #include "src/network/network_channel.h"
+#include "network/network_api.h"
 #include "unit_test_frame/unittest.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
 #ifdef USE_GPERF_TOOLS
 #include <gperftools/profiler.h>
 #endif // USE_GPERF_TOOLS
@@ -235,5 +239,174 @@ CASE(test_udp_forward)
     return;
 }
 
+/*
+* UDP 吞吐基准: 回环上单向灌包 1 秒,统计服务器每秒收到的数据报数量与客户端每个数据报的发送系统调用数
+* @param batch_size 批量收发的数据报数量,1 为逐个数据报 recvfrom/sendto
+* @param port 服务器端口
+*/
+static void RunUdpThroughput(uint32_t batch_size, uint16_t port, double& pps, double& syscalls_per_datagram)
+{
+    const uint32_t datagram_size = 64;
+    const uint32_t burst = 256;
+    std::atomic<uint64_t> received = 0;
+    bool connected = false;
+    uint64_t client_conn_id = 0;
+    ToolBox::Network network_server;
+    ToolBox::Network network_client;
+    network_server.SetOnReceived([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, const char* data, size_t size)
+    {
+        received.fetch_add(1, std::memory_order_relaxed);
+    });
+    network_client.SetOnConnected([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id)
+    {
+        connected = true;
+        client_conn_id = conn_id;
+    });
+    // Start 之前设置,网络建立时沿用
+    network_server.SetUdpBatchSize(batch_size);
+    network_client.SetUdpBatchSize(batch_size);
+    network_server.Accept(ToolBox::NT_UDP, port, "127.0.0.1", port, 0, 8 * 1024 * 1024);
+    network_server.Start(1);
+    network_client.Start(1);
+    bool run = true;
+    std::thread server_thread([&]()
+    {
+        while (run)
+        {
+            network_server.Update();
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    network_client.Connect(ToolBox::NT_UDP, port, "127.0.0.1", port);
+    for (uint32_t i = 0; i < 1000 && !connected; i++)
+    {
+        network_client.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    char datagram[datagram_size];
+    memset(datagram, 'u', sizeof(datagram));
+    uint64_t sended = 0;
+    auto begin = std::chrono::steady_clock::now();
+    auto end = begin + std::chrono::seconds(1);
+    uint64_t received_begin = received.load();
+    while (connected && std::chrono::steady_clock::now() < end)
+    {
+        // 控制逻辑线程->网络线程队列的深度,避免事件队列溢出
+        if (0 == sended % (burst * 16) && network_client.GetEventQueueStats()[0].to_worker_depth > 8192)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        for (uint32_t i = 0; i < burst; i++)
+        {
+            network_client.Send(client_conn_id, datagram, sizeof(datagram));
+        }
+        sended += burst;
+        network_client.Update();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    pps = double(received.load() - received_begin) / seconds;
+    uint64_t send_syscalls = 0;
+    for (const auto& load : network_client.GetThreadLoadStats())
+    {
+        send_syscalls += load.send_syscalls;
+    }
+    syscalls_per_datagram = sended > 0 ? double(send_syscalls) / double(sended) : 0.0;
+    run = false;
+    server_thread.join();
+    network_client.StopWait();
+    network_server.StopWait();
+}
+
+CASE(test_udp_batch_throughput)
+{
+    /*
+    * 对比逐个数据报收发与 recvmmsg/sendmmsg 批量收发的吞吐
+    */
+    fprintf(stderr, "网络库测试用例: test_udp_batch_throughput \n");
+    double single_pps = 0.0;
+    double single_syscalls = 0.0;
+    double batch_pps = 0.0;
+    double batch_syscalls = 0.0;
+    RunUdpThroughput(1, 9710, single_pps, single_syscalls);
+    RunUdpThroughput(ToolBox::NETWORK_UDP_BATCH_SIZE, 9711, batch_pps, batch_syscalls);
+    fprintf(stderr, "[逐个收发] 每秒收包:%.0f 每个数据报发送系统调用数:%.3f\n", single_pps, single_syscalls);
+    fprintf(stderr, "[批量收发 %u] 每秒收包:%.0f 每个数据报发送系统调用数:%.3f\n", ToolBox::NETWORK_UDP_BATCH_SIZE, batch_pps, batch_syscalls);
+    if (single_pps <= 0.0 || batch_pps <= 0.0)
+    {
+        SetError("UDP 吞吐测试没有收到数据.");
+    }
+    if (batch_syscalls >= single_syscalls)
+    {
+        SetError("批量发送没有减少系统调用.");
+    }
+}
+
+CASE(test_udp_batch_truncated)
+{
+    /*
+    * 批量接收预留的数据报大小不足时,超长数据报被丢弃并回调错误,之后预留加倍直到能收下
+    */
+    fprintf(stderr, "网络库测试用例: test_udp_batch_truncated \n");
+    const uint16_t port = 9712;
+    const uint32_t datagram_size = 1200;
+    std::atomic<uint64_t> received = 0;
+    std::atomic<uint64_t> truncated = 0;
+    std::atomic<std::size_t> received_size = 0;
+    bool connected = false;
+    uint64_t client_conn_id = 0;
+    ToolBox::Network network_server;
+    ToolBox::Network network_client;
+    network_server.SetOnReceived([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, const char* data, size_t size)
+    {
+        received_size = size;
+        received.fetch_add(1);
+    }).SetOnErrored([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id, ToolBox::ENetErrCode err_code, int32_t err_no)
+    {
+        if (ToolBox::ENetErrCode::NET_RECV_BUFF_OVERFLOW == err_code)
+        {
+            truncated.fetch_add(1);
+        }
+    });
+    network_client.SetOnConnected([&](ToolBox::NetworkType type, uint64_t opaque, uint64_t conn_id)
+    {
+        connected = true;
+        client_conn_id = conn_id;
+    });
+    // 每个数据报只预留 64 字节
+    network_server.SetUdpBatchSize(ToolBox::NETWORK_UDP_BATCH_SIZE, 64);
+    network_server.Accept(ToolBox::NT_UDP, port, "127.0.0.1", port);
+    network_server.Start(1);
+    network_client.Start(1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    network_client.Connect(ToolBox::NT_UDP, port, "127.0.0.1", port);
+    for (uint32_t i = 0; i < 1000 && !connected; i++)
+    {
+        network_client.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    char datagram[datagram_size];
+    memset(datagram, 't', sizeof(datagram));
+    for (uint32_t i = 0; i < 100 && connected && 0 == received.load(); i++)
+    {
+        network_client.Send(client_conn_id, datagram, sizeof(datagram));
+        network_client.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        network_server.Update();
+    }
+    fprintf(stderr, "截断丢弃:%llu 收到:%llu 长度:%zu\n", (unsigned long long)truncated.load(), (unsigned long long)received.load(), received_size.load());
+    if (0 == truncated.load())
+    {
+        SetError("超长数据报没有回调截断错误.");
+    }
+    if (0 == received.load() || received_size.load() < datagram_size)
+    {
+        SetError("预留加倍后没有收到完整的数据报.");
+    }
+    network_client.StopWait();
+    network_server.StopWait();
+}
+
 FIXTURE_END(UdpEpollNetwork)
 